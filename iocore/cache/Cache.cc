@@ -1925,7 +1925,14 @@ static void unmarshal_helper(Doc *doc, Ptr<IOBufferData> &buf, int &okay) {
   while (len > 0) {
     int r = HTTPInfo::unmarshal(tmp, len, buf._ptr());
     if (r < 0) {
-      ink_assert(!"CacheVC::handleReadDone unmarshal failed");
+      // a header that fails its checksum is a miss, like a bad doc checksum
+      if (((HTTPCacheAlt *) tmp)->m_magic == CACHE_ALT_MAGIC_DEAD) {
+        Note("cache: header checksum error for [%" PRIu64 " %" PRIu64 "] len %d, hlen %d",
+             doc->first_key.b[0], doc->first_key.b[1], doc->len, doc->hlen);
+        doc->magic = DOC_CORRUPT;
+      } else {
+        ink_assert(!"CacheVC::handleReadDone unmarshal failed");
+      }
       okay = 0;
       break;
     }
@@ -2820,6 +2827,8 @@ ink_cache_init(ModuleVersion v)
   REC_EstablishStaticConfigInt32(url_hash_method, "proxy.config.cache.url_hash_method");
   Debug("cache_init", "proxy.config.cache.url_hash_method = %d", url_hash_method);
   REC_EstablishStaticConfigInt32(enable_cache_empty_http_doc, "proxy.config.http.cache.allow_empty_doc");
+  REC_EstablishStaticConfigInt32(hdr_heap_enable_checksum, "proxy.config.cache.enable_header_checksum");
+  Debug("cache_init", "proxy.config.cache.enable_header_checksum = %d", hdr_heap_enable_checksum);
 #endif
 
   REC_EstablishStaticConfigInt32(cache_config_max_disk_errors, "proxy.config.cache.max_disk_errors");
@@ -113,7 +113,7 @@ OpenDir::signal_readers(int event, Event *e)
   while ((c = delayed_readers.dequeue())) {
     CACHE_TRY_LOCK(lock, c->mutex, t);
     if (lock) {
-      c->f.open_read_timeout = 0;
+      c->f.waiting_for_writer = 0;
       c->handleEvent(EVENT_IMMEDIATE, 0);
       continue;
     }
@@ -143,11 +143,51 @@ OpenDir::close_write(CacheVC *cont)
     signal_readers(0, 0);
     cont->od->vector.clear();
     THREAD_FREE(cont->od, openDirEntryAllocator, cont->mutex->thread_holding);
+  } else {
+    // readers may have been waiting on this particular writer
+    wake_readers(cont->od);
   }
   cont->od = NULL;
   return 0;
 }
 
+/*
+   Hand the readers waiting on d to signal_readers.  Called by a writer
+   under the vol lock when it makes progress; the readers are called
+   back from the event loop rather than from the writer's stack.
+   */
+void
+OpenDir::wake_readers(OpenDirEntry *d)
+{
+  ink_assert(mutex->thread_holding == this_ethread());
+  if (!d->readers.head)
+    return;
+  delayed_readers.append(d->readers);
+  d->readers.clear();
+  mutex->thread_holding->schedule_imm(this);
+}
+
+/*
+   Take a reader which is being closed off whichever list it is waiting
+   on: its entry's readers or, if the wakeup could not get the reader's
+   lock yet, delayed_readers.  Must be called under the vol lock.
+   */
+void
+OpenDir::cancel_wait(CacheVC *c)
+{
+  ink_assert(mutex->thread_holding == this_ethread());
+  OpenDirEntry *d = open_read(&c->first_key);
+  CacheVC *r = d ? d->readers.head : NULL;
+
+  while (r && r != c)
+    r = (CacheVC *) r->opendir_link.next;
+  if (r)
+    d->readers.remove(c);
+  else
+    delayed_readers.remove(c);
+  c->f.waiting_for_writer = 0;
+}
+
 OpenDirEntry *
 OpenDir::open_read(INK_MD5 *key)
 {
@@ -159,14 +199,20 @@ OpenDir::open_read(INK_MD5 *key)
   return NULL;
 }
 
+/*
+   Park a reader until one of the writers writes a fragment or closes.
+   A reader which is already waiting (woken early by a reenable) keeps
+   its place.
+   */
 int
-OpenDirEntry::wait(CacheVC *cont, int msec)
+OpenDirEntry::wait(CacheVC *cont)
 {
   ink_assert(cont->vol->mutex->thread_holding == this_ethread());
-  cont->f.open_read_timeout = 1;
   ink_assert(!cont->trigger);
-  cont->trigger = cont->vol->mutex->thread_holding->schedule_in_local(cont, HRTIME_MSECONDS(msec));
-  readers.push(cont);
+  if (!cont->f.waiting_for_writer) {
+    cont->f.waiting_for_writer = 1;
+    readers.push(cont);
+  }
   return EVENT_CONT;
 }
 
@@ -1447,3 +1493,143 @@ EXCLUSIVE_REGRESSION_TEST(Cache_dir) (RegressionTest *t, int atype, int *status)
   vol_dir_clear(d);
   *status = ret;
 }
+
+// A reader parked on a writer; counts the wake ups it gets
+struct CollapseTestVC: public CacheVC
+{
+  int woken;
+
+  int handle_wake(int event, void *data)
+  {
+    NOWARN_UNUSED(event);
+    NOWARN_UNUSED(data);
+    woken++;
+    return EVENT_DONE;
+  }
+
+  CollapseTestVC(ProxyMutex *m, Vol *v, CacheKey *key): woken(0)
+  {
+    mutex = m;
+    vol = v;
+    first_key = *key;
+    SET_HANDLER(&CollapseTestVC::handle_wake);
+  }
+};
+
+/*
+   Readers collapsed onto a writer park on its OpenDirEntry.  A reader
+   that parks twice keeps one place, a closed reader is cancelled off the
+   list, writer progress wakes the rest through the event loop, and the
+   last writer leaving wakes whoever parked again.
+   */
+struct CollapseTest: public Continuation
+{
+  RegressionTest *test;
+  int *status;
+  Vol *vol;
+  CacheKey key;
+  CollapseTestVC *writer;
+  CollapseTestVC *readers[3];
+  int checks;
+
+  int count_readers(OpenDirEntry *od)
+  {
+    int n = 0;
+    for (CacheVC *c = od->readers.head; c; c = (CacheVC *) c->opendir_link.next)
+      n++;
+    return n;
+  }
+
+  void check(bool ok, const char *what)
+  {
+    if (!ok) {
+      rprintf(test, "%s\n", what);
+      *status = REGRESSION_TEST_FAILED;
+    }
+  }
+
+  int start(int event, void *data)
+  {
+    NOWARN_UNUSED(event);
+    NOWARN_UNUSED(data);
+    MUTEX_TRY_LOCK(lock, vol->mutex, mutex->thread_holding);
+    if (!lock) {
+      mutex->thread_holding->schedule_in(this, HRTIME_MSECONDS(cache_config_mutex_retry_delay));
+      return EVENT_CONT;
+    }
+
+    check(vol->open_dir.open_write(writer, false, 1) == 1, "writer did not get the write lock");
+    OpenDirEntry *od = vol->open_read(&key);
+    check(od == writer->od, "writer's entry not found");
+    for (int i = 0; i < 3; i++)
+      od->wait(readers[i]);
+    od->wait(readers[0]);
+    check(count_readers(od) == 3, "a reader parked twice took two places");
+
+    vol->open_dir.cancel_wait(readers[2]);
+    check(!readers[2]->f.waiting_for_writer && count_readers(od) == 2, "closed reader still parked");
+
+    // The writer wrote a fragment; its readers run from the event loop
+    vol->open_dir.wake_readers(od);
+    check(count_readers(od) == 0, "woken readers still on the entry");
+    check(readers[0]->woken == 0, "reader woken on the writer's stack");
+
+    SET_HANDLER(&CollapseTest::woken);
+    mutex->thread_holding->schedule_in(this, HRTIME_MSECONDS(10));
+    return EVENT_DONE;
+  }
+
+  int woken(int event, void *data)
+  {
+    NOWARN_UNUSED(event);
+    NOWARN_UNUSED(data);
+    if (readers[0]->woken + readers[1]->woken < 2 && ++checks < 100) {
+      mutex->thread_holding->schedule_in(this, HRTIME_MSECONDS(10));
+      return EVENT_CONT;
+    }
+    check(readers[0]->woken == 1 && readers[1]->woken == 1, "parked readers not woken once each");
+    check(readers[2]->woken == 0, "cancelled reader woken");
+
+    MUTEX_TRY_LOCK(lock, vol->mutex, mutex->thread_holding);
+    if (!lock) {
+      mutex->thread_holding->schedule_in(this, HRTIME_MSECONDS(cache_config_mutex_retry_delay));
+      return EVENT_CONT;
+    }
+    // A reader that caught up parks again and goes with the last writer
+    writer->od->wait(readers[0]);
+    vol->open_dir.close_write(writer);
+    check(vol->open_read(&key) == NULL, "entry outlived its last writer");
+    check(readers[0]->woken == 2 && !readers[0]->f.waiting_for_writer, "reader not woken by the closing writer");
+    MUTEX_RELEASE(lock);
+
+    if (*status == REGRESSION_TEST_INPROGRESS)
+      *status = REGRESSION_TEST_PASSED;
+    test->status = *status;
+    delete writer;
+    for (int i = 0; i < 3; i++)
+      delete readers[i];
+    delete this;
+    return EVENT_DONE;
+  }
+
+  CollapseTest(RegressionTest *t, int *s, Vol *v)
+    : Continuation(new_ProxyMutex()), test(t), status(s), vol(v), checks(0)
+  {
+    regress_rand_CacheKey(&key);
+    writer = new CollapseTestVC(mutex, vol, &key);
+    for (int i = 0; i < 3; i++)
+      readers[i] = new CollapseTestVC(mutex, vol, &key);
+    SET_HANDLER(&CollapseTest::start);
+  }
+};
+
+EXCLUSIVE_REGRESSION_TEST(Cache_collapse) (RegressionTest *t, int atype, int *status) {
+  NOWARN_UNUSED(atype);
+  if ((CacheProcessor::IsCacheEnabled() != CACHE_INITIALIZED) || gnvol < 1) {
+    rprintf(t, "cache not ready/configured");
+    *status = REGRESSION_TEST_FAILED;
+    return;
+  }
+  *status = REGRESSION_TEST_INPROGRESS;
+  eventProcessor.schedule_imm(new CollapseTest(t, status, gvol[0]), ET_CALL);
+}
@@ -205,6 +205,11 @@ CacheVC::openReadChooseWriter(int event, Event * e)
     for (w = (CacheVC *) od->writers.head; w; w = (CacheVC *) w->opendir_link.next) {
       if (w->start_time > start_time || w->closed < 0)
         continue;
+      // An update which has not set its new alternate yet (a
+      // revalidation still waiting on the origin) leaves the old one
+      // in place, so read that instead of failing or waiting.
+      if (w->f.update && !w->closed && !w->alternate.valid())
+        continue;
       if (!w->closed && !cache_config_read_while_writer) {
         return -err;
       }
@@ -323,7 +328,7 @@ CacheVC::openReadFromWriter(int event, Event * e)
       return openReadStartHead(event, e);
     } else if (ret == EVENT_CONT) {
       ink_assert(!write_vc);
-      VC_SCHED_WRITER_RETRY();
+      VC_WAIT_FOR_WRITER(vol->open_read(&first_key));
     } else
       ink_assert(write_vc);
   } else {
@@ -359,7 +364,7 @@ CacheVC::openReadFromWriter(int event, Event * e)
     DDebug("cache_read_agg",
           "%p: key: %X writer: closed:%d, fragment:%d, retry: %d",
           this, first_key.word(1), write_vc->closed, write_vc->fragment, writer_lock_retry);
-    VC_SCHED_WRITER_RETRY();
+    VC_WAIT_FOR_WRITER(vol->open_read(&first_key));
   }
 
   CACHE_TRY_LOCK(writer_lock, write_vc->mutex, mutex->thread_holding);
@@ -519,6 +524,8 @@ CacheVC::openReadClose(int event, Event * e)
   CACHE_TRY_LOCK(lock, vol->mutex, mutex->thread_holding);
   if (!lock)
     VC_SCHED_LOCK_RETRY();
+  if (f.waiting_for_writer)
+    vol->open_dir.cancel_wait(this);
 #ifdef HIT_EVACUATE
   if (f.hit_evacuate && dir_valid(vol, &first_dir) && closed > 0) {
     if (f.single_fragment)
@@ -753,9 +760,9 @@ Lread: {
               this, first_key.word(1), (int)vio.ndone);
         goto Lerror;
       }
-      DDebug("cache_read_agg", "%p: key: %X ReadMain retrying: %d", this, first_key.word(1), (int)vio.ndone);
+      DDebug("cache_read_agg", "%p: key: %X ReadMain waiting: %d", this, first_key.word(1), (int)vio.ndone);
       SET_HANDLER(&CacheVC::openReadMain);
-      VC_SCHED_WRITER_RETRY();
+      VC_WAIT_FOR_WRITER(vol->open_read(&first_key));
     }
     if (is_action_tag_set("cache"))
       ink_release_assert(false);
@@ -245,7 +245,7 @@ CacheVC::scanObject(int event, Event * e)
       while (len > 0) {
         int r = HTTPInfo::unmarshal(tmp, len, buf._ptr());
         if (r < 0) {
-          ink_assert(!"CacheVC::scanObject unmarshal failed");
+          ink_assert(((HTTPCacheAlt *) tmp)->m_magic == CACHE_ALT_MAGIC_DEAD || !"CacheVC::scanObject unmarshal failed");
           goto Lskip;
         }
         len -= r;
@@ -1320,6 +1320,9 @@ CacheVC::openWriteWriteDone(int event, Event *e)
     DDebug("cache_insert", "WriteDone: %X, %X, %d", key.word(0), first_key.word(0), write_len);
     blocks = iobufferblock_skip(blocks, &offset, &length, write_len);
     next_CacheKey(&key, &key);
+    // the new fragment is readable, let waiting readers at it
+    if (od)
+      vol->open_dir.wake_readers(od);
   }
   if (closed)
     return die();
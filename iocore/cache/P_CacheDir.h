@@ -222,7 +222,7 @@ LINK_FORWARD_DECLARATION(CacheVC, opendir_link) // forward declaration
 struct OpenDirEntry
 {
   DLL<CacheVC, Link_CacheVC_opendir_link> writers;       // list of all the current writers
-  DLL<CacheVC, Link_CacheVC_opendir_link> readers;         // list of all the current readers - not used
+  DLL<CacheVC, Link_CacheVC_opendir_link> readers;         // readers waiting for the writers to make progress
   CacheHTTPInfoVector vector;   // Vector for the http document. Each writer
                                 // maintains a pointer to this vector and
                                 // writes it down to disk.
@@ -239,7 +239,7 @@ struct OpenDirEntry
 
   LINK(OpenDirEntry, link);
 
-  int wait(CacheVC *c, int msec);
+  int wait(CacheVC *c);
 
   bool has_multiple_writers()
   {
@@ -256,6 +256,8 @@ struct OpenDir: public Continuation
   int close_write(CacheVC *c);
   OpenDirEntry *open_read(INK_MD5 *key);
   int signal_readers(int event, Event *e);
+  void wake_readers(OpenDirEntry *d);
+  void cancel_wait(CacheVC *c);
 
   OpenDir();
 };
@@ -110,6 +110,17 @@ struct EvacuationBlock;
     return EVENT_CONT; \
   } while (0)
 
+// Park a reader on the open directory entry until the writer makes
+// progress (writes a fragment or closes).  Falls back to polling if the
+// writer has already left.
+#define VC_WAIT_FOR_WRITER(_od) \
+  do { \
+    OpenDirEntry *_wait_od = (_od); \
+    if (!_wait_od) \
+      VC_SCHED_WRITER_RETRY(); \
+    return _wait_od->wait(this); \
+  } while (0)
+
 
   // cache stats definitions
 enum
@@ -475,7 +486,7 @@ struct CacheVC: public CacheVConnection
       unsigned int update:1;
       unsigned int remove:1;
       unsigned int remove_aborted_writers:1;
-      unsigned int open_read_timeout:1; // UNUSED
+      unsigned int waiting_for_writer:1; // parked on an OpenDirEntry's readers
       unsigned int data_done:1;
       unsigned int read_from_writer_called:1;
       unsigned int not_from_ram_cache:1;        // entire object was from ram cache
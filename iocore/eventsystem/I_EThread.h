@@ -34,6 +34,9 @@
 // TODO: This would be much nicer to have "run-time" configurable (or something),
 // perhaps based on proxy.config.stat_api.max_stats_allowed or other configs. XXX
 #define PER_THREAD_DATA (1024*1024)
+// EThreads start on a cache line, so that aligned thread private data is
+// aligned in every thread
+#define ETHREAD_ALIGNMENT 64
 
 // This is not used by the cache anymore, it uses proxy.config.cache.mutex_retry_delay
 // instead.
@@ -293,6 +296,9 @@ public:
   EThread(ThreadType att, Event *e, ink_sem *sem);
   virtual ~EThread();
 
+  static void *operator new(size_t size) { return ats_memalign(ETHREAD_ALIGNMENT, size); }
+  static void operator delete(void *p) { ats_memalign_free(p); }
+
   Event *schedule_spawn(Continuation *cont);
   Event *schedule(Event *e, bool fast_signal = false);
 
@@ -260,9 +260,11 @@ public:
     safe.
 
     @param size bytes to be allocated.
+    @param alignment of the allocation, a power of two up to
+      ETHREAD_ALIGNMENT.
 
   */
-  off_t allocate(int size);
+  off_t allocate(int size, int alignment = 16);
 
   /**
     An array of pointers to all of the EThreads handled by the
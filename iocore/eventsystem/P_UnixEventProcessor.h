@@ -42,20 +42,23 @@ thread_data_used(0)
 }
 
 TS_INLINE off_t
-EventProcessor::allocate(int size)
+EventProcessor::allocate(int size, int alignment)
 {
   static off_t start = INK_ALIGN(offsetof(EThread, thread_private), 16);
   static off_t loss = start - offsetof(EThread, thread_private);
   size = INK_ALIGN(size, 16);       // 16 byte alignment
 
-  int old;
+  ink_assert(alignment <= ETHREAD_ALIGNMENT && (alignment & (alignment - 1)) == 0);
+  int old, offset;
   do {
     old = thread_data_used;
-    if (old + loss + size > PER_THREAD_DATA)
+    // skip ahead to the next aligned offset from the start of the EThread
+    offset = (int) (INK_ALIGN(start + old, alignment) - start);
+    if (offset + loss + size > PER_THREAD_DATA)
       return -1;
-  } while (!ink_atomic_cas(&thread_data_used, old, old + size));
+  } while (!ink_atomic_cas(&thread_data_used, old, offset + size));
 
-  return (off_t) (old + start);
+  return (off_t) (offset + start);
 }
 
 TS_INLINE EThread *
@@ -108,6 +108,17 @@ int RecGetRecordCounter(const char *name, RecCounter * rec_counter, bool lock =
 // Convenience to allow us to treat the RecInt as a single byte internally
 int RecGetRecordByte(const char *name, RecByte * rec_byte, bool lock = true);
 
+// Name lookups take no lock, so the getters above ignore 'lock'.  Code
+// reading a record often can resolve its name once; a handle stays valid
+// for the life of the process, whether or not the record is registered
+// yet, and the int, float and counter reads through it take no lock.
+RecRecordHandle RecGetRecordHandle(const char *name);
+int RecGetHandleInt(RecRecordHandle handle, RecInt * rec_int);
+int RecGetHandleFloat(RecRecordHandle handle, RecFloat * rec_float);
+int RecGetHandleCounter(RecRecordHandle handle, RecCounter * rec_counter);
+int RecGetHandleString(RecRecordHandle handle, char *buf, int buf_len);
+int RecGetHandleString_Xmalloc(RecRecordHandle handle, RecString * rec_string);
+
 //------------------------------------------------------------------------
 // Record Attributes Reading
 //------------------------------------------------------------------------
@@ -133,6 +133,13 @@ union RecData
 };
 
 
+//-------------------------------------------------------------------------
+// Record Handle
+//-------------------------------------------------------------------------
+struct RecRecord;
+typedef RecRecord *RecRecordHandle;
+
+
 //-------------------------------------------------------------------------
 // RawStat Structures
 //-------------------------------------------------------------------------
@@ -148,6 +155,31 @@ struct RecRawStat
   uint32_t version;
 };
 
+// The thread local half of a RecRawStat.  A block's are packed in each
+// thread, so a sync adds up a whole block with one pass per thread.
+struct RecRawStatLocal
+{
+  int64_t sum;
+  int64_t count;
+};
+
+
+//-------------------------------------------------------------------------
+// RawStat Histograms
+//-------------------------------------------------------------------------
+// Log-linear buckets, after HDR histograms: values below
+// 2^(REC_HIST_SUB_BITS + 1) get a bucket each, and every power of two
+// above that is split into REC_HIST_SUB_BUCKETS, so a bucket is never
+// wider than 1/16th of the values in it.  Values are clamped to 32 bits.
+#define REC_HIST_SUB_BITS     4
+#define REC_HIST_SUB_BUCKETS  (1 << REC_HIST_SUB_BITS)
+#define REC_HIST_MAX_VALUE    ((int64_t) 0xffffffff)
+#define REC_HIST_BUCKETS      ((32 - REC_HIST_SUB_BITS + 1) << REC_HIST_SUB_BITS)
+
+// Each histogram is published as the records <name>.count, .p50, .p90,
+// .p99, .p999 and .max, backed by this many raw stats of its block.
+#define REC_HIST_STATS        6
+
 
 // WARNING!  It's advised that developers do not modify the contents of
 // the RecRawStatBlock.  ^_^
@@ -158,6 +190,11 @@ struct RecRawStatBlock
   int num_stats;            // number of stats in this block
   int max_stats;            // maximum number of stats for this block
   ink_mutex mutex;
+  int max_hists;            // histograms, whose raw stats follow max_stats
+  off_t ethr_hist_offset;   // thread local histogram buckets
+  int64_t *sync_totals;     // thread local sums and counts, added up at each sync
+  int64_t *sync_globals;    // global sums and counts as of the last sync
+  RecRawStatBlock *sync_next;
 };
 
 
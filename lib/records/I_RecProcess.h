@@ -45,19 +45,13 @@ void RecProcess_set_remote_sync_interval_ms(int ms);
 //-------------------------------------------------------------------------
 // RawStat Registration
 //-------------------------------------------------------------------------
-RecRawStatBlock *RecAllocateRawStatBlock(int num_stats);
+RecRawStatBlock *RecAllocateRawStatBlock(int num_stats, int num_hists = 0);
 int RecRegisterRawStat(RecRawStatBlock * rsb, RecT rec_type, const char *name, RecDataT data_type, RecPersistT persist_type, int id, RecRawStatSyncCb sync_cb);
 
-
-// RecRawStatRange* RecAllocateRawStatRange (int num_buckets);
-
-// int RecRegisterRawStatRange (RecRawStatRange *rsr,
-//                           RecT rec_type,
-//                           char *name,
-//                           RecPersistT persist_type,
-//                           int id,
-//                           RecInt min,
-//                           RecInt max);
+// Registers histogram hist_id of the block as the non-persistent
+// records <name>.count, <name>.p50, .p90, .p99, .p999 and .max, which
+// are worked out from the merged buckets at each raw stat sync.
+int RecRegisterRawHistogram(RecRawStatBlock * rsb, RecT rec_type, const char *name, int hist_id);
 
 
 //-------------------------------------------------------------------------
@@ -91,6 +85,13 @@ int RecSetRawStatBlock(RecRawStatBlock * rsb, RecRawStat * stat_array);
 int RecGetRawStatSum(RecRawStatBlock * rsb, int id, int64_t * data);
 int RecGetRawStatCount(RecRawStatBlock * rsb, int id, int64_t * data);
 
+// Records a value (e.g. a latency in usecs) in a histogram; as fast as
+// RecIncrRawStat, it only touches the calling thread's buckets.
+inline int RecRecordRawHistogram(RecRawStatBlock * rsb, EThread * ethread, int hist_id, int64_t value);
+// The value below which the given fraction (0 to 1) of the recorded
+// values fall, to within a bucket, merging the threads as it goes.
+int RecGetRawHistogramQuantile(RecRawStatBlock * rsb, int hist_id, double quantile, int64_t * data);
+
 
 //-------------------------------------------------------------------------
 // Global RawStat Items (e.g. same as above, but no thread-local behavior)
@@ -115,20 +116,20 @@ int64_t *RecGetGlobalRawStatCountPtr(RecRawStatBlock * rsb, int id);
 //-------------------------------------------------------------------------
 // inlined functions that are used very frequently.
 // FIXME: move it to Inline.cc
-inline RecRawStat *
+inline RecRawStatLocal *
 raw_stat_get_tlp(RecRawStatBlock * rsb, int id, EThread * ethread)
 {
   ink_assert((id >= 0) && (id < rsb->max_stats));
   if (ethread == NULL) {
     ethread = this_ethread();
   }
-  return (((RecRawStat *) ((char *) (ethread) + rsb->ethr_stat_offset)) + id);
+  return (((RecRawStatLocal *) ((char *) (ethread) + rsb->ethr_stat_offset)) + id);
 }
 
 inline int
 RecIncrRawStat(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatLocal *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->sum += incr;
   tlp->count += 1;
   return REC_ERR_OKAY;
@@ -137,7 +138,7 @@ RecIncrRawStat(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr)
 inline int
 RecDecrRawStat(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t decr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatLocal *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->sum -= decr;
   tlp->count += 1;
   return REC_ERR_OKAY;
@@ -146,7 +147,7 @@ RecDecrRawStat(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t decr)
 inline int
 RecIncrRawStatSum(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatLocal *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->sum += incr;
   return REC_ERR_OKAY;
 }
@@ -154,9 +155,53 @@ RecIncrRawStatSum(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr
 inline int
 RecIncrRawStatCount(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatLocal *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->count += incr;
   return REC_ERR_OKAY;
 }
 
+//-------------------------------------------------------------------------
+// RecRecordRawHistogram
+//-------------------------------------------------------------------------
+inline int
+rec_hist_bucket(int64_t value)
+{
+  if (value < 2 * REC_HIST_SUB_BUCKETS) {
+    return value < 0 ? 0 : (int) value;
+  }
+  if (value > REC_HIST_MAX_VALUE) {
+    value = REC_HIST_MAX_VALUE;
+  }
+
+  uint32_t v = (uint32_t) value;
+  int msb = 0;
+
+  if (v >> 16) { v >>= 16; msb += 16; }
+  if (v >> 8) { v >>= 8; msb += 8; }
+  if (v >> 4) { v >>= 4; msb += 4; }
+  if (v >> 2) { v >>= 2; msb += 2; }
+  if (v >> 1) { msb += 1; }
+
+  int shift = msb - REC_HIST_SUB_BITS;
+  return ((shift + 1) << REC_HIST_SUB_BITS) + (int) ((value >> shift) & (REC_HIST_SUB_BUCKETS - 1));
+}
+
+inline int
+RecRecordRawHistogram(RecRawStatBlock * rsb, EThread * ethread, int hist_id, int64_t value)
+{
+  ink_assert((hist_id >= 0) && (hist_id < rsb->max_hists));
+  if (ethread == NULL) {
+    ethread = this_ethread();
+  }
+
+  // the count and sum of the histogram are the first of its raw stats
+  RecRawStatLocal *tlp = ((RecRawStatLocal *) ((char *) (ethread) + rsb->ethr_stat_offset)) + rsb->max_stats + hist_id * REC_HIST_STATS;
+  int64_t *buckets = ((int64_t *) ((char *) (ethread) + rsb->ethr_hist_offset)) + hist_id * REC_HIST_BUCKETS;
+
+  tlp->sum += value;
+  tlp->count += 1;
+  buckets[rec_hist_bucket(value)] += 1;
+  return REC_ERR_OKAY;
+}
+
 #endif /* !_I_REC_PROCESS_H_ */
@@ -384,12 +384,12 @@ RecSetRecord(RecT rec_type, const char *name, RecDataT data_type, RecData *data,
   RecRecord *r1;
 
   // FIXME: Most of the time we set, we don't actually need to wrlock
-  // since we are not modifying the g_records_ht.
+  // since we are not modifying the record index.
   if (lock) {
     ink_rwlock_wrlock(&g_records_rwlock);
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r1)) {
+  if ((r1 = RecIndexLookup(name)) != NULL) {
     if (i_am_the_record_owner(r1->rec_type)) {
       rec_mutex_acquire(&(r1->lock));
       if ((data_type != RECD_NULL) && (r1->data_type != data_type)) {
@@ -466,7 +466,7 @@ RecSetRecord(RecT rec_type, const char *name, RecDataT data_type, RecData *data,
     } else {
       err = send_set_message(r1);
     }
-    ink_hash_table_insert(g_records_ht, name, (void *) r1);
+    RecIndexInsert(r1);
 
   }
 
@@ -815,7 +815,7 @@ RecSyncConfigToTB(textBuffer * tb)
           tb->copyFrom(cfe->entry, strlen(cfe->entry));
           tb->copyFrom("\n", 1);
         } else {
-          if (ink_hash_table_lookup(g_records_ht, cfe->entry, (void **) &r)) {
+          if ((r = RecIndexLookup(cfe->entry)) != NULL) {
             rec_mutex_acquire(&(r->lock));
             // rec_type
             switch (r->rec_type) {
@@ -933,7 +933,7 @@ RecResetStatRecord(const char *name)
   RecRecord *r1 = NULL;
   int err = REC_ERR_OKAY;
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r1)) {
+  if ((r1 = RecIndexLookup(name)) != NULL) {
     if (i_am_the_record_owner(r1->rec_type)) {
       rec_mutex_acquire(&(r1->lock));
       ++(r1->version);
@@ -1006,12 +1006,12 @@ RecSetSyncRequired(char *name, bool lock)
   RecRecord *r1;
 
   // FIXME: Most of the time we set, we don't actually need to wrlock
-  // since we are not modifying the g_records_ht.
+  // since we are not modifying the record index.
   if (lock) {
     ink_rwlock_wrlock(&g_records_rwlock);
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r1)) {
+  if ((r1 = RecIndexLookup(name)) != NULL) {
     if (i_am_the_record_owner(r1->rec_type)) {
       rec_mutex_acquire(&(r1->lock));
       r1->sync_required = REC_SYNC_REQUIRED;
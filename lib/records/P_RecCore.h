@@ -34,9 +34,8 @@
 #include "P_RecDefs.h"
 #include "P_RecTree.h"
 
-// records, record hash-table, and hash-table rwlock
+// records, and the rwlock taken to add to them (see RecIndexInsert)
 extern RecRecord *g_records;
-extern InkHashTable *g_records_ht;
 extern ink_rwlock g_records_rwlock;
 extern int g_num_records;
 extern int g_num_update[];
@@ -64,6 +64,17 @@ RecData RecDataMul(RecDataT type, RecData left, RecData right);
 RecData RecDataDiv(RecDataT type, RecData left, RecData right);
 
 
+//-------------------------------------------------------------------------
+// Record Index
+//-------------------------------------------------------------------------
+
+// Name to record lookups take no lock.  Records are never removed, so the
+// index only grows; inserts must hold g_records_rwlock for writing.
+int RecIndexInit(int max_records);
+RecRecord *RecIndexLookup(const char *name);
+void RecIndexInsert(RecRecord * r);
+
+
 //-------------------------------------------------------------------------
 // Logging
 //-------------------------------------------------------------------------
@@ -34,7 +34,6 @@ static bool g_initialized = false;
 Diags *g_diags = NULL;
 
 RecRecord *g_records = NULL;
-InkHashTable *g_records_ht = NULL;
 ink_rwlock g_records_rwlock;
 int g_num_records = 0;
 
@@ -56,7 +55,7 @@ register_record(RecT rec_type, const char *name, RecDataT data_type, RecData dat
 {
   RecRecord *r = NULL;
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     ink_release_assert(r->rec_type == rec_type);
     ink_release_assert(r->data_type == data_type);
     // Note: do not set r->data as we want to keep the previous value
@@ -68,7 +67,7 @@ register_record(RecT rec_type, const char *name, RecDataT data_type, RecData dat
     // Set the r->data to its default value as this is a new record
     RecDataSet(r->data_type, &(r->data), &(data_default));
     RecDataSet(r->data_type, &(r->data_default), &(data_default));
-    ink_hash_table_insert(g_records_ht, name, (void *) r);
+    RecIndexInsert(r);
   }
 
   // we're now registered
@@ -79,6 +78,31 @@ register_record(RecT rec_type, const char *name, RecDataT data_type, RecData dat
 }
 
 
+//-------------------------------------------------------------------------
+// get_record_data
+//-------------------------------------------------------------------------
+static int
+get_record_data(RecRecord *r, RecDataT data_type, RecData *data)
+{
+  int err = REC_ERR_OKAY;
+
+  if (r == NULL) {
+    return REC_ERR_FAIL;
+  }
+  rec_mutex_acquire(&(r->lock));
+  if (!r->registered || (r->data_type != data_type)) {
+    err = REC_ERR_FAIL;
+  } else {
+    // Clear the caller's record just in case it has trash in it.
+    // Passing trashy records to RecDataSet will cause confusion.
+    memset(data, 0, sizeof(RecData));
+    RecDataSet(data_type, data, &(r->data));
+  }
+  rec_mutex_release(&(r->lock));
+  return err;
+}
+
+
 //-------------------------------------------------------------------------
 // link_XXX
 //-------------------------------------------------------------------------
@@ -188,10 +212,9 @@ RecCoreInit(RecModeT mode_type, Diags *_diags)
   g_records = (RecRecord *)ats_malloc(REC_MAX_RECORDS * sizeof(RecRecord));
   memset(g_records, 0, REC_MAX_RECORDS * sizeof(RecRecord));
 
-  // initialize record hash index
-  g_records_ht = ink_hash_table_create(InkHashTableKeyType_String);
+  // initialize record index
   ink_rwlock_init(&g_records_rwlock);
-  if (!g_records_ht) {
+  if (RecIndexInit(REC_MAX_RECORDS) != REC_ERR_OKAY) {
     return REC_ERR_FAIL;
   }
   // read stats
@@ -319,7 +342,7 @@ RecRegisterConfigUpdateCb(const char *name, RecConfigUpdateCb update_cb, void *c
 
   ink_rwlock_rdlock(&g_records_rwlock);
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_CONFIG(r->rec_type)) {
       /* -- upgrade to support a list of callback functions
@@ -388,30 +411,8 @@ RecGetRecordFloat(const char *name, RecFloat * rec_float, bool lock)
 int
 RecGetRecordString(const char *name, char *buf, int buf_len, bool lock)
 {
-  int err = REC_ERR_OKAY;
-  RecRecord *r;
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
-    rec_mutex_acquire(&(r->lock));
-    if (!r->registered || (r->data_type != RECD_STRING)) {
-      err = REC_ERR_FAIL;
-    } else {
-      if (r->data.rec_string == NULL) {
-        buf[0] = '\0';
-      } else {
-        ink_strlcpy(buf, r->data.rec_string, buf_len);
-      }
-    }
-    rec_mutex_release(&(r->lock));
-  } else {
-    err = REC_ERR_FAIL;
-  }
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-  return err;
+  REC_NOWARN_UNUSED(lock);
+  return RecGetHandleString(RecIndexLookup(name), buf, buf_len);
 }
 
 int
@@ -458,7 +459,7 @@ RecGetRecordType(const char *name, RecT * rec_type, bool lock)
     ink_rwlock_rdlock(&g_records_rwlock);
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     *rec_type = r->rec_type;
     err = REC_ERR_OKAY;
@@ -483,7 +484,7 @@ RecGetRecordDataType(const char *name, RecDataT * data_type, bool lock)
     ink_rwlock_rdlock(&g_records_rwlock);
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (!r->registered) {
       err = REC_ERR_FAIL;
@@ -517,7 +518,7 @@ RecGetRecordOrderAndId(const char *name, int* order, int* id, bool lock)
     ink_rwlock_rdlock(&g_records_rwlock);
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (order)
       *order = r->order;
@@ -544,7 +545,7 @@ RecGetRecordUpdateType(const char *name, RecUpdateT *update_type, bool lock)
     ink_rwlock_rdlock(&g_records_rwlock);
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_CONFIG(r->rec_type)) {
       *update_type = r->config_meta.update_type;
@@ -573,7 +574,7 @@ RecGetRecordCheckType(const char *name, RecCheckT *check_type, bool lock)
     ink_rwlock_rdlock(&g_records_rwlock);
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_CONFIG(r->rec_type)) {
       *check_type = r->config_meta.check_type;
@@ -602,7 +603,7 @@ RecGetRecordCheckExpr(const char *name, char **check_expr, bool lock)
     ink_rwlock_rdlock(&g_records_rwlock);
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_CONFIG(r->rec_type)) {
       *check_expr = r->config_meta.check_expr;
@@ -628,7 +629,7 @@ RecGetRecordDefaultDataString_Xmalloc(char *name, char **buf, bool lock)
   int err;
   RecRecord *r = NULL;
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     *buf = (char *)ats_malloc(sizeof(char) * 1024);
     memset(*buf, 0, 1024);
     err = REC_ERR_OKAY;
@@ -675,7 +676,7 @@ RecGetRecordAccessType(const char *name, RecAccessT *access, bool lock)
     ink_rwlock_rdlock(&g_records_rwlock);
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     *access = r->config_meta.access_type;
     err = REC_ERR_OKAY;
@@ -700,7 +701,7 @@ RecSetRecordAccessType(const char *name, RecAccessT access, bool lock)
     ink_rwlock_rdlock(&g_records_rwlock);
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     r->config_meta.access_type = access;
     err = REC_ERR_OKAY;
@@ -768,32 +769,81 @@ RecRegisterConfig(RecT rec_type, const char *name, RecDataT data_type,
 int
 RecGetRecord_Xmalloc(const char *name, RecDataT data_type, RecData *data, bool lock)
 {
-  int err = REC_ERR_OKAY;
-  RecRecord *r;
+  REC_NOWARN_UNUSED(lock);
+  return get_record_data(RecIndexLookup(name), data_type, data);
+}
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
+
+//-------------------------------------------------------------------------
+// RecGetRecordHandle, RecGetHandleXXX
+//-------------------------------------------------------------------------
+RecRecordHandle
+RecGetRecordHandle(const char *name)
+{
+  return RecIndexLookup(name);
+}
+
+// Records never move, and an int, float or counter is read in one
+// aligned load, so these take neither the rwlock nor the record lock.
+int
+RecGetHandleInt(RecRecordHandle r, RecInt *rec_int)
+{
+  if (r == NULL || !r->registered || (r->data_type != RECD_INT)) {
+    return REC_ERR_FAIL;
   }
+  *rec_int = *((volatile RecInt *) &(r->data.rec_int));
+  return REC_ERR_OKAY;
+}
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
-    rec_mutex_acquire(&(r->lock));
-    if (!r->registered || (r->data_type != data_type)) {
-      err = REC_ERR_FAIL;
-    } else {
-      // Clear the caller's record just in case it has trash in it.
-      // Passing trashy records to RecDataSet will cause confusion.
-      memset(data, 0, sizeof(RecData));
-      RecDataSet(data_type, data, &(r->data));
-    }
-    rec_mutex_release(&(r->lock));
-  } else {
-    err = REC_ERR_FAIL;
+int
+RecGetHandleFloat(RecRecordHandle r, RecFloat *rec_float)
+{
+  if (r == NULL || !r->registered || (r->data_type != RECD_FLOAT)) {
+    return REC_ERR_FAIL;
   }
+  *rec_float = *((volatile RecFloat *) &(r->data.rec_float));
+  return REC_ERR_OKAY;
+}
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
+int
+RecGetHandleCounter(RecRecordHandle r, RecCounter *rec_counter)
+{
+  if (r == NULL || !r->registered || (r->data_type != RECD_COUNTER)) {
+    return REC_ERR_FAIL;
+  }
+  *rec_counter = *((volatile RecCounter *) &(r->data.rec_counter));
+  return REC_ERR_OKAY;
+}
+
+int
+RecGetHandleString(RecRecordHandle r, char *buf, int buf_len)
+{
+  int err = REC_ERR_OKAY;
+
+  if (r == NULL) {
+    return REC_ERR_FAIL;
+  }
+  rec_mutex_acquire(&(r->lock));
+  if (!r->registered || (r->data_type != RECD_STRING)) {
+    err = REC_ERR_FAIL;
+  } else {
+    if (r->data.rec_string == NULL) {
+      buf[0] = '\0';
+    } else {
+      ink_strlcpy(buf, r->data.rec_string, buf_len);
+    }
   }
+  rec_mutex_release(&(r->lock));
+  return err;
+}
 
+int
+RecGetHandleString_Xmalloc(RecRecordHandle r, RecString *rec_string)
+{
+  int err;
+  RecData data;
+  if ((err = get_record_data(r, RECD_STRING, &data)) == REC_ERR_OKAY)
+    *rec_string = data.rec_string;
   return err;
 }
 
@@ -809,7 +859,7 @@ RecForceInsert(RecRecord * record)
 
   ink_rwlock_wrlock(&g_records_rwlock);
 
-  if (ink_hash_table_lookup(g_records_ht, record->name, (void **) &r)) {
+  if ((r = RecIndexLookup(record->name)) != NULL) {
     r_is_a_new_record = false;
     rec_mutex_acquire(&(r->lock));
     r->rec_type = record->rec_type;
@@ -839,7 +889,7 @@ RecForceInsert(RecRecord * record)
   }
 
   if (r_is_a_new_record) {
-    ink_hash_table_insert(g_records_ht, r->name, (void *) r);
+    RecIndexInsert(r);
   } else {
     rec_mutex_release(&(r->lock));
   }
@@ -41,6 +41,10 @@ static int g_rec_raw_stat_sync_interval_ms = REC_RAW_STAT_SYNC_INTERVAL_MS;
 static int g_rec_config_update_interval_ms = REC_CONFIG_UPDATE_INTERVAL_MS;
 static int g_rec_remote_sync_interval_ms = REC_REMOTE_SYNC_INTERVAL_MS;
 
+// every raw stat block, and the sync of their totals
+static RecRawStatBlock *g_raw_stat_blocks = NULL;
+static ink_mutex g_raw_stat_sync_mutex = INK_MUTEX_INIT;
+
 //-------------------------------------------------------------------------
 // i_am_the_record_owner, only used for librecprocess.a
 //-------------------------------------------------------------------------
@@ -103,7 +107,7 @@ static int
 raw_stat_get_total(RecRawStatBlock *rsb, int id, RecRawStat *total)
 {
   int i;
-  RecRawStat *tlp;
+  RecRawStatLocal *tlp;
 
   total->sum = 0;
   total->count = 0;
@@ -114,7 +118,7 @@ raw_stat_get_total(RecRawStatBlock *rsb, int id, RecRawStat *total)
 
   // get thread local values
   for (i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatLocal *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
     total->sum += tlp->sum;
     total->count += tlp->count;
   }
@@ -127,28 +131,48 @@ raw_stat_get_total(RecRawStatBlock *rsb, int id, RecRawStat *total)
 
 
 //-------------------------------------------------------------------------
-// raw_stat_sync_to_global
+// raw_stat_block_sum
 //-------------------------------------------------------------------------
 static int
-raw_stat_sync_to_global(RecRawStatBlock *rsb, int id)
+raw_stat_block_sum(RecRawStatBlock *rsb)
 {
-  int i;
-  RecRawStat *tlp;
-  RecRawStat total;
+  int i, j;
+  int n = 2 * (rsb->max_stats + rsb->max_hists * REC_HIST_STATS);
+  int64_t *totals = rsb->sync_totals;
+  const int64_t *tlp;
 
-  total.sum = 0;
-  total.count = 0;
+  memset(totals, 0, n * sizeof(int64_t));
 
-  // sum the thread local values
+  // a thread's stats of the block are one run of sums and counts, which
+  // the compiler can add up with vector instructions
   for (i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
-    total.sum += tlp->sum;
-    total.count += tlp->count;
+    tlp = (const int64_t *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset);
+    for (j = 0; j < n; j++) {
+      totals[j] += tlp[j];
+    }
   }
-  if (total.sum < 0) { // Assure that we stay positive
-    total.sum = 0;
+  for (j = 0; j < n; j += 2) {
+    if (totals[j] < 0) { // Assure that we stay positive
+      totals[j] = 0;
+    }
   }
 
+  return REC_ERR_OKAY;
+}
+
+
+//-------------------------------------------------------------------------
+// raw_stat_sync_to_global
+//-------------------------------------------------------------------------
+static int
+raw_stat_sync_to_global(RecRawStatBlock *rsb, int id)
+{
+  RecRawStat total;
+
+  // the thread local values, as added up at the start of this sync
+  total.sum = rsb->sync_totals[2 * id];
+  total.count = rsb->sync_totals[2 * id + 1];
+
   // lock so the setting of the globals and last values are atomic
   ink_mutex_acquire(&(rsb->mutex));
 
@@ -175,6 +199,107 @@ raw_stat_sync_to_global(RecRawStatBlock *rsb, int id)
 }
 
 
+//-------------------------------------------------------------------------
+// raw_hist_get_total
+//-------------------------------------------------------------------------
+static const struct
+{
+  const char *suffix;
+  double quantile;
+} raw_hist_stats[REC_HIST_STATS] = {
+  { "count", 0.0 },
+  { "p50", 0.5 },
+  { "p90", 0.9 },
+  { "p99", 0.99 },
+  { "p999", 0.999 },
+  { "max", 1.0 }
+};
+
+static int64_t
+raw_hist_get_total(RecRawStatBlock *rsb, int hist_id, int64_t *total)
+{
+  int i, b;
+  int64_t *tlp;
+  int64_t count = 0;
+
+  memset(total, 0, REC_HIST_BUCKETS * sizeof(int64_t));
+
+  // merge the thread local buckets
+  for (i = 0; i < eventProcessor.n_ethreads; i++) {
+    tlp = ((int64_t *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_hist_offset)) + hist_id * REC_HIST_BUCKETS;
+    for (b = 0; b < REC_HIST_BUCKETS; b++) {
+      total[b] += tlp[b];
+    }
+  }
+  for (b = 0; b < REC_HIST_BUCKETS; b++) {
+    count += total[b];
+  }
+
+  return count;
+}
+
+
+//-------------------------------------------------------------------------
+// raw_hist_quantile
+//-------------------------------------------------------------------------
+static int64_t
+raw_hist_bucket_max(int bucket)
+{
+  if (bucket < 2 * REC_HIST_SUB_BUCKETS) {
+    return bucket;
+  }
+
+  int shift = (bucket >> REC_HIST_SUB_BITS) - 1;
+  int64_t sub = REC_HIST_SUB_BUCKETS + (bucket & (REC_HIST_SUB_BUCKETS - 1));
+
+  return (sub << shift) + ((int64_t) 1 << shift) - 1;
+}
+
+// The largest value of the bucket holding the value of the given rank,
+// so a quantile is never reported below what was recorded.
+static int64_t
+raw_hist_quantile(const int64_t *total, int64_t count, double quantile)
+{
+  int64_t rank, seen = 0;
+
+  if (count <= 0) {
+    return 0;
+  }
+  rank = (int64_t) (quantile * count);
+  if (rank < quantile * count) {
+    ++rank;
+  }
+  if (rank < 1) {
+    rank = 1;
+  } else if (rank > count) {
+    rank = count;
+  }
+
+  for (int b = 0; b < REC_HIST_BUCKETS; b++) {
+    seen += total[b];
+    if (seen >= rank) {
+      return raw_hist_bucket_max(b);
+    }
+  }
+  return REC_HIST_MAX_VALUE;
+}
+
+
+//-------------------------------------------------------------------------
+// raw_hist_clear
+//-------------------------------------------------------------------------
+static void
+raw_hist_clear(RecRawStatBlock *rsb, int hist_id)
+{
+  Debug("stats", "raw_hist_clear(): rsb pointer:%p hist_id:%d\n", rsb, hist_id);
+
+  for (int i = 0; i < eventProcessor.n_ethreads; i++) {
+    memset(((int64_t *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_hist_offset)) + hist_id * REC_HIST_BUCKETS,
+           0, REC_HIST_BUCKETS * sizeof(int64_t));
+  }
+}
+
+
 //-------------------------------------------------------------------------
 // raw_stat_clear
 //-------------------------------------------------------------------------
@@ -193,12 +318,17 @@ raw_stat_clear(RecRawStatBlock *rsb, int id)
   ink_mutex_release(&(rsb->mutex));
 
   // reset the local stats
-  RecRawStat *tlp;
+  RecRawStatLocal *tlp;
   for (int i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatLocal *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
     ink_atomic_swap(&(tlp->sum), (int64_t)0);
     ink_atomic_swap(&(tlp->count), (int64_t)0);
   }
+
+  // the count of a histogram stands for its buckets
+  if (id >= rsb->max_stats && (id - rsb->max_stats) % REC_HIST_STATS == 0) {
+    raw_hist_clear(rsb, (id - rsb->max_stats) / REC_HIST_STATS);
+  }
   return REC_ERR_OKAY;
 }
 
@@ -219,9 +349,9 @@ raw_stat_clear_sum(RecRawStatBlock *rsb, int id)
   ink_mutex_release(&(rsb->mutex));
 
   // reset the local stats
-  RecRawStat *tlp;
+  RecRawStatLocal *tlp;
   for (int i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatLocal *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
     ink_atomic_swap(&(tlp->sum), (int64_t)0);
   }
   return REC_ERR_OKAY;
@@ -244,9 +374,9 @@ raw_stat_clear_count(RecRawStatBlock *rsb, int id)
   ink_mutex_release(&(rsb->mutex));
 
   // reset the local stats
-  RecRawStat *tlp;
+  RecRawStatLocal *tlp;
   for (int i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatLocal *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
     ink_atomic_swap(&(tlp->count), (int64_t)0);
   }
   return REC_ERR_OKAY;
@@ -450,6 +580,10 @@ RecProcessStart()
     return REC_ERR_OKAY;
   }
 
+  // what each raw stat sync cost, and how many stats it had to look at
+  RecRegisterStatInt(RECT_PROCESS, "proxy.process.stats.raw_sync_usecs", 0, RECP_NON_PERSISTENT);
+  RecRegisterStatInt(RECT_PROCESS, "proxy.process.stats.raw_sync_stats", 0, RECP_NON_PERSISTENT);
+
   Debug("statsproc", "Starting sync processors:");
   raw_stat_sync_cont *rssc = NEW(new raw_stat_sync_cont(new_ProxyMutex()));
   Debug("statsproc", "\traw-stat syncer");
@@ -473,24 +607,43 @@ RecProcessStart()
 // RecAllocateRawStatBlock
 //-------------------------------------------------------------------------
 RecRawStatBlock *
-RecAllocateRawStatBlock(int num_stats)
+RecAllocateRawStatBlock(int num_stats, int num_hists)
 {
-  off_t ethr_stat_offset;
+  off_t ethr_stat_offset, ethr_hist_offset = 0;
   RecRawStatBlock *rsb;
+  int num_raw_stats = num_stats + num_hists * REC_HIST_STATS;
 
-  // allocate thread-local raw-stat memory
-  if ((ethr_stat_offset = eventProcessor.allocate(num_stats * sizeof(RecRawStat))) == -1) {
+  // allocate thread-local raw-stat memory, in whole cache lines so that
+  // blocks don't share them
+  if ((ethr_stat_offset = eventProcessor.allocate(INK_ALIGN(num_raw_stats * sizeof(RecRawStatLocal), ETHREAD_ALIGNMENT),
+                                                  ETHREAD_ALIGNMENT)) == -1) {
+    return NULL;
+  }
+  if (num_hists > 0 &&
+      (ethr_hist_offset = eventProcessor.allocate(INK_ALIGN(num_hists * REC_HIST_BUCKETS * sizeof(int64_t), ETHREAD_ALIGNMENT),
+                                                  ETHREAD_ALIGNMENT)) == -1) {
     return NULL;
   }
   // create the raw-stat-block structure
   rsb = (RecRawStatBlock *)ats_malloc(sizeof(RecRawStatBlock));
   memset(rsb, 0, sizeof(RecRawStatBlock));
   rsb->ethr_stat_offset = ethr_stat_offset;
-  rsb->global = (RecRawStat **)ats_malloc(num_stats * sizeof(RecRawStat *));
-  memset(rsb->global, 0, num_stats * sizeof(RecRawStat *));
+  rsb->global = (RecRawStat **)ats_malloc(num_raw_stats * sizeof(RecRawStat *));
+  memset(rsb->global, 0, num_raw_stats * sizeof(RecRawStat *));
   rsb->num_stats = 0;
   rsb->max_stats = num_stats;
   ink_mutex_init(&(rsb->mutex),"net stat mutex");
+  rsb->max_hists = num_hists;
+  rsb->ethr_hist_offset = ethr_hist_offset;
+  rsb->sync_totals = (int64_t *)ats_malloc(2 * num_raw_stats * sizeof(int64_t));
+  memset(rsb->sync_totals, 0, 2 * num_raw_stats * sizeof(int64_t));
+  rsb->sync_globals = (int64_t *)ats_malloc(2 * num_raw_stats * sizeof(int64_t));
+  memset(rsb->sync_globals, 0, 2 * num_raw_stats * sizeof(int64_t));
+
+  ink_mutex_acquire(&g_raw_stat_sync_mutex);
+  rsb->sync_next = g_raw_stat_blocks;
+  g_raw_stat_blocks = rsb;
+  ink_mutex_release(&g_raw_stat_sync_mutex);
   return rsb;
 }
 
@@ -498,15 +651,12 @@ RecAllocateRawStatBlock(int num_stats)
 //-------------------------------------------------------------------------
 // RecRegisterRawStat
 //-------------------------------------------------------------------------
-int
-RecRegisterRawStat(RecRawStatBlock *rsb, RecT rec_type, const char *name, RecDataT data_type, RecPersistT persist_type, int id,
-                   RecRawStatSyncCb sync_cb)
+static int
+raw_stat_register(RecRawStatBlock *rsb, RecT rec_type, const char *name, RecDataT data_type, RecPersistT persist_type, int id,
+                  RecRawStatSyncCb sync_cb)
 {
   Debug("stats", "RecRawStatSyncCb(%s): rsb pointer:%p id:%d\n", name, rsb, id);
 
-  // check to see if we're good to proceed
-  ink_assert(id < rsb->max_stats);
-
   int err = REC_ERR_OKAY;
 
   RecRecord *r;
@@ -537,6 +687,67 @@ Ldone:
   return err;
 }
 
+int
+RecRegisterRawStat(RecRawStatBlock *rsb, RecT rec_type, const char *name, RecDataT data_type, RecPersistT persist_type, int id,
+                   RecRawStatSyncCb sync_cb)
+{
+  // check to see if we're good to proceed
+  ink_assert(id < rsb->max_stats);
+
+  return raw_stat_register(rsb, rec_type, name, data_type, persist_type, id, sync_cb);
+}
+
+
+//-------------------------------------------------------------------------
+// RecRegisterRawHistogram
+//-------------------------------------------------------------------------
+
+// The count merges the buckets and sets the quantiles aside in the raw
+// stats of the records after it, which are synced right after it.
+static int
+raw_hist_sync_count(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id)
+{
+  REC_NOWARN_UNUSED(name);
+  int64_t total[REC_HIST_BUCKETS];
+  int64_t count;
+
+  Debug("stats", "raw sync:histogram for %s", name);
+  raw_stat_sync_to_global(rsb, id);
+  count = raw_hist_get_total(rsb, (id - rsb->max_stats) / REC_HIST_STATS, total);
+  for (int k = 1; k < REC_HIST_STATS; k++) {
+    ink_atomic_swap(&(rsb->global[id + k]->sum), raw_hist_quantile(total, count, raw_hist_stats[k].quantile));
+  }
+  RecDataSetFromInk64(data_type, data, rsb->global[id]->count);
+
+  return REC_ERR_OKAY;
+}
+
+static int
+raw_hist_sync_quantile(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id)
+{
+  REC_NOWARN_UNUSED(name);
+  RecDataSetFromInk64(data_type, data, rsb->global[id]->sum);
+  return REC_ERR_OKAY;
+}
+
+int
+RecRegisterRawHistogram(RecRawStatBlock *rsb, RecT rec_type, const char *name, int hist_id)
+{
+  char stat_name[1024];
+  int id, err = REC_ERR_OKAY;
+
+  ink_assert(hist_id < rsb->max_hists);
+
+  id = rsb->max_stats + hist_id * REC_HIST_STATS;
+  for (int k = 0; k < REC_HIST_STATS && err == REC_ERR_OKAY; k++) {
+    snprintf(stat_name, sizeof(stat_name), "%s.%s", name, raw_hist_stats[k].suffix);
+    err = raw_stat_register(rsb, rec_type, stat_name, RECD_INT, RECP_NON_PERSISTENT, id + k,
+                            k == 0 ? raw_hist_sync_count : raw_hist_sync_quantile);
+  }
+
+  return err;
+}
+
 
 //-------------------------------------------------------------------------
 // RecRawStatSync...
@@ -719,6 +930,18 @@ RecGetRawStatCount(RecRawStatBlock *rsb, int id, int64_t *data)
   return REC_ERR_OKAY;
 }
 
+int
+RecGetRawHistogramQuantile(RecRawStatBlock *rsb, int hist_id, double quantile, int64_t *data)
+{
+  int64_t total[REC_HIST_BUCKETS];
+  int64_t count;
+
+  ink_assert((hist_id >= 0) && (hist_id < rsb->max_hists));
+  count = raw_hist_get_total(rsb, hist_id, total);
+  *data = raw_hist_quantile(total, count, quantile);
+  return REC_ERR_OKAY;
+}
+
 
 //-------------------------------------------------------------------------
 // RecIncrGlobalRawStatXXX
@@ -814,10 +1037,12 @@ RecRegisterRawStatSyncCb(const char *name, RecRawStatSyncCb sync_cb, RecRawStatB
   RecRecord *r;
 
   ink_rwlock_rdlock(&g_records_rwlock);
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_STAT(r->rec_type)) {
       if (!(r->stat_meta.sync_cb)) {
+        // no global is ever INT64_MIN, so the first sync runs the callback
+        rsb->sync_globals[2 * id] = INT64_MIN;
         r->stat_meta.sync_rsb = rsb;
         r->stat_meta.sync_id = id;
         r->stat_meta.sync_cb = sync_cb;
@@ -838,29 +1063,276 @@ RecRegisterRawStatSyncCb(const char *name, RecRawStatSyncCb sync_cb, RecRawStatB
 //-------------------------------------------------------------------------
 // RecExecRawStatSyncCbs
 //-------------------------------------------------------------------------
+
+// The callbacks that work from their raw stat alone, and so needn't run
+// again while it and its global stay the same.
+static bool
+raw_stat_sync_cb_is_pure(RecRawStatSyncCb sync_cb)
+{
+  return sync_cb == RecRawStatSyncSum || sync_cb == RecRawStatSyncCount || sync_cb == RecRawStatSyncAvg ||
+    sync_cb == RecRawStatSyncHrTimeAvg || sync_cb == RecRawStatSyncIntMsecsToFloatSeconds ||
+    sync_cb == RecRawStatSyncMHrTimeAvg || sync_cb == raw_hist_sync_count || sync_cb == raw_hist_sync_quantile;
+}
+
+// Read without the record lock; a stat caught halfway through being
+// registered or changed just waits for the next sync.
+static bool
+raw_stat_sync_is_clean(RecRecord *r)
+{
+  RecRawStatBlock *rsb = r->stat_meta.sync_rsb;
+  int id = r->stat_meta.sync_id;
+
+  if (rsb == NULL || !raw_stat_sync_cb_is_pure(r->stat_meta.sync_cb)) {
+    return false;
+  }
+
+  RecRawStat *global = rsb->global[id];
+  const int64_t *totals = rsb->sync_totals + 2 * id;
+  const int64_t *seen = rsb->sync_globals + 2 * id;
+
+  if (r->version && r->version != global->version) {
+    return false;
+  }
+  return totals[0] == global->last_sum && totals[1] == global->last_count &&
+    global->sum == seen[0] && global->count == seen[1];
+}
+
+static bool
+raw_stat_data_changed(RecDataT data_type, RecData before, RecData after)
+{
+  switch (data_type) {
+  case RECD_INT:
+  case RECD_COUNTER:
+  case RECD_FLOAT:
+    return RecDataCmp(data_type, before, after) != 0;
+  default:
+    return true;
+  }
+}
+
 int
 RecExecRawStatSyncCbs()
 {
   RecRecord *r;
-  int i, num_records;
+  RecRawStatBlock *rsb;
+  RecData before;
+  int i, id, num_records, num_synced = 0;
+  ink_hrtime start = ink_get_hrtime_internal();
+
+  ink_mutex_acquire(&g_raw_stat_sync_mutex);
+
+  // add up every block, a thread at a time, before looking at any stat
+  for (rsb = g_raw_stat_blocks; rsb != NULL; rsb = rsb->sync_next) {
+    raw_stat_block_sum(rsb);
+  }
 
   num_records = g_num_records;
   for (i = 0; i < num_records; i++) {
     r = &(g_records[i]);
+    if (!REC_TYPE_IS_STAT(r->rec_type) || r->stat_meta.sync_cb == NULL || raw_stat_sync_is_clean(r)) {
+      continue;
+    }
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_STAT(r->rec_type)) {
       if (r->stat_meta.sync_cb) {
-        if (r->version && r->version != r->stat_meta.sync_rsb->global[r->stat_meta.sync_id]->version) {
-          raw_stat_clear(r->stat_meta.sync_rsb, r->stat_meta.sync_id);
-          r->stat_meta.sync_rsb->global[r->stat_meta.sync_id]->version = r->version;
+        rsb = r->stat_meta.sync_rsb;
+        id = r->stat_meta.sync_id;
+        if (r->version && r->version != rsb->global[id]->version) {
+          raw_stat_clear(rsb, id);
+          rsb->global[id]->version = r->version;
+          r->sync_required = REC_SYNC_REQUIRED;
         } else {
-          (*(r->stat_meta.sync_cb)) (r->name, r->data_type, &(r->data), r->stat_meta.sync_rsb, r->stat_meta.sync_id);
+          before = r->data;
+          (*(r->stat_meta.sync_cb)) (r->name, r->data_type, &(r->data), rsb, id);
+          rsb->sync_globals[2 * id] = rsb->global[id]->sum;
+          rsb->sync_globals[2 * id + 1] = rsb->global[id]->count;
+          // only what changed goes out to our peer
+          if (raw_stat_data_changed(r->data_type, before, r->data)) {
+            r->sync_required = REC_SYNC_REQUIRED;
+          }
         }
-        r->sync_required = REC_SYNC_REQUIRED;
+        ++num_synced;
       }
     }
     rec_mutex_release(&(r->lock));
   }
 
+  ink_mutex_release(&g_raw_stat_sync_mutex);
+
+  RecSetRecordInt("proxy.process.stats.raw_sync_usecs", ink_hrtime_to_usec(ink_get_hrtime_internal() - start));
+  RecSetRecordInt("proxy.process.stats.raw_sync_stats", num_synced);
+
   return REC_ERR_OKAY;
 }
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+
+#define REC_HIST_TEST_VALUES 100000
+
+static bool
+rec_hist_test_close(int64_t value, int64_t expected)
+{
+  // a quantile is the top of its bucket, at most 1/16th above the value
+  return value >= expected && value <= expected + expected / REC_HIST_SUB_BUCKETS;
+}
+
+// Walks values up to the clamp checking the buckets are in order and
+// narrow enough, then records 1..100000 on this thread next to a plain
+// stat and reads the quantiles back, merged and through the records,
+// before and after resetting the count.
+REGRESSION_TEST(RecRawHistogram)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  static const char *quantiles[] = { "count", "p50", "p90", "p99", "p999", "max" };
+  static const int64_t expected[] = { REC_HIST_TEST_VALUES, 50000, 90000, 99000, 99900, REC_HIST_TEST_VALUES };
+  TestBox tb(t, pstatus);
+  char name[256];
+  int last = 0, bad = 0;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  for (int64_t v = 0; v <= REC_HIST_MAX_VALUE; v += 1 + v / 64) {
+    int b = rec_hist_bucket(v);
+    int64_t hi = raw_hist_bucket_max(b);
+    int64_t lo = b ? raw_hist_bucket_max(b - 1) + 1 : 0;
+
+    if (b < last || b >= REC_HIST_BUCKETS || v < lo || v > hi || (hi - lo) * REC_HIST_SUB_BUCKETS > lo) {
+      if (++bad < 5) {
+        rprintf(t, "value %d in bucket %d of [%d, %d]\n", (int) v, b, (int) lo, (int) hi);
+      }
+    }
+    last = b;
+  }
+  tb.check(bad == 0, "%d values out of their buckets", bad);
+  tb.check(rec_hist_bucket(-1) == 0, "negative values not in the first bucket");
+  tb.check(rec_hist_bucket(REC_HIST_MAX_VALUE + 1000) == REC_HIST_BUCKETS - 1 &&
+           raw_hist_bucket_max(REC_HIST_BUCKETS - 1) == REC_HIST_MAX_VALUE, "values past the clamp not in the last bucket");
+
+  RecRawStatBlock *rsb = RecAllocateRawStatBlock(1, 1);
+  int64_t value;
+  RecInt rec_value;
+  ink_hrtime start;
+
+  tb.check(rsb != NULL, "cannot allocate a raw stat block");
+  if (rsb == NULL) {
+    return;
+  }
+  RecRegisterRawStat(rsb, RECT_PROCESS, "proxy.process.regression.raw_stat", RECD_INT, RECP_NON_PERSISTENT, 0,
+                     RecRawStatSyncSum);
+  RecRegisterRawHistogram(rsb, RECT_PROCESS, "proxy.process.regression.raw_histogram", 0);
+
+  start = ink_get_hrtime_internal();
+  for (int v = 1; v <= REC_HIST_TEST_VALUES; v++) {
+    RecRecordRawHistogram(rsb, this_ethread(), 0, v);
+  }
+  start = ink_get_hrtime_internal() - start;
+  RecIncrRawStat(rsb, this_ethread(), 0, 7);
+
+  for (unsigned k = 1; k < sizeof(quantiles) / sizeof(quantiles[0]); k++) {
+    RecGetRawHistogramQuantile(rsb, 0, raw_hist_stats[k].quantile, &value);
+    tb.check(rec_hist_test_close(value, expected[k]), "%s is %d, expected %d", quantiles[k], (int) value, (int) expected[k]);
+  }
+
+  RecExecRawStatSyncCbs();
+  for (unsigned k = 0; k < sizeof(quantiles) / sizeof(quantiles[0]); k++) {
+    snprintf(name, sizeof(name), "proxy.process.regression.raw_histogram.%s", quantiles[k]);
+    rec_value = -1;
+    RecGetRecordInt(name, &rec_value);
+    tb.check(k == 0 ? rec_value == expected[k] : rec_hist_test_close(rec_value, expected[k]), "%s is %d, expected %d",
+             name, (int) rec_value, (int) expected[k]);
+    rprintf(t, "%s = %d\n", name, (int) rec_value);
+  }
+  rec_value = -1;
+  RecGetRecordInt("proxy.process.regression.raw_stat", &rec_value);
+  tb.check(rec_value == 7, "the plain stat is %d, expected 7", (int) rec_value);
+
+  // the first sync after a reset clears the buckets, the next republishes
+  RecResetStatRecord("proxy.process.regression.raw_histogram.count");
+  RecExecRawStatSyncCbs();
+  RecExecRawStatSyncCbs();
+  rec_value = -1;
+  RecGetRecordInt("proxy.process.regression.raw_histogram.p99", &rec_value);
+  tb.check(rec_value == 0, "p99 is %d after a reset", (int) rec_value);
+  RecGetRecordInt("proxy.process.regression.raw_histogram.count", &rec_value);
+  tb.check(rec_value == 0, "count is %d after a reset", (int) rec_value);
+
+  rprintf(t, "%d ns/value recorded\n", (int) (start / REC_HIST_TEST_VALUES));
+  rperf(t, "rec_raw_histogram_ns_per_value", (double) start / REC_HIST_TEST_VALUES);
+}
+
+#define REC_SYNC_TEST_STATS 200
+#define REC_SYNC_TEST_CHANGED 10
+
+// Syncs a block of stats after bumping all of them and then a few,
+// checking the values come through and that the stats left alone are
+// not sent on to our peer again.
+REGRESSION_TEST(RecRawStatSync)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+  RecRawStatBlock *rsb = RecAllocateRawStatBlock(REC_SYNC_TEST_STATS);
+  RecRecord *records[REC_SYNC_TEST_STATS];
+  char name[256];
+  int wrong = 0, resent = 0;
+  RecInt value;
+  ink_hrtime start;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  tb.check(rsb != NULL, "cannot allocate a raw stat block");
+  if (rsb == NULL) {
+    return;
+  }
+  tb.check(((uintptr_t) raw_stat_get_tlp(rsb, 0, this_ethread()) & (ETHREAD_ALIGNMENT - 1)) == 0,
+           "raw stat block is not on a cache line");
+  for (int id = 0; id < REC_SYNC_TEST_STATS; id++) {
+    snprintf(name, sizeof(name), "proxy.process.regression.raw_sync.%d", id);
+    RecRegisterRawStat(rsb, RECT_PROCESS, name, RECD_INT, RECP_NON_PERSISTENT, id, RecRawStatSyncSum);
+    records[id] = RecGetRecordHandle(name);
+    RecIncrRawStat(rsb, this_ethread(), id, id + 1);
+  }
+  RecExecRawStatSyncCbs();
+
+  for (int id = 0; id < REC_SYNC_TEST_STATS; id++) {
+    if (records[id] == NULL || RecGetHandleInt(records[id], &value) != REC_ERR_OKAY || value != id + 1) {
+      ++wrong;
+    }
+  }
+  tb.check(wrong == 0, "%d of %d stats wrong after the first sync", wrong, REC_SYNC_TEST_STATS);
+  if (wrong) {
+    return;
+  }
+
+  // forget what is waiting to go out, then change a few
+  for (int id = 0; id < REC_SYNC_TEST_STATS; id++) {
+    rec_mutex_acquire(&(records[id]->lock));
+    records[id]->sync_required = 0;
+    rec_mutex_release(&(records[id]->lock));
+  }
+  for (int id = 0; id < REC_SYNC_TEST_CHANGED; id++) {
+    RecIncrRawStat(rsb, this_ethread(), id * (REC_SYNC_TEST_STATS / REC_SYNC_TEST_CHANGED), 1000);
+  }
+  start = ink_get_hrtime_internal();
+  RecExecRawStatSyncCbs();
+  start = ink_get_hrtime_internal() - start;
+
+  for (int id = 0; id < REC_SYNC_TEST_STATS; id++) {
+    bool changed = id % (REC_SYNC_TEST_STATS / REC_SYNC_TEST_CHANGED) == 0;
+
+    RecGetHandleInt(records[id], &value);
+    if (value != id + 1 + (changed ? 1000 : 0)) {
+      ++wrong;
+    }
+    if (!changed && records[id]->sync_required) {
+      ++resent;
+    }
+  }
+  tb.check(wrong == 0, "%d of %d stats wrong after the second sync", wrong, REC_SYNC_TEST_STATS);
+  tb.check(resent == 0, "%d unchanged stats marked for sending", resent);
+
+  RecGetRecordInt("proxy.process.stats.raw_sync_stats", &value);
+  rprintf(t, "sync with %d of %d records changed: %d us, %d stats synced\n", REC_SYNC_TEST_CHANGED, (int) g_num_records,
+          (int) ink_hrtime_to_usec(start), (int) value);
+  rperf(t, "rec_raw_stat_sync_usecs", (double) ink_hrtime_to_usec(start));
+}
+#endif /* TS_HAS_TESTS */
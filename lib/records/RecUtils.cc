@@ -52,6 +52,81 @@ RecAlloc(RecT rec_type, const char *name, RecDataT data_type)
 }
 
 
+//-------------------------------------------------------------------------
+// Record Index
+//
+// Open addressing over a table kept at most half full.  A slot's hash is
+// written before its record is published, and slots are never reused,
+// so a reader that finds a record in a slot finds the matching hash.
+//-------------------------------------------------------------------------
+struct RecIndexSlot
+{
+  RecRecord *volatile record;
+  uint32_t hash;
+};
+
+static RecIndexSlot *g_rec_index = NULL;
+static uint32_t g_rec_index_mask = 0;
+
+static inline uint32_t
+rec_index_hash(const char *name)
+{
+  uint32_t h = 2166136261U;
+
+  for (; *name; name++) {
+    h = (h ^ (unsigned char) *name) * 16777619U;
+  }
+  return h;
+}
+
+int
+RecIndexInit(int max_records)
+{
+  uint32_t slots = 64;
+
+  while (slots < 2 * (uint32_t) max_records) {
+    slots <<= 1;
+  }
+  g_rec_index = (RecIndexSlot *)ats_malloc(slots * sizeof(RecIndexSlot));
+  memset(g_rec_index, 0, slots * sizeof(RecIndexSlot));
+  g_rec_index_mask = slots - 1;
+  return REC_ERR_OKAY;
+}
+
+RecRecord *
+RecIndexLookup(const char *name)
+{
+  uint32_t h = rec_index_hash(name);
+
+  for (uint32_t i = h;; i++) {
+    RecIndexSlot *slot = &(g_rec_index[i & g_rec_index_mask]);
+    RecRecord *r = slot->record;
+
+    if (r == NULL) {
+      return NULL;
+    }
+    if (slot->hash == h && strcmp(r->name, name) == 0) {
+      return r;
+    }
+  }
+}
+
+void
+RecIndexInsert(RecRecord * r)
+{
+  uint32_t h = rec_index_hash(r->name);
+  uint32_t i = h;
+
+  while (g_rec_index[i & g_rec_index_mask].record != NULL) {
+    i++;
+  }
+
+  RecIndexSlot *slot = &(g_rec_index[i & g_rec_index_mask]);
+
+  slot->hash = h;
+  ink_atomic_swap(&(slot->record), r);
+}
+
 //-------------------------------------------------------------------------
 // RecDataClear
 //-------------------------------------------------------------------------
@@ -0,0 +1,309 @@
+/** @file
+
+    Compressed radix tree for longest/best prefix lookups.
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef _RADIX_TREE_H
+#define _RADIX_TREE_H
+
+#include <string.h>
+
+#include "ink_assert.h"
+#undef std  // FIXME: remove dependancy on the STL
+#include <vector>
+#include <algorithm>
+
+/**
+  A read-mostly replacement for Trie<T> with the same lookup semantics:
+  Search() returns the lowest ranked value whose key is a prefix of the
+  search key, with ties going to the longer key.
+
+  Keys are queued by Insert() and indexed all at once by Build().  Runs
+  of single-child nodes are collapsed into a byte prefix, and every node,
+  edge and prefix byte lives in one of a handful of flat arrays, so there
+  is no per-node allocation and a lookup walks contiguous memory.  Nodes
+  with few children keep a short sorted key list; wider nodes switch to a
+  direct 256-way table.
+
+  Values are not owned by the tree.
+
+*/
+template<typename T>
+class RadixTree
+{
+public:
+  RadixTree()
+    : m_built(false)
+  { }
+
+  /// Queue @a value under @a key; the key bytes are copied.
+  void Insert(const char *key, int key_len, T *value, int rank);
+
+  /** Index the queued keys.  @return false if a key was inserted twice,
+      in which case @a duplicate (if given) is set to the second value.
+  */
+  bool Build(T **duplicate = NULL);
+
+  T *Search(const char *key, int key_len) const;
+  void Clear();
+
+  int NumValues() const { return (int) m_values.size(); }
+  T *Value(int i) const { return m_values[i]; }
+  int NumNodes() const { return (int) m_nodes.size(); }
+
+private:
+  static const int SPARSE_MAX = 16;     // wider nodes use a 256 entry table
+
+  struct Node
+  {
+    uint32_t prefix;            // first collapsed byte in m_bytes
+    uint32_t prefix_len;
+    int32_t value;              // index into m_values, or -1
+    uint32_t children;          // first slot in m_child_keys / m_child_nodes
+    uint16_t n_children;        // 256 for a direct table
+  };
+
+  struct PendingKey
+  {
+    uint32_t offset;            // into m_pending_bytes
+    uint32_t len;
+    T *value;
+    int rank;
+  };
+
+  struct PendingLess
+  {
+    const char *bytes;
+
+    PendingLess(const char *b) : bytes(b) { }
+    bool operator()(const PendingKey &a, const PendingKey &b) const
+    {
+      int cmp = memcmp(bytes + a.offset, bytes + b.offset, (a.len < b.len) ? a.len : b.len);
+      return cmp ? (cmp < 0) : (a.len < b.len);
+    }
+  };
+
+  int _Build(int lo, int hi, uint32_t depth, T **duplicate);
+  inline int _Child(const Node &node, unsigned char c) const;
+
+  bool m_built;
+  std::vector<PendingKey> m_pending;
+  std::vector<char> m_pending_bytes;
+
+  std::vector<Node> m_nodes;            // preorder, root first
+  std::vector<char> m_bytes;            // collapsed prefixes
+  std::vector<unsigned char> m_child_keys;
+  std::vector<int32_t> m_child_nodes;
+  std::vector<T *> m_values;
+  std::vector<int> m_ranks;
+
+  // make copy-constructor and assignment operator private
+  RadixTree(const RadixTree<T> &rhs);
+  RadixTree &operator =(const RadixTree<T> &rhs);
+};
+
+template<typename T>
+void
+RadixTree<T>::Insert(const char *key, int key_len, T *value, int rank)
+{
+  PendingKey pending;
+
+  ink_assert(!m_built);
+  pending.offset = m_pending_bytes.size();
+  pending.len = key_len;
+  pending.value = value;
+  pending.rank = rank;
+  m_pending_bytes.insert(m_pending_bytes.end(), key, key + key_len);
+  m_pending.push_back(pending);
+}
+
+template<typename T>
+bool
+RadixTree<T>::Build(T **duplicate)
+{
+  bool retval = true;
+
+  ink_assert(!m_built);
+  m_built = true;
+
+  if (!m_pending.empty()) {
+    // An empty vector has no data pointer to hand out
+    m_pending_bytes.push_back('\0');
+    std::stable_sort(m_pending.begin(), m_pending.end(), PendingLess(&m_pending_bytes[0]));
+    retval = (_Build(0, m_pending.size(), 0, duplicate) >= 0);
+  }
+
+  std::vector<PendingKey>().swap(m_pending);
+  std::vector<char>().swap(m_pending_bytes);
+  return retval;
+}
+
+/**
+  Build the subtree for the sorted keys [lo, hi), which all share their
+  first @a depth bytes.  @return the node index, or -1 on a duplicate.
+
+*/
+template<typename T>
+int
+RadixTree<T>::_Build(int lo, int hi, uint32_t depth, T **duplicate)
+{
+  const PendingKey &first = m_pending[lo];
+  const PendingKey &last = m_pending[hi - 1];
+  const char *first_key = &m_pending_bytes[first.offset];
+  const char *last_key = &m_pending_bytes[last.offset];
+  uint32_t lcp = depth;
+  int node_id = m_nodes.size();
+  Node node;
+
+  // Sorted input: the common prefix of the range is that of its ends
+  while (lcp < first.len && lcp < last.len && first_key[lcp] == last_key[lcp]) {
+    ++lcp;
+  }
+
+  node.prefix = m_bytes.size();
+  node.prefix_len = lcp - depth;
+  node.value = -1;
+  node.children = 0;
+  node.n_children = 0;
+  m_bytes.insert(m_bytes.end(), first_key + depth, first_key + lcp);
+
+  if (first.len == lcp) {
+    if (lo + 1 < hi && m_pending[lo + 1].len == lcp) {
+      if (duplicate) {
+        *duplicate = m_pending[lo + 1].value;
+      }
+      return -1;
+    }
+    node.value = m_values.size();
+    m_values.push_back(first.value);
+    m_ranks.push_back(first.rank);
+    ++lo;
+  }
+
+  // Count the distinct next bytes to size the child table
+  int n_children = 0;
+  for (int i = lo; i < hi; ++i) {
+    if (i == lo || m_pending_bytes[m_pending[i].offset + lcp] != m_pending_bytes[m_pending[i - 1].offset + lcp]) {
+      ++n_children;
+    }
+  }
+
+  if (n_children > 0) {
+    int slots = (n_children > SPARSE_MAX) ? 256 : n_children;
+
+    node.children = m_child_nodes.size();
+    node.n_children = slots;
+    m_child_keys.resize(m_child_keys.size() + slots, 0);
+    m_child_nodes.resize(m_child_nodes.size() + slots, -1);
+  }
+  m_nodes.push_back(node);
+
+  // Children are laid out right behind their parent (preorder)
+  int slot = 0;
+  for (int i = lo; i < hi;) {
+    unsigned char c = (unsigned char) m_pending_bytes[m_pending[i].offset + lcp];
+    int j = i + 1;
+    int child;
+
+    while (j < hi && (unsigned char) m_pending_bytes[m_pending[j].offset + lcp] == c) {
+      ++j;
+    }
+    if ((child = _Build(i, j, lcp + 1, duplicate)) < 0) {
+      return -1;
+    }
+    if (node.n_children == 256) {
+      m_child_nodes[node.children + c] = child;
+    } else {
+      m_child_keys[node.children + slot] = c;
+      m_child_nodes[node.children + slot] = child;
+      ++slot;
+    }
+    i = j;
+  }
+
+  return node_id;
+}
+
+template<typename T>
+inline int
+RadixTree<T>::_Child(const Node &node, unsigned char c) const
+{
+  if (node.n_children == 256) {
+    return m_child_nodes[node.children + c];
+  }
+
+  const unsigned char *keys = &m_child_keys[0] + node.children;
+  for (int i = 0; i < node.n_children && keys[i] <= c; ++i) {
+    if (keys[i] == c) {
+      return m_child_nodes[node.children + i];
+    }
+  }
+  return -1;
+}
+
+template<typename T>
+T *
+RadixTree<T>::Search(const char *key, int key_len) const
+{
+  int best = -1;
+  int node_id = 0;
+  int depth = 0;
+
+  if (m_nodes.empty()) {
+    return NULL;
+  }
+
+  while (true) {
+    const Node &node = m_nodes[node_id];
+
+    if (node.prefix_len) {
+      if (depth + (int) node.prefix_len > key_len || memcmp(key + depth, &m_bytes[node.prefix], node.prefix_len)) {
+        break;
+      }
+      depth += node.prefix_len;
+    }
+    if (node.value >= 0 && (best < 0 || m_ranks[node.value] <= m_ranks[best])) {
+      best = node.value;
+    }
+    if (depth == key_len || (node_id = _Child(node, (unsigned char) key[depth])) < 0) {
+      break;
+    }
+    ++depth;
+  }
+
+  return (best >= 0) ? m_values[best] : NULL;
+}
+
+template<typename T>
+void
+RadixTree<T>::Clear()
+{
+  m_built = false;
+  std::vector<PendingKey>().swap(m_pending);
+  std::vector<char>().swap(m_pending_bytes);
+  std::vector<Node>().swap(m_nodes);
+  std::vector<char>().swap(m_bytes);
+  std::vector<unsigned char>().swap(m_child_keys);
+  std::vector<int32_t>().swap(m_child_nodes);
+  std::vector<T *>().swap(m_values);
+  std::vector<int>().swap(m_ranks);
+}
+
+#endif // _RADIX_TREE_H
@@ -209,9 +209,11 @@ template<typename T>
 void
 Trie<T>::Clear()
 {
-  forl_LL(T, iter, m_value_list)
+  T *iter;
+
+  // dequeue first; forl_LL would read the link of a deleted value
+  while ((iter = m_value_list.dequeue()) != NULL)
     delete iter;
-  m_value_list.clear();
 
   _Clear(&m_root);
   m_root.Clear();
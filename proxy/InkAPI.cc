@@ -66,6 +66,7 @@
 #include "I_RecDefs.h"
 #include "I_RecCore.h"
 #include "HttpProxyServerMain.h"
+#include "TransformInternal.h"
 
 
 /****************************************************************
@@ -4221,6 +4222,46 @@ TSMgmtStringGet(const char *var_name, TSMgmtString *result)
   return TS_ERROR;
 }
 
+TSMgmtHandle
+TSMgmtHandleGet(const char *var_name)
+{
+  sdk_assert(sdk_sanity_check_null_ptr((void *) var_name) == TS_SUCCESS);
+
+  return (TSMgmtHandle) RecGetRecordHandle(var_name);
+}
+
+TSReturnCode
+TSMgmtHandleIntGet(TSMgmtHandle handle, TSMgmtInt *result)
+{
+  return RecGetHandleInt((RecRecordHandle) handle, (RecInt *) result) == REC_ERR_OKAY ? TS_SUCCESS : TS_ERROR;
+}
+
+TSReturnCode
+TSMgmtHandleCounterGet(TSMgmtHandle handle, TSMgmtCounter *result)
+{
+  return RecGetHandleCounter((RecRecordHandle) handle, (RecCounter *) result) == REC_ERR_OKAY ? TS_SUCCESS : TS_ERROR;
+}
+
+TSReturnCode
+TSMgmtHandleFloatGet(TSMgmtHandle handle, TSMgmtFloat *result)
+{
+  return RecGetHandleFloat((RecRecordHandle) handle, (RecFloat *) result) == REC_ERR_OKAY ? TS_SUCCESS : TS_ERROR;
+}
+
+TSReturnCode
+TSMgmtHandleStringGet(TSMgmtHandle handle, TSMgmtString *result)
+{
+  RecString tmp = 0;
+  (void) RecGetHandleString_Xmalloc((RecRecordHandle) handle, &tmp);
+
+  if (tmp) {
+    *result = tmp;
+    return TS_SUCCESS;
+  }
+
+  return TS_ERROR;
+}
+
 ////////////////////////////////////////////////////////////////////
 //
 // Continuations
@@ -5699,11 +5740,11 @@ TSHttpTxnSetHttpRetBody(TSHttpTxn txnp, const char *body_msg, int plain_msg_flag
   HttpTransact::State *s = &(sm->t_state);
 
   s->return_xbuf_size = 0;
-  s->return_xbuf[0] = 0;
+  s->return_xbuf = NULL;
   s->return_xbuf_plain = false;
   if (body_msg) {
-    ink_strlcpy(s->return_xbuf, body_msg, HTTP_TRANSACT_STATE_MAX_XBUF_SIZE);
-    s->return_xbuf_size = strlen(s->return_xbuf);
+    s->return_xbuf_size = MIN(strlen(body_msg), (size_t) HTTP_TRANSACT_STATE_MAX_XBUF_SIZE - 1);
+    s->return_xbuf = s->arena.str_store(body_msg, s->return_xbuf_size);
     s->return_xbuf_plain = plain_msg_flag;
   }
 }
@@ -6384,6 +6425,43 @@ TSTransformOutputVConnGet(TSVConn connp)
   return data;
 }
 
+// A TransformStage calling a plugin's stage function
+class APITransformStage:public TransformStage
+{
+public:
+  APITransformStage(TSTransformStageFunc funcp, void *edata)
+    : m_func(funcp), m_edata(edata)
+  {
+  }
+
+  bool transform(IOBufferReader *in, MIOBuffer *out, bool eos)
+  {
+    return m_func((TSIOBufferReader) in, (TSIOBuffer) out, eos, m_edata) == TS_SUCCESS;
+  }
+
+private:
+  TSTransformStageFunc m_func;
+  void *m_edata;
+};
+
+TSVConn
+TSTransformChainCreate(TSHttpTxn txnp)
+{
+  sdk_assert(sdk_sanity_check_txn(txnp) == TS_SUCCESS);
+
+  return reinterpret_cast<TSVConn>(transformProcessor.chain_transform((ProxyMutex *) ((HttpSM *) txnp)->mutex));
+}
+
+void
+TSTransformChainStageAdd(TSVConn chainp, TSTransformStageFunc funcp, void *edata)
+{
+  sdk_assert(sdk_sanity_check_iocore_structure(chainp) == TS_SUCCESS);
+  sdk_assert(sdk_sanity_check_null_ptr((void *) funcp) == TS_SUCCESS);
+
+  TransformChain *chain = (TransformChain *) chainp;
+  chain->add_stage(NEW(new APITransformStage(funcp, edata)));
+}
+
 void
 TSHttpTxnServerIntercept(TSCont contp, TSHttpTxn txnp)
 {
@@ -5444,6 +5444,110 @@ REGRESSION_TEST(SDK_API_TSMgmtGet) (RegressionTest * test, int atype, int *pstat
 }
 
 
+//////////////////////////////////////////////
+//       SDK_API_TSMgmtHandle
+//
+// Unit Test for APIs: TSMgmtHandleGet
+//                     TSMgmtHandleCounterGet
+//                     TSMgmtHandleFloatGet
+//                     TSMgmtHandleIntGet
+//                     TSMgmtHandleStringGet
+//
+// Also times reads by name against reads through a handle.
+//////////////////////////////////////////////
+
+#define MGMT_HANDLE_TEST_READS 200000
+
+REGRESSION_TEST(SDK_API_TSMgmtHandle) (RegressionTest * test, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+  const char *CONFIG_PARAM_COUNTER_NAME = "proxy.process.http.total_parent_proxy_connections";
+  const char *CONFIG_PARAM_FLOAT_NAME = "proxy.config.http.background_fill_completed_threshold";
+  const char *CONFIG_PARAM_INT_NAME = "proxy.config.http.cache.http";
+  const char *CONFIG_PARAM_STRING_NAME = "proxy.config.product_name";
+
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+
+  int err = 0;
+  TSMgmtHandle counter = TSMgmtHandleGet(CONFIG_PARAM_COUNTER_NAME);
+  TSMgmtHandle fl = TSMgmtHandleGet(CONFIG_PARAM_FLOAT_NAME);
+  TSMgmtHandle in = TSMgmtHandleGet(CONFIG_PARAM_INT_NAME);
+  TSMgmtHandle str = TSMgmtHandleGet(CONFIG_PARAM_STRING_NAME);
+  TSMgmtCounter cvalue = -1, cexpected = -2;
+  TSMgmtFloat fvalue = -1.0, fexpected = -2.0;
+  TSMgmtInt ivalue = -1, iexpected = -2;
+  TSMgmtString svalue = NULL, sexpected = NULL;
+
+  if (!counter || !fl || !in || !str || TSMgmtHandleGet("proxy.config.no.such.record")) {
+    SDK_RPRINT(test, "TSMgmtHandleGet", "TestCase1", TC_FAIL, "wrong handles");
+    err = 1;
+  } else {
+    SDK_RPRINT(test, "TSMgmtHandleGet", "TestCase1", TC_PASS, "ok");
+  }
+
+  if (!err) {
+    TSMgmtCounterGet(CONFIG_PARAM_COUNTER_NAME, &cexpected);
+    TSMgmtFloatGet(CONFIG_PARAM_FLOAT_NAME, &fexpected);
+    TSMgmtIntGet(CONFIG_PARAM_INT_NAME, &iexpected);
+    TSMgmtStringGet(CONFIG_PARAM_STRING_NAME, &sexpected);
+
+    if (TSMgmtHandleCounterGet(counter, &cvalue) != TS_SUCCESS || cvalue != cexpected ||
+        TSMgmtHandleFloatGet(fl, &fvalue) != TS_SUCCESS || fvalue != fexpected ||
+        TSMgmtHandleIntGet(in, &ivalue) != TS_SUCCESS || ivalue != iexpected ||
+        TSMgmtHandleStringGet(str, &svalue) != TS_SUCCESS || !sexpected || strcmp(svalue, sexpected) != 0) {
+      SDK_RPRINT(test, "TSMgmtHandleGet", "TestCase2", TC_FAIL, "values differ from those read by name");
+      err = 1;
+    } else {
+      SDK_RPRINT(test, "TSMgmtHandleGet", "TestCase2", TC_PASS, "ok");
+    }
+    TSfree(svalue);
+    TSfree(sexpected);
+
+    // a handle reads only its own type
+    if (TSMgmtHandleIntGet(fl, &ivalue) != TS_ERROR || TSMgmtHandleFloatGet(in, &fvalue) != TS_ERROR ||
+        TSMgmtHandleCounterGet(in, &cvalue) != TS_ERROR || TSMgmtHandleIntGet(NULL, &ivalue) != TS_ERROR) {
+      SDK_RPRINT(test, "TSMgmtHandleGet", "TestCase3", TC_FAIL, "read through a handle of the wrong type");
+      err = 1;
+    } else {
+      SDK_RPRINT(test, "TSMgmtHandleGet", "TestCase3", TC_PASS, "ok");
+    }
+  }
+
+  if (!err) {
+    TSMgmtInt sum_by_name = 0, sum_by_handle = 0;
+    ink_hrtime start = ink_get_hrtime_internal();
+
+    for (int i = 0; i < MGMT_HANDLE_TEST_READS; i++) {
+      TSMgmtIntGet(CONFIG_PARAM_INT_NAME, &ivalue);
+      sum_by_name += ivalue;
+    }
+
+    ink_hrtime by_name = ink_get_hrtime_internal() - start;
+
+    start = ink_get_hrtime_internal();
+    for (int i = 0; i < MGMT_HANDLE_TEST_READS; i++) {
+      TSMgmtHandleIntGet(in, &ivalue);
+      sum_by_handle += ivalue;
+    }
+
+    ink_hrtime by_handle = ink_get_hrtime_internal() - start;
+
+    if (sum_by_name != sum_by_handle) {
+      SDK_RPRINT(test, "TSMgmtHandleIntGet", "TestCase4", TC_FAIL, "reads disagree");
+      err = 1;
+    }
+    rprintf(test, "%d int reads: %d ns each by name, %d ns through a handle\n", MGMT_HANDLE_TEST_READS,
+            (int) (by_name / MGMT_HANDLE_TEST_READS), (int) (by_handle / MGMT_HANDLE_TEST_READS));
+    rperf(test, "mgmt_int_get_by_name_per_sec", (double) MGMT_HANDLE_TEST_READS * HRTIME_SECOND / (by_name ? by_name : 1));
+    rperf(test, "mgmt_int_get_by_handle_per_sec",
+          (double) MGMT_HANDLE_TEST_READS * HRTIME_SECOND / (by_handle ? by_handle : 1));
+  }
+
+  *pstatus = err ? REGRESSION_TEST_FAILED : REGRESSION_TEST_PASSED;
+  return;
+}
+
+
 //////////////////////////////////////////////
 //       SDK_API_TSConstant
 //
@@ -58,9 +58,13 @@ static const char *ParentResultStr[] = {
 static const char *ParentRRStr[] = {
   "false",
   "strict",
-  "true"
+  "true",
+  "consistent_hash"
 };
 
+// Virtual nodes on the consistent hash ring per unit of parent weight
+#define PARENT_HASH_VNODES 160
+
 //
 //  Config Callback Prototypes
 //
@@ -201,6 +205,8 @@ ParentConfigParams::parentExists(HttpRequestData * rdata)
   ParentResult junk;
 
   findParent(rdata, &junk);
+  // Nothing is sent to the parent, so don't leave it counted in flight
+  parentRequestDone(&junk);
 
   if (junk.r == PARENT_SPECIFIED) {
     return true;
@@ -421,6 +427,8 @@ ParentConfigParams::nextParent(HttpRequestData * rdata, ParentResult * result)
     result->r = PARENT_FAIL;
     return;
   }
+  // We are done with the parent that failed
+  parentRequestDone(result);
   // The epoch pointer is a legacy from the time when the tables
   //  would be swapped and deleted in the future.  I'm using the
   //  pointer now to ensure that the ParentConfigParams structure
@@ -471,10 +479,240 @@ ParentConfigParams::nextParent(HttpRequestData * rdata, ParentResult * result)
   }
 }
 
+void
+ParentConfigParams::parentRequestDone(ParentResult * result)
+{
+  if (result->in_flight == false) {
+    return;
+  }
+  result->in_flight = false;
+
+  ink_assert(result->rec != NULL && result->rec != extApiRecord);
+  ink_assert((int) (result->last_parent) < result->rec->num_parents);
+  ink_atomic_increment(&result->rec->parents[result->last_parent].in_flight, -1);
+  ink_atomic_increment(&result->rec->in_flight, -1);
+}
+
 //
 //   End API functions
 //
 
+static int
+hash_point_compare(const void *a, const void *b)
+{
+  uint64_t x = ((const pHashPoint *) a)->hash;
+  uint64_t y = ((const pHashPoint *) b)->hash;
+
+  return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+// static uint64_t parent_hash_key(HttpRequestData* rdata)
+//
+//   The point on the ring for a request.  This is the url MD5,
+//     the same thing the cache keys on, so a given object always
+//     lands on the same parent.
+//
+static uint64_t
+parent_hash_key(HttpRequestData * rdata)
+{
+  INK_MD5 md5;
+  URL *url = (rdata->hdr && rdata->hdr->valid()) ? rdata->hdr->url_get() : NULL;
+
+  if (url && url->valid()) {
+    url->MD5_get(&md5);
+  } else {
+    const char *host = rdata->get_host();
+
+    ink_code_md5((unsigned char *) host, host ? strlen(host) : 0, (unsigned char *) &md5);
+  }
+  return md5.fold();
+}
+
+// const char* ParentRecord::BuildRing()
+//
+//   Places PARENT_HASH_VNODES points per unit of weight on the
+//     ring for each parent.  The points only depend on the parent's
+//     own name, so adding or removing a parent moves just the keys
+//     on that parent's slices of the ring.
+//
+//   Returns NULL on success and a static error string
+//     on failure
+//
+const char *
+ParentRecord::BuildRing()
+{
+  char buf[MAXDNAME + 32];
+  int n = 0;
+
+  ats_free(ring);
+  ring = NULL;
+  ring_size = 0;
+  total_weight = 0;
+
+  if (num_parents == 0) {
+    return "No parents specified";
+  }
+
+  for (int i = 0; i < num_parents; i++) {
+    total_weight += parents[i].weight;
+    ring_size += MAX(1, (int) (parents[i].weight * PARENT_HASH_VNODES + 0.5));
+  }
+  ring = (pHashPoint *)ats_malloc(sizeof(pHashPoint) * ring_size);
+
+  for (int i = 0; i < num_parents; i++) {
+    int vnodes = MAX(1, (int) (parents[i].weight * PARENT_HASH_VNODES + 0.5));
+
+    for (int v = 0; v < vnodes; v++) {
+      INK_MD5 md5;
+      int len = snprintf(buf, sizeof(buf), "%s:%d-%d", parents[i].hostname, parents[i].port, v);
+
+      ink_code_md5((unsigned char *) buf, len, (unsigned char *) &md5);
+      ring[n].hash = md5.fold();
+      ring[n].parent = i;
+      n++;
+    }
+  }
+  qsort(ring, ring_size, sizeof(pHashPoint), hash_point_compare);
+
+  return NULL;
+}
+
+// void ParentRecord::FindParentHash(...)
+//
+//   FindParent for round_robin=consistent_hash.  Walks the ring
+//     clockwise from the request's point and takes the first parent
+//     that is up and not yet tried, so a down parent only sends its
+//     own keys elsewhere, spread over the parents that follow its
+//     points.  With a hash_load_factor, a parent carrying more than
+//     its share of the in flight requests times the factor is skipped
+//     too; the walk then spills to the next one.
+//
+void
+ParentRecord::FindParentHash(bool first_call, ParentResult * result, RD * rdata, ParentConfigParams * config)
+{
+  HttpRequestData *request_info = (HttpRequestData *) rdata;
+  bool bypass_ok = (go_direct == true && config->DNS_ParentOnly == 0);
+  uint32_t pos;
+  int chosen = -1;
+  uint32_t chosen_pos = 0;
+  int spill = -1;               // first parent that was up but over its bound
+  uint32_t spill_pos = 0;
+  uint64_t seen;
+
+  if (first_call == true) {
+    uint64_t key = parent_hash_key(request_info);
+    int lo = 0, hi = ring_size;
+
+    // First point at or after the key, wrapping around the ring
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+
+      if (ring[mid].hash < key) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    pos = result->start_parent = (lo == ring_size) ? 0 : lo;
+    result->tried = 0;
+  } else {
+    if (result->last_parent < 64) {
+      result->tried |= ((uint64_t) 1) << result->last_parent;
+    }
+    pos = (result->ring_pos + 1) % ring_size;
+  }
+
+  while (true) {
+    seen = result->tried;
+
+    for (int n = 0; n < ring_size; n++, pos = (pos + 1) % ring_size) {
+      int cur_index = ring[pos].parent;
+      pRecord *pRec = parents + cur_index;
+      bool parentRetry = false;
+
+      // Parents past the first 64 are not tracked, they are just
+      //   looked at again
+      if (cur_index < 64) {
+        if (seen & (((uint64_t) 1) << cur_index)) {
+          continue;
+        }
+        seen |= ((uint64_t) 1) << cur_index;
+      }
+
+      if (pRec->failedAt != 0 && pRec->failCount >= config->FailThreshold) {
+        if ((result->wrap_around) || ((pRec->failedAt + config->ParentRetryTime) < request_info->xact_start)) {
+          parentRetry = true;
+          Debug("parent_select", "Parent marked for retry %s:%d", pRec->hostname, pRec->port);
+        } else {
+          continue;
+        }
+      }
+
+      if (load_factor > 0 && parentRetry == false) {
+        // Bounded loads: ceil(factor * share of all in flight requests, this one included)
+        int32_t bound = (int32_t) ceil(load_factor * (in_flight + 1) * pRec->weight / total_weight);
+
+        if (pRec->in_flight >= bound) {
+          Debug("parent_select", "Parent %s:%d over its load bound (%d >= %d)", pRec->hostname, pRec->port,
+                pRec->in_flight, bound);
+          if (spill < 0) {
+            spill = cur_index;
+            spill_pos = pos;
+          }
+          continue;
+        }
+      }
+
+      chosen = cur_index;
+      chosen_pos = pos;
+      result->retry = parentRetry;
+      goto FOUND;
+    }
+
+    // Every up parent is over its bound; take the first one anyway
+    if (spill >= 0) {
+      chosen = spill;
+      chosen_pos = spill_pos;
+      result->retry = false;
+      goto FOUND;
+    }
+
+    if (bypass_ok == true || result->wrap_around == true) {
+      break;
+    }
+    // Bypass disabled so keep trying, ignoring whether we think
+    //   a parent is down or not
+    result->wrap_around = true;
+    result->tried = 0;
+    pos = result->start_parent;
+  }
+
+  // Could not find a parent
+  if (this->go_direct == true) {
+    result->r = PARENT_DIRECT;
+  } else {
+    result->r = PARENT_FAIL;
+  }
+  result->hostname = NULL;
+  result->port = 0;
+  return;
+
+FOUND:
+  result->r = PARENT_SPECIFIED;
+  result->hostname = parents[chosen].hostname;
+  result->port = parents[chosen].port;
+  result->last_parent = chosen;
+  result->ring_pos = chosen_pos;
+  if (load_factor > 0) {
+    ink_atomic_increment(&parents[chosen].in_flight, 1);
+    ink_atomic_increment(&in_flight, 1);
+    result->in_flight = true;
+  }
+  ink_assert(result->hostname != NULL);
+  ink_assert(result->port != 0);
+  Debug("parent_select", "Chosen parent = %s.%d", result->hostname, result->port);
+}
+
 void
 ParentRecord::FindParent(bool first_call, ParentResult * result, RD * rdata, ParentConfigParams * config)
 {
@@ -488,6 +726,11 @@ ParentRecord::FindParent(bool first_call, ParentResult * result, RD * rdata, Par
 
   ink_assert(num_parents > 0 || go_direct == true);
 
+  if (round_robin == P_CONSISTENT_HASH && parents != NULL) {
+    FindParentHash(first_call, result, rdata, config);
+    return;
+  }
+
   if (first_call == true) {
     if (parents == NULL) {
       // We should only get into this state if
@@ -650,6 +893,18 @@ ParentRecord::ProcessParents(char *val)
     //   port
     char *scan = tmp + 1;
     for (; *scan != '\0' && ParseRules::is_digit(*scan); scan++);
+    // Optional "|weight" for consistent hashing
+    this->parents[i].weight = 1.0;
+    if (*scan == '|') {
+      char *end;
+
+      this->parents[i].weight = (float) strtod(scan + 1, &end);
+      if (end == scan + 1 || this->parents[i].weight <= 0) {
+        errPtr = "Malformed parent weight";
+        goto MERROR;
+      }
+      scan = end;
+    }
     for (; *scan != '\0' && ParseRules::is_wslfcr(*scan); scan++);
     if (*scan != '\0') {
       errPtr = "Garbage trailing entry or invalid separator";
@@ -670,6 +925,7 @@ ParentRecord::ProcessParents(char *val)
     this->parents[i].port = port;
     this->parents[i].failedAt = 0;
     this->parents[i].scheme = scheme;
+    this->parents[i].in_flight = 0;
   }
 
   num_parents = numTok;
@@ -755,6 +1011,8 @@ ParentRecord::Init(matcher_line * line_info)
         round_robin = P_STRICT_ROUND_ROBIN;
       } else if (strcasecmp(val, "false") == 0) {
         round_robin = P_NO_ROUND_ROBIN;
+      } else if (strcasecmp(val, "consistent_hash") == 0) {
+        round_robin = P_CONSISTENT_HASH;
       } else {
         round_robin = P_NO_ROUND_ROBIN;
         errPtr = "invalid argument to round_robin directive";
@@ -763,6 +1021,15 @@ ParentRecord::Init(matcher_line * line_info)
     } else if (strcasecmp(label, "parent") == 0) {
       errPtr = ProcessParents(val);
       used = true;
+    } else if (strcasecmp(label, "hash_load_factor") == 0) {
+      char *end;
+
+      load_factor = (float) strtod(val, &end);
+      if (end == val || *end != '\0' || (load_factor != 0 && load_factor < 1.0)) {
+        load_factor = 0;
+        errPtr = "hash_load_factor must be 0 or at least 1.0";
+      }
+      used = true;
     } else if (strcasecmp(label, "go_direct") == 0) {
       if (strcasecmp(val, "false") == 0) {
         go_direct = false;
@@ -792,6 +1059,12 @@ ParentRecord::Init(matcher_line * line_info)
     snprintf(errBuf, errBufLen, "%s No parent specified in parent.config at line %d", modulePrefix, line_num);
     return errBuf;
   }
+
+  if (round_robin == P_CONSISTENT_HASH && this->parents != NULL && (errPtr = BuildRing()) != NULL) {
+    errBuf = (char *)ats_malloc(errBufLen * sizeof(char));
+    snprintf(errBuf, errBufLen, "%s %s at line %d", modulePrefix, errPtr, line_num);
+    return errBuf;
+  }
   // Process any modifiers to the directive, if they exist
   if (line_info->num_el > 0) {
     tmp = ProcessModifiers(line_info);
@@ -834,6 +1107,7 @@ ParentRecord::UpdateMatch(ParentResult * result, RD * rdata)
 ParentRecord::~ParentRecord()
 {
   ats_free(parents);
+  ats_free(ring);
 }
 
 void
@@ -844,6 +1118,9 @@ ParentRecord::Print()
     printf(" %s:%d ", parents[i].hostname, parents[i].port);
   }
   printf(" rr=%s direct=%s\n", ParentRRStr[round_robin], (go_direct == true) ? "true" : "false");
+  if (round_robin == P_CONSISTENT_HASH) {
+    printf("\t\t ring points=%d load_factor=%.2f\n", ring_size, load_factor);
+  }
 }
 
 // ParentRecord* createDefaultParent(char* val)
@@ -1227,6 +1504,184 @@ EXCLUSIVE_REGRESSION_TEST(PARENTSELECTION) (RegressionTest * t, int intensity_le
   *pstatus = (!fails ? REGRESSION_TEST_PASSED : REGRESSION_TEST_FAILED);
 }
 
+#include "TestBox.h"
+
+#define HASH_TEST_KEYS 20000
+#define HASH_TEST_PARENTS 10
+
+static ParentConfigParams *
+hash_test_params(int n_parents, const char *extra)
+{
+  ParentConfigParams *params = new ParentConfigParams();
+  char tbl[4096];
+  int len = snprintf(tbl, sizeof(tbl), "dest_domain=. parent=");
+
+  for (int i = 0; i < n_parents; i++) {
+    len += snprintf(tbl + len, sizeof(tbl) - len, "%sp%d.example.com:8080", i ? "," : "", i);
+  }
+  snprintf(tbl + len, sizeof(tbl) - len, " round_robin=consistent_hash %s\n", extra);
+
+  params->ParentEnable = 1;
+  params->FailThreshold = 1;
+  params->ParentRetryTime = 300;
+  params->ParentTable = new P_table("", "ParentSelection Hash Test Table", &http_dest_tags, ALLOW_HOST_TABLE | DONT_BUILD_TABLE);
+  params->ParentTable->BuildTableFromString(tbl);
+  return params;
+}
+
+// Returns the index of the parent chosen for object @a key, -1 if none
+static int
+hash_test_find(ParentConfigParams *params, HttpRequestData *request, int key, ParentResult *result)
+{
+  char url[64];
+  int len = snprintf(url, sizeof(url), "http://www.example.com/object/%d", key);
+
+  request->hdr->url_set(url, len);
+  params->findParent(request, result);
+  return (result->r == PARENT_SPECIFIED) ? (int) result->last_parent : -1;
+}
+
+static void
+hash_test_assign(ParentConfigParams *params, HttpRequestData *request, int *assigned)
+{
+  for (int i = 0; i < HASH_TEST_KEYS; i++) {
+    ParentResult result;
+
+    assigned[i] = hash_test_find(params, request, i, &result);
+  }
+}
+
+REGRESSION_TEST(PARENTSELECTION_ConsistentHash)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+  ParentConfigParams *params = hash_test_params(HASH_TEST_PARENTS, "");
+  ParentConfigParams *grown = hash_test_params(HASH_TEST_PARENTS + 1, "");
+  int *before = (int *)ats_malloc(HASH_TEST_KEYS * sizeof(int));
+  int *after = (int *)ats_malloc(HASH_TEST_KEYS * sizeof(int));
+  int counts[HASH_TEST_PARENTS + 1];
+  HttpRequestData request;
+  HTTPHdr hdr;
+  int moved, stray, modulo_moved = 0;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  hdr.create(HTTP_TYPE_REQUEST);
+  request.hdr = &hdr;
+  request.hostname_str = (char *) "www.example.com";
+  request.xact_start = time(NULL);
+
+  // Adding a parent should only move the keys the new parent takes over
+  hash_test_assign(params, &request, before);
+  hash_test_assign(grown, &request, after);
+  moved = stray = 0;
+  memset(counts, 0, sizeof(counts));
+  for (int i = 0; i < HASH_TEST_KEYS; i++) {
+    if (before[i] != after[i]) {
+      moved++;
+      stray += (after[i] != HASH_TEST_PARENTS);
+    }
+    if (before[i] >= 0) {
+      counts[before[i]]++;
+    }
+    // What a plain modulo over the same keys would do
+    modulo_moved += ((uint64_t) i * 0x9E3779B97F4A7C15ULL) % HASH_TEST_PARENTS !=
+      ((uint64_t) i * 0x9E3779B97F4A7C15ULL) % (HASH_TEST_PARENTS + 1);
+  }
+  tb.check(stray == 0, "%d keys moved between existing parents", stray);
+  tb.check(moved < HASH_TEST_KEYS * 2 / (HASH_TEST_PARENTS + 1), "%d of %d keys moved adding a parent", moved, HASH_TEST_KEYS);
+  for (int i = 0; i < HASH_TEST_PARENTS; i++) {
+    tb.check(counts[i] > HASH_TEST_KEYS / HASH_TEST_PARENTS / 2, "Parent %d only got %d keys", i, counts[i]);
+  }
+  rperf(t, "remap_fraction_add_parent", (double) moved / HASH_TEST_KEYS);
+  rperf(t, "remap_fraction_add_parent_modulo", (double) modulo_moved / HASH_TEST_KEYS);
+
+  // A down parent only gives up its own slice, spread over the others
+  {
+    ParentResult result;
+    int down = before[0];
+
+    hash_test_find(params, &request, 0, &result);
+    params->markParentDown(&result);
+    hash_test_assign(params, &request, after);
+
+    moved = stray = 0;
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < HASH_TEST_KEYS; i++) {
+      if (before[i] != after[i]) {
+        moved++;
+        stray += (before[i] != down);
+      }
+      if (before[i] == down && after[i] >= 0) {
+        counts[after[i]]++;
+      }
+    }
+    tb.check(stray == 0, "%d keys moved off parents that are up", stray);
+    tb.check(counts[down] == 0, "Keys still sent to the down parent");
+    int takers = 0;
+    for (int i = 0; i < HASH_TEST_PARENTS; i++) {
+      takers += (counts[i] > 0);
+    }
+    tb.check(takers > HASH_TEST_PARENTS / 2, "Down parent's keys went to only %d parents", takers);
+    rperf(t, "remap_fraction_parent_down", (double) moved / HASH_TEST_KEYS);
+
+    // Once a retry works the parent gets its keys back
+    result.retry = true;
+    params->recordRetrySuccess(&result);
+    hash_test_assign(params, &request, after);
+    tb.check(memcmp(before, after, HASH_TEST_KEYS * sizeof(int)) == 0, "Keys did not return to the restored parent");
+  }
+
+  // nextParent walks on to other parents for the same key
+  {
+    ParentResult result;
+    int first = hash_test_find(params, &request, 7, &result);
+
+    params->nextParent(&request, &result);
+    tb.check(result.r == PARENT_SPECIFIED && (int) result.last_parent != first, "nextParent returned the same parent");
+  }
+
+  delete params;
+  delete grown;
+
+  // Bounded loads: one hot object spills over once its parent is full
+  {
+    ParentConfigParams *bounded = hash_test_params(HASH_TEST_PARENTS, "hash_load_factor=1.25");
+    ParentResult *results = new ParentResult[1000];
+    ParentRecord *rec;
+    int max_load = 0;
+
+    for (int i = 0; i < 1000; i++) {
+      hash_test_find(bounded, &request, 42, &results[i]);
+    }
+    rec = results[0].rec;
+    tb.check(rec != NULL && rec->in_flight == 1000, "In flight total is wrong");
+    for (int i = 0; rec && i < rec->num_parents; i++) {
+      max_load = MAX(max_load, rec->parents[i].in_flight);
+    }
+    tb.check(max_load <= 125, "A parent has %d of 1000 requests in flight", max_load);
+    rprintf(t, "bounded: busiest parent has %d of 1000 in flight\n", max_load);
+
+    for (int i = 0; i < 1000; i++) {
+      bounded->parentRequestDone(&results[i]);
+      bounded->parentRequestDone(&results[i]);
+    }
+    tb.check(rec != NULL && rec->in_flight == 0 && rec->parents[results[0].last_parent].in_flight == 0,
+             "In flight counts did not drain");
+
+    // Only asking whether there is a parent must not count as a request
+    tb.check(bounded->parentExists(&request), "No parent for the hot object");
+    tb.check(rec != NULL && rec->in_flight == 0, "parentExists left %d requests in flight", rec ? rec->in_flight : -1);
+    delete[] results;
+    delete bounded;
+  }
+
+  hdr.destroy();
+  request.hdr = NULL;
+  request.hostname_str = NULL;
+  ats_free(before);
+  ats_free(after);
+}
+
 // verify returns 1 iff the test passes
 int
 verify(ParentResult * r, ParentResultType e, const char *h, int p)
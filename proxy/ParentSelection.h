@@ -62,7 +62,8 @@ struct ParentResult
 {
   ParentResult()
     : r(PARENT_UNDEFINED), hostname(NULL), port(0), line_number(0), epoch(NULL), rec(NULL),
-      last_parent(0), start_parent(0), wrap_around(false), retry(false)
+      last_parent(0), start_parent(0), wrap_around(false), retry(false),
+      ring_pos(0), tried(0), in_flight(false)
   { };
 
   // For outside consumption
@@ -79,6 +80,10 @@ struct ParentResult
   uint32_t start_parent;
   bool wrap_around;
   bool retry;
+  // consistent hash state
+  uint32_t ring_pos;            // ring point of last_parent
+  uint64_t tried;               // parents already handed out, by index (first 64)
+  bool in_flight;               // last_parent's in flight count includes us
 };
 
 class HttpRequestData;
@@ -114,6 +119,14 @@ struct ParentConfigParams:public ConfigInfo
   //
   inkcoreapi void nextParent(HttpRequestData *rdata, ParentResult *result);
 
+  // void parentRequestDone(ParentResult* result)
+  //
+  //    Http calls this when it is done with the parent in result, so
+  //      the parent's in flight count used for bounded load consistent
+  //      hashing is released.  Safe to call more than once.
+  //
+  inkcoreapi void parentRequestDone(ParentResult *result);
+
   // bool parentExists(HttpRequestData* rdata)
   //
   //   Returns true if there is a parent matching the request data and
@@ -163,13 +176,26 @@ struct pRecord
   int failCount;
   int32_t upAt;
   const char *scheme;           // for which parent matches (if any)
+  float weight;                 // share of the consistent hash ring
+  volatile int32_t in_flight;   // requests out to this parent (bounded loads only)
+};
+
+// struct pHashPoint
+//
+//    A virtual node on the consistent hash ring of a ParentRecord
+//
+struct pHashPoint
+{
+  uint64_t hash;
+  int parent;
 };
 
 enum ParentRR_t
 {
   P_NO_ROUND_ROBIN = 0,
   P_STRICT_ROUND_ROBIN,
-  P_HASH_ROUND_ROBIN
+  P_HASH_ROUND_ROBIN,
+  P_CONSISTENT_HASH
 };
 
 // class ParentRecord : public ControlBase
@@ -181,7 +207,8 @@ class ParentRecord: public ControlBase
 {
 public:
   ParentRecord()
-    : parents(NULL), num_parents(0), round_robin(P_NO_ROUND_ROBIN), rr_next(0), go_direct(true)
+    : parents(NULL), num_parents(0), round_robin(P_NO_ROUND_ROBIN), rr_next(0), go_direct(true),
+      ring(NULL), ring_size(0), load_factor(0), total_weight(0), in_flight(0)
   { }
 
   ~ParentRecord();
@@ -202,6 +229,15 @@ public:
   ParentRR_t round_robin;
   volatile uint32_t rr_next;
   bool go_direct;
+
+  // Consistent hashing (round_robin=consistent_hash)
+  const char *BuildRing();
+  void FindParentHash(bool firstCall, ParentResult *result, RD *rdata, ParentConfigParams *config);
+  pHashPoint *ring;             // sorted by hash
+  int ring_size;
+  float load_factor;            // hash_load_factor, 0 for unbounded
+  float total_weight;
+  volatile int32_t in_flight;   // sum of the parents' in_flight
 };
 
 // Helper Functions
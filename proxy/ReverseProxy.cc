@@ -46,6 +46,7 @@
 
 /** Time till we free the old stuff after a reconfiguration. */
 #define URL_REWRITE_TIMEOUT            (HRTIME_SECOND*60)
+#define URL_REWRITE_RETRY              (HRTIME_SECOND*10)
 
 // Global Ptrs
 static Ptr<ProxyMutex> reconfig_mutex;
@@ -116,13 +117,47 @@ request_url_remap(HttpTransact::State * s, HTTPHdr * request_header, char **redi
 mapping_type
 request_url_remap_redirect(HTTPHdr *request_header, URL *redirect_url)
 {
-  return rewrite_table ? rewrite_table->Remap_redirect(request_header, redirect_url) : NONE;
+  UrlRewrite *table = acquireUrlRewrite();
+  mapping_type result = table ? table->Remap_redirect(request_header, redirect_url) : NONE;
+
+  releaseUrlRewrite(table);
+  return result;
 }
 
 bool
 response_url_remap(HTTPHdr *response_header)
 {
-  return rewrite_table ? rewrite_table->ReverseMap(response_header) : false;
+  UrlRewrite *table = acquireUrlRewrite();
+  bool result = table ? table->ReverseMap(response_header) : false;
+
+  releaseUrlRewrite(table);
+  return result;
+}
+
+/**
+  Pins the current remap table.  Lookups never lock: the pin is a per
+  thread counter, and a replaced table is only freed once it has gone
+  unpinned after the reload grace period.  Every call must be matched
+  by releaseUrlRewrite().
+
+*/
+UrlRewrite *
+acquireUrlRewrite()
+{
+  UrlRewrite *table = rewrite_table;
+
+  if (table) {
+    table->acquire();
+  }
+  return table;
+}
+
+void
+releaseUrlRewrite(UrlRewrite *table)
+{
+  if (table) {
+    table->release();
+  }
 }
  
 
@@ -163,6 +198,14 @@ struct UR_FreerContinuation: public Continuation
   {
     NOWARN_UNUSED(event);
     NOWARN_UNUSED(e);
+    // The grace period covers readers that loaded rewrite_table just
+    // before the swap but had not pinned it yet; after that only the
+    // pins of live transactions can keep the table around.
+    if (p->in_use()) {
+      Debug("url_rewrite", "Old remap.config table still in use, checking again later");
+      eventProcessor.schedule_in(this, URL_REWRITE_RETRY, ET_TASK);
+      return EVENT_DONE;
+    }
     Debug("url_rewrite", "Deleting old remap.config table");
     delete p;
     delete this;
@@ -186,10 +229,13 @@ reloadUrlRewrite()
   UrlRewrite *newTable;
 
   Debug("url_rewrite", "remap.config updated, reloading...");
-  newTable = new UrlRewrite("proxy.config.url_remap.filename");
+  // Unchanged host entries are shared with the live table, which can't
+  // go away under us since reloads are serialized on reconfig_mutex.
+  newTable = new UrlRewrite("proxy.config.url_remap.filename", rewrite_table);
   if (newTable->is_valid()) {
     eventProcessor.schedule_in(new UR_FreerContinuation(rewrite_table), URL_REWRITE_TIMEOUT, ET_TASK);
-    Debug("url_rewrite", "remap.config done reloading!");
+    Debug("url_rewrite", "remap.config done reloading! %d host entries shared, %d rebuilt",
+          newTable->num_entries_reused, newTable->num_entries_built);
     ink_atomic_swap(&rewrite_table, newTable);
   } else {
     static const char* msg = "failed to reload remap.config, not replacing!";
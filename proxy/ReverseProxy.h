@@ -64,6 +64,10 @@ bool request_url_remap(HttpTransact::State *s, HTTPHdr *request_header, char **r
 mapping_type request_url_remap_redirect(HTTPHdr *request_header, URL *redirect_url);
 bool response_url_remap(HTTPHdr *response_header);
 
+// Pin the live remap table for the duration of a lookup or transaction
+UrlRewrite *acquireUrlRewrite();
+void releaseUrlRewrite(UrlRewrite *table);
+
 // Reload Functions
 void reloadUrlRewrite();
 
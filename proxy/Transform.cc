@@ -110,6 +110,16 @@ TransformProcessor::null_transform(ProxyMutex *mutex)
 }
 
 
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+TransformChain *
+TransformProcessor::chain_transform(ProxyMutex *mutex)
+{
+  return NEW(new TransformChain(mutex));
+}
+
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
@@ -698,6 +708,224 @@ NullTransform::handle_event(int event, void *edata)
 }
 
 
+/*-------------------------------------------------------------------------
+  Make the first block readable from in private to in's buffer, copying
+  its data if another block still shares it, and return where the
+  readable bytes start.  The *avail bytes from there may be edited in
+  place.
+  -------------------------------------------------------------------------*/
+
+char *
+TransformStage::writable_start(IOBufferReader *in, int64_t *avail)
+{
+  IOBufferBlock *b;
+
+  in->skip_empty_blocks();
+  b = in->get_current_block();
+  if (b == NULL) {
+    *avail = 0;
+    return NULL;
+  }
+
+  if (b->data->refcount() > 1) {
+    int64_t len = b->read_avail();
+    IOBufferData *d = new_IOBufferData(iobuffer_size_to_index(len));
+
+    memcpy(d->data(), b->start(), len);
+    b->set(d, len);
+    b->_buf_end = b->_end;      // still not appendable
+  }
+
+  *avail = in->block_read_avail();
+  return in->start();
+}
+
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+TransformChain::TransformChain(ProxyMutex *_mutex)
+  : INKVConnInternal(NULL, reinterpret_cast<TSMutex>(_mutex)),
+    m_stages(), m_num_stages(0), m_bufs(NULL), m_readers(NULL), m_output_vio(NULL), m_output_done(0), m_eos_done(false)
+{
+  SET_HANDLER(&TransformChain::handle_event);
+
+  Debug("transform", "TransformChain create [%p]", this);
+}
+
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+TransformChain::~TransformChain()
+{
+  TransformStage *stage;
+
+  while ((stage = m_stages.pop()) != NULL) {
+    delete stage;
+  }
+  if (m_bufs) {
+    for (int i = 0; i <= m_num_stages; i++) {
+      free_MIOBuffer(m_bufs[i]);
+    }
+    ats_free(m_bufs);
+    ats_free(m_readers);
+  }
+}
+
+/*-------------------------------------------------------------------------
+  Stages are added before the chain sees its first event.
+  -------------------------------------------------------------------------*/
+
+void
+TransformChain::add_stage(TransformStage *stage)
+{
+  ink_assert(m_bufs == NULL);
+  m_stages.enqueue(stage);
+  ++m_num_stages;
+}
+
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+void
+TransformChain::init_buffers()
+{
+  m_bufs = (MIOBuffer **)ats_malloc((m_num_stages + 1) * sizeof(MIOBuffer *));
+  m_readers = (IOBufferReader **)ats_malloc((m_num_stages + 1) * sizeof(IOBufferReader *));
+  for (int i = 0; i <= m_num_stages; i++) {
+    m_bufs[i] = new_empty_MIOBuffer();
+    m_readers[i] = m_bufs[i]->alloc_reader();
+  }
+}
+
+/*-------------------------------------------------------------------------
+  Run every stage over what is waiting for it.  The last buffer is read
+  by the output VConnection, so the bytes it gains are the chain's
+  output.
+  -------------------------------------------------------------------------*/
+
+bool
+TransformChain::run_stages(bool eos)
+{
+  IOBufferReader *output_reader = m_readers[m_num_stages];
+  int64_t output_avail = output_reader->read_avail();
+  int i = 0;
+
+  for (TransformStage *stage = m_stages.head; stage; stage = stage->link.next, i++) {
+    if (!stage->transform(m_readers[i], m_bufs[i + 1], eos)) {
+      Debug("transform", "[TransformChain::run_stages] stage %d failed [%p]", i, this);
+      return false;
+    }
+  }
+
+  m_output_done += output_reader->read_avail() - output_avail;
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+int
+TransformChain::handle_event(int event, void *edata)
+{
+  handle_event_count(event);
+
+  Debug("transform", "[TransformChain::handle_event] event count %d", m_event_count);
+
+  if (m_closed) {
+    if (m_deletable) {
+      Debug("transform", "TransformChain destroy: %" PRId64" [%p]", m_output_done, this);
+      delete this;
+    }
+  } else {
+    switch (event) {
+    case VC_EVENT_ERROR:
+      m_write_vio._cont->handleEvent(VC_EVENT_ERROR, &m_write_vio);
+      break;
+    case VC_EVENT_WRITE_COMPLETE:
+      ink_assert(m_output_vio == (VIO *) edata);
+      ink_assert(m_write_vio.ntodo() == 0);
+
+      m_output_vc->do_io_shutdown(IO_SHUTDOWN_WRITE);
+      break;
+    case VC_EVENT_WRITE_READY:
+    default:
+      {
+        int64_t towrite;
+        int64_t avail;
+
+        ink_assert(m_output_vc != NULL);
+
+        if (!m_output_vio) {
+          init_buffers();
+          m_output_vio = m_output_vc->do_io_write(this, INT64_MAX, m_readers[m_num_stages]);
+        }
+
+        MUTEX_TRY_LOCK(trylock, m_write_vio.mutex, this_ethread());
+        if (!trylock) {
+          retry(10);
+          return 0;
+        }
+
+        if (m_closed) {
+          return 0;
+        }
+
+        if (m_write_vio.op == VIO::NONE) {
+          m_output_vio->nbytes = m_output_done;
+          m_output_vio->reenable();
+          return 0;
+        }
+
+        // Whatever the producer writes from its WRITE_READY callback is
+        // taken in the same event, so a chain costs one event per burst
+        // of input rather than one per block.
+        do {
+          towrite = m_write_vio.ntodo();
+          avail = m_write_vio.get_reader()->read_avail();
+          if (towrite > avail) {
+            towrite = avail;
+          }
+
+          if (towrite > 0) {
+            m_bufs[0]->write(m_write_vio.get_reader(), towrite);
+            m_write_vio.get_reader()->consume(towrite);
+            m_write_vio.ndone += towrite;
+          }
+
+          if (m_write_vio.ntodo() <= 0) {
+            if (!m_eos_done) {
+              m_eos_done = true;
+              if (!run_stages(true)) {
+                m_write_vio._cont->handleEvent(VC_EVENT_ERROR, &m_write_vio);
+                return 0;
+              }
+            }
+            m_output_vio->nbytes = m_output_done;
+            m_output_vio->reenable();
+            m_write_vio._cont->handleEvent(VC_EVENT_WRITE_COMPLETE, &m_write_vio);
+            return 0;
+          }
+
+          if (towrite <= 0) {
+            break;
+          }
+          if (!run_stages(false)) {
+            m_write_vio._cont->handleEvent(VC_EVENT_ERROR, &m_write_vio);
+            return 0;
+          }
+          m_output_vio->reenable();
+          m_write_vio._cont->handleEvent(VC_EVENT_WRITE_READY, &m_write_vio);
+        } while (!m_closed && m_write_vio.op == VIO::WRITE && m_write_vio.get_reader()->read_avail() > 0);
+
+        break;
+      }
+    }
+  }
+
+  return 0;
+}
+
+
 /*-------------------------------------------------------------------------
   Reasons the JG transform cannot currently be a plugin:
     a) Uses the config system
@@ -1021,4 +1249,327 @@ RangeTransform::change_response_header()
 
 #undef RANGE_NUMBERS_LENGTH
 
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+
+/*-------------------------------------------------------------------------
+  Push a body through three transforms, as a chain of transform
+  VConnections and as one TransformChain, a block at a time.  Both are
+  timed end to end, so they include every wakeup and reschedule on the
+  way; the same three stages called directly, with no events at all,
+  give the cost of the transform work itself.
+  -------------------------------------------------------------------------*/
+
+#define TRANSFORM_BENCH_BLOCK_SIZE  BUFFER_SIZE_FOR_INDEX(BUFFER_SIZE_INDEX_32K)
+#define TRANSFORM_BENCH_BLOCKS      512
+
+static const char transform_bench_prefix[] = "<!-- transformed -->";
+
+struct PassStage:public TransformStage
+{
+  bool transform(IOBufferReader *in, MIOBuffer *out, bool /* eos ATS_UNUSED */)
+  {
+    int64_t n = in->read_avail();
+
+    out->write(in, n);
+    in->consume(n);
+    return true;
+  }
+};
+
+struct PrefixStage:public TransformStage
+{
+  bool written;
+
+  PrefixStage():written(false) { }
+
+  bool transform(IOBufferReader *in, MIOBuffer *out, bool /* eos ATS_UNUSED */)
+  {
+    int64_t n = in->read_avail();
+
+    if (!written) {
+      out->write(transform_bench_prefix, sizeof(transform_bench_prefix) - 1);
+      written = true;
+    }
+    out->write(in, n);
+    in->consume(n);
+    return true;
+  }
+};
+
+struct UpperCaseStage:public TransformStage
+{
+  bool transform(IOBufferReader *in, MIOBuffer *out, bool /* eos ATS_UNUSED */)
+  {
+    int64_t avail;
+    char *p;
+
+    while ((p = writable_start(in, &avail)) != NULL && avail > 0) {
+      for (int64_t i = 0; i < avail; i++) {
+        p[i] = ParseRules::ink_toupper(p[i]);
+      }
+      out->write(in, avail);
+      in->consume(avail);
+    }
+    return true;
+  }
+};
+
+// The three pass stages of TRANSFORM_BENCH_CHAIN, called one after the
+//   other on each block as TransformChain::run_stages() does
+static ink_hrtime
+transform_bench_inline(IOBufferBlock *pattern, int64_t *received)
+{
+  PassStage stages[3];
+  MIOBuffer *bufs[4];
+  IOBufferReader *readers[4];
+  ink_hrtime start, elapsed;
+
+  for (int i = 0; i < 4; i++) {
+    bufs[i] = new_empty_MIOBuffer(BUFFER_SIZE_INDEX_32K);
+    readers[i] = bufs[i]->alloc_reader();
+  }
+  *received = 0;
+  start = ink_get_hrtime_internal();
+  for (int b = 0; b < TRANSFORM_BENCH_BLOCKS; b++) {
+    bufs[0]->append_block(pattern->clone());
+    for (int i = 0; i < 3; i++) {
+      stages[i].transform(readers[i], bufs[i + 1], b == TRANSFORM_BENCH_BLOCKS - 1);
+    }
+    *received += readers[3]->read_avail();
+    readers[3]->consume(readers[3]->read_avail());
+  }
+  elapsed = ink_get_hrtime_internal() - start;
+  for (int i = 0; i < 4; i++) {
+    free_MIOBuffer(bufs[i]);
+  }
+  return elapsed;
+}
+
+enum TransformBenchMode
+{
+  TRANSFORM_BENCH_VCONNECTIONS,
+  TRANSFORM_BENCH_CHAIN,
+  TRANSFORM_BENCH_CHAIN_EDIT,
+  TRANSFORM_BENCH_MODES
+};
+
+static const char *transform_bench_names[] = { "3 transform VConnections", "TransformChain of 3 stages",
+                                               "TransformChain upper case+prefix+pass" };
+
+struct TransformBench:public Continuation
+{
+  RegressionTest *t;
+  int *pstatus;
+  int mode;
+  HttpAPIHooks *hooks;
+  VConnection *tvc;
+  Ptr<IOBufferBlock> pattern;
+  MIOBuffer *input;
+  MIOBuffer *output;
+  IOBufferReader *output_reader;
+  VIO *write_vio;
+  VIO *read_vio;
+  int blocks_written;
+  int64_t received;
+  bool output_ok;
+  ink_hrtime start_time;
+  ink_hrtime elapsed[TRANSFORM_BENCH_MODES];
+  char upper[TRANSFORM_BENCH_BLOCK_SIZE];
+
+  TransformBench(RegressionTest *_t, int *_pstatus)
+    : Continuation(new_ProxyMutex()), t(_t), pstatus(_pstatus), mode(0), hooks(NULL), tvc(NULL), input(NULL), output(NULL),
+      output_reader(NULL), write_vio(NULL), read_vio(NULL), blocks_written(0), received(0), output_ok(true), start_time(0)
+  {
+    pattern = new_IOBufferBlock();
+    pattern->alloc(BUFFER_SIZE_INDEX_32K);
+    for (int i = 0; i < TRANSFORM_BENCH_BLOCK_SIZE; i++) {
+      pattern->end()[i] = 'a' + i % 26;
+      upper[i] = 'A' + i % 26;
+    }
+    pattern->fill(TRANSFORM_BENCH_BLOCK_SIZE);
+    SET_HANDLER(&TransformBench::start_event);
+  }
+
+  ~TransformBench()
+  {
+    pattern = NULL;
+    mutex = NULL;
+  }
+
+  // Compare output at @a offset with what the edit mode should produce
+  bool edited_output_ok(int64_t offset, const char *p, int64_t len)
+  {
+    const int64_t prefix_len = sizeof(transform_bench_prefix) - 1;
+
+    for (int64_t i = 0, n; i < len; i += n) {
+      if (offset + i < prefix_len) {
+        n = 1;
+        if (p[i] != transform_bench_prefix[offset + i])
+          return false;
+      } else {
+        int64_t o = (offset + i - prefix_len) % TRANSFORM_BENCH_BLOCK_SIZE;
+
+        n = min(len - i, (int64_t) TRANSFORM_BENCH_BLOCK_SIZE - o);
+        if (memcmp(p + i, upper + o, n) != 0)
+          return false;
+      }
+    }
+    return true;
+  }
+
+  int64_t expected_length()
+  {
+    int64_t len = (int64_t) TRANSFORM_BENCH_BLOCKS * TRANSFORM_BENCH_BLOCK_SIZE;
+
+    return mode == TRANSFORM_BENCH_CHAIN_EDIT ? len + sizeof(transform_bench_prefix) - 1 : len;
+  }
+
+  void start_mode()
+  {
+    hooks = NEW(new HttpAPIHooks);
+    if (mode == TRANSFORM_BENCH_VCONNECTIONS) {
+      for (int i = 0; i < 3; i++) {
+        hooks->append(TS_HTTP_RESPONSE_TRANSFORM_HOOK, transformProcessor.null_transform(mutex));
+      }
+    } else {
+      TransformChain *chain = transformProcessor.chain_transform(mutex);
+
+      if (mode == TRANSFORM_BENCH_CHAIN) {
+        chain->add_stage(NEW(new PassStage));
+        chain->add_stage(NEW(new PassStage));
+      } else {
+        chain->add_stage(NEW(new UpperCaseStage));
+        chain->add_stage(NEW(new PrefixStage));
+      }
+      chain->add_stage(NEW(new PassStage));
+      hooks->append(TS_HTTP_RESPONSE_TRANSFORM_HOOK, chain);
+    }
+
+    tvc = transformProcessor.open(this, hooks->get(TS_HTTP_RESPONSE_TRANSFORM_HOOK));
+    input = new_empty_MIOBuffer(BUFFER_SIZE_INDEX_32K);
+    blocks_written = 0;
+    received = 0;
+    output_ok = true;
+    start_time = ink_get_hrtime_internal();
+    write_block();
+    write_vio = tvc->do_io_write(this, (int64_t) TRANSFORM_BENCH_BLOCKS * TRANSFORM_BENCH_BLOCK_SIZE,
+                                 input->alloc_reader());
+  }
+
+  void write_block()
+  {
+    input->append_block(pattern->clone());
+    ++blocks_written;
+  }
+
+  void read_output()
+  {
+    int64_t avail;
+
+    while ((avail = output_reader->block_read_avail()) > 0) {
+      // the pass-through modes are timed, so check them only by length
+      if (mode == TRANSFORM_BENCH_CHAIN_EDIT) {
+        output_ok = output_ok && edited_output_ok(received, output_reader->start(), avail);
+      }
+      received += avail;
+      output_reader->consume(avail);
+    }
+  }
+
+  void finish_mode(bool error)
+  {
+    elapsed[mode] = ink_get_hrtime_internal() - start_time;
+
+    TestBox tb(t, pstatus);
+    tb.check(!error, "%s: transform error", transform_bench_names[mode]);
+    tb.check(received == expected_length(), "%s: %d bytes out, expected %d", transform_bench_names[mode],
+             (int) received, (int) expected_length());
+    tb.check(output_ok, "%s: output differs", transform_bench_names[mode]);
+    tb.check(memcmp(pattern->start(), "abcdefghijklmnopqrstuvwxyzab", 28) == 0, "%s: input blocks edited",
+             transform_bench_names[mode]);
+
+    tvc->do_io_close();
+    tvc = NULL;
+    free_MIOBuffer(input);
+    input = NULL;
+    if (output) {
+      free_MIOBuffer(output);
+      output = NULL;
+    }
+    delete hooks;
+    hooks = NULL;
+
+    if (++mode < TRANSFORM_BENCH_MODES) {
+      start_mode();
+      return;
+    }
+
+    int64_t inline_received;
+    ink_hrtime inline_elapsed = transform_bench_inline(pattern, &inline_received);
+
+    tb.check(inline_received == (int64_t) TRANSFORM_BENCH_BLOCKS * TRANSFORM_BENCH_BLOCK_SIZE,
+             "3 stages called directly: %d bytes out", (int) inline_received);
+    for (int i = 0; i < TRANSFORM_BENCH_MODES; i++) {
+      rprintf(t, "%s: %d us end to end for %d blocks, %d ns per block\n", transform_bench_names[i],
+              (int) (elapsed[i] / HRTIME_USECOND), TRANSFORM_BENCH_BLOCKS, (int) (elapsed[i] / TRANSFORM_BENCH_BLOCKS));
+    }
+    rprintf(t, "3 stages called directly: %d us for %d blocks, %d ns per block\n", (int) (inline_elapsed / HRTIME_USECOND),
+            TRANSFORM_BENCH_BLOCKS, (int) (inline_elapsed / TRANSFORM_BENCH_BLOCKS));
+    rperf(t, "vconnection_chain_end_to_end_ns_per_block", (double) elapsed[TRANSFORM_BENCH_VCONNECTIONS] / TRANSFORM_BENCH_BLOCKS);
+    rperf(t, "transform_chain_end_to_end_ns_per_block", (double) elapsed[TRANSFORM_BENCH_CHAIN] / TRANSFORM_BENCH_BLOCKS);
+    rperf(t, "stages_direct_ns_per_block", (double) inline_elapsed / TRANSFORM_BENCH_BLOCKS);
+    if (*pstatus == REGRESSION_TEST_INPROGRESS)
+      *pstatus = REGRESSION_TEST_PASSED;
+    delete this;
+  }
+
+  int start_event(int /* event ATS_UNUSED */, void * /* edata ATS_UNUSED */)
+  {
+    SET_HANDLER(&TransformBench::main_event);
+    start_mode();
+    return EVENT_DONE;
+  }
+
+  int main_event(int event, void * /* edata ATS_UNUSED */)
+  {
+    switch (event) {
+    case TRANSFORM_READ_READY:
+      output = new_empty_MIOBuffer(BUFFER_SIZE_INDEX_32K);
+      output_reader = output->alloc_reader();
+      read_vio = tvc->do_io_read(this, INT64_MAX, output);
+      break;
+    case VC_EVENT_WRITE_READY:
+      if (blocks_written < TRANSFORM_BENCH_BLOCKS) {
+        write_block();
+        write_vio->reenable();
+      }
+      break;
+    case VC_EVENT_WRITE_COMPLETE:
+      break;
+    case VC_EVENT_READ_READY:
+      read_output();
+      read_vio->reenable();
+      break;
+    case VC_EVENT_READ_COMPLETE:
+    case VC_EVENT_EOS:
+      read_output();
+      finish_mode(false);
+      break;
+    default:
+      finish_mode(true);
+      break;
+    }
+    return EVENT_CONT;
+  }
+};
+
+REGRESSION_TEST(Transform_Chain)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  eventProcessor.schedule_imm(NEW(new TransformBench(t, pstatus)), ET_NET);
+}
+#endif /* TS_HAS_TESTS */
+
 #endif // TS_NO_TRANSFORM
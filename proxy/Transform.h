@@ -41,6 +41,8 @@ typedef struct _RangeRecord
   int64_t _done_byte;
 } RangeRecord;
 
+class TransformChain;
+
 class TransformProcessor
 {
 public:
@@ -49,6 +51,7 @@ public:
 public:
   VConnection * open(Continuation * cont, APIHook * hooks);
   INKVConnInternal *null_transform(ProxyMutex * mutex);
+  TransformChain *chain_transform(ProxyMutex * mutex);
   INKVConnInternal *range_transform(ProxyMutex * mutex, RangeRecord * ranges, int, HTTPHdr *, const char * content_type, int content_type_len, int64_t content_length);
 };
 
@@ -112,6 +112,64 @@ public:
 };
 
 
+/** One stage of a TransformChain.
+
+    Stages run synchronously, one after the other, on the chain's
+    thread and lock, each time more of the body reaches the chain.
+    transform() must consume what it handles from @a in, leaving any
+    partial input for the next call, and append its output to @a out.
+    Input should be passed on by reference with MIOBuffer::write(),
+    which shares the IOBufferBlock data, and edited in place through
+    writable_start() rather than copied.  @a eos is true on the last
+    call, once all of the body is in @a in.
+
+    @return false to abort the transform.
+ */
+class TransformStage
+{
+public:
+  virtual ~TransformStage()
+  {
+  }
+
+  virtual bool transform(IOBufferReader * in, MIOBuffer * out, bool eos) = 0;
+
+  static char *writable_start(IOBufferReader * in, int64_t * avail);
+
+  LINK(TransformStage, link);
+};
+
+
+/** A transform VConnection running a list of TransformStages.
+
+    Between stages the blocks stay in private MIOBuffers, so a body
+    passes through the whole chain in one event per burst of input, not
+    one VConnection, event dispatch and lock attempt per stage.
+ */
+class TransformChain:public INKVConnInternal
+{
+public:
+  TransformChain(ProxyMutex * mutex);
+  ~TransformChain();
+
+  void add_stage(TransformStage * stage);
+  int handle_event(int event, void *edata);
+
+private:
+  void init_buffers();
+  bool run_stages(bool eos);
+
+public:
+  Queue<TransformStage> m_stages;
+  int m_num_stages;
+  MIOBuffer **m_bufs;           // input of each stage, then the output
+  IOBufferReader **m_readers;
+  VIO *m_output_vio;
+  int64_t m_output_done;
+  bool m_eos_done;
+};
+
+
 class RangeTransform:public INKVConnInternal
 {
 public:
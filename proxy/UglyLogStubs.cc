@@ -96,7 +96,9 @@ LogCollationClientSM::LogCollationClientSM(LogHost * log_host):
   m_pending_event(NULL),
   m_abort_vio(NULL),
   m_abort_buffer(NULL),
-  m_buffer_send_list(NULL), m_buffer_in_iocore(NULL), m_flow(LOG_COLL_FLOW_ALLOW), m_log_host(log_host), m_id(0)
+  m_buffer_send_list(NULL), m_flow(LOG_COLL_FLOW_ALLOW), m_deflater(NULL),
+  m_window(NULL), m_window_size(0), m_window_head(0), m_window_count(0), m_window_end(0),
+  m_log_host(log_host), m_id(0)
 {
 }
 
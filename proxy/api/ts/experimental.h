@@ -109,6 +109,38 @@ extern "C"
    ****************************************************************************/
   tsapi void TSHttpTxnServerRequestBodySet(TSHttpTxn txnp, char *buf, int64_t buflength);
 
+  /****************************************************************************
+   *  Transform chains.  A chain is one transform VConnection running a    *
+   *  list of stage functions synchronously, in the order added, for each  *
+   *  block of the body.  Blocks are handed between stages in private      *
+   *  buffers instead of through a transform VConnection per stage.  A     *
+   *  stage consumes what it handles from input and writes its output to   *
+   *  output, preferably with TSIOBufferCopy(), which shares the data.     *
+   *  eos is non-zero on the last call.  Returning TS_ERROR aborts the     *
+   *  transform.  edata is owned by the caller and must outlive the        *
+   *  transaction.  Add the chain to a transform hook with                 *
+   *  TSHttpTxnHookAdd() like any transform.                               *
+   ****************************************************************************/
+  typedef TSReturnCode (*TSTransformStageFunc) (TSIOBufferReader input, TSIOBuffer output, int eos, void *edata);
+
+  tsapi TSVConn TSTransformChainCreate(TSHttpTxn txnp);
+  tsapi void TSTransformChainStageAdd(TSVConn chainp, TSTransformStageFunc funcp, void *edata);
+
+  /****************************************************************************
+   *  Record handles.  TSMgmtHandleGet() resolves the record named         *
+   *  var_name once; the TSMgmtHandle*Get functions then read it without   *
+   *  looking it up again, and take no lock to read an int, counter or     *
+   *  float.  A handle stays valid for the life of the process.            *
+   *  TSMgmtHandleGet() returns NULL if there is no such record.           *
+   ****************************************************************************/
+  typedef struct tsapi_mgmthandle* TSMgmtHandle;
+
+  tsapi TSMgmtHandle TSMgmtHandleGet(const char* var_name);
+  tsapi TSReturnCode TSMgmtHandleIntGet(TSMgmtHandle handle, TSMgmtInt* result);
+  tsapi TSReturnCode TSMgmtHandleCounterGet(TSMgmtHandle handle, TSMgmtCounter* result);
+  tsapi TSReturnCode TSMgmtHandleFloatGet(TSMgmtHandle handle, TSMgmtFloat* result);
+  tsapi TSReturnCode TSMgmtHandleStringGet(TSMgmtHandle handle, TSMgmtString* result);
+
   /* ===== High Resolution Time ===== */
 #define TS_HRTIME_FOREVER  HRTIME_FOREVER
 #define TS_HRTIME_DECADE   HRTIME_DECADE
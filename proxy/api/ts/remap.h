@@ -34,15 +34,21 @@ extern "C"
 #endif                          /* __cplusplus */
 
 #define TSREMAP_VMAJOR   3      /* major version number */
-#define TSREMAP_VMINOR   0      /* minor version number */
+#define TSREMAP_VMINOR   1      /* minor version number */
 #define TSREMAP_VERSION ((TSREMAP_VMAJOR << 16)|TSREMAP_VMINOR)
 
   typedef struct _tsremap_api_info
   {
     unsigned long size;         /* in: sizeof(struct _tsremap_api_info) */
     unsigned long tsremap_version;      /* in: TS supported version ((major << 16) | minor) */
+    unsigned long flags;        /* out: TSREMAP_FLAG_* bits set by TSRemapInit() (since 3.1) */
   } TSRemapInterface;
 
+  /* TSRemapDoRemap() neither blocks nor reschedules the transaction. When
+     every plugin of a remap rule sets this, the whole plugin chain runs
+     inline in a single pass instead of one event dispatch per plugin. */
+#define TSREMAP_FLAG_SYNC 0x1
+
 
   typedef struct _tm_remap_request_info
   {
@@ -92,6 +98,7 @@ extern "C"
 
   /* Plugin initialization - called first.
      Mandatory interface function.
+     A plugin may set TSREMAP_FLAG_SYNC in api_info->flags.
      Return: TS_SUCCESS
              TS_ERROR - error, errbuf can include error message from plugin
   */
@@ -1900,6 +1900,19 @@ HTTPInfo::marshal(char *buf, int len)
   return used;
 }
 
+// An alternate whose header heap failed its checksum is dead, and
+//   the caller treats it as a cache miss
+static int
+unmarshal_reject(HTTPCacheAlt *alt)
+{
+  if (alt->m_frag_offsets != alt->m_integral_frag_offsets) {
+    ats_free(alt->m_frag_offsets);
+  }
+  alt->m_frag_offsets = 0;
+  alt->m_magic = CACHE_ALT_MAGIC_DEAD;
+  return -1;
+}
+
 int
 HTTPInfo::unmarshal(char *buf, int len, RefCountObj *block_ref)
 {
@@ -1912,6 +1925,9 @@ HTTPInfo::unmarshal(char *buf, int len, RefCountObj *block_ref)
     ink_assert(alt->m_unmarshal_len > 0);
     ink_assert(alt->m_unmarshal_len <= len);
     return alt->m_unmarshal_len;
+  } else if (alt->m_magic == CACHE_ALT_MAGIC_DEAD) {
+    // refused before
+    return -1;
   } else if (alt->m_magic != CACHE_ALT_MAGIC_MARSHALED) {
     ink_assert(!"HTTPInfo::unmarshal bad magic");
     return -1;
@@ -1950,6 +1966,9 @@ HTTPInfo::unmarshal(char *buf, int len, RefCountObj *block_ref)
 
     tmp = heap->unmarshal(len, HDR_HEAP_OBJ_HTTP_HEADER, (HdrHeapObjImpl **) & hh, block_ref);
     if (hh == NULL || tmp < 0) {
+      if (heap->m_magic == HDR_BUF_MAGIC_CORRUPT) {
+        return unmarshal_reject(alt);
+      }
       ink_assert(!"HTTPInfo::request unmarshal failed");
       return -1;
     }
@@ -1964,6 +1983,9 @@ HTTPInfo::unmarshal(char *buf, int len, RefCountObj *block_ref)
   if (heap != NULL) {
     tmp = heap->unmarshal(len, HDR_HEAP_OBJ_HTTP_HEADER, (HdrHeapObjImpl **) & hh, block_ref);
     if (hh == NULL || tmp < 0) {
+      if (heap->m_magic == HDR_BUF_MAGIC_CORRUPT) {
+        return unmarshal_reject(alt);
+      }
       ink_assert(!"HTTPInfo::response unmarshal failed");
       return -1;
     }
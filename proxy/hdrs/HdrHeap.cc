@@ -44,6 +44,8 @@ static HdrHeap proto_heap;
 Allocator strHeapAllocator("hdrStrHeap", HDR_STR_HEAP_DEFAULT_SIZE);
 static HdrStrHeap str_proto_heap;
 
+int hdr_heap_enable_checksum = 0;
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
@@ -549,27 +551,52 @@ HdrHeap::marshal_length()
   return len;
 }
 
-#ifdef HDR_HEAP_CHECKSUMS
-static uint32_t
+// static uintptr_t compute_checksum(void* buf, int len)
+//
+//   Fletcher style sum over the marshalled image, kept in four
+//     independent lanes of 64 bit words so the additions don't
+//     wait on each other.  The image is always HDR_PTR_SIZE
+//     aligned and rounded so we can walk it a word at a time.
+//     The result is stored in the otherwise unused m_free_start
+//     slot of the marshalled heap, so the slot must be NULL while
+//     summing
+//
+static uintptr_t
 compute_checksum(void *buf, int len)
 {
-  uint32_t cksum = 0;
-
-  while (len > 4) {
-    cksum += *((uint32_t *) buf);
-    buf = ((char *) buf) + 4;
-    len -= 4;
+  const uint64_t *word = (const uint64_t *) buf;
+  const uint64_t *end = word + (len / sizeof(uint64_t));
+  uint64_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+  uint64_t b0 = 0, b1 = 0, b2 = 0, b3 = 0;
+
+  ink_assert((len & HDR_PTR_ALIGNMENT_MASK) == 0);
+
+  while (end - word >= 4) {
+    a0 += word[0];
+    a1 += word[1];
+    a2 += word[2];
+    a3 += word[3];
+    b0 += a0;
+    b1 += a1;
+    b2 += a2;
+    b3 += a3;
+    word += 4;
   }
-
-  if (len > 0) {
-    uint32_t tmp = 0;
-    memcpy((char *) &tmp, buf, len);
-    cksum += tmp;
+  while (word < end) {
+    a0 += *word++;
+    b0 += a0;
+  }
+  // a 32 bit image may end on half a word
+  if (len & (sizeof(uint64_t) - 1)) {
+    a1 += *(const uint32_t *) word;
+    b1 += a1;
   }
 
-  return cksum;
+  // weight the lanes so that words swapped between them show
+  uint64_t sum = (a0 + 3 * a1 + 5 * a2 + 7 * a3) ^ ((b0 + b1 + b2 + b3) * 0x9E3779B97F4A7C15ULL);
+
+  return (uintptr_t) (sum ^ (sum >> 32));
 }
-#endif
 
 
 // int HdrHeap::marshal(char* buf, int len)
@@ -769,12 +796,11 @@ HdrHeap::marshal(char *buf, int len)
   used = ptr_heap_size + str_size + HDR_HEAP_HDR_SIZE;
   used = ROUND(used, HDR_PTR_SIZE);
 
-#ifdef HDR_HEAP_CHECKSUMS
-  {
-    uint32_t chksum = compute_checksum(buf, used);
-    marshal_hdr->m_free_start = (char *) chksum;
+  // Stamp the image so readers can verify it with a single pass
+  //   before trusting the offsets in it
+  if (hdr_heap_enable_checksum) {
+    marshal_hdr->m_free_start = (char *) compute_checksum(buf, used);
   }
-#endif
 
   return used;
 
@@ -852,26 +878,22 @@ HdrHeap::unmarshal(int buf_length, int obj_type, HdrHeapObjImpl ** found_obj, Re
     ink_assert(!"HdrHeap::unmarshal truncated header");
     return -1;
   }
-#ifdef HDR_HEAP_CHECKSUMS
+  // Heaps marshalled without a checksum have a NULL m_free_start;
+  //   those are accepted as is, as are all heaps with checking off
   if (m_free_start != NULL) {
-    uint32_t stored_sum = (uint32_t) m_free_start;
+    uintptr_t stored_sum = (uintptr_t) m_free_start;
+
     m_free_start = NULL;
-    int sum_len = ROUND(unmarshal_size, HDR_PTR_SIZE);
-    uint32_t new_sum = compute_checksum((void *) this, sum_len);
+    if (hdr_heap_enable_checksum) {
+      int sum_len = ROUND(unmarshal_size, HDR_PTR_SIZE);
 
-    if (stored_sum != new_sum) {
-      fprintf(stderr, "WARNING: Unmarshal checksum comparison failed\n");
-      dump_heap(unmarshal_size);
-      ink_assert(!"HdrHeap::unmarshal checksum failure");
-      return -1;
+      if (stored_sum != compute_checksum((void *) this, sum_len)) {
+        Warning("header heap checksum mismatch, %d byte image refused", sum_len);
+        m_magic = HDR_BUF_MAGIC_CORRUPT;
+        return -1;
+      }
     }
   }
-#else
-  // Because checksums could have been enabled in the past
-  //   and then be turned off without clearing the cache,
-  //   always reset our variable we use for checksumming
-  m_free_start = NULL;
-#endif
 
   ink_release_assert(m_writeable == false);
   ink_release_assert(m_free_size == 0);
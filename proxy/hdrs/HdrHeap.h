@@ -87,6 +87,10 @@ struct HdrHeapObjImpl
 
 extern void obj_describe(HdrHeapObjImpl * obj, bool recurse);
 
+// proxy.config.cache.enable_header_checksum: stamp marshalled heaps
+//   with a checksum and verify it on unmarshal
+extern int hdr_heap_enable_checksum;
+
 inline int
 obj_is_aligned(HdrHeapObjImpl * obj)
 {
@@ -78,6 +78,7 @@ HdrTest::go(RegressionTest * t, int atype)
   status = status & test_regex();
   status = status & test_http_parser_eos_boundary_cases();
   status = status & test_http_mutation();
+  status = status & test_http_hdr_marshal();
   status = status & test_mime();
   status = status & test_http();
 
@@ -1462,6 +1463,165 @@ HdrTest::test_http()
   return (failures_to_status("test_http", (status == 0)));
 }
 
+/*-------------------------------------------------------------------------
+  Marshals a cached response header once and then replays the cache read
+  path against copies of the image: verify the checksum, swizzle the
+  offsets and look up a field, with checksums on and off.  Also checks
+  that a damaged image is rejected and that images without a checksum,
+  or read with checking off, are still accepted.
+  -------------------------------------------------------------------------*/
+
+int
+HdrTest::test_http_hdr_marshal()
+{
+  static const char resp[] = {
+    "HTTP/1.1 200 OK\r\n"
+      "Date: Mon, 08 Apr 2013 18:25:27 GMT\r\n"
+      "Server: Apache/2.2.15 (Unix)\r\n"
+      "Last-Modified: Fri, 05 Apr 2013 21:17:05 GMT\r\n"
+      "ETag: \"21e0a52-3ac4-4d9a3a8e2aa40\"\r\n"
+      "Accept-Ranges: bytes\r\n"
+      "Content-Length: 15044\r\n"
+      "Cache-Control: max-age=3600, public\r\n"
+      "Vary: Accept-Encoding\r\n"
+      "Content-Type: text/html; charset=UTF-8\r\n" "\r\n"
+  };
+  static const int iterations = 100000;
+  static const int rounds = 5;
+
+  int failures = 0;
+  int err;
+  HTTPHdr hdr;
+  HTTPParser parser;
+  const char *start = resp;
+  const char *end = start + strlen(start);
+
+  bri_box("test_http_hdr_marshal");
+
+  hdr.create(HTTP_TYPE_RESPONSE);
+  http_parser_init(&parser);
+  while (1) {
+    err = hdr.parse_resp(&parser, &start, end, true);
+    if (err != PARSE_CONT)
+      break;
+  }
+  if (err == PARSE_ERROR) {
+    printf("FAILED: parse error parsing response hdr\n");
+    hdr.destroy();
+    return (0);
+  }
+
+  int saved_enable_checksum = hdr_heap_enable_checksum;
+
+  hdr_heap_enable_checksum = 1;
+  int image_size = hdr.m_heap->marshal_length();
+  char *image = (char *) ats_memalign(HDR_PTR_SIZE, image_size);
+  char *buf = (char *) ats_memalign(HDR_PTR_SIZE, image_size);
+  int image_len = hdr.m_heap->marshal(image, image_size);
+
+  // with checksums on they are stamped on every marshal, so time those too.
+  //   The other threads are still starting up while this runs, so the two
+  //   modes take turns and each keeps its best round
+  ink_hrtime t_marshal[2] = { 0, 0 };
+
+  for (int round = 0; round < rounds; ++round) {
+    for (int checked = 1; checked >= 0; --checked) {
+      hdr_heap_enable_checksum = checked;
+      ink_hrtime t_start = ink_get_hrtime_internal();
+      for (int i = 0; i < iterations; ++i) {
+        hdr.m_heap->marshal(buf, image_size);
+      }
+      t_start = ink_get_hrtime_internal() - t_start;
+      if (round == 0 || t_start < t_marshal[checked])
+        t_marshal[checked] = t_start;
+    }
+  }
+  hdr_heap_enable_checksum = 1;
+
+  hdr.destroy();
+
+  if (image_len <= 0) {
+    printf("FAILED: couldn't marshal response hdr\n");
+    hdr_heap_enable_checksum = saved_enable_checksum;
+    ats_memalign_free(image);
+    ats_memalign_free(buf);
+    return (0);
+  }
+
+  // (1) a corrupted image must be refused
+  HTTPHdr read_hdr;
+  memcpy(buf, image, image_len);
+  buf[image_len - HDR_PTR_SIZE - 1] ^= 0x5a;
+  if (read_hdr.unmarshal(buf, image_len, NULL) > 0) {
+    printf("FAILED: corrupted image was unmarshalled\n");
+    ++failures;
+  }
+
+  // (2) an image written without a checksum is still readable
+  memcpy(buf, image, image_len);
+  ((HdrHeap *) buf)->m_free_start = NULL;
+  if (read_hdr.unmarshal(buf, image_len, NULL) != image_len) {
+    printf("FAILED: image without checksum was refused\n");
+    ++failures;
+  }
+
+  // (3) with checking off a stamped image is read without a look at it
+  hdr_heap_enable_checksum = 0;
+  memcpy(buf, image, image_len);
+  if (read_hdr.unmarshal(buf, image_len, NULL) != image_len) {
+    printf("FAILED: stamped image was refused with checksums off\n");
+    ++failures;
+  }
+
+  // (4) cache hit replay of the stamped image with checksums on and
+  //     then off; the difference is what the checksum adds to a read
+  int ct_len = 0;
+  ink_hrtime elapsed[2] = { 0, 0 };
+
+  for (int round = 0; round < rounds && failures == 0; ++round) {
+    for (int checked = 1; checked >= 0; --checked) {
+      hdr_heap_enable_checksum = checked;
+      ink_hrtime t_start = ink_get_hrtime_internal();
+
+      for (int i = 0; i < iterations; ++i) {
+        memcpy(buf, image, image_len);
+        if (read_hdr.unmarshal(buf, image_len, NULL) != image_len ||
+            read_hdr.value_get(MIME_FIELD_CONTENT_TYPE, MIME_LEN_CONTENT_TYPE, &ct_len) == NULL) {
+          printf("FAILED: unmarshal of a clean image failed on iteration %d\n", i);
+          ++failures;
+          break;
+        }
+      }
+      t_start = ink_get_hrtime_internal() - t_start;
+      if (round == 0 || t_start < elapsed[checked])
+        elapsed[checked] = t_start;
+    }
+  }
+  hdr_heap_enable_checksum = saved_enable_checksum;
+
+  if (ct_len != (int) strlen("text/html; charset=UTF-8")) {
+    printf("FAILED: Content-Type length %d after unmarshal\n", ct_len);
+    ++failures;
+  }
+
+  double checked_ns = (double) elapsed[1] / iterations;
+  double unchecked_ns = (double) elapsed[0] / iterations;
+
+  printf("    %d byte image: marshal %.0f ns (%.0f ns without checksum), read %.0f ns (%.0f ns without checksum)\n",
+         image_len, (double) t_marshal[1] / iterations, (double) t_marshal[0] / iterations, checked_ns, unchecked_ns);
+  rperf(rtest, "hdr_marshal_hits_per_sec", (double) iterations * HRTIME_SECOND / (double) (elapsed[1] > 0 ? elapsed[1] : 1));
+  rperf(rtest, "hdr_marshal_ns", (double) t_marshal[1] / iterations);
+  rperf(rtest, "hdr_marshal_unchecked_ns", (double) t_marshal[0] / iterations);
+  rperf(rtest, "hdr_unmarshal_ns", checked_ns);
+  rperf(rtest, "hdr_unmarshal_unchecked_ns", unchecked_ns);
+  rperf(rtest, "hdr_checksum_ns_per_read", checked_ns - unchecked_ns);
+
+  ats_memalign_free(image);
+  ats_memalign_free(buf);
+
+  return (failures_to_status("test_http_hdr_marshal", failures));
+}
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
@@ -48,6 +48,9 @@
 
     HttpBodyTemplate      The template loaded from the directory to be
                           instantiated with variables, producing a body.
+                          Templates are compiled when loaded into a list
+                          of literal text runs and log fields, so making
+                          a body does not reparse the template.
 
 
  ****************************************************************************/
@@ -71,6 +74,23 @@
 #define HTTP_BODY_SET_MAGIC      0xB0DFAC55
 #define HTTP_BODY_FACTORY_MAGIC  0xB0DFACFF
 
+// most Accept-Language/Accept-Charset pairs remembered per reconfigure
+#define HTTP_BODY_LANGUAGE_CACHE_SIZE 1024
+// longest Accept-Language/Accept-Charset key remembered
+#define HTTP_BODY_LANGUAGE_KEY_SIZE   256
+
+class LogField;
+class LogFieldList;
+
+// A run of literal template text, followed by the log field to
+// substitute after it (NULL for the last run of the template).
+struct HttpBodyTemplateSegment
+{
+  const char *text;
+  int text_len;
+  LogField *field;
+};
+
 ////////////////////////////////////////////////////////////////////////
 //
 //      class HttpBodyTemplate
@@ -90,16 +110,24 @@ public:
 
   void reset();
   int load_from_file(char *dir, char *file);
+  bool compile();
   bool is_sane()
   {
     return (magic == HTTP_BODY_TEMPLATE_MAGIC);
   }
-  char *build_instantiated_buffer(HttpTransact::State * context, int64_t *length_return);
+  char *build_instantiated_buffer(HttpTransact::State * context, int64_t max_buffer_length,
+                                  int64_t *length_return, int64_t *fast_size_index_return);
 
   unsigned int magic;
   int64_t byte_count;
   char *template_buffer;
   char *template_pathname;
+
+private:
+  char *literal_buffer;         // template text with the fields cut out
+  LogFieldList *fields;         // fields in template order
+  HttpBodyTemplateSegment *segments;
+  int n_segments;
 };
 
 
@@ -158,6 +186,7 @@ public:
   ///////////////////////
   char *fabricate_with_old_api(const char *type, HttpTransact::State * context,
                                int64_t max_buffer_length, int64_t *resulting_buffer_length,
+                               int64_t *fast_size_index_return,
                                char* content_language_out_buf,
                                size_t content_language_buf_size,
                                char* content_type_out_buf,
@@ -166,6 +195,7 @@ public:
 
   char *fabricate_with_old_api_build_va(const char *type, HttpTransact::State * context,
                                         int64_t max_buffer_length, int64_t *resulting_buffer_length,
+                                        int64_t *fast_size_index_return,
                                         char* content_language_out_buf, size_t content_language_buf_size,
                                         char* content_type_out_buf, size_t content_type_buf_size,
                                         const char *format, ...)
@@ -173,7 +203,7 @@ public:
     va_list ap;
 
     va_start(ap, format);
-    return fabricate_with_old_api(type, context, max_buffer_length, resulting_buffer_length,
+    return fabricate_with_old_api(type, context, max_buffer_length, resulting_buffer_length, fast_size_index_return,
                                    content_language_out_buf, content_language_buf_size,
                                    content_type_out_buf, content_type_buf_size, format, ap);
   }
@@ -183,13 +213,12 @@ public:
 
 private:
 
-  char *fabricate(StrList * acpt_language_list,
-                  StrList * acpt_charset_list,
-                  const char *type, HttpTransact::State * context,
-                  int64_t *resulting_buffer_length,
-                  const char **content_language_return,
-                  const char **content_charset_return, const char **set_return = NULL);
+  char *fabricate(const char *set, const char *type, HttpTransact::State * context,
+                  int64_t max_buffer_length, int64_t *resulting_buffer_length,
+                  int64_t *fast_size_index_return,
+                  const char **content_language_return, const char **content_charset_return);
 
+  const char *determine_set_by_language(HTTPHdr * client_request);
   const char *determine_set_by_language(StrList * acpt_language_list, StrList * acpt_charset_list);
   HttpBodyTemplate *find_template(const char *set, const char *type, HttpBodySet ** body_set_return);
   bool is_response_suppressed(HttpTransact::State * context);
@@ -237,6 +266,8 @@ private:
   ink_mutex mutex;              // prevents reconfig/read races
   bool callbacks_established;   // all config variables present
   RawHashTable *table_of_sets;  // sets of template hash tables
+  RawHashTable *language_cache; // Accept-Language/Charset -> set name
+  int language_cache_count;     // entries in language_cache
 };
 
 #endif
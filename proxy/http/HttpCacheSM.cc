@@ -70,7 +70,7 @@ HttpCacheSM::HttpCacheSM():
   captive_action(),
   open_read_cb(false), open_write_cb(false), open_read_tries(0),
   read_request_hdr(NULL), read_config(NULL),
-  read_pin_in_cache(0), retry_write(true), open_write_tries(0),
+  read_pin_in_cache(0), open_read_start(0), collapsed_miss(false), retry_write(true), open_write_tries(0),
   lookup_url(NULL), lookup_max_recursive(0), current_lookup_level(0)
 {
 }
@@ -113,7 +113,15 @@ HttpCacheSM::state_cache_open_read(int event, void *data)
   case CACHE_EVENT_OPEN_READ:
     HTTP_INCREMENT_DYN_STAT(http_current_cache_connections_stat);
     ink_assert(cache_read_vc == NULL);
+    if (readwhilewrite_inprogress) {
+      // Collapsed onto another transaction's fill of the same object
+      HTTP_INCREMENT_DYN_STAT(http_cache_collapsed_requests_stat);
+      HTTP_SUM_DYN_STAT(http_cache_collapsed_wait_time_stat, ink_hrtime_to_msec(ink_get_hrtime() - open_read_start));
+    }
     open_read_cb = true;
+    if (write_locked) {
+      open_write_cb = true;
+    }
     cache_read_vc = (CacheVConnection *) data;
     master_sm->handleEvent(event, data);
     break;
@@ -128,13 +136,21 @@ HttpCacheSM::state_cache_open_read(int event, void *data)
       } else {
         // Give up; the update didn't finish in time
         // HttpSM will inform HttpTransact to 'proxy-only'
+        if (readwhilewrite_inprogress) {
+          HTTP_INCREMENT_DYN_STAT(http_cache_collapsed_failures_stat);
+          collapsed_miss = true;
+        }
         open_read_cb = true;
-        master_sm->handleEvent(event, data);
+        open_read_failed(event, data);
       }
     } else {
-      // Simple miss in the cache.
+      // Simple miss in the cache, or the writer we waited on went away
+      if (readwhilewrite_inprogress) {
+        HTTP_INCREMENT_DYN_STAT(http_cache_collapsed_failures_stat);
+        collapsed_miss = true;
+      }
       open_read_cb = true;
-      master_sm->handleEvent(event, data);
+      open_read_failed(event, data);
     }
     break;
 
@@ -173,6 +189,21 @@ HttpCacheSM::state_cache_open_write(int event, void *data)
     break;
 
   case CACHE_EVENT_OPEN_WRITE_FAILED:
+    if (data == (void *) -ECACHE_DOC_BUSY && read_config && !collapsed_miss &&
+        master_sm->t_state.http_config_param->cache_collapsed_forwarding &&
+        master_sm->t_state.cache_info.action == HttpTransact::CACHE_PREPARE_TO_WRITE) {
+      // Another transaction is already filling this object.  Rather
+      // than fetching it as well, read it while it is being written;
+      // the HttpSM sees either the read or the original failure.
+      Debug("http_cache", "[%" PRId64 "] [state_cache_open_write] write lock busy, "
+            "waiting on the fill in progress", master_sm->sm_id);
+      write_locked = true;
+      // The wait counts from here, not from the original lookup
+      open_read_start = ink_get_hrtime();
+      SET_HANDLER(&HttpCacheSM::state_cache_open_read);
+      do_cache_open_read();
+      break;
+    }
     // The cache is hosed or full or something.
     // Forward the failure to the main sm
     open_write_cb = true;
@@ -186,6 +217,19 @@ HttpCacheSM::state_cache_open_write(int event, void *data)
   return VC_EVENT_CONT;
 }
 
+// A read issued after losing the write lock must look like the
+// original open write failure to the HttpSM
+void
+HttpCacheSM::open_read_failed(int event, void *data)
+{
+  if (write_locked) {
+    open_write_cb = true;
+    master_sm->handleEvent(CACHE_EVENT_OPEN_WRITE_FAILED, (void *) -ECACHE_DOC_BUSY);
+  } else {
+    master_sm->handleEvent(event, data);
+  }
+}
+
 void
 HttpCacheSM::do_schedule_in()
 {
@@ -239,6 +283,7 @@ HttpCacheSM::open_read(URL * url, HTTPHdr * hdr, CacheLookupHttpConfig * params,
   read_request_hdr = hdr;
   read_config = params;
   read_pin_in_cache = pin_in_cache;
+  open_read_start = ink_get_hrtime();
   ink_assert(pending_action == NULL);
   SET_HANDLER(&HttpCacheSM::state_cache_open_read);
 
@@ -276,6 +321,7 @@ HttpCacheSM::open_write(URL * url, HTTPHdr * request, CacheHTTPInfo * old_info,
   ink_assert(cache_write_vc == NULL);
   // INKqa12119
   open_write_cb = false;
+  write_locked = false;
   open_write_tries++;
   this->retry_write = retry;
 
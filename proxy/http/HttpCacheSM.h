@@ -146,6 +146,7 @@ public:
 private:
 
   void do_schedule_in();
+  void open_read_failed(int event, void *data);
   Action *do_cache_open_read();
 
   int state_cache_open_read(int event, void *data);
@@ -160,6 +161,10 @@ private:
   HTTPHdr *read_request_hdr;
   CacheLookupHttpConfig *read_config;
   time_t read_pin_in_cache;
+  ink_hrtime open_read_start;
+  // waited on a writer which went away without leaving an object (most
+  // likely an uncacheable response), so do not wait on the next one
+  bool collapsed_miss;
 
   // Open write parameters
   bool retry_write;
@@ -1108,6 +1108,103 @@ register_stat_callbacks()
                      RECD_COUNTER, RECP_NULL,
                      (int) http_total_x_redirect_stat, RecRawStatSyncCount);
 
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.remap.regex_lookups",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_remap_regex_lookups_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.remap.regex_rules_evaluated",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_remap_regex_rules_evaluated_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.remap.regex_rules_skipped",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_remap_regex_rules_skipped_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_pool.reuses",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_origin_pool_reuse_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_pool.steals",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_origin_pool_steal_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_pool.misses",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_origin_pool_miss_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_prewarm.opens",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_origin_prewarm_opens_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_prewarm.open_failures",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_origin_prewarm_open_failures_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_prewarm.avg_connect_msecs",
+                     RECD_FLOAT, RECP_NULL,
+                     (int) http_origin_prewarm_connect_time_stat, RecRawStatSyncAvg);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_prewarm.used",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_origin_prewarm_used_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_prewarm.expired",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_origin_prewarm_expired_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_connections.queued",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_origin_connections_queued_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_connections.queue_full",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_origin_connections_queue_full_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_connections.queue_depth",
+                     RECD_INT, RECP_NON_PERSISTENT,
+                     (int) http_origin_connections_queue_depth_stat, RecRawStatSyncSum);
+  HTTP_CLEAR_DYN_STAT(http_origin_connections_queue_depth_stat);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_collapsed.requests",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_cache_collapsed_requests_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_collapsed.avg_wait_msecs",
+                     RECD_FLOAT, RECP_NULL,
+                     (int) http_cache_collapsed_wait_time_stat, RecRawStatSyncAvg);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_collapsed.failures",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_cache_collapsed_failures_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_stale.served_while_revalidate",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_cache_stale_while_revalidate_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_stale.background_revalidations",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_cache_background_revalidations_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_stale.served_on_error",
+                     RECD_COUNTER, RECP_NULL,
+                     (int) http_cache_stale_if_error_stat, RecRawStatSyncSum);
+
+  RecRegisterRawHistogram(http_rsb, RECT_PROCESS, "proxy.process.http.latency_usec.total",
+                          (int) http_total_latency_hist);
+  RecRegisterRawHistogram(http_rsb, RECT_PROCESS, "proxy.process.http.latency_usec.first_byte",
+                          (int) http_first_byte_latency_hist);
+  RecRegisterRawHistogram(http_rsb, RECT_PROCESS, "proxy.process.http.latency_usec.cache_lookup",
+                          (int) http_cache_lookup_latency_hist);
+  RecRegisterRawHistogram(http_rsb, RECT_PROCESS, "proxy.process.http.latency_usec.dns_lookup",
+                          (int) http_dns_lookup_latency_hist);
+  RecRegisterRawHistogram(http_rsb, RECT_PROCESS, "proxy.process.http.latency_usec.origin_connect",
+                          (int) http_origin_connect_latency_hist);
 }
 
 
@@ -1120,7 +1217,7 @@ void
 HttpConfig::startup()
 {
 
-  http_rsb = RecAllocateRawStatBlock((int) http_stat_count);
+  http_rsb = RecAllocateRawStatBlock((int) http_stat_count, (int) http_hist_count);
   register_configs();
   register_stat_callbacks();
 
@@ -1150,6 +1247,11 @@ HttpConfig::startup()
   HttpEstablishStaticConfigLongLong(c.oride.server_tcp_init_cwnd, "proxy.config.http.server_tcp_init_cwnd");
   HttpEstablishStaticConfigLongLong(c.oride.origin_max_connections, "proxy.config.http.origin_max_connections");
   HttpEstablishStaticConfigLongLong(c.origin_min_keep_alive_connections, "proxy.config.http.origin_min_keep_alive_connections");
+  HttpEstablishStaticConfigLongLong(c.origin_max_connections_queue, "proxy.config.http.origin_max_connections_queue");
+  HttpEstablishStaticConfigStringAlloc(c.server_prewarm_origins, "proxy.config.http.server_prewarm.origins");
+  HttpEstablishStaticConfigByte(c.server_prewarm_parents, "proxy.config.http.server_prewarm.parents");
+  HttpEstablishStaticConfigLongLong(c.server_prewarm_min_idle, "proxy.config.http.server_prewarm.min_idle");
+  HttpEstablishStaticConfigLongLong(c.server_prewarm_interval, "proxy.config.http.server_prewarm.interval");
 
   HttpEstablishStaticConfigByte(c.parent_proxy_routing_enable, "proxy.config.http.parent_proxy_routing_enable");
 
@@ -1275,6 +1377,9 @@ HttpConfig::startup()
 
   // open write failure retries
   HttpEstablishStaticConfigLongLong(c.max_cache_open_write_retries, "proxy.config.http.cache.max_open_write_retries");
+  HttpEstablishStaticConfigByte(c.cache_collapsed_forwarding, "proxy.config.http.cache.collapsed_forwarding");
+  HttpEstablishStaticConfigByte(c.cache_stale_while_revalidate, "proxy.config.http.cache.stale_while_revalidate");
+  HttpEstablishStaticConfigByte(c.cache_stale_if_error, "proxy.config.http.cache.stale_if_error");
 
   HttpEstablishStaticConfigByte(c.oride.cache_http, "proxy.config.http.cache.http");
   HttpEstablishStaticConfigByte(c.oride.cache_cluster_cache_local, "proxy.config.http.cache.cluster_cache_local");
@@ -1350,6 +1455,7 @@ HttpConfig::startup()
 
   // Stat Page Info
   HttpEstablishStaticConfigByte(c.enable_http_info, "proxy.config.http.enable_http_info");
+  HttpEstablishStaticConfigByte(c.record_sm_history, "proxy.config.http.record_sm_history");
 
   //##############################################################################
   //#
@@ -1437,6 +1543,13 @@ HttpConfig::reconfigure()
     params->origin_min_keep_alive_connections = params->oride.origin_max_connections;
   }
 
+  params->origin_max_connections_queue = m_master.origin_max_connections_queue;
+
+  params->server_prewarm_origins = ats_strdup(m_master.server_prewarm_origins);
+  params->server_prewarm_parents = INT_TO_BOOL(m_master.server_prewarm_parents);
+  params->server_prewarm_min_idle = m_master.server_prewarm_min_idle;
+  params->server_prewarm_interval = m_master.server_prewarm_interval;
+
   params->parent_proxy_routing_enable = INT_TO_BOOL(m_master.parent_proxy_routing_enable);
   params->enable_url_expandomatic = INT_TO_BOOL(m_master.enable_url_expandomatic);
 
@@ -1538,6 +1651,9 @@ HttpConfig::reconfigure()
 
   // open write failure retries
   params->max_cache_open_write_retries = m_master.max_cache_open_write_retries;
+  params->cache_collapsed_forwarding = INT_TO_BOOL(m_master.cache_collapsed_forwarding);
+  params->cache_stale_while_revalidate = INT_TO_BOOL(m_master.cache_stale_while_revalidate);
+  params->cache_stale_if_error = INT_TO_BOOL(m_master.cache_stale_if_error);
 
   params->oride.cache_http = INT_TO_BOOL(m_master.oride.cache_http);
   params->oride.cache_cluster_cache_local = INT_TO_BOOL(m_master.oride.cache_cluster_cache_local);
@@ -1579,6 +1695,7 @@ HttpConfig::reconfigure()
   params->default_buffer_size_index = m_master.default_buffer_size_index;
   params->default_buffer_water_mark = m_master.default_buffer_water_mark;
   params->enable_http_info = INT_TO_BOOL(m_master.enable_http_info);
+  params->record_sm_history = INT_TO_BOOL(m_master.record_sm_history);
   params->reverse_proxy_no_host_redirect = ats_strdup(m_master.reverse_proxy_no_host_redirect);
   params->reverse_proxy_no_host_redirect_len =
     params->reverse_proxy_no_host_redirect ? strlen(params->reverse_proxy_no_host_redirect) : 0;
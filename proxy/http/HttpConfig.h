@@ -344,9 +344,62 @@ enum
   http_response_status_505_count_stat,
   http_response_status_5xx_count_stat,
 
+  // regex_map lookups and how many rules the literal prefilter saved
+  http_remap_regex_lookups_stat,
+  http_remap_regex_rules_evaluated_stat,
+  http_remap_regex_rules_skipped_stat,
+
+  // Origin session pool: hits in the local pool, sessions taken from
+  // another thread's pool, and lookups that found nothing
+  http_origin_pool_reuse_stat,
+  http_origin_pool_steal_stat,
+  http_origin_pool_miss_stat,
+
+  // Origin connection pre-warming: connections opened for the idle
+  // pool, failed opens, average open time, and how many of them were
+  // picked up by a transaction or timed out unused
+  http_origin_prewarm_opens_stat,
+  http_origin_prewarm_open_failures_stat,
+  http_origin_prewarm_connect_time_stat,
+  http_origin_prewarm_used_stat,
+  http_origin_prewarm_expired_stat,
+
+  // Transactions that waited for a connection under origin_max_connections,
+  // the ones turned away because the origin's queue was full, and the
+  // number waiting right now
+  http_origin_connections_queued_stat,
+  http_origin_connections_queue_full_stat,
+  http_origin_connections_queue_depth_stat,
+
+  // Cache misses that were served from another transaction's fill of
+  // the same object, how long they waited for it, and the ones that
+  // had to give up because the writer went away
+  http_cache_collapsed_requests_stat,
+  http_cache_collapsed_wait_time_stat,
+  http_cache_collapsed_failures_stat,
+
+  // Stale hits served under stale-while-revalidate, the background
+  // revalidations started for them, and stale hits served because the
+  // origin failed inside a stale-if-error window
+  http_cache_stale_while_revalidate_stat,
+  http_cache_background_revalidations_stat,
+  http_cache_stale_if_error_stat,
+
   http_stat_count
 };
 
+// Latency histograms, in usecs, between HttpSM milestones
+enum
+{
+  http_total_latency_hist,          // sm_start to sm_finish
+  http_first_byte_latency_hist,     // ua_read_header_done to ua_begin_write
+  http_cache_lookup_latency_hist,   // cache_open_read_begin to cache_open_read_end
+  http_dns_lookup_latency_hist,     // dns_lookup_begin to dns_lookup_end
+  http_origin_connect_latency_hist, // server_connect to server_connect_end
+
+  http_hist_count
+};
+
 extern RecRawStatBlock *http_rsb;
 
 /* Stats should only be accessed using these macros */
@@ -354,6 +407,7 @@ extern RecRawStatBlock *http_rsb;
 #define HTTP_DECREMENT_DYN_STAT(x) RecIncrRawStat(http_rsb, mutex->thread_holding, (int) x, -1)
 #define HTTP_SUM_DYN_STAT(x, y) RecIncrRawStat(http_rsb, mutex->thread_holding, (int) x, (int64_t) y)
 #define HTTP_SUM_GLOBAL_DYN_STAT(x, y) RecIncrGlobalRawStatSum(http_rsb, x, y)
+#define HTTP_RECORD_DYN_HIST(x, y) RecRecordRawHistogram(http_rsb, mutex->thread_holding, (int) x, (int64_t) y)
 
 #define HTTP_CLEAR_DYN_STAT(x) \
 do { \
@@ -619,6 +673,13 @@ public:
 
   MgmtInt server_max_connections;
   MgmtInt origin_min_keep_alive_connections; // TODO: This one really ought to be overridable, but difficult right now.
+  MgmtInt origin_max_connections_queue;      // -1 to queue without limit, 0 to fail right away
+
+  // Origin connection pre-warming, see HttpSessionPrewarm.h
+  char *server_prewarm_origins;
+  MgmtByte server_prewarm_parents;
+  MgmtInt server_prewarm_min_idle;
+  MgmtInt server_prewarm_interval;
 
   MgmtByte parent_proxy_routing_enable;
   MgmtByte disable_ssl_parenting;
@@ -690,6 +751,15 @@ public:
   // open write failure retries.
   MgmtInt max_cache_open_write_retries;
 
+  // wait on another transaction's fill instead of going to the origin
+  // when the cache write lock is taken
+  MgmtByte cache_collapsed_forwarding;
+
+  // honor the RFC 5861 stale-while-revalidate and stale-if-error
+  // Cache-Control extensions of cached responses
+  MgmtByte cache_stale_while_revalidate;
+  MgmtByte cache_stale_if_error;
+
   ///////////////////
   // cache control //
   ///////////////////
@@ -766,6 +836,7 @@ public:
   MgmtInt default_buffer_size_index;
   MgmtInt default_buffer_water_mark;
   MgmtByte enable_http_info;
+  MgmtByte record_sm_history;
 
   // Cluster time delta is not a config variable,
   //  rather it is the time skew which the manager observes
@@ -894,6 +965,11 @@ HttpConfigParams::HttpConfigParams()
     proxy_hostname_len(0),
     server_max_connections(0),
     origin_min_keep_alive_connections(0),
+    origin_max_connections_queue(-1),
+    server_prewarm_origins(NULL),
+    server_prewarm_parents(0),
+    server_prewarm_min_idle(0),
+    server_prewarm_interval(5),
     parent_proxy_routing_enable(0),
     disable_ssl_parenting(0),
     enable_url_expandomatic(0),
@@ -930,6 +1006,9 @@ HttpConfigParams::HttpConfigParams()
     cache_vary_default_images(0),
     cache_vary_default_other(0),
     max_cache_open_write_retries(0),
+    cache_collapsed_forwarding(0),
+    cache_stale_while_revalidate(0),
+    cache_stale_if_error(0),
     cache_enable_default_vary_headers(0),
     cache_when_to_add_no_cache_to_msie_requests(0),
     connect_ports_string(0),
@@ -952,6 +1031,7 @@ HttpConfigParams::HttpConfigParams()
     default_buffer_size_index(0),
     default_buffer_water_mark(0),
     enable_http_info(0),
+    record_sm_history(1),
     cluster_time_delta(0),
     redirection_enabled(1),
     number_of_redirections(0),
@@ -976,6 +1056,7 @@ HttpConfigParams::~HttpConfigParams()
   ats_free(global_user_agent_header);
   ats_free(oride.proxy_response_server_string);
   ats_free(cache_vary_default_text);
+  ats_free(server_prewarm_origins);
   ats_free(cache_vary_default_images);
   ats_free(cache_vary_default_other);
   ats_free(connect_ports_string);
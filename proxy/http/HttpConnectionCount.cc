@@ -21,8 +21,347 @@
   limitations under the License.
  */
 
+#include "P_Net.h"
 #include "HttpConnectionCount.h"
+#include "HttpConfig.h"
 
 
 ConnectionCount ConnectionCount::_connectionCount;
-ink_mutex ConnectionCount::_mutex;
+
+typedef MapElem<ConnectionCount::ConnAddr, ConnectionCount::Entry *> ConnectionCountElem;
+
+ConnectionCount::ConnectionCount()
+{
+  for (int i = 0; i < CONNECTION_COUNT_SHARDS; ++i)
+    ink_mutex_init(&_shards[i].mutex, "ConnectionCount");
+}
+
+ConnectionCount::Entry *
+ConnectionCount::findEntry(const IpEndpoint& addr)
+{
+  Shard &shard = shardFor(addr);
+
+  ink_mutex_acquire(&shard.mutex);
+  Entry *entry = shard.entries.get(ConnAddr(addr));
+  ink_mutex_release(&shard.mutex);
+  return entry;
+}
+
+ConnectionCount::Entry *
+ConnectionCount::getEntry(const IpEndpoint& addr)
+{
+  int index;
+  Shard &shard = shardFor(addr, &index);
+  ConnAddr caddr(addr);
+
+  ink_mutex_acquire(&shard.mutex);
+  Entry *entry = shard.entries.get(caddr);
+  if (entry == NULL) {
+    entry = NEW(new Entry);
+    ats_ip_copy(&entry->addr, &addr);
+    entry->count = 0;
+    entry->queued = 0;
+    entry->shard = index;
+    shard.entries.put(caddr, entry);
+  }
+  ink_mutex_release(&shard.mutex);
+  return entry;
+}
+
+bool
+ConnectionCount::enqueue(Entry *entry, Waiter *waiter, int max_queue)
+{
+  Shard &shard = _shards[entry->shard];
+  bool queued = true;
+
+  ink_mutex_acquire(&shard.mutex);
+  if (waiter->entry == NULL) {
+    bool requeue = (waiter->woken && waiter->origin == entry);
+
+    if (!requeue && max_queue >= 0 && entry->queued >= max_queue) {
+      queued = false;
+    } else {
+      waiter->refcount_inc();
+      waiter->entry = entry;
+      waiter->origin = entry;
+      if (requeue)
+        entry->waiters.push(waiter);
+      else
+        entry->waiters.enqueue(waiter);
+      ink_atomic_increment(&entry->queued, 1);
+      HTTP_SUM_GLOBAL_DYN_STAT(http_origin_connections_queue_depth_stat, 1);
+    }
+    waiter->woken = false;
+  }
+  ink_mutex_release(&shard.mutex);
+  return queued;
+}
+
+void
+ConnectionCount::dequeue(Waiter *waiter)
+{
+  Entry *entry = waiter->entry;
+
+  if (entry == NULL)
+    return;
+
+  Shard &shard = _shards[entry->shard];
+  bool removed = false;
+
+  ink_mutex_acquire(&shard.mutex);
+  // A wake up may have taken the waiter off the queue meanwhile
+  if (waiter->entry == entry) {
+    entry->waiters.remove(waiter);
+    ink_atomic_increment(&entry->queued, -1);
+    HTTP_SUM_GLOBAL_DYN_STAT(http_origin_connections_queue_depth_stat, -1);
+    waiter->entry = NULL;
+    removed = true;
+  }
+  ink_mutex_release(&shard.mutex);
+
+  if (removed)
+    waiter->release();
+}
+
+void
+ConnectionCount::wakeWaiter(Entry *entry)
+{
+  Shard &shard = _shards[entry->shard];
+
+  ink_mutex_acquire(&shard.mutex);
+  Waiter *waiter = entry->waiters.dequeue();
+  if (waiter) {
+    ink_atomic_increment(&entry->queued, -1);
+    HTTP_SUM_GLOBAL_DYN_STAT(http_origin_connections_queue_depth_stat, -1);
+    waiter->entry = NULL;
+    waiter->woken = true;
+  }
+  ink_mutex_release(&shard.mutex);
+
+  // The queue's reference now belongs to the wake up event
+  if (waiter)
+    eventProcessor.schedule_imm(waiter, ET_NET);
+}
+
+int
+ConnectionCount::Waiter::wake(int event, void *data)
+{
+  NOWARN_UNUSED(event);
+  NOWARN_UNUSED(data);
+
+  if (cont) {
+    cont->handleEvent(EVENT_IMMEDIATE, this);
+  } else if (origin && origin->queued > 0) {
+    // The owner went away, so pass the free connection on
+    ConnectionCount::getInstance()->wakeWaiter(origin);
+  }
+  release();
+  return EVENT_DONE;
+}
+
+int
+ConnectionCount::snapshot(Usage *usage, int max)
+{
+  int n = 0;
+
+  for (int i = 0; i < CONNECTION_COUNT_SHARDS && n < max; ++i) {
+    Shard &shard = _shards[i];
+
+    ink_mutex_acquire(&shard.mutex);
+    form_Map(ConnectionCountElem, e, shard.entries) {
+      Entry *entry = e->value;
+
+      if (n < max && (entry->count > 0 || entry->queued > 0)) {
+        ats_ip_copy(&usage[n].addr, &entry->addr);
+        usage[n].count = entry->count;
+        usage[n].queued = entry->queued;
+        ++n;
+      }
+    }
+    ink_mutex_release(&shard.mutex);
+  }
+
+  return n;
+}
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+
+#define CONNECTION_COUNT_BENCH_THREADS 8
+#define CONNECTION_COUNT_BENCH_OPS 200000
+#define CONNECTION_COUNT_BENCH_ORIGINS 64
+
+static IpEndpoint connection_count_test_addr[CONNECTION_COUNT_BENCH_ORIGINS];
+
+// What the table used to be: one map behind one lock
+struct SingleLockCount
+{
+  ink_mutex mutex;
+  HashMap<ConnectionCount::ConnAddr, ConnectionCount::ConnAddrHashFns, int> counts;
+
+  SingleLockCount() { ink_mutex_init(&mutex, "SingleLockCount"); }
+  void increment(const IpEndpoint& addr, int delta)
+  {
+    ConnectionCount::ConnAddr caddr(addr);
+    ink_mutex_acquire(&mutex);
+    counts.put(caddr, counts.get(caddr) + delta);
+    ink_mutex_release(&mutex);
+  }
+};
+
+static SingleLockCount connection_count_single_lock;
+
+// A connect checks the count and opens, a close decrements, as
+//   HttpSM and HttpServerSession do
+static void *
+connection_count_sharded_worker(void *arg)
+{
+  int seed = (int) (intptr_t) arg;
+  ConnectionCount *cc = ConnectionCount::getInstance();
+
+  for (int i = 0; i < CONNECTION_COUNT_BENCH_OPS; ++i) {
+    const IpEndpoint &addr = connection_count_test_addr[(seed + i * 7) % CONNECTION_COUNT_BENCH_ORIGINS];
+    ConnectionCount::Entry *entry = cc->getEntry(addr);
+
+    cc->incrementCount(entry, 1);
+    cc->incrementCount(entry, -1);
+  }
+  return NULL;
+}
+
+static void *
+connection_count_single_lock_worker(void *arg)
+{
+  int seed = (int) (intptr_t) arg;
+
+  for (int i = 0; i < CONNECTION_COUNT_BENCH_OPS; ++i) {
+    const IpEndpoint &addr = connection_count_test_addr[(seed + i * 7) % CONNECTION_COUNT_BENCH_ORIGINS];
+
+    connection_count_single_lock.increment(addr, 1);
+    connection_count_single_lock.increment(addr, -1);
+  }
+  return NULL;
+}
+
+static double
+connection_count_run(void *(*worker) (void *))
+{
+  ink_thread threads[CONNECTION_COUNT_BENCH_THREADS];
+  ink_hrtime start = ink_get_hrtime_internal();
+
+  for (int i = 0; i < CONNECTION_COUNT_BENCH_THREADS; ++i)
+    threads[i] = ink_thread_create(worker, (void *) (intptr_t) i);
+  for (int i = 0; i < CONNECTION_COUNT_BENCH_THREADS; ++i)
+    pthread_join(threads[i], NULL);
+
+  ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+  return (double) CONNECTION_COUNT_BENCH_THREADS * CONNECTION_COUNT_BENCH_OPS * HRTIME_SECOND / (double) (elapsed > 0 ? elapsed : 1);
+}
+
+REGRESSION_TEST(ConnectionCount_Benchmark)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+  ConnectionCount *cc = ConnectionCount::getInstance();
+  bool balanced = true;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  for (int i = 0; i < CONNECTION_COUNT_BENCH_ORIGINS; ++i) {
+    char name[32];
+
+    snprintf(name, sizeof(name), "198.51.100.%d", i + 1);
+    ats_ip_pton(name, &connection_count_test_addr[i]);
+  }
+
+  rperf(t, "single_lock_connects_per_sec", connection_count_run(connection_count_single_lock_worker));
+  rperf(t, "sharded_connects_per_sec", connection_count_run(connection_count_sharded_worker));
+
+  for (int i = 0; i < CONNECTION_COUNT_BENCH_ORIGINS; ++i) {
+    if (cc->getCount(connection_count_test_addr[i]) != 0)
+      balanced = false;
+  }
+  tb.check(balanced, "connection counts return to zero");
+}
+
+// Two waiters are queued behind a full origin and a third is turned
+//   away; each closed connection then wakes the next waiter in order.
+//   The first one loses its connection to a newcomer once and has to
+//   queue again, which must not cost it its place.
+struct ConnectionQueueTest: public Continuation
+{
+  RegressionTest *test;
+  int *pstatus;
+  ConnectionCount::Entry *entry;
+  ConnectionCount::Waiter *waiters[3];
+  int woken[3];
+  int n_woken;
+
+  ConnectionQueueTest(RegressionTest *t, int *s)
+    : Continuation(new_ProxyMutex()), test(t), pstatus(s), entry(NULL), n_woken(0)
+  {
+    SET_HANDLER(&ConnectionQueueTest::handle_wake);
+  }
+
+  void start()
+  {
+    TestBox tb(test, pstatus);
+    ConnectionCount *cc = ConnectionCount::getInstance();
+    IpEndpoint addr;
+
+    ats_ip_pton("192.0.2.77", &addr);
+    entry = cc->getEntry(addr);
+    cc->incrementCount(entry, 2);
+    for (int i = 0; i < 3; ++i)
+      waiters[i] = NEW(new ConnectionCount::Waiter(this));
+
+    tb.check(cc->enqueue(entry, waiters[0], 2), "first waiter is queued");
+    tb.check(cc->enqueue(entry, waiters[1], 2), "second waiter is queued");
+    tb.check(cc->enqueue(entry, waiters[0], 2), "a queued waiter keeps its place");
+    tb.check(!cc->enqueue(entry, waiters[2], 2), "third waiter is turned away");
+    tb.check(entry->queued == 2, "queue depth is %d, expected 2", entry->queued);
+
+    cc->leave(waiters[2]);
+    cc->incrementCount(entry, -1);
+  }
+
+  int handle_wake(int event, void *data)
+  {
+    TestBox tb(test, pstatus);
+    ConnectionCount *cc = ConnectionCount::getInstance();
+
+    tb.check(event == EVENT_IMMEDIATE, "woken with EVENT_IMMEDIATE");
+    woken[n_woken++] = (data == waiters[0]) ? 0 : 1;
+    if (n_woken == 1) {
+      // A newcomer took the free connection
+      cc->incrementCount(entry, 1);
+      tb.check(cc->enqueue(entry, waiters[0], 1), "a woken waiter can queue again");
+      tb.check(entry->queued == 2, "queue depth is %d, expected 2", entry->queued);
+      cc->incrementCount(entry, -1);
+      return EVENT_DONE;
+    }
+    if (n_woken == 2) {
+      cc->incrementCount(entry, -1);
+      return EVENT_DONE;
+    }
+
+    tb.check(woken[0] == 0 && woken[1] == 0 && woken[2] == 1, "waiters woken in order");
+    tb.check(entry->queued == 0, "queue is empty");
+    tb.check(entry->count == 0, "count is %d, expected 0", entry->count);
+    cc->leave(waiters[0]);
+    cc->leave(waiters[1]);
+    if (*pstatus == REGRESSION_TEST_INPROGRESS)
+      *pstatus = REGRESSION_TEST_PASSED;
+    test->status = *pstatus;
+    return EVENT_DONE;
+  }
+};
+
+REGRESSION_TEST(ConnectionCount_Queue)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  ConnectionQueueTest *cont = NEW(new ConnectionQueueTest(t, pstatus));
+
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  MUTEX_LOCK(lock, cont->mutex, this_ethread());
+  cont->start();
+}
+#endif /* TS_HAS_TESTS */
@@ -24,15 +24,79 @@
 //
 #include "libts.h"
 #include "Map.h"
+#include "P_EventSystem.h"
 
 #ifndef _HTTP_CONNECTION_COUNT_H_
+#define _HTTP_CONNECTION_COUNT_H_
+
+#define CONNECTION_COUNT_SHARDS 64
 
 /**
  * Singleton class to keep track of the number of connections per host
+ *
+ * The table is split into shards, each with its own lock, and the lock
+ * is only taken to find or create the entry for an address.  Entries are
+ * never freed, so a server session keeps a pointer to its entry and
+ * adjusts the count with atomic operations.
+ *
+ * Transactions that find an origin at its connection limit can wait in
+ * the origin's queue; the queue is served in order as connections close.
  */
 class ConnectionCount
 {
 public:
+  struct Entry;
+
+  /**
+   * A continuation waiting for a connection to an origin.  It shares the
+   * mutex of the waiting continuation, which is called back with
+   * EVENT_IMMEDIATE and the waiter as data once a connection closes.
+   * Waiters are reference counted: the owner, the queue and a pending
+   * wake up each hold a reference.
+   */
+  class Waiter: public Continuation, public RefCountObj
+  {
+  public:
+    Waiter(Continuation *c)
+      : Continuation(c->mutex), cont(c), entry(NULL), origin(NULL), woken(false)
+    {
+      refcount_inc();
+      SET_HANDLER(&Waiter::wake);
+    }
+
+    int wake(int event, void *data);
+
+    /// Drop a reference, freeing the waiter on the last one.
+    void release()
+    {
+      if (refcount_dec() == 0)
+        free();
+    }
+
+    Continuation *cont;         // cleared when the owner goes away
+    Entry *entry;               // queue the waiter is in, if any
+    Entry *origin;              // last queue the waiter was in
+    bool woken;                 // taken off the head of origin's queue
+    LINK(Waiter, link);
+  };
+
+  struct Entry
+  {
+    IpEndpoint addr;
+    volatile int count;         // open connections
+    volatile int queued;        // transactions waiting for a connection
+    int shard;
+    Que(Waiter, link) waiters;    // protected by the shard lock
+  };
+
+  /// Point in time copy of an entry, for reporting
+  struct Usage
+  {
+    IpEndpoint addr;
+    int count;
+    int queued;
+  };
+
   /**
    * Static method to get the instance of the class
    * @return Returns a pointer to the instance of the class
@@ -41,16 +105,27 @@ public:
     return &_connectionCount;
   }
 
+  /**
+   * Find the entry for the host, creating it if needed
+   * @param ip IP address of the host
+   * @return The entry, which is valid for the life of the process
+   */
+  Entry *getEntry(const IpEndpoint& addr);
+
+  /**
+   * Find the entry for the host
+   * @return The entry, or NULL if no connection was ever counted
+   */
+  Entry *findEntry(const IpEndpoint& addr);
+
   /**
    * Gets the number of connections for the host
    * @param ip IP address of the host
    * @return Number of connections
    */
   int getCount(const IpEndpoint& addr) {
-    ink_mutex_acquire(&_mutex);
-    int count = _hostCount.get(ConnAddr(addr));
-    ink_mutex_release(&_mutex);
-    return count;
+    Entry *entry = findEntry(addr);
+    return entry ? entry->count : 0;
   }
 
   /**
@@ -59,13 +134,49 @@ public:
    * @param delta Default is +1, can be set to negative to decrement
    */
   void incrementCount(const IpEndpoint& addr, const int delta = 1) {
-    ConnAddr caddr(addr);
-    ink_mutex_acquire(&_mutex);
-    int count = _hostCount.get(caddr);
-    _hostCount.put(caddr, count + delta);
-    ink_mutex_release(&_mutex);
+    incrementCount(getEntry(addr), delta);
   }
 
+  /**
+   * Change the connection count of an entry.  Closing a connection
+   * wakes up the first waiter of the origin, if any.
+   */
+  void incrementCount(Entry *entry, const int delta = 1) {
+    ink_atomic_increment(&entry->count, delta);
+    if (delta < 0 && entry->queued > 0)
+      wakeWaiter(entry);
+  }
+
+  /**
+   * Queue @a waiter for a connection to @a entry.  A waiter that is
+   * already queued keeps its place, and one that was woken up but lost
+   * the connection to a newcomer goes back to the head of the queue.
+   * @param max_queue Maximum queue length, negative for no limit
+   * @return false if the queue is full
+   */
+  bool enqueue(Entry *entry, Waiter *waiter, int max_queue);
+
+  /**
+   * Remove @a waiter from the queue it is in, if any
+   */
+  void dequeue(Waiter *waiter);
+
+  /**
+   * Dequeue @a waiter and drop the owner's reference.  A wake up that
+   * is already on its way is handed on to the next waiter.
+   */
+  void leave(Waiter *waiter) {
+    dequeue(waiter);
+    waiter->cont = NULL;
+    waiter->release();
+  }
+
+  /**
+   * Copy out the entries with open connections or waiters
+   * @return The number of entries copied, at most @a max
+   */
+  int snapshot(Usage *usage, int max);
+
   struct ConnAddr {
     IpEndpoint _addr;
 
@@ -82,13 +193,27 @@ public:
   };
 
 private:
+  struct Shard
+  {
+    ink_mutex mutex;
+    HashMap<ConnAddr, ConnAddrHashFns, Entry *> entries;
+  };
+
   // Hide the constructor and copy constructor
-  ConnectionCount() { }
+  ConnectionCount();
   ConnectionCount(const ConnectionCount & x) { NOWARN_UNUSED(x); }
 
+  Shard &shardFor(const IpEndpoint& addr, int *index = NULL) {
+    int i = ats_ip_hash(&addr.sa) % CONNECTION_COUNT_SHARDS;
+    if (index)
+      *index = i;
+    return _shards[i];
+  }
+  void wakeWaiter(Entry *entry);
+
+  friend class Waiter;
   static ConnectionCount _connectionCount;
-  HashMap<ConnAddr, ConnAddrHashFns, int> _hostCount;
-  static ink_mutex _mutex;
+  Shard _shards[CONNECTION_COUNT_SHARDS];
 };
 
 #endif
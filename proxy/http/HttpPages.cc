@@ -55,6 +55,9 @@ HttpPagesHandler::HttpPagesHandler(Continuation * cont, HTTPHdr * header)
     request = arena.str_store(request, length);
     SET_HANDLER(&HttpPagesHandler::handle_smdetails);
 
+  } else if (strncmp(request, "origins", sizeof("origins")) == 0) {
+    SET_HANDLER(&HttpPagesHandler::handle_origins);
+
   } else {
     SET_HANDLER(&HttpPagesHandler::handle_smlist);
   }
@@ -430,6 +433,32 @@ HttpPagesHandler::handle_smlist(int event, void *data)
   return EVENT_DONE;
 }
 
+// Connections and queued transactions per origin, for
+//   origin_max_connections
+int
+HttpPagesHandler::handle_origins(int event, void *data)
+{
+  NOWARN_UNUSED(event);
+  NOWARN_UNUSED(data);
+  const int max_origins = 1024;
+  ConnectionCount::Usage *usage = (ConnectionCount::Usage *) arena.alloc(max_origins * sizeof(ConnectionCount::Usage));
+  int n = ConnectionCount::getInstance()->snapshot(usage, max_origins);
+
+  resp_begin("Http:Origin Connections");
+  for (int i = 0; i < n; ++i) {
+    char addrbuf[INET6_ADDRSTRLEN];
+
+    resp_begin_item();
+    resp_add("%s | connections: %d | queued: %d\n",
+             ats_ip_ntop(&usage[i].addr.sa, addrbuf, sizeof(addrbuf)), usage[i].count, usage[i].queued);
+    resp_end_item();
+  }
+  resp_end();
+  handle_callback(EVENT_NONE, NULL);
+
+  return EVENT_DONE;
+}
+
 int
 HttpPagesHandler::handle_callback(int event, void *edata)
 {
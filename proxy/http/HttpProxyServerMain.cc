@@ -29,6 +29,7 @@
 #include "HttpAccept.h"
 #include "ReverseProxy.h"
 #include "HttpSessionManager.h"
+#include "HttpSessionPrewarm.h"
 #include "HttpUpdateSM.h"
 #include "HttpClientSession.h"
 #include "HttpPages.h"
@@ -193,6 +194,9 @@ start_HttpProxyServer(int accept_threads)
     start_HttpProxyPort(HttpProxyPort::global()[i], accept_threads);
   }
 
+  // Keep idle sessions open to the configured upstreams
+  start_http_session_prewarm();
+
 #if TS_HAS_TESTS
   if (is_action_tag_set("http_update_test")) {
     init_http_update_test();
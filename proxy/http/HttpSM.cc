@@ -38,6 +38,7 @@
 #include "ReverseProxy.h"
 #include "RemapProcessor.h"
 #include "Transform.h"
+#include "HttpStaleRevalidate.h"
 
 #include "HttpPages.h"
 
@@ -73,12 +74,12 @@ ink_mutex debug_sm_list_mutex;
 //  _instantiate_func is called from the fast allocator to initialize
 //  newly-allocated HttpSM objects.  By default, the fast allocators
 //  just memcpys the entire prototype object, but this function does
-//  sparse initialization, not copying dead space for history.
+//  sparse initialization.
 //
 //  Most of the content of in the prototype object consists of zeroes.
 //  To take advantage of that, a "scatter list" is contructed of
 //  the non-zero words, and those values are scattered onto the
-//  new object after first zeroing out the object (except for dead space).
+//  new object after first zeroing out the object.
 //
 //  make_scatter_list should be called only once (during static
 //  initialization, since it isn't thread safe).
@@ -139,32 +140,33 @@ HttpSM::_make_scatter_list(HttpSM * prototype)
 void
 HttpSM::_instantiate_func(HttpSM * prototype, HttpSM * new_instance)
 {
-  int history_len = sizeof(prototype->history);
   int total_len = sizeof(HttpSM);
-  int pre_history_len = (char *) (&(prototype->history)) - (char *) prototype;
-  int post_history_len = total_len - history_len - pre_history_len;
-  int post_offset = pre_history_len + history_len;
 
 #ifndef SIMPLE_MEMCPY_INIT
   int j;
 
-  memset(((char *) new_instance), 0, pre_history_len);
-  memset(((char *) new_instance) + post_offset, 0, post_history_len);
+  memset(((char *) new_instance), 0, total_len);
   uint32_t *pd = (uint32_t *) new_instance;
   for (j = 0; j < scat_count; j++) {
     pd[to[j]] = val[j];
   }
 
-  ink_assert((memcmp((char *) new_instance, (char *) prototype, pre_history_len) == 0) &&
-                   (memcmp(((char *) new_instance) + post_offset, ((char *) prototype) + post_offset, post_history_len) == 0));
+  ink_assert(memcmp((char *) new_instance, (char *) prototype, total_len) == 0);
 #else
-  // memcpy(new_instance, prototype, total_len);
-  memcpy(new_instance, prototype, pre_history_len);
-  memcpy(((char *) new_instance) + post_offset, ((char *) prototype) + post_offset, post_history_len);
+  memcpy(new_instance, prototype, total_len);
 #endif
 }
 
 SparceClassAllocator<HttpSM> httpSMAllocator("httpSMAllocator", 128, 16, HttpSM::_instantiate_func);
+static Allocator httpSMHistoryAllocator("httpSMHistoryAllocator", HISTORY_SIZE * sizeof(HttpSM::History));
+
+// Everything a transaction needs only some of the time (the debug
+//  history, plugin buffers and config copies, SRV names, the transform
+//  cache write) is allocated on demand, so that each of many idle,
+//  long-lived transactions costs as little as possible.  Keep it that
+//  way: the build fails if the state machine grows past this.
+#define HTTP_SM_SIZE_LIMIT  6144
+typedef char HttpSMSizeCheck[sizeof(HttpSM) <= HTTP_SM_SIZE_LIMIT ? 1 : -1];
 
 #define HTTP_INCREMENT_TRANS_STAT(X) HttpTransact::update_stat(&t_state, X, 1);
 
@@ -314,13 +316,13 @@ HttpSM::HttpSM()
     post_failed(false), debug_on(false),
     plugin_tunnel_type(HTTP_NO_PLUGIN_TUNNEL),
     plugin_tunnel(NULL), reentrancy_count(0),
-    history_pos(0), tunnel(), ua_entry(NULL),
+    history(NULL), history_pos(0), tunnel(), ua_entry(NULL),
     ua_session(NULL), background_fill(BACKGROUND_FILL_NONE),
     ua_raw_buffer_reader(NULL),
     server_entry(NULL), server_session(NULL), shared_session_retries(0),
     server_buffer_reader(NULL),
-    transform_info(), post_transform_info(), second_cache_sm(NULL),
-    default_handler(NULL), pending_action(NULL), historical_action(NULL),
+    transform_info(), post_transform_info(), transform_cache_sm(NULL), second_cache_sm(NULL),
+    default_handler(NULL), pending_action(NULL), historical_action(NULL), origin_waiter(NULL),
     last_action(HttpTransact::STATE_MACHINE_ACTION_UNDEFINED),
     client_request_hdr_bytes(0), client_request_body_bytes(0),
     server_request_hdr_bytes(0), server_request_body_bytes(0),
@@ -333,7 +335,6 @@ HttpSM::HttpSM()
 {
   static int scatter_init = 0;
 
-  memset(&history, 0, sizeof(history));
   memset(&vc_table, 0, sizeof(vc_table));
   memset(&http_parser, 0, sizeof(http_parser));
 
@@ -346,6 +347,8 @@ HttpSM::HttpSM()
 void
 HttpSM::cleanup()
 {
+  releaseUrlRewrite(t_state.remap_table);
+  t_state.remap_table = NULL;
   t_state.destroy();
   api_hooks.clear();
   http_parser_clear(&http_parser);
@@ -357,11 +360,18 @@ HttpSM::cleanup()
   mutex.clear();
   tunnel.mutex.clear();
   cache_sm.mutex.clear();
-  transform_cache_sm.mutex.clear();
+  if (transform_cache_sm) {
+    transform_cache_sm->mutex.clear();
+    delete transform_cache_sm;
+  }
   if (second_cache_sm) {
     second_cache_sm->mutex.clear();
     delete second_cache_sm;
   }
+  if (history) {
+    httpSMHistoryAllocator.free_void(history);
+    history = NULL;
+  }
   magic = HTTP_SM_MAGIC_DEAD;
   debug_on = false;
 }
@@ -400,6 +410,11 @@ HttpSM::init()
 
   t_state.http_config_param = HttpConfig::acquire();
 
+  if (t_state.http_config_param->record_sm_history) {
+    history = (History *) httpSMHistoryAllocator.alloc_void();
+    history_pos = 0;
+  }
+
   // Simply point to the global config for the time being, no need to copy this
   // entire struct if nothing is going to change it.
   t_state.txn_conf = &t_state.http_config_param->oride;
@@ -583,7 +598,6 @@ HttpSM::start_sub_sm()
 {
   tunnel.init(this, mutex);
   cache_sm.init(this, mutex);
-  transform_cache_sm.init(this, mutex);
 }
 
 void
@@ -1092,8 +1106,20 @@ HttpSM::state_raw_http_server_open(int event, void *data)
   milestones.server_connect_end = ink_get_hrtime();
   NetVConnection *netvc = NULL;
 
+  if (event == EVENT_IMMEDIATE && data == origin_waiter && pending_action) {
+    pending_action->cancel();
+  }
   pending_action = NULL;
+  if (event != EVENT_INTERVAL && event != EVENT_IMMEDIATE) {
+    leave_origin_queue();
+  }
   switch (event) {
+  case EVENT_INTERVAL:
+  case EVENT_IMMEDIATE:
+    // Retry after waiting for a connection to the origin
+    do_http_server_open(true);
+    return 0;
+
   case NET_EVENT_OPEN:
 
     if (t_state.pCongestionEntry != NULL) {
@@ -1451,7 +1477,8 @@ HttpSM::state_api_callout(int event, void *data)
       t_state.api_http_sm_shutdown = false;
       t_state.cache_info.object_read = NULL;
       cache_sm.close_read();
-      transform_cache_sm.close_read();
+      if (transform_cache_sm)
+        transform_cache_sm->close_read();
       release_server_session();
       terminate_sm = true;
       api_next = API_RETURN_SHUTDOWN;
@@ -1550,7 +1577,8 @@ HttpSM::handle_api_return()
       t_state.request_sent_time = UNDEFINED_TIME;
       t_state.response_received_time = UNDEFINED_TIME;
       cache_sm.close_read();
-      transform_cache_sm.close_read();
+      if (transform_cache_sm)
+        transform_cache_sm->close_read();
     }
     call_transact_and_set_next_state(NULL);
     return;
@@ -1639,7 +1667,16 @@ HttpSM::state_http_server_open(int event, void *data)
   STATE_ENTER(&HttpSM::state_http_server_open, event);
   // TODO decide whether to uncomment after finish testing redirect
   // ink_assert(server_entry == NULL);
+
+  // Woken up by the origin's connection queue; drop the fallback timer
+  if (event == EVENT_IMMEDIATE && data == origin_waiter && pending_action) {
+    pending_action->cancel();
+  }
   pending_action = NULL;
+  // Anything but a retry ends the wait for this origin
+  if (event != EVENT_INTERVAL && event != EVENT_IMMEDIATE) {
+    leave_origin_queue();
+  }
   milestones.server_connect_end = ink_get_hrtime();
   HttpServerSession *session;
 
@@ -1681,6 +1718,7 @@ HttpSM::state_http_server_open(int event, void *data)
     handle_http_server_open();
     return 0;
   case EVENT_INTERVAL:
+  case EVENT_IMMEDIATE:
     do_http_server_open();
     break;
   case VC_EVENT_ERROR:
@@ -1979,7 +2017,6 @@ HttpSM::process_srv_info(HostDBInfo * r)
 
   /* we didnt get any SRV records, continue w normal lookup */
   if (!r || !r->is_srv || !r->round_robin) {
-    t_state.dns_info.srv_hostname[0] = '\0';
     t_state.dns_info.srv_lookup_success = false;
     t_state.srv_lookup = false;
     DebugSM("dns_srv", "No SRV records were available, continuing to lookup %s", t_state.dns_info.lookup_name);
@@ -1987,12 +2024,14 @@ HttpSM::process_srv_info(HostDBInfo * r)
     HostDBRoundRobin *rr = r->rr();
     HostDBInfo *srv = NULL;
     if (rr) {
+      if (t_state.dns_info.srv_hostname == NULL) {
+        t_state.dns_info.srv_hostname = (char *) t_state.arena.alloc(MAXDNAME);
+      }
       srv = rr->select_best_srv(t_state.dns_info.srv_hostname, &mutex.m_ptr->thread_holding->generator,
           ink_cluster_time(), (int) t_state.txn_conf->down_server_timeout);
     }
     if (!srv) {
       t_state.dns_info.srv_lookup_success = false;
-      t_state.dns_info.srv_hostname[0] = '\0';
       t_state.srv_lookup = false;
       DebugSM("dns_srv", "SRV records empty for %s", t_state.dns_info.lookup_name);
     } else {
@@ -2103,7 +2142,10 @@ HttpSM::state_hostdb_lookup(int event, void *data)
             : HostDBProcessor::HOSTDB_FORCE_DNS_RELOAD
           ;
       opt.timeout = (t_state.api_txn_dns_timeout_value != -1) ? t_state.api_txn_dns_timeout_value : 0;
-      opt.host_res_style = ua_session->host_res_style;
+      // Scheduled updates have no client session; keep the default style
+      if (ua_session) {
+        opt.host_res_style = ua_session->host_res_style;
+      }
 
       Action *dns_lookup_action_handle = hostDBProcessor.getbyname_imm(this,
                                                                  (process_hostdb_info_pfn) & HttpSM::
@@ -3826,7 +3868,9 @@ HttpSM::do_hostdb_lookup()
             : HostDBProcessor::HOSTDB_FORCE_DNS_RELOAD
           ;
       opt.timeout = (t_state.api_txn_dns_timeout_value != -1) ? t_state.api_txn_dns_timeout_value : 0;
-      opt.host_res_style = ua_session->host_res_style;
+      if (ua_session) {
+        opt.host_res_style = ua_session->host_res_style;
+      }
 
       Action *dns_lookup_action_handle = hostDBProcessor.getbyname_imm(this,
                                                                  (process_hostdb_info_pfn) & HttpSM::
@@ -3861,7 +3905,9 @@ HttpSM::do_hostdb_lookup()
       : HostDBProcessor::HOSTDB_FORCE_DNS_RELOAD
     ;
     opt.timeout = (t_state.api_txn_dns_timeout_value != -1) ? t_state.api_txn_dns_timeout_value : 0;
-    opt.host_res_style = ua_session->host_res_style;
+    if (ua_session) {
+      opt.host_res_style = ua_session->host_res_style;
+    }
 
     Action *dns_lookup_action_handle = hostDBProcessor.getbyname_imm(this, (process_hostdb_info_pfn) & HttpSM::process_hostdb_info, t_state.dns_info.lookup_name, 0, opt);
 
@@ -3966,6 +4012,53 @@ HttpSM::do_hostdb_update_if_necessary()
   return;
 }
 
+void
+HttpSM::do_background_revalidation()
+{
+  HTTPHdr request;
+  INK_MD5 md5;
+
+  // The revalidation goes through remap again, so it starts from the
+  //  URL and Host the client sent.  It is always a GET, and conditionals
+  //  and ranges are dropped, so that a changed object is fetched whole
+  //  even when the stale hit was a HEAD.
+  request.create(HTTP_TYPE_REQUEST);
+  request.copy(&t_state.hdr_info.client_request);
+
+  if (t_state.pristine_url.valid()) {
+    request.url_set(&t_state.pristine_url);
+
+    if (request.presence(MIME_PRESENCE_HOST)) {
+      char host_hdr_buf[TS_MAX_HOST_NAME_LEN];
+      int host_len;
+      const char *host = t_state.pristine_url.host_get(&host_len);
+      int port = t_state.pristine_url.port_get_raw();
+
+      if (host && host_len < TS_MAX_HOST_NAME_LEN - 8) {
+        memcpy(host_hdr_buf, host, host_len);
+        if (port) {
+          host_len += snprintf(host_hdr_buf + host_len, sizeof(host_hdr_buf) - host_len, ":%d", port);
+        }
+        request.value_set(MIME_FIELD_HOST, MIME_LEN_HOST, host_hdr_buf, host_len);
+      }
+    }
+  }
+
+  request.method_set(HTTP_METHOD_GET, HTTP_LEN_GET);
+  request.field_delete(MIME_FIELD_IF_MODIFIED_SINCE, MIME_LEN_IF_MODIFIED_SINCE);
+  request.field_delete(MIME_FIELD_IF_UNMODIFIED_SINCE, MIME_LEN_IF_UNMODIFIED_SINCE);
+  request.field_delete(MIME_FIELD_IF_NONE_MATCH, MIME_LEN_IF_NONE_MATCH);
+  request.field_delete(MIME_FIELD_IF_MATCH, MIME_LEN_IF_MATCH);
+  request.field_delete(MIME_FIELD_IF_RANGE, MIME_LEN_IF_RANGE);
+  request.field_delete(MIME_FIELD_RANGE, MIME_LEN_RANGE);
+
+  t_state.cache_info.lookup_url->MD5_get(&md5);
+  if (http_stale_revalidate_schedule(&request, md5)) {
+    DebugSM("http", "[%" PRId64 "] started background revalidation", sm_id);
+  }
+  request.destroy();
+}
+
 /*
  * range entry vaild [a,b] (a >= 0 and b >= 0 and a <= b)
  * HttpTransact::RANGE_NONE if the content length of cached copy is zero or
@@ -4286,9 +4379,9 @@ inline void
 HttpSM::do_cache_prepare_write_transform()
 {
   if (cache_sm.cache_write_vc != NULL || tunnel.is_there_cache_write())
-    do_cache_prepare_action(&transform_cache_sm, NULL, false, true);
+    do_cache_prepare_action(add_transform_cache_sm(), NULL, false, true);
   else
-    do_cache_prepare_action(&transform_cache_sm, NULL, false);
+    do_cache_prepare_action(add_transform_cache_sm(), NULL, false);
 }
 
 void
@@ -4531,15 +4624,39 @@ HttpSM::do_http_server_open(bool raw)
   // host.
   if (t_state.txn_conf->origin_max_connections > 0) {
     ConnectionCount *connections = ConnectionCount::getInstance();
+    ConnectionCount::Entry *entry = connections->getEntry(t_state.current.server->addr);
 
     char addrbuf[INET6_ADDRSTRLEN];
-    if (connections->getCount((t_state.current.server->addr)) >= t_state.txn_conf->origin_max_connections) {
-      DebugSM("http", "[%" PRId64 "] over the number of connection for this host: %s", sm_id,
-        ats_ip_ntop(&t_state.current.server->addr.sa, addrbuf, sizeof(addrbuf)));
+    if (entry->count >= t_state.txn_conf->origin_max_connections) {
+      DebugSM("http", "[%" PRId64 "] over the number of connection for this host: %s, %d waiting", sm_id,
+        ats_ip_ntop(&t_state.current.server->addr.sa, addrbuf, sizeof(addrbuf)), entry->queued);
+
+      if (origin_waiter == NULL) {
+        origin_waiter = NEW(new ConnectionCount::Waiter(this));
+      }
+      bool was_queued = (origin_waiter->entry != NULL);
+
+      if (!connections->enqueue(entry, origin_waiter, t_state.http_config_param->origin_max_connections_queue)) {
+        DebugSM("http", "[%" PRId64 "] connection queue for %s is full", sm_id,
+                ats_ip_ntop(&t_state.current.server->addr.sa, addrbuf, sizeof(addrbuf)));
+        HTTP_INCREMENT_DYN_STAT(http_origin_connections_queue_full_stat);
+        leave_origin_queue();
+        t_state.current.state = HttpTransact::OUTBOUND_CONGESTION;
+        call_transact_and_set_next_state(raw ? HttpTransact::OriginServerRawOpen : HttpTransact::HandleResponse);
+        return;
+      }
+      if (!was_queued) {
+        HTTP_INCREMENT_DYN_STAT(http_origin_connections_queued_stat);
+      }
+
+      // A closing connection wakes us up; the timer only covers a
+      //   limit that was lowered while we wait
       ink_assert(pending_action == NULL);
-      pending_action = eventProcessor.schedule_in(this, HRTIME_MSECONDS(100));
+      pending_action = eventProcessor.schedule_in(this, HRTIME_SECONDS(1));
       return;
     }
+
+    leave_origin_queue();
   }
 
   // We did not manage to get an exisiting session
@@ -4623,6 +4740,17 @@ HttpSM::do_http_server_open(bool raw)
   return;
 }
 
+// Give up our place in the origin's connection queue.  A wake up that
+//   is already on its way goes to the next waiter instead of to us.
+void
+HttpSM::leave_origin_queue()
+{
+  if (origin_waiter) {
+    ConnectionCount::getInstance()->leave(origin_waiter);
+    origin_waiter = NULL;
+  }
+}
+
 
 void
 HttpSM::do_icp_lookup()
@@ -4938,6 +5066,9 @@ HttpSM::handle_post_failure()
 void
 HttpSM::handle_http_server_open()
 {
+  // A pooled session may have come along while we were queued
+  leave_origin_queue();
+
   // [bwyatt] applying per-transaction OS netVC options here
   //          IFF they differ from the netVC's current options.
   //          This should keep this from being redundant on a
@@ -5260,15 +5391,16 @@ HttpSM::perform_transform_cache_write_action()
   case HttpTransact::CACHE_DO_NO_ACTION:
     {
       // Nothing to do
-      transform_cache_sm.end_both();
+      if (transform_cache_sm)
+        transform_cache_sm->end_both();
       break;
     }
 
   case HttpTransact::CACHE_DO_WRITE:
     {
-      transform_cache_sm.close_read();
+      add_transform_cache_sm()->close_read();
       t_state.cache_info.transform_write_status = HttpTransact::CACHE_WRITE_IN_PROGRESS;
-      setup_cache_write_transfer(&transform_cache_sm,
+      setup_cache_write_transfer(transform_cache_sm,
                                  transform_info.entry->vc,
                                  &t_state.cache_info.transform_store, client_response_hdr_bytes, "cache write t");
       break;
@@ -5349,8 +5481,9 @@ HttpSM::perform_cache_write_action()
     } else {
       // We are not caching the untransformed.  We might want to
       //  use the cache writevc to cache the transformed copy
-      ink_assert(transform_cache_sm.cache_write_vc == NULL);
-      transform_cache_sm.cache_write_vc = cache_sm.cache_write_vc;
+      add_transform_cache_sm();
+      ink_assert(transform_cache_sm->cache_write_vc == NULL);
+      transform_cache_sm->cache_write_vc = cache_sm.cache_write_vc;
       cache_sm.cache_write_vc = NULL;
     }
     break;
@@ -6312,10 +6445,13 @@ HttpSM::kill_this()
       pending_action = NULL;
     }
 
+    leave_origin_queue();
+
     cache_sm.end_both();
     if (second_cache_sm)
       second_cache_sm->end_both();
-    transform_cache_sm.end_both();
+    if (transform_cache_sm)
+      transform_cache_sm->end_both();
     vc_table.cleanup_all();
     tunnel.deallocate_buffers();
 
@@ -6487,6 +6623,24 @@ HttpSM::update_stats()
     cache_lookup_time = -1;
   }
 
+  // latency histograms, for the milestones this transaction got through
+  HTTP_RECORD_DYN_HIST(http_total_latency_hist, ink_hrtime_to_usec(total_time));
+  if (milestones.ua_read_header_done != 0 && milestones.ua_begin_write >= milestones.ua_read_header_done) {
+    HTTP_RECORD_DYN_HIST(http_first_byte_latency_hist,
+                         ink_hrtime_to_usec(milestones.ua_begin_write - milestones.ua_read_header_done));
+  }
+  if (cache_lookup_time >= 0) {
+    HTTP_RECORD_DYN_HIST(http_cache_lookup_latency_hist, ink_hrtime_to_usec(cache_lookup_time));
+  }
+  if (milestones.dns_lookup_begin != 0 && milestones.dns_lookup_end >= milestones.dns_lookup_begin) {
+    HTTP_RECORD_DYN_HIST(http_dns_lookup_latency_hist,
+                         ink_hrtime_to_usec(milestones.dns_lookup_end - milestones.dns_lookup_begin));
+  }
+  if (milestones.server_connect != 0 && milestones.server_connect_end >= milestones.server_connect) {
+    HTTP_RECORD_DYN_HIST(http_origin_connect_latency_hist,
+                         ink_hrtime_to_usec(milestones.server_connect_end - milestones.server_connect));
+  }
+
   HttpTransact::update_size_and_time_stats(&t_state,
                                            total_time,
                                            ua_write_time,
@@ -7076,7 +7230,7 @@ HttpSM::set_next_state()
     {
       ink_assert(t_state.cache_info.transform_action == HttpTransact::CACHE_PREPARE_TO_WRITE);
 
-      if (transform_cache_sm.cache_write_vc) {
+      if (transform_cache_sm && transform_cache_sm->cache_write_vc) {
         // We've already got the write_vc that
         //  didn't use for the untransformed copy
         ink_assert(cache_sm.cache_write_vc == NULL);
@@ -7301,6 +7455,7 @@ HttpSM::redirect_request(const char *redirect_url, const int redirect_len)
   t_state.hdr_info.server_request.destroy();
   // we want to close the server session
   t_state.api_release_server_session = true;
+  t_state.parent_params->parentRequestDone(&t_state.parent_result);
   t_state.parent_result.r = PARENT_UNDEFINED;
   t_state.request_sent_time = 0;
   t_state.response_received_time = 0;
@@ -7396,3 +7551,46 @@ HttpSM::is_private()
     }
     return res;
 }
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+
+REGRESSION_TEST(HttpSM_Footprint)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+  char body[HTTP_TRANSACT_STATE_MAX_XBUF_SIZE + 100];
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  rprintf(t, "HttpSM %d bytes (limit %d), HttpTransact::State %d, HttpTunnel %d, HttpCacheSM %d, history %d\n",
+          (int) sizeof(HttpSM), HTTP_SM_SIZE_LIMIT, (int) sizeof(HttpTransact::State), (int) sizeof(HttpTunnel),
+          (int) sizeof(HttpCacheSM), (int) (HISTORY_SIZE * sizeof(HttpSM::History)));
+  rperf(t, "http_sm_bytes", (double) sizeof(HttpSM));
+
+  HttpSM *sm = HttpSM::allocate();
+  HttpTransact::State *s = &sm->t_state;
+
+  sm->init();
+
+  // None of the on demand parts exist until they are needed
+  tb.check(s->return_xbuf == NULL && s->return_xbuf_size == 0, "no plugin response body");
+  tb.check(s->dns_info.srv_hostname == NULL, "no SRV name buffer");
+  tb.check(s->my_txn_conf == NULL && s->txn_conf == &s->http_config_param->oride, "global overridable config shared");
+
+  s->setup_per_txn_configs();
+  tb.check(s->my_txn_conf != NULL && s->txn_conf == s->my_txn_conf, "private overridable config after a plugin override");
+  tb.check(memcmp(s->my_txn_conf, &s->http_config_param->oride, sizeof(OverridableHttpConfigParams)) == 0,
+           "private overridable config starts as a copy");
+
+  memset(body, 'x', sizeof(body) - 1);
+  body[sizeof(body) - 1] = '\0';
+  TSHttpTxnSetHttpRetBody((TSHttpTxn) sm, body, 1);
+  tb.check(s->return_xbuf_size == HTTP_TRANSACT_STATE_MAX_XBUF_SIZE - 1 && strlen(s->return_xbuf) == (size_t) s->return_xbuf_size,
+           "plugin response body is truncated to %d bytes, got %d", HTTP_TRANSACT_STATE_MAX_XBUF_SIZE - 1, s->return_xbuf_size);
+  TSHttpTxnSetHttpRetBody((TSHttpTxn) sm, "gone", 0);
+  tb.check(s->return_xbuf_size == 4 && strcmp(s->return_xbuf, "gone") == 0 && !s->return_xbuf_plain, "plugin response body replaced");
+
+  sm->destroy();
+}
+#endif /* TS_HAS_TESTS */
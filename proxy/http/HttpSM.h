@@ -42,6 +42,7 @@
 #include "StatSystem.h"
 #include "HttpClientSession.h"
 #include "HdrUtils.h"
+#include "HttpConnectionCount.h"
 //#include "AuthHttpAdapter.h"
 
 /* Enable LAZY_BUF_ALLOC to delay allocation of buffers until they
@@ -215,6 +216,10 @@ public:
   //  directly from transact
   void do_hostdb_update_if_necessary();
 
+  // Called by transact when a stale-while-revalidate hit is
+  //  served.  Starts the refresh in the background, once per object
+  void do_background_revalidation();
+
   // Called by transact. Decide if cached response supports Range and
   // setup Range transfomration if so.
   // return true when the Range is unsatisfiable
@@ -262,6 +267,7 @@ public:
 
   void add_history_entry(const char *fileline, int event, int reentrant);
   void add_cache_sm();
+  HttpCacheSM *add_transform_cache_sm();
   bool is_private();
   bool decide_cached_url(URL * s_url);
 
@@ -284,16 +290,19 @@ public:
 
   HttpTransact::State t_state;
 
-protected:
-  int reentrancy_count;
-
   struct History
   {
     const char *fileline;
     unsigned short event;
     short reentrancy;
   };
-  History history[HISTORY_SIZE];
+
+protected:
+  int reentrancy_count;
+
+  // HISTORY_SIZE entries, only allocated when
+  //  proxy.config.http.record_sm_history is set
+  History *history;
   int history_pos;
 
   HttpTunnel tunnel;
@@ -324,12 +333,14 @@ protected:
   HttpTransformInfo post_transform_info;
 
   HttpCacheSM cache_sm;
-  HttpCacheSM transform_cache_sm;
+  HttpCacheSM *transform_cache_sm;
   HttpCacheSM *second_cache_sm;
 
   HttpSMHandler default_handler;
   Action *pending_action;
   Action *historical_action;
+  // Place in the origin's queue when it is at origin_max_connections
+  ConnectionCount::Waiter *origin_waiter;
   Continuation *schedule_cont;
 
   HTTPParser http_parser;
@@ -402,6 +413,7 @@ protected:
   void do_hostdb_reverse_lookup();
   void do_cache_lookup_and_read();
   void do_http_server_open(bool raw = false);
+  void leave_origin_queue();
   void do_setup_post_tunnel(HttpVC_t to_vc_type);
   void do_cache_prepare_write();
   void do_cache_prepare_write_transform();
@@ -575,6 +587,10 @@ HttpSM::write_response_header_into_buffer(HTTPHdr * h, MIOBuffer * b)
 inline void
 HttpSM::add_history_entry(const char *fileline, int event, int reentrant)
 {
+  if (history == NULL) {
+    return;
+  }
+
   int pos = history_pos++ % HISTORY_SIZE;
   history[pos].fileline = fileline;
   history[pos].event = (unsigned short) event;
@@ -624,6 +640,16 @@ HttpSM::add_cache_sm()
   }
 }
 
+inline HttpCacheSM *
+HttpSM::add_transform_cache_sm()
+{
+  if (transform_cache_sm == NULL) {
+    transform_cache_sm = NEW(new HttpCacheSM);
+    transform_cache_sm->init(this, mutex);
+  }
+  return transform_cache_sm;
+}
+
 inline bool
 HttpSM::is_transparent_passthrough_allowed()
 {
@@ -77,11 +77,12 @@ HttpServerSession::new_connection(NetVConnection *new_vc)
   if (enable_origin_connection_limiting == true) {
     if (connection_count == NULL)
       connection_count = ConnectionCount::getInstance();
-    connection_count->incrementCount(server_ip);
+    connection_entry = connection_count->getEntry(server_ip);
+    connection_count->incrementCount(connection_entry);
     char addrbuf[INET6_ADDRSTRLEN];
     Debug("http_ss", "[%" PRId64 "] new connection, ip: %s, count: %u", 
         con_id, 
-        ats_ip_ntop(&server_ip.sa, addrbuf, sizeof(addrbuf)), connection_count->getCount(server_ip));
+        ats_ip_ntop(&server_ip.sa, addrbuf, sizeof(addrbuf)), connection_entry->count);
   }
 #ifdef LAZY_BUF_ALLOC
   read_buffer = new_empty_MIOBuffer(HTTP_SERVER_RESP_HDR_BUFFER_INDEX);
@@ -129,16 +130,16 @@ HttpServerSession::do_io_close(int alerrno)
   // Check to see if we are limiting the number of connections
   // per host
   if (enable_origin_connection_limiting == true) {
-    if (connection_count->getCount(server_ip) > 0) {
-      connection_count->incrementCount(server_ip, -1);
+    if (connection_entry->count > 0) {
+      connection_count->incrementCount(connection_entry, -1);
       char addrbuf[INET6_ADDRSTRLEN];
       Debug("http_ss", "[%" PRId64 "] connection closed, ip: %s, count: %u",
             con_id, 
             ats_ip_ntop(&server_ip.sa, addrbuf, sizeof(addrbuf)), 
-            connection_count->getCount(server_ip));
+            connection_entry->count);
     } else {
       Error("[%" PRId64 "] number of connections should be greater then zero: %u",
-            con_id, connection_count->getCount(server_ip));
+            con_id, connection_entry->count);
     }
   }
 
@@ -72,9 +72,9 @@ public:
       hostname_hash(),
       host_hash_computed(false), con_id(0), transact_count(0),
       state(HSS_INIT), to_parent_proxy(false), server_trans_stat(0),
-      private_session(false), share_session(0),
+      private_session(false), share_session(0), prewarmed(false),
       enable_origin_connection_limiting(false),
-      connection_count(NULL), read_buffer(NULL),
+      connection_count(NULL), connection_entry(NULL), read_buffer(NULL),
       server_vc(NULL), magic(HTTP_SS_MAGIC_DEAD), buf_reader(NULL)
     { 
       ink_zero(server_ip);
@@ -140,6 +140,9 @@ public:
   // Copy of the owning SM's share_server_session setting
   int share_session;
 
+  // Opened ahead of demand by the pre-warmer and not used yet
+  bool prewarmed;
+
   LINK(HttpServerSession, lru_link);
   LINK(HttpServerSession, hash_link);
 
@@ -147,6 +150,7 @@ public:
   // singleton that keeps track of the connection counts.
   bool enable_origin_connection_limiting;
   ConnectionCount *connection_count;
+  ConnectionCount::Entry *connection_entry;
 
   // The ServerSession owns the following buffer which use
   //   for parsing the headers.  The server session needs to
@@ -39,6 +39,11 @@
 #define FIRST_LEVEL_HASH(x)   ats_ip_hash(x) % HSM_LEVEL1_BUCKETS
 #define SECOND_LEVEL_HASH(x)  ats_ip_hash(x) % HSM_LEVEL2_BUCKETS
 
+// Threads that have per-thread session pools, so a thread that
+//   misses in its own pool can look for an idle session in theirs
+static EThread *session_threads[MAX_EVENT_THREADS];
+static volatile int n_session_threads = 0;
+
 // Initialize a thread to handle HTTP session management
 void
 initialize_thread_for_http_sessions(EThread *thread, int thread_index)
@@ -49,6 +54,10 @@ initialize_thread_for_http_sessions(EThread *thread, int thread_index)
   for (int i = 0; i < HSM_LEVEL1_BUCKETS; ++i)
     thread->l1_hash[i].mutex = new_ProxyMutex();
   //thread->l1_hash[i].mutex = thread->mutex;
+
+  int slot = ink_atomic_increment(&n_session_threads, 1);
+  ink_release_assert(slot < MAX_EVENT_THREADS);
+  session_threads[slot] = thread;
 }
 
 
@@ -105,7 +114,7 @@ SessionBucket::session_handler(int event, void *data)
       if ((event == VC_EVENT_INACTIVITY_TIMEOUT || event == VC_EVENT_ACTIVE_TIMEOUT) &&
           s->state == HSS_KA_SHARED &&
           s->enable_origin_connection_limiting) {
-        bool connection_count_below_min = s->connection_count->getCount(s->server_ip) <= http_config_params->origin_min_keep_alive_connections;
+        bool connection_count_below_min = s->connection_entry->count <= http_config_params->origin_min_keep_alive_connections;
 
         if (connection_count_below_min) {
           Debug("http_ss", "[%" PRId64 "] [session_bucket] session received io notice [%s], "
@@ -123,6 +132,9 @@ SessionBucket::session_handler(int event, void *data)
       Debug("http_ss", "[%" PRId64 "] [session_bucket] session received io notice [%s]",
             s->con_id, HttpDebugNames::get_event_name(event));
       ink_assert(s->state == HSS_KA_SHARED);
+      if (s->prewarmed) {
+        RecIncrRawStat(http_rsb, this_ethread(), (int) http_origin_prewarm_expired_stat, 1);
+      }
       lru_list.remove(s);
       l2_hash[l2_index].remove(s);
       s->do_io_close();
@@ -197,6 +209,10 @@ _acquire_session(SessionBucket *bucket, sockaddr const* ip, INK_MD5 &hostname_ha
         bucket->lru_list.remove(b);
         bucket->l2_hash[l2_index].remove(b);
         b->state = HSS_ACTIVE;
+        if (b->prewarmed) {
+          b->prewarmed = false;
+          RecIncrRawStat(http_rsb, this_ethread(), (int) http_origin_prewarm_used_stat, 1);
+        }
         to_return = b;
         Debug("http_ss", "[%" PRId64 "] [acquire session] " "return session from shared pool", to_return->con_id);
         sm->attach_server_session(to_return);
@@ -210,6 +226,40 @@ _acquire_session(SessionBucket *bucket, sockaddr const* ip, INK_MD5 &hostname_ha
   return HSM_NOT_FOUND;
 }
 
+// Look for an idle session in the pools of the other threads.  The
+//   buckets are only ever try-locked, so a busy bucket is skipped
+//   rather than waited on.  The session's connection stays with the
+//   net thread it was opened on, as it does for the global pool.
+static HSMresult_t
+_steal_session(EThread *ethread, int l1_index, sockaddr const* ip, INK_MD5 &hostname_hash, HttpSM *sm)
+{
+  int n = n_session_threads;
+  int start = (ethread->id < 0 ? 0 : ethread->id);
+
+  for (int i = 0; i < n; ++i) {
+    EThread *victim = session_threads[(start + i) % n];
+
+    if (victim == NULL || victim == ethread) {
+      continue;
+    }
+
+    SessionBucket *bucket = victim->l1_hash + l1_index;
+
+    // Cheap unlocked peek; an empty bucket is not worth the lock
+    if (bucket->lru_list.head == NULL) {
+      continue;
+    }
+
+    MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
+    if (lock && _acquire_session(bucket, ip, hostname_hash, sm) == HSM_DONE) {
+      Debug("http_ss", "[acquire session] took an idle session from thread %p", victim);
+      return HSM_DONE;
+    }
+  }
+
+  return HSM_NOT_FOUND;
+}
+
 HSMresult_t
 HttpSessionManager::acquire_session(Continuation *cont, sockaddr const* ip,
                                     const char *hostname, HttpClientSession *ua_session, HttpSM *sm)
@@ -270,14 +320,36 @@ HttpSessionManager::acquire_session(Continuation *cont, sockaddr const* ip,
     ink_code_MMH((unsigned char *) hostname, strlen(hostname), (unsigned char *) &hostname_hash);
 
   if (2 == sm->t_state.txn_conf->share_server_sessions) {
+    SessionBucket *bucket = ethread->l1_hash + l1_index;
+    HSMresult_t retval = HSM_NOT_FOUND;
+
     ink_assert(ethread->l1_hash);
-    return _acquire_session(ethread->l1_hash + l1_index, ip, hostname_hash, sm);
+    {
+      // Other threads may be taking sessions from this bucket too
+      MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
+      if (lock) {
+        retval = _acquire_session(bucket, ip, hostname_hash, sm);
+      }
+    }
+
+    if (retval == HSM_DONE) {
+      RecIncrRawStat(http_rsb, ethread, (int) http_origin_pool_reuse_stat, 1);
+    } else if ((retval = _steal_session(ethread, l1_index, ip, hostname_hash, sm)) == HSM_DONE) {
+      RecIncrRawStat(http_rsb, ethread, (int) http_origin_pool_steal_stat, 1);
+    } else {
+      RecIncrRawStat(http_rsb, ethread, (int) http_origin_pool_miss_stat, 1);
+    }
+    return retval;
   } else {
     SessionBucket *bucket = g_l1_hash + l1_index;
 
     MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
     if (lock) {
-      return _acquire_session(bucket, ip, hostname_hash, sm);
+      HSMresult_t retval = _acquire_session(bucket, ip, hostname_hash, sm);
+
+      RecIncrRawStat(http_rsb, ethread,
+                     (int) (retval == HSM_DONE ? http_origin_pool_reuse_stat : http_origin_pool_miss_stat), 1);
+      return retval;
     } else {
       Debug("http_ss", "[acquire session] could not acquire session due to lock contention");
     }
@@ -286,6 +358,55 @@ HttpSessionManager::acquire_session(Continuation *cont, sockaddr const* ip,
   return HSM_RETRY;
 }
 
+static int
+_count_idle_sessions(SessionBucket *bucket, sockaddr const* ip, INK_MD5 &hostname_hash)
+{
+  int count = 0;
+  int l2_index = SECOND_LEVEL_HASH(ip);
+
+  for (HttpServerSession *b = bucket->l2_hash[l2_index].head; b != NULL; b = b->hash_link.next) {
+    if (ats_ip_addr_eq(&b->server_ip.sa, ip) &&
+        ats_ip_port_cast(ip) == ats_ip_port_cast(&b->server_ip) &&
+        hostname_hash == b->hostname_hash) {
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+int
+HttpSessionManager::count_idle_sessions(sockaddr const* ip, INK_MD5 &hostname_hash, int share_sessions)
+{
+  EThread *ethread = this_ethread();
+  int l1_index = FIRST_LEVEL_HASH(ip);
+  int count = 0;
+
+  if (2 == share_sessions) {
+    int n = n_session_threads;
+
+    for (int i = 0; i < n; ++i) {
+      SessionBucket *bucket = session_threads[i]->l1_hash + l1_index;
+
+      MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
+      if (!lock) {
+        return -1;
+      }
+      count += _count_idle_sessions(bucket, ip, hostname_hash);
+    }
+  } else {
+    SessionBucket *bucket = g_l1_hash + l1_index;
+
+    MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
+    if (!lock) {
+      return -1;
+    }
+    count = _count_idle_sessions(bucket, ip, hostname_hash);
+  }
+
+  return count;
+}
+
 HSMresult_t
 HttpSessionManager::release_session(HttpServerSession *to_release)
 {
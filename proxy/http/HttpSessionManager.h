@@ -76,6 +76,12 @@ public:
                               sockaddr const* addr,
                               const char *hostname, HttpClientSession *ua_session, HttpSM *sm);
   HSMresult_t release_session(HttpServerSession *to_release);
+
+  /** Count the idle sessions to @a addr for @a hostname_hash in the
+      pools selected by @a share_sessions.  @return -1 if a bucket
+      could not be locked, so the count is not known.
+  */
+  int count_idle_sessions(sockaddr const* addr, INK_MD5 &hostname_hash, int share_sessions);
   void purge_keepalives();
   void init();
   int main_handler(int event, void *data);
@@ -0,0 +1,432 @@
+/** @file
+
+  Origin connection pre-warming
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+#undef std  // FIXME: remove dependancy on the STL
+#include <vector>
+
+#include "P_Net.h"
+#include "I_Tasks.h"
+#include "HttpConfig.h"
+#include "HttpSessionManager.h"
+#include "HttpServerSession.h"
+#include "HttpSessionPrewarm.h"
+#include "ParentSelection.h"
+
+// How often host names are looked up again, in seconds
+#define PREWARM_RESOLVE_INTERVAL 300
+
+// One upstream to keep warm.  Connects in progress hold a reference,
+//   so a target that is dropped by a reconfiguration stays valid
+//   until they finish.
+struct PrewarmTarget: public RefCountObj
+{
+  char *host;
+  int port;
+  bool ssl;
+  bool parent;
+  int min_idle;                 // -1 to use the configured default
+  IpEndpoint addr;
+  INK_MD5 hostname_hash;
+  bool resolved;
+  volatile int pending;         // connects in progress
+
+  PrewarmTarget(const char *h, int h_len, int p, bool s)
+    : port(p), ssl(s), parent(false), min_idle(-1), resolved(false), pending(0)
+  {
+    host = ats_strndup(h, h_len);
+    ink_zero(addr);
+    ink_code_MMH((unsigned char *) host, strlen(host), (unsigned char *) &hostname_hash);
+  }
+
+  ~PrewarmTarget()
+  {
+    ats_free(host);
+  }
+
+  bool same(const PrewarmTarget *t) const
+  {
+    return port == t->port && ssl == t->ssl && strcasecmp(host, t->host) == 0;
+  }
+
+  void resolve()
+  {
+    IpEndpoint ip4, ip6;
+
+    ink_zero(ip4);
+    ink_zero(ip6);
+    if (ats_ip_getbestaddrinfo(host, &ip4, &ip6) == 0) {
+      ats_ip_copy(&addr, ats_is_ip(&ip4) ? &ip4 : &ip6);
+      ats_ip_port_cast(&addr) = htons(port);
+      resolved = true;
+    } else {
+      Warning("origin pre-warm: could not resolve '%s'", host);
+      resolved = false;
+    }
+  }
+};
+
+typedef std::vector<Ptr<PrewarmTarget> > PrewarmTargets;
+
+// Opens one connection on a net thread and hands it to the session
+//   manager as an idle session.  Running on the net thread means a
+//   per-thread pool receives the session in the thread that owns it.
+struct PrewarmConnect: public Continuation
+{
+  Ptr<PrewarmTarget> target;
+  int share_sessions;
+  bool limit_connections;
+  MgmtInt connect_timeout;
+  MgmtInt keep_alive_timeout;
+  ink_hrtime start;
+
+  PrewarmConnect(PrewarmTarget *t, HttpConfigParams *params)
+    : Continuation(new_ProxyMutex()), target(t), start(0)
+  {
+    share_sessions = params->oride.share_server_sessions;
+    limit_connections = (params->oride.origin_max_connections > 0 || params->origin_min_keep_alive_connections > 0);
+    connect_timeout = t->parent ? params->parent_connect_timeout : params->oride.connect_attempts_timeout;
+    keep_alive_timeout = params->oride.keep_alive_no_activity_timeout_out;
+    SET_HANDLER(&PrewarmConnect::state_start);
+  }
+
+  int state_start(int event, Event *e);
+  int state_open(int event, void *data);
+  void done()
+  {
+    ink_atomic_increment(&target->pending, -1);
+    mutex.clear();
+    delete this;
+  }
+};
+
+int
+PrewarmConnect::state_start(int event, Event *e)
+{
+  NOWARN_UNUSED(event);
+  NOWARN_UNUSED(e);
+  NetVCOptions opt;
+
+  opt.f_blocking_connect = false;
+  opt.ip_family = target->addr.sa.sa_family;
+  start = ink_get_hrtime();
+  SET_HANDLER(&PrewarmConnect::state_open);
+
+  // A plain connect is only reported once the handshake completes, so
+  //   the open time is real; an SSL session does its TLS handshake on
+  //   the pool's first read.
+  if (target->ssl) {
+    sslNetProcessor.connect_re(this, &target->addr.sa, &opt);
+  } else {
+    netProcessor.connect_s(this, &target->addr.sa, connect_timeout, &opt);
+  }
+  return EVENT_DONE;
+}
+
+int
+PrewarmConnect::state_open(int event, void *data)
+{
+  EThread *ethread = this_ethread();
+
+  if (event != NET_EVENT_OPEN) {
+    Debug("http_prewarm", "connect to %s:%d failed", target->host, target->port);
+    RecIncrRawStat(http_rsb, ethread, (int) http_origin_prewarm_open_failures_stat, 1);
+    done();
+    return EVENT_DONE;
+  }
+
+  NetVConnection *netvc = (NetVConnection *) data;
+  HttpServerSession *session = (2 == share_sessions) ?
+    THREAD_ALLOC_INIT(httpServerSessionAllocator, ethread) :
+    httpServerSessionAllocator.alloc();
+
+  session->share_session = share_sessions;
+  session->enable_origin_connection_limiting = limit_connections;
+  ats_ip_copy(&session->server_ip, &target->addr);
+  session->new_connection(netvc);
+  session->attach_hostname(target->host);
+  session->prewarmed = true;
+  if (target->parent) {
+    session->to_parent_proxy = true;
+    HTTP_INCREMENT_DYN_STAT(http_current_parent_proxy_connections_stat);
+    HTTP_INCREMENT_DYN_STAT(http_total_parent_proxy_connections_stat);
+  }
+  netvc->set_inactivity_timeout(HRTIME_SECONDS(keep_alive_timeout));
+
+  RecIncrRawStat(http_rsb, ethread, (int) http_origin_prewarm_opens_stat, 1);
+  RecIncrRawStat(http_rsb, ethread, (int) http_origin_prewarm_connect_time_stat,
+                 ink_hrtime_to_msec(ink_get_hrtime() - start));
+  Debug("http_prewarm", "[%" PRId64 "] opened idle session to %s:%d", session->con_id, target->host, target->port);
+
+  session->release();
+  done();
+  return EVENT_DONE;
+}
+
+// Periodic task that tops up the idle pools
+struct HttpSessionPrewarm: public Continuation
+{
+  PrewarmTargets targets;
+  char *origins;
+  bool parents;
+  ink_hrtime next_resolve;
+
+  HttpSessionPrewarm()
+    : Continuation(new_ProxyMutex()), origins(NULL), parents(false), next_resolve(0)
+  {
+    SET_HANDLER(&HttpSessionPrewarm::tick);
+  }
+
+  int tick(int event, Event *e);
+
+private:
+  void add_target(PrewarmTargets &list, PrewarmTarget *t);
+  void parse_origins(PrewarmTargets &list, const char *str);
+  void add_parents(PrewarmTargets &list);
+  void rebuild(HttpConfigParams *params);
+  void fill(PrewarmTarget *t, HttpConfigParams *params);
+};
+
+// Add @a t to @a list unless it is already there, picking up the
+//   pending count of a matching target from the previous list.
+void
+HttpSessionPrewarm::add_target(PrewarmTargets &list, PrewarmTarget *t)
+{
+  Ptr<PrewarmTarget> keep(t);
+
+  for (unsigned i = 0; i < list.size(); ++i) {
+    if (list[i]->same(t)) {
+      return;
+    }
+  }
+  for (unsigned i = 0; i < targets.size(); ++i) {
+    if (targets[i]->same(t)) {
+      targets[i]->min_idle = t->min_idle;
+      targets[i]->parent = t->parent;
+      list.push_back(targets[i]);
+      return;
+    }
+  }
+  list.push_back(keep);
+}
+
+void
+HttpSessionPrewarm::parse_origins(PrewarmTargets &list, const char *str)
+{
+  const char *s = str;
+
+  while (s && *s) {
+    while (*s == ',' || ParseRules::is_space(*s)) {
+      ++s;
+    }
+    if (!*s) {
+      break;
+    }
+
+    const char *end = s;
+    while (*end && *end != ',' && !ParseRules::is_space(*end)) {
+      ++end;
+    }
+
+    const char *host = s;
+    const char *host_end;
+    bool ssl = false;
+    int port = 0;
+    int min_idle = -1;
+
+    if (end - host > 8 && strncasecmp(host, "https://", 8) == 0) {
+      ssl = true;
+      host += 8;
+    } else if (end - host > 7 && strncasecmp(host, "http://", 7) == 0) {
+      host += 7;
+    }
+
+    const char *bar = (const char *) memchr(host, '|', end - host);
+    const char *hp_end = bar ? bar : end;
+
+    if (bar) {
+      min_idle = atoi(bar + 1);
+    }
+
+    if (*host == '[') {
+      // [ipv6]:port
+      const char *close = (const char *) memchr(host, ']', hp_end - host);
+      if (!close) {
+        Warning("origin pre-warm: bad address in '%.*s'", (int) (end - s), s);
+        s = end;
+        continue;
+      }
+      ++host;
+      host_end = close;
+      if (close + 1 < hp_end && close[1] == ':') {
+        port = atoi(close + 2);
+      }
+    } else {
+      const char *colon = (const char *) memchr(host, ':', hp_end - host);
+      host_end = colon ? colon : hp_end;
+      if (colon) {
+        port = atoi(colon + 1);
+      }
+    }
+
+    if (host_end == host || port < 0 || port > 65535) {
+      Warning("origin pre-warm: bad entry '%.*s'", (int) (end - s), s);
+    } else {
+      PrewarmTarget *t = NEW(new PrewarmTarget(host, host_end - host, port ? port : (ssl ? 443 : 80), ssl));
+
+      t->min_idle = min_idle;
+      add_target(list, t);
+    }
+    s = end;
+  }
+}
+
+void
+HttpSessionPrewarm::add_parents(PrewarmTargets &list)
+{
+  ParentConfigParams *pconfig = ParentConfig::acquire();
+  std::vector<ParentRecord *> records;
+
+  if (pconfig->DefaultParent) {
+    records.push_back(pconfig->DefaultParent);
+  }
+  if (pconfig->ParentTable) {
+    P_table *table = pconfig->ParentTable;
+
+    if (table->getHostMatcher()) {
+      for (int i = 0; i < table->getHostMatcher()->getNumElements(); ++i)
+        records.push_back(table->getHostMatcher()->getDataArray() + i);
+    }
+    if (table->getReMatcher()) {
+      for (int i = 0; i < table->getReMatcher()->getNumElements(); ++i)
+        records.push_back(table->getReMatcher()->getDataArray() + i);
+    }
+    if (table->getIPMatcher()) {
+      for (int i = 0; i < table->getIPMatcher()->getNumElements(); ++i)
+        records.push_back(table->getIPMatcher()->getDataArray() + i);
+    }
+    if (table->getHrMatcher()) {
+      for (int i = 0; i < table->getHrMatcher()->getNumElements(); ++i)
+        records.push_back(table->getHrMatcher()->getDataArray() + i);
+    }
+  }
+
+  for (unsigned i = 0; i < records.size(); ++i) {
+    for (int j = 0; j < records[i]->num_parents; ++j) {
+      pRecord *p = records[i]->parents + j;
+      PrewarmTarget *t = NEW(new PrewarmTarget(p->hostname, strlen(p->hostname), p->port, false));
+
+      t->parent = true;
+      add_target(list, t);
+    }
+  }
+
+  ParentConfig::release(pconfig);
+}
+
+void
+HttpSessionPrewarm::rebuild(HttpConfigParams *params)
+{
+  PrewarmTargets list;
+
+  parse_origins(list, params->server_prewarm_origins);
+  if (params->server_prewarm_parents) {
+    add_parents(list);
+  }
+
+  for (unsigned i = 0; i < list.size(); ++i) {
+    list[i]->resolve();
+  }
+
+  targets.swap(list);
+  ats_free(origins);
+  origins = ats_strdup(params->server_prewarm_origins);
+  parents = params->server_prewarm_parents;
+  next_resolve = ink_get_hrtime() + HRTIME_SECONDS(PREWARM_RESOLVE_INTERVAL);
+  Debug("http_prewarm", "keeping %d upstreams warm", (int) targets.size());
+}
+
+void
+HttpSessionPrewarm::fill(PrewarmTarget *t, HttpConfigParams *params)
+{
+  int want = (t->min_idle >= 0) ? t->min_idle : params->server_prewarm_min_idle;
+
+  if (!t->resolved || want <= 0) {
+    return;
+  }
+
+  int idle = httpSessionManager.count_idle_sessions(&t->addr.sa, t->hostname_hash,
+                                                    params->oride.share_server_sessions);
+
+  // Busy pool; try again on the next tick
+  if (idle < 0) {
+    return;
+  }
+
+  int deficit = want - idle - t->pending;
+
+  // Never push an origin over its connection limit
+  if (params->oride.origin_max_connections > 0) {
+    int room = params->oride.origin_max_connections - ConnectionCount::getInstance()->getCount(t->addr) - t->pending;
+    if (room < deficit) {
+      deficit = room;
+    }
+  }
+
+  for (int i = 0; i < deficit; ++i) {
+    ink_atomic_increment(&t->pending, 1);
+    eventProcessor.schedule_imm(NEW(new PrewarmConnect(t, params)), ET_NET);
+  }
+}
+
+int
+HttpSessionPrewarm::tick(int event, Event *e)
+{
+  NOWARN_UNUSED(event);
+  NOWARN_UNUSED(e);
+  HttpConfigParams *params = HttpConfig::acquire();
+  MgmtInt interval = params->server_prewarm_interval > 0 ? params->server_prewarm_interval : 1;
+  const char *cur = params->server_prewarm_origins ? params->server_prewarm_origins : "";
+  const char *prev = origins ? origins : "";
+
+  if (strcmp(cur, prev) != 0 || parents != (bool) params->server_prewarm_parents || ink_get_hrtime() > next_resolve) {
+    rebuild(params);
+  }
+
+  // Only sessions that can be shared can be pooled
+  if (params->oride.share_server_sessions) {
+    for (unsigned i = 0; i < targets.size(); ++i) {
+      fill(targets[i], params);
+    }
+  }
+
+  HttpConfig::release(params);
+  eventProcessor.schedule_in(this, HRTIME_SECONDS(interval), ET_TASK);
+  return EVENT_DONE;
+}
+
+void
+start_http_session_prewarm()
+{
+  eventProcessor.schedule_imm(NEW(new HttpSessionPrewarm), ET_TASK);
+}
@@ -0,0 +1,53 @@
+/** @file
+
+  Origin connection pre-warming
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+   HttpSessionPrewarm.h
+
+   Description:
+     Keeps a minimum number of idle keep-alive sessions open to a set
+     of upstreams, so the first requests after a quiet period do not
+     pay for connection setup.
+
+     The upstreams come from proxy.config.http.server_prewarm.origins,
+     a list of "[http://|https://]host[:port][|min_idle]" entries
+     separated by commas or white space, and, when
+     proxy.config.http.server_prewarm.parents is set, from every parent
+     in parent.config.  Entries without an explicit count use
+     proxy.config.http.server_prewarm.min_idle.
+
+     Every proxy.config.http.server_prewarm.interval seconds a task
+     thread counts the idle sessions to each upstream and opens the
+     shortfall.  New connections are handed to the session manager
+     exactly like a session released by a transaction, so they age
+     out with the usual keep-alive timeouts.
+
+ ****************************************************************************/
+
+#ifndef _HTTP_SESSION_PREWARM_H_
+#define _HTTP_SESSION_PREWARM_H_
+
+void start_http_session_prewarm();
+
+#endif
@@ -0,0 +1,205 @@
+/** @file
+
+  RFC 5861 stale content support
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+#undef std  // FIXME: remove dependancy on the STL
+#include <set>
+
+#include "P_EventSystem.h"
+#include "HdrUtils.h"
+#include "HttpConfig.h"
+#include "HttpUpdateSM.h"
+#include "HttpStaleRevalidate.h"
+
+// Cache keys with a revalidation in flight
+struct StaleRevalidateTable
+{
+  ink_mutex mutex;
+  std::set<uint64_t> keys;
+
+  StaleRevalidateTable() { ink_mutex_init(&mutex, "StaleRevalidateTable"); }
+
+  bool claim(uint64_t key)
+  {
+    bool inserted;
+
+    ink_mutex_acquire(&mutex);
+    inserted = keys.insert(key).second;
+    ink_mutex_release(&mutex);
+    return inserted;
+  }
+
+  void release(uint64_t key)
+  {
+    ink_mutex_acquire(&mutex);
+    keys.erase(key);
+    ink_mutex_release(&mutex);
+  }
+};
+
+static StaleRevalidateTable stale_revalidate_table;
+
+// Runs one HttpUpdateSM on its own thread and lock, away from the
+//   transaction that served the stale copy, and frees the key when
+//   the update SM calls back.
+struct StaleRevalidateCont: public Continuation
+{
+  uint64_t key;
+  HTTPHdr request;
+
+  StaleRevalidateCont(uint64_t k, HTTPHdr *req)
+    : Continuation(new_ProxyMutex()), key(k)
+  {
+    request.create(HTTP_TYPE_REQUEST);
+    request.copy(req);
+    SET_HANDLER(&StaleRevalidateCont::start_event);
+  }
+
+  int start_event(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+  {
+    HttpUpdateSM *sm = HttpUpdateSM::allocate();
+
+    sm->init();
+    sm->t_state.cache_info.background_revalidation = true;
+    SET_HANDLER(&StaleRevalidateCont::done_event);
+    // The update SM may finish, and call done_event, before returning
+    sm->start_scheduled_update(this, &request);
+    return EVENT_DONE;
+  }
+
+  int done_event(int event, void * /* data ATS_UNUSED */)
+  {
+    Debug("http_stale", "revalidation of %" PRIx64 " done, event %d", key, event);
+    stale_revalidate_table.release(key);
+    request.destroy();
+    mutex.clear();
+    delete this;
+    return EVENT_DONE;
+  }
+};
+
+int
+http_cache_control_extension_get(HTTPHdr *hdr, const char *name, int name_len)
+{
+  MIMEField *field = hdr->field_find(MIME_FIELD_CACHE_CONTROL, MIME_LEN_CACHE_CONTROL);
+  HdrCsvIter iter;
+  const char *val;
+  int val_len;
+
+  if (field == NULL) {
+    return -1;
+  }
+
+  for (val = iter.get_first(field, &val_len); val; val = iter.get_next(&val_len)) {
+    if (val_len <= name_len + 1 || val[name_len] != '=' || strncasecmp(val, name, name_len) != 0) {
+      continue;
+    }
+
+    const char *p = val + name_len + 1;
+    const char *end = val + val_len;
+    int64_t seconds = 0;
+
+    // A quoted value is allowed; HdrCsvIter already drops the closing quote
+    if (*p == '"') {
+      ++p;
+      if (p < end && end[-1] == '"') {
+        --end;
+      }
+    }
+    if (p == end) {
+      return -1;
+    }
+    for (; p < end; ++p) {
+      if (!ParseRules::is_digit(*p)) {
+        return -1;
+      }
+      seconds = min((int64_t) INT_MAX, seconds * 10 + (*p - '0'));
+    }
+    return (int) seconds;
+  }
+
+  return -1;
+}
+
+bool
+http_stale_revalidate_schedule(HTTPHdr *request, const INK_MD5 &key)
+{
+  uint64_t fold = key.fold();
+
+  if (!stale_revalidate_table.claim(fold)) {
+    Debug("http_stale", "revalidation of %" PRIx64 " already in flight", fold);
+    return false;
+  }
+
+  Debug("http_stale", "starting revalidation of %" PRIx64, fold);
+  RecIncrRawStat(http_rsb, this_ethread(), (int) http_cache_background_revalidations_stat, 1);
+  eventProcessor.schedule_imm(NEW(new StaleRevalidateCont(fold, request)), ET_NET);
+  return true;
+}
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+
+REGRESSION_TEST(HttpStaleRevalidate_Extension)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  static const struct
+  {
+    const char *cc;
+    int swr;
+    int sie;
+  } cases[] = {
+    { "max-age=1", -1, -1 },
+    { "max-age=1, stale-while-revalidate=30", 30, -1 },
+    { "Stale-While-Revalidate=\"15\", stale-if-error=600", 15, 600 },
+    { "stale-while-revalidate, stale-if-error=", -1, -1 },
+    { "stale-while-revalidate=1x, stale-if-error=99999999999", -1, INT_MAX },
+    { "stale-while-revalidated=5", -1, -1 },
+  };
+  TestBox tb(t, pstatus);
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  for (unsigned i = 0; i < countof(cases); ++i) {
+    HTTPHdr hdr;
+
+    hdr.create(HTTP_TYPE_RESPONSE);
+    hdr.value_set(MIME_FIELD_CACHE_CONTROL, MIME_LEN_CACHE_CONTROL, cases[i].cc, strlen(cases[i].cc));
+    tb.check(http_cache_control_extension_get(&hdr, "stale-while-revalidate", 22) == cases[i].swr,
+             "\"%s\" stale-while-revalidate", cases[i].cc);
+    tb.check(http_cache_control_extension_get(&hdr, "stale-if-error", 14) == cases[i].sie,
+             "\"%s\" stale-if-error", cases[i].cc);
+    hdr.destroy();
+  }
+
+  // A second Cache-Control field is searched too
+  HTTPHdr hdr;
+
+  hdr.create(HTTP_TYPE_RESPONSE);
+  hdr.value_set(MIME_FIELD_CACHE_CONTROL, MIME_LEN_CACHE_CONTROL, "public", 6);
+  MIMEField *dup = hdr.field_create(MIME_FIELD_CACHE_CONTROL, MIME_LEN_CACHE_CONTROL);
+  hdr.field_value_set(dup, "stale-if-error=60", 17);
+  hdr.field_attach(dup);
+  tb.check(http_cache_control_extension_get(&hdr, "stale-if-error", 14) == 60, "duplicate Cache-Control field");
+  hdr.destroy();
+}
+#endif /* TS_HAS_TESTS */
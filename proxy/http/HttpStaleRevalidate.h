@@ -0,0 +1,58 @@
+/** @file
+
+  RFC 5861 stale content support
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+   HttpStaleRevalidate.h
+
+   Description:
+     Background revalidation for stale-while-revalidate hits.
+
+     When HttpTransact serves a stale object inside its
+     stale-while-revalidate window, the transaction hands a copy of the
+     client request to http_stale_revalidate_schedule().  At most one
+     revalidation runs per cache key: further stale hits on the same
+     object while it is in flight only serve.  The revalidation is an
+     HttpUpdateSM whose transaction is marked as a background
+     revalidation, so it always goes to the origin and updates or
+     replaces the cached copy through the normal cache write lock.
+
+ ****************************************************************************/
+
+#ifndef _HTTP_STALE_REVALIDATE_H_
+#define _HTTP_STALE_REVALIDATE_H_
+
+#include "HTTP.h"
+
+/** Value of a "name=seconds" Cache-Control extension of @a hdr.
+    @return the number of seconds, -1 if absent or malformed.
+*/
+int http_cache_control_extension_get(HTTPHdr *hdr, const char *name, int name_len);
+
+/** Start a background revalidation of the object cached under @a key
+    unless one is already in flight.  @a request is copied.
+    @return true if a revalidation was started.
+*/
+bool http_stale_revalidate_schedule(HTTPHdr *request, const INK_MD5 &key);
+
+#endif
@@ -47,6 +47,7 @@
 #include "HttpClientSession.h"
 #include "I_Machine.h"
 #include "IPAllow.h"
+#include "HttpStaleRevalidate.h"
 
 static const char *URL_MSG = "Unable to process requested URL.\n";
 static char range_type[] = "multipart/byteranges; boundary=RANGE_SEPARATOR";
@@ -288,7 +289,11 @@ find_server_and_update_current_info(HttpTransact::State* s)
   int host_len;
   const char *host = s->hdr_info.client_request.host_get(&host_len);
 
-  if (ptr_len_cmp(host, host_len, local_host_ip_str, sizeof(local_host_ip_str) - 1) == 0) {
+  if (s->parent_result.r == PARENT_UNDEFINED && !s->parent_params->ParentEnable) {
+    // Parent selection is off, so findParent() would answer PARENT_DIRECT
+    //   whatever the checks below decided.
+    s->parent_result.r = PARENT_DIRECT;
+  } else if (ptr_len_cmp(host, host_len, local_host_ip_str, sizeof(local_host_ip_str) - 1) == 0) {
     // Do not forward requests to local_host onto a parent.
     // I just wanted to do this for cop heartbeats, someone else
     // wanted it for all requests to local_host.
@@ -2323,6 +2328,10 @@ HttpTransact::HandleCacheOpenReadHitFreshness(State* s)
   if (!s->force_dns) {          // If DNS is not performed before
     if (need_to_revalidate(s)) {
       TRANSACT_RETURN(HTTP_API_CACHE_LOOKUP_COMPLETE, CallOSDNSLookup); // content needs to be revalidated and we did not perform a dns ....calling DNS lookup
+    } else if (s->cache_lookup_result == CACHE_LOOKUP_HIT_FRESH && !s->state_machine->hooks_set &&
+               s->api_update_cached_object == UPDATE_CACHED_OBJECT_NONE) {
+      // no plugin can revisit the decision need_to_revalidate() just made
+      TRANSACT_RETURN(HTTP_API_CACHE_LOOKUP_COMPLETE, HttpTransact::HandleFreshCacheHit);
     } else {                    // document can be served can cache
       TRANSACT_RETURN(HTTP_API_CACHE_LOOKUP_COMPLETE, HttpTransact::HandleCacheOpenReadHit);
     }
@@ -2399,7 +2408,8 @@ HttpTransact::need_to_revalidate(State* s)
              s->cache_lookup_result == CACHE_LOOKUP_HIT_WARNING || s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE);
   if (s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE &&
       s->api_update_cached_object != HttpTransact::UPDATE_CACHED_OBJECT_CONTINUE) {
-    needs_revalidate = true;
+    // a stale-while-revalidate hit is served without going to the origin first
+    needs_revalidate = !is_stale_while_revalidate_allowed(s);
   } else
     needs_revalidate = false;
 
@@ -2452,6 +2462,7 @@ HttpTransact::HandleCacheOpenReadHit(State* s)
   bool needs_revalidate, needs_authenticate = false;
   bool needs_cache_auth = false;
   bool server_up = true;
+  bool serve_stale = false;
   CacheHTTPInfo *obj;
 
   if (s->api_update_cached_object == HttpTransact::UPDATE_CACHED_OBJECT_CONTINUE) {
@@ -2494,8 +2505,15 @@ HttpTransact::HandleCacheOpenReadHit(State* s)
              s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE);
   if (s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE &&
       s->api_update_cached_object != HttpTransact::UPDATE_CACHED_OBJECT_CONTINUE) {
-    needs_revalidate = true;
-    SET_VIA_STRING(VIA_DETAIL_CACHE_LOOKUP, VIA_DETAIL_MISS_EXPIRED);
+    if (is_stale_while_revalidate_allowed(s)) {
+      // RFC 5861: still inside the stale-while-revalidate window, so
+      // serve the stale copy now and refresh it in the background
+      serve_stale = true;
+      needs_revalidate = false;
+    } else {
+      needs_revalidate = true;
+      SET_VIA_STRING(VIA_DETAIL_CACHE_LOOKUP, VIA_DETAIL_MISS_EXPIRED);
+    }
   } else
     needs_revalidate = false;
 
@@ -2531,6 +2549,9 @@ HttpTransact::HandleCacheOpenReadHit(State* s)
   DebugTxn("http_trans", "CacheOpenRead --- response_returnable = %d", response_returnable);
   DebugTxn("http_trans", "CacheOpenRead --- needs_cache_auth    = %d", needs_cache_auth);
   DebugTxn("http_trans", "CacheOpenRead --- send_revalidate    = %d", send_revalidate);
+  // authentication may still force the trip to the origin
+  s->cache_info.stale_while_revalidate = serve_stale && !send_revalidate;
+
   if (send_revalidate) {
     DebugTxn("http_trans", "CacheOpenRead --- HIT-STALE");
     s->dns_info.attempts = 0;
@@ -2646,7 +2667,9 @@ HttpTransact::HandleCacheOpenReadHit(State* s)
   DebugTxn("http_trans", "CacheOpenRead --- HIT-FRESH");
   DebugTxn("http_seq", "[HttpTransact::HandleCacheOpenReadHit] " "Serve from cache");
 
-  if (s->cache_info.is_ram_cache_hit) {
+  if (s->cache_info.stale_while_revalidate) {
+    SET_VIA_STRING(VIA_CACHE_RESULT, VIA_IN_CACHE_STALE);
+  } else if (s->cache_info.is_ram_cache_hit) {
     SET_VIA_STRING(VIA_CACHE_RESULT, VIA_IN_RAM_CACHE_FRESH);
   } else {
     SET_VIA_STRING(VIA_CACHE_RESULT, VIA_IN_CACHE_FRESH);
@@ -2654,6 +2677,13 @@ HttpTransact::HandleCacheOpenReadHit(State* s)
 
   if (s->cache_lookup_result == CACHE_LOOKUP_HIT_WARNING) {
     build_response_from_cache(s, HTTP_WARNING_CODE_HERUISTIC_EXPIRATION);
+  } else if (s->cache_info.stale_while_revalidate) {
+    DebugTxn("http_trans", "CacheOpenRead --- serving stale while revalidating");
+    HTTP_INCREMENT_TRANS_STAT(http_cache_stale_while_revalidate_stat);
+    // Kick off the refresh before building the response, which may
+    // still divert a Range request to the origin
+    s->state_machine->do_background_revalidation();
+    build_response_from_cache(s, HTTP_WARNING_CODE_RESPONSE_STALE);
   } else if (s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE) {
     ink_assert(server_up == false);
     build_response_from_cache(s, HTTP_WARNING_CODE_REVALIDATION_FAILED);
@@ -2669,6 +2699,43 @@ HttpTransact::HandleCacheOpenReadHit(State* s)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Name       : HandleFreshCacheHit
+// Description: serve a fresh cache hit without going over it again
+//
+// Details    :
+//
+// HandleCacheOpenReadHitFreshness sends a fresh hit here when need_to_revalidate()
+// has already found it returnable without authentication and the
+// transaction has no plugin hooks that could change that.
+// HandleCacheOpenReadHit would repeat those checks and then skip its
+// revalidation branch (ICP, parent proxy, negative cached origin), so
+// go straight to building the response.
+//
+//
+// Possible Next States From Here:
+// - HttpTransact::SERVE_FROM_CACHE;
+// - HttpTransact::PROXY_INTERNAL_CACHE_NOOP;
+// - HttpTransact::DNS_LOOKUP;
+//
+///////////////////////////////////////////////////////////////////////////////
+void
+HttpTransact::HandleFreshCacheHit(State* s)
+{
+  ink_assert(s->cache_lookup_result == CACHE_LOOKUP_HIT_FRESH);
+
+  DebugTxn("http_trans", "CacheOpenRead --- HIT-FRESH");
+  DebugTxn("http_seq", "[HttpTransact::HandleFreshCacheHit] " "Serve from cache");
+
+  if (s->cache_info.is_ram_cache_hit) {
+    SET_VIA_STRING(VIA_CACHE_RESULT, VIA_IN_RAM_CACHE_FRESH);
+  } else {
+    SET_VIA_STRING(VIA_CACHE_RESULT, VIA_IN_CACHE_FRESH);
+  }
+  build_response_from_cache(s, HTTP_WARNING_CODE_NONE);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Name       : build_response_from_cache()
 // Description: build a client response from cached response and client request
@@ -2936,20 +3003,12 @@ HttpTransact::HandleCacheOpenReadMiss(State* s)
   }
 
   // We should not issue an ICP lookup if the request has a
-  // no-cache header. First check if the request has a no
-  // cache header. Then, if icp is enabled and the request
-  // does not have a no-cache header, issue an icp lookup.
-
-  // does the request have a no-cache?
-  bool no_cache_in_request = false;
-
-  if (s->hdr_info.client_request.is_pragma_no_cache_set() ||
-      s->hdr_info.client_request.is_cache_control_set(HTTP_VALUE_NO_CACHE)) {
-    no_cache_in_request = true;
-  }
-  // if ICP is enabled and above test indicates that request
-  // does not have a no-cache, issue icp query to sibling cache.
-  if (s->http_config_param->icp_enabled && icp_dynamic_enabled != 0 && (no_cache_in_request == false)) {
+  // no-cache header. If icp is enabled and the request
+  // does not have a no-cache header, issue icp query to
+  // sibling cache; without ICP the headers are not looked at.
+  if (s->http_config_param->icp_enabled && icp_dynamic_enabled != 0 &&
+      !s->hdr_info.client_request.is_pragma_no_cache_set() &&
+      !s->hdr_info.client_request.is_cache_control_set(HTTP_VALUE_NO_CACHE)) {
     DebugTxn("http_trans", "[HandleCacheOpenReadMiss] " "ICP is configured and no no-cache in request; checking ICP");
     s->next_action = ICP_QUERY;
     return;
@@ -3098,6 +3157,8 @@ HttpTransact::OriginServerRawOpen(State* s)
   case CONGEST_CONTROL_CONGESTED_ON_F:
     /* fall through */
   case CONGEST_CONTROL_CONGESTED_ON_M:
+    /* fall through */
+  case OUTBOUND_CONGESTION:
     handle_server_died(s);
 
     ink_assert(s->cache_info.action == CACHE_DO_NO_ACTION);
@@ -3390,7 +3451,9 @@ HttpTransact::handle_response_from_parent(State* s)
 
       // If the request is not retryable, just give up!
       if (!is_request_retryable(s)) {
-        s->parent_params->markParentDown(&s->parent_result);
+        if (s->current.state != OUTBOUND_CONGESTION) {
+          s->parent_params->markParentDown(&s->parent_result);
+        }
         s->parent_result.r = PARENT_FAIL;
         handle_parent_died(s);
         return;
@@ -3423,7 +3486,9 @@ HttpTransact::handle_response_from_parent(State* s)
         // Done trying parents... fail over to origin server if that is
         //   appropriate
         DebugTxn("http_trans", "[handle_response_from_parent] Error. No more retries.");
-        s->parent_params->markParentDown(&s->parent_result);
+        if (s->current.state != OUTBOUND_CONGESTION) {
+          s->parent_params->markParentDown(&s->parent_result);
+        }
         s->parent_result.r = PARENT_FAIL;
         next_lookup = find_server_and_update_current_info(s);
       }
@@ -3502,6 +3567,13 @@ HttpTransact::handle_response_from_server(State* s)
     s->current.server->connect_failure = 1;
     handle_server_connection_not_open(s);
     break;
+  case OUTBOUND_CONGESTION:
+    // Our own limit on connections to the origin, not a failure of
+    //   the origin, so it is neither retried nor marked down
+    DebugTxn("http_trans", "[handle_response_from_server] Error. origin connection queue is full.");
+    SET_VIA_STRING(VIA_DETAIL_SERVER_CONNECT, VIA_DETAIL_SERVER_FAILURE);
+    handle_server_connection_not_open(s);
+    break;
   case OPEN_RAW_ERROR:
     /* fall through */
   case CONNECTION_ERROR:
@@ -3671,17 +3743,23 @@ HttpTransact::handle_server_connection_not_open(State* s)
   DebugTxn("http_trans", "[handle_server_connection_not_open] (hscno)");
   DebugTxn("http_seq", "[HttpTransact::handle_server_connection_not_open] ");
   ink_assert(s->current.state != CONNECTION_ALIVE);
-  ink_assert(s->current.server->connect_failure != 0);
+  ink_assert(s->current.server->connect_failure != 0 || s->current.state == OUTBOUND_CONGESTION);
 
   SET_VIA_STRING(VIA_SERVER_RESULT, VIA_SERVER_ERROR);
   HTTP_INCREMENT_TRANS_STAT(http_broken_server_connections_stat);
 
   // Fire off a hostdb update to mark the server as down
-  s->state_machine->do_hostdb_update_if_necessary();
+  if (s->current.state != OUTBOUND_CONGESTION) {
+    s->state_machine->do_hostdb_update_if_necessary();
+  }
 
   switch (s->cache_info.action) {
   case CACHE_DO_UPDATE:
     serve_from_cache = is_stale_cache_response_returnable(s);
+    if (!serve_from_cache && is_stale_if_error_allowed(s)) {
+      HTTP_INCREMENT_TRANS_STAT(http_cache_stale_if_error_stat);
+      serve_from_cache = true;
+    }
     break;
 
   case CACHE_PREPARE_TO_DELETE:
@@ -4163,6 +4241,19 @@ HttpTransact::handle_cache_operation_on_forward_server_response(State* s)
       return;
     }
 
+    // RFC 5861 stale-if-error: hand out the cached copy as it is, leaving
+    // it stale so the next request tries the origin again
+    if ((server_response_code == HTTP_STATUS_INTERNAL_SERVER_ERROR ||
+         server_response_code == HTTP_STATUS_GATEWAY_TIMEOUT ||
+         server_response_code == HTTP_STATUS_BAD_GATEWAY ||
+         server_response_code == HTTP_STATUS_SERVICE_UNAVAILABLE) &&
+        s->cache_info.action == CACHE_DO_UPDATE && is_stale_if_error_allowed(s)) {
+      DebugTxn("http_trans", "[hcoofsr] stale-if-error: serving stale object after a %d", server_response_code);
+      HTTP_INCREMENT_TRANS_STAT(http_cache_stale_if_error_stat);
+      build_response_from_cache(s, HTTP_WARNING_CODE_REVALIDATION_FAILED);
+      return;
+    }
+
     s->next_action = SERVER_READ;
     client_response_code = server_response_code;
     base_response = &s->hdr_info.server_response;
@@ -5784,6 +5875,70 @@ HttpTransact::is_stale_cache_response_returnable(State* s)
   return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Name       : is_stale_within_window
+// Description: may the stale cached copy be served under the RFC 5861
+//              extension @name?
+//
+// Details    :
+//
+// Only documents that went stale by age alone qualify (stale_age is set
+// by what_is_document_freshness), and only while the staleness is inside
+// the window the origin granted.  The headers that forbid serving stale
+// on a connection failure forbid it here as well.
+//
+///////////////////////////////////////////////////////////////////////////////
+static bool
+is_stale_within_window(HttpTransact::State *s, const char *name, int name_len)
+{
+  HTTPHdr *cached_response = s->cache_info.object_read->response_get();
+  uint32_t cc_mask;
+  int window;
+
+  if (s->cache_info.stale_age < 0 || !s->cache_info.directives.does_client_permit_lookup) {
+    return false;
+  }
+
+  cc_mask = (MIME_COOKED_MASK_CC_MUST_REVALIDATE |
+             MIME_COOKED_MASK_CC_PROXY_REVALIDATE |
+             MIME_COOKED_MASK_CC_NEED_REVALIDATE_ONCE |
+             MIME_COOKED_MASK_CC_NO_CACHE | MIME_COOKED_MASK_CC_NO_STORE | MIME_COOKED_MASK_CC_S_MAXAGE);
+  if ((cached_response->get_cooked_cc_mask() & cc_mask) || cached_response->is_pragma_no_cache_set()) {
+    return false;
+  }
+
+  window = http_cache_control_extension_get(cached_response, name, name_len);
+  DebugTxn("http_trans", "[is_stale_within_window] %.*s=%d, stale for %d", name_len, name, window, s->cache_info.stale_age);
+  if (window < s->cache_info.stale_age) {
+    return false;
+  }
+
+  return HttpTransact::AuthenticationNeeded(s->txn_conf, &s->hdr_info.client_request, cached_response) ==
+    HttpTransact::AUTHENTICATION_SUCCESS;
+}
+
+bool
+HttpTransact::is_stale_while_revalidate_allowed(State* s)
+{
+  // The background revalidation itself must go to the origin
+  if (!s->http_config_param->cache_stale_while_revalidate || s->cache_info.background_revalidation) {
+    return false;
+  }
+  if (s->method != HTTP_WKSIDX_GET && s->method != HTTP_WKSIDX_HEAD) {
+    return false;
+  }
+  return is_stale_within_window(s, "stale-while-revalidate", 22);
+}
+
+bool
+HttpTransact::is_stale_if_error_allowed(State* s)
+{
+  if (!s->http_config_param->cache_stale_if_error || s->cache_info.object_read == NULL) {
+    return false;
+  }
+  return is_stale_within_window(s, "stale-if-error", 14);
+}
+
 
 bool
 HttpTransact::url_looks_dynamic(URL* url)
@@ -6349,7 +6504,8 @@ HttpTransact::is_response_valid(State* s, HTTPHdr* incoming_response)
                       (s->current.state == INACTIVE_TIMEOUT) ||
                       (s->current.state == ACTIVE_TIMEOUT) ||
                       (s->current.state == CONGEST_CONTROL_CONGESTED_ON_M) ||
-                      (s->current.state == CONGEST_CONTROL_CONGESTED_ON_F));
+                      (s->current.state == CONGEST_CONTROL_CONGESTED_ON_F) ||
+                      (s->current.state == OUTBOUND_CONGESTION));
 
     s->hdr_info.response_error = CONNECTION_OPEN_FAILED;
     return false;
@@ -7175,6 +7331,8 @@ HttpTransact::what_is_document_freshness(State *s, HTTPHdr* client_request, HTTP
   uint32_t cc_mask, cooked_cc_mask;
   uint32_t os_specifies_revalidate;
 
+  s->cache_info.stale_age = -1;
+
   //////////////////////////////////////////////////////
   // If config file has a ttl-in-cache field set,     //
   // it has priority over any other http headers and  //
@@ -7338,6 +7496,11 @@ HttpTransact::what_is_document_freshness(State *s, HTTPHdr* client_request, HTTP
   ///////////////////////////////////////////
 
   if (do_revalidate || current_age > age_limit) { // client-modified limit
+    // Only a document that outlived its own lifetime may use the RFC 5861
+    // stale windows; one the client or config wants revalidated may not
+    if (!do_revalidate && age_limit == fresh_limit && s->cache_control.revalidate_after < 0) {
+      s->cache_info.stale_age = current_age - fresh_limit;
+    }
     DebugTxn("http_match", "[..._document_freshness] document needs revalidate/too old; "
             "returning FRESHNESS_STALE");
     return (FRESHNESS_STALE);
@@ -7499,6 +7662,12 @@ HttpTransact::handle_server_died(State* s)
       body_type = "congestion#retryAfter";
     s->hdr_info.response_error = TOTAL_RESPONSE_ERROR_TYPES;
     break;
+  case OUTBOUND_CONGESTION:
+    status = HTTP_STATUS_SERVICE_UNAVAILABLE;
+    reason = "Too Many Connections To Origin";
+    body_type = "congestion#retryAfter";
+    s->hdr_info.response_error = TOTAL_RESPONSE_ERROR_TYPES;
+    break;
   case STATE_UNDEFINED:
   case TRANSACTION_COMPLETE:
   default:                     /* unknown death */
@@ -8009,6 +8178,7 @@ HttpTransact::build_error_response(State *s, HTTPStatus status_code, const char
 
   s->internal_msg_buffer = body_factory->fabricate_with_old_api(error_body_type, s, 8192,
                                                                 &s->internal_msg_buffer_size,
+                                                                &s->internal_msg_buffer_fast_allocator_size,
                                                                 body_language, sizeof(body_language), 
                                                                 body_type, sizeof(body_type), 
                                                                 format, ap);
@@ -8100,6 +8270,7 @@ HttpTransact::build_redirect_response(State* s)
   s->internal_msg_buffer_fast_allocator_size = -1;
   s->internal_msg_buffer = body_factory->fabricate_with_old_api_build_va("redirect#moved_temporarily", s, 8192,
                                                                          &s->internal_msg_buffer_size,
+                                                                         &s->internal_msg_buffer_fast_allocator_size,
                                                                          body_language, sizeof(body_language),
                                                                          body_type, sizeof(body_type), 
                                                                          "%s <a href=\"%s\">%s</a>.  %s.",
@@ -8755,3 +8926,231 @@ HttpTransact::change_response_header_because_of_range_request(State *s, HTTPHdr
     header->set_content_length(s->range_output_cl);
   }
 }
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+
+#define TRANSACT_REPLAY_BATCHES 10
+#define TRANSACT_REPLAY_BATCH_SIZE 2000
+#define TRANSACT_REPLAY_MAX_STEPS 32
+
+// A transaction as HttpSM hands it to Transact: the parsed client
+//   request, what the cache lookup found and what the origin sent.
+//   The replay stands in for HttpSM, answering each I/O action from
+//   the record instead of the network, cache or HostDB.
+struct TransactReplayRecord
+{
+  const char *name;
+  const char *request;
+  const char *cached;           // NULL for a cache miss
+  int cached_age;
+  const char *response;         // NULL if the origin is never asked
+  HttpTransact::StateMachineAction_t last_action;
+};
+
+static const TransactReplayRecord transact_replay_records[] = {
+  { "fresh_hit",
+    "GET http://replay.test/site.css HTTP/1.1\r\nHost: replay.test\r\nUser-Agent: replay\r\nAccept: */*\r\n\r\n",
+    "HTTP/1.1 200 OK\r\nCache-Control: max-age=3600\r\nContent-Type: text/css\r\nContent-Length: 2048\r\n\r\n", 10,
+    NULL, HttpTransact::SERVE_FROM_CACHE },
+  { "fresh_hit_ims",
+    "GET http://replay.test/font.woff HTTP/1.1\r\nHost: replay.test\r\nUser-Agent: replay\r\n"
+    "If-Modified-Since: Tue, 01 Jan 2013 00:00:00 GMT\r\n\r\n",
+    "HTTP/1.1 200 OK\r\nCache-Control: max-age=3600\r\nLast-Modified: Tue, 01 Jan 2013 00:00:00 GMT\r\n"
+    "Content-Type: font/woff\r\nContent-Length: 16384\r\n\r\n", 10,
+    NULL, HttpTransact::PROXY_INTERNAL_CACHE_NOOP },
+  { "simple_miss",
+    "GET http://replay.test/app.js HTTP/1.1\r\nHost: replay.test\r\nUser-Agent: replay\r\nAccept: */*\r\n\r\n",
+    NULL, 0,
+    "HTTP/1.1 200 OK\r\nCache-Control: max-age=600\r\nContent-Type: text/javascript\r\nContent-Length: 8192\r\n\r\n",
+    HttpTransact::SERVER_READ },
+  { "stale_revalidate",
+    "GET http://replay.test/logo.png HTTP/1.1\r\nHost: replay.test\r\nUser-Agent: replay\r\nAccept: */*\r\n\r\n",
+    "HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\nLast-Modified: Tue, 01 Jan 2013 00:00:00 GMT\r\n"
+    "Content-Type: image/png\r\nContent-Length: 4096\r\n\r\n", 120,
+    "HTTP/1.1 304 Not Modified\r\nCache-Control: max-age=60\r\n\r\n",
+    HttpTransact::SERVE_FROM_CACHE },
+};
+
+struct TransactReplayProfile
+{
+  HttpTransact::StateMachineAction_t entered_on[TRANSACT_REPLAY_MAX_STEPS];
+  ink_hrtime elapsed[TRANSACT_REPLAY_MAX_STEPS];
+  int steps;
+};
+
+static void
+transact_replay_parse(HTTPHdr *hdr, HTTPType type, const char *text)
+{
+  HTTPParser parser;
+  const char *start = text;
+
+  hdr->create(type);
+  http_parser_init(&parser);
+  if (type == HTTP_TYPE_REQUEST)
+    hdr->parse_req(&parser, &start, text + strlen(text), true);
+  else
+    hdr->parse_resp(&parser, &start, text + strlen(text), true);
+  http_parser_clear(&parser);
+}
+
+// Run one record through Transact, timing each entry into it.
+//   Returns the action Transact finally left HttpSM with.
+static HttpTransact::StateMachineAction_t
+transact_replay_run(HTTPHdr *request, CacheHTTPInfo *cached, HTTPHdr *response, TransactReplayProfile *profile)
+{
+  HttpSM *sm = HttpSM::allocate();
+  HttpTransact::State *s = &sm->t_state;
+  TransactEntryFunc_t entry = HttpTransact::ModifyRequest;
+  HttpTransact::StateMachineAction_t action = HttpTransact::STATE_MACHINE_ACTION_UNDEFINED;
+  int step;
+
+  sm->init();
+  s->hdr_info.client_request.create(HTTP_TYPE_REQUEST);
+  s->hdr_info.client_request.copy(request);
+
+  for (step = 0; entry != NULL && step < TRANSACT_REPLAY_MAX_STEPS; ++step) {
+    ink_hrtime start = ink_get_hrtime_internal();
+
+    s->transact_return_point = NULL;
+    entry(s);
+    profile->elapsed[step] += ink_get_hrtime_internal() - start;
+    profile->entered_on[step] = action;
+    action = s->next_action;
+    entry = s->transact_return_point;
+
+    // Stand in for HttpSM on whatever Transact asked for
+    switch (action) {
+    case HttpTransact::HTTP_REMAP_REQUEST:
+      s->url_remap_success = true;
+      break;
+    case HttpTransact::CACHE_LOOKUP:
+      if (cached) {
+        s->source = HttpTransact::SOURCE_CACHE;
+        s->cache_info.object_read = cached;
+        entry = HttpTransact::HandleCacheOpenRead;
+      } else {
+        s->cache_lookup_result = HttpTransact::CACHE_LOOKUP_MISS;
+        entry = HttpTransact::HandleCacheOpenRead;
+      }
+      break;
+    case HttpTransact::DNS_LOOKUP:
+      s->dns_info.lookup_success = true;
+      s->dns_info.round_robin = false;
+      ats_ip_pton("192.0.2.10", s->host_db_info.ip());
+      s->host_db_info.app.http_data.http_version = HostDBApplicationInfo::HTTP_VERSION_11;
+      s->host_db_info.app.http_data.pipeline_max = 1;
+      break;
+    case HttpTransact::CACHE_ISSUE_WRITE:
+      s->cache_info.write_lock_state = HttpTransact::CACHE_WL_SUCCESS;
+      break;
+    case HttpTransact::ORIGIN_SERVER_OPEN:
+      if (response == NULL) {
+        entry = NULL;
+        break;
+      }
+      s->request_sent_time = s->response_received_time = ink_cluster_time();
+      s->current.state = HttpTransact::CONNECTION_ALIVE;
+      s->hdr_info.server_response.create(HTTP_TYPE_RESPONSE);
+      s->hdr_info.server_response.copy(response);
+      entry = HttpTransact::HandleResponse;
+      break;
+    default:
+      // HTTP_API_* callouts fall through to the return point as they
+      //   do when no plugin hooks the transaction
+      if (action < HttpTransact::HTTP_API_SM_START || action > HttpTransact::HTTP_API_SM_SHUTDOWN)
+        entry = NULL;
+      break;
+    }
+  }
+  profile->steps = step;
+
+  // The replay never opened the cached object, so HttpSM must not close it
+  s->cache_info.object_read = NULL;
+  sm->destroy();
+  return action;
+}
+
+// Each record is replayed in batches; the fastest batch stands for
+//   each step so a stall elsewhere on the box does not land on it.
+REGRESSION_TEST(HttpTransact_Replay)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  for (unsigned i = 0; i < countof(transact_replay_records); ++i) {
+    const TransactReplayRecord *rec = &transact_replay_records[i];
+    TransactReplayProfile profile;
+    HTTPHdr request, cached_request, cached_response, response;
+    CacheHTTPInfo cached;
+    CacheHTTPInfo *cached_p = NULL;
+    HTTPHdr *response_p = NULL;
+    time_t received = ink_cluster_time() - rec->cached_age;
+    ink_hrtime best[TRANSACT_REPLAY_MAX_STEPS];
+    ink_hrtime best_batch = 0;
+
+    transact_replay_parse(&request, HTTP_TYPE_REQUEST, rec->request);
+    if (rec->cached) {
+      transact_replay_parse(&cached_request, HTTP_TYPE_REQUEST, rec->request);
+      transact_replay_parse(&cached_response, HTTP_TYPE_RESPONSE, rec->cached);
+      cached_response.value_set_date(MIME_FIELD_DATE, MIME_LEN_DATE, received);
+      cached.create();
+      cached.request_set(&cached_request);
+      cached.response_set(&cached_response);
+      cached.request_sent_time_set(received);
+      cached.response_received_time_set(received);
+      cached.object_size_set(cached_response.get_content_length());
+      cached_p = &cached;
+    }
+    if (rec->response) {
+      transact_replay_parse(&response, HTTP_TYPE_RESPONSE, rec->response);
+      response_p = &response;
+    }
+
+    memset(&profile, 0, sizeof(profile));
+    HttpTransact::StateMachineAction_t last = transact_replay_run(&request, cached_p, response_p, &profile);
+    tb.check(last == rec->last_action, "%s ended on %s, expected %s", rec->name,
+             HttpDebugNames::get_action_name(last), HttpDebugNames::get_action_name(rec->last_action));
+
+    for (int batch = 0; batch < TRANSACT_REPLAY_BATCHES; ++batch) {
+      ink_hrtime start = ink_get_hrtime_internal();
+
+      memset(profile.elapsed, 0, sizeof(profile.elapsed));
+      for (int n = 0; n < TRANSACT_REPLAY_BATCH_SIZE; ++n)
+        transact_replay_run(&request, cached_p, response_p, &profile);
+
+      ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+      if (batch == 0 || elapsed < best_batch)
+        best_batch = elapsed;
+      for (int step = 0; step < profile.steps; ++step) {
+        if (batch == 0 || profile.elapsed[step] < best[step])
+          best[step] = profile.elapsed[step];
+      }
+    }
+
+    ink_hrtime total = 0;
+    for (int step = 0; step < profile.steps; ++step) {
+      rprintf(t, "%s step %d after %s: %d ns\n", rec->name, step,
+              step ? HttpDebugNames::get_action_name(profile.entered_on[step]) : "client request",
+              (int) (best[step] / TRANSACT_REPLAY_BATCH_SIZE));
+      total += best[step];
+    }
+
+    char tag[64];
+    snprintf(tag, sizeof(tag), "%s_transact_ns", rec->name);
+    rperf(t, tag, (double) total / TRANSACT_REPLAY_BATCH_SIZE);
+    snprintf(tag, sizeof(tag), "%s_per_sec", rec->name);
+    rperf(t, tag, (double) TRANSACT_REPLAY_BATCH_SIZE * HRTIME_SECOND / (double) (best_batch > 0 ? best_batch : 1));
+
+    if (response_p)
+      response.destroy();
+    if (cached_p) {
+      cached.destroy();
+      cached_response.destroy();
+      cached_request.destroy();
+    }
+    request.destroy();
+  }
+}
+#endif /* TS_HAS_TESTS */
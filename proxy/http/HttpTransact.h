@@ -101,6 +101,7 @@ typedef time_t ink_time_t;
 struct HttpConfigParams;
 struct MimeTableEntry;
 class HttpSM;
+class UrlRewrite;
 
 #include "InkErrno.h"
 #define UNKNOWN_INTERNAL_ERROR           (INK_START_ERRNO - 1)
@@ -409,7 +410,8 @@ public:
     PARSE_ERROR,
     TRANSACTION_COMPLETE,
     CONGEST_CONTROL_CONGESTED_ON_F,
-    CONGEST_CONTROL_CONGESTED_ON_M
+    CONGEST_CONTROL_CONGESTED_ON_M,
+    OUTBOUND_CONGESTION
   };
 
   enum CacheWriteStatus_t
@@ -644,6 +646,9 @@ public:
     CacheWriteLock_t write_lock_state;
     int lookup_count;
     bool is_ram_cache_hit;
+    int stale_age;              // seconds past the freshness lifetime, -1 unless stale by age alone
+    bool stale_while_revalidate;        // served stale, revalidating in the background
+    bool background_revalidation;       // this transaction is that revalidation
 
     _CacheLookupInfo()
       : action(CACHE_DO_UNDEFINED),
@@ -661,7 +666,8 @@ public:
         config(),
         directives(),
         open_read_retries(0),
-        open_write_retries(0), write_lock_state(CACHE_WL_INIT), lookup_count(0), is_ram_cache_hit(false)
+        open_write_retries(0), write_lock_state(CACHE_WL_INIT), lookup_count(0), is_ram_cache_hit(false),
+        stale_age(-1), stale_while_revalidate(false), background_revalidation(false)
     { }
   } CacheLookupInfo;
 
@@ -767,7 +773,7 @@ public:
 
     bool lookup_success;
     char *lookup_name;
-    char srv_hostname[MAXDNAME];
+    char *srv_hostname;         // MAXDNAME bytes from the State arena, set up by the first SRV lookup
     LookingUp_t looking_up;
     bool round_robin;
     bool srv_lookup_success;
@@ -776,10 +782,9 @@ public:
 
     _DNSLookupInfo()
     : attempts(0), os_addr_style(OS_ADDR_TRY_DEFAULT),
-        lookup_success(false), lookup_name(NULL), looking_up(UNDEFINED_LOOKUP), round_robin(false),
+        lookup_success(false), lookup_name(NULL), srv_hostname(NULL), looking_up(UNDEFINED_LOOKUP), round_robin(false),
         srv_lookup_success(false), srv_port(0)
     {
-      srv_hostname[0] = '\0';
       srv_app.allotment.application1 = 0;
       srv_app.allotment.application2 = 0;
     }
@@ -934,7 +939,7 @@ public:
     HTTPStatus http_return_code;
     int return_xbuf_size;
     bool return_xbuf_plain;
-    char return_xbuf[HTTP_TRANSACT_STATE_MAX_XBUF_SIZE];
+    char *return_xbuf;          // from the arena, at most HTTP_TRANSACT_STATE_MAX_XBUF_SIZE bytes
     void *user_args[HTTP_SSN_TXN_MAX_USER_ARG];
 
     int api_txn_active_timeout_value;
@@ -967,6 +972,7 @@ public:
 
     // Remap plugin processor support
     UrlMappingContainer url_map;
+    UrlRewrite *remap_table;    // pinned for the transaction, see acquireUrlRewrite()
     host_hdr_info hh_info;
 
     // congestion control
@@ -993,7 +999,7 @@ public:
     RangeRecord *ranges;
     
     OverridableHttpConfigParams *txn_conf;
-    OverridableHttpConfigParams my_txn_conf; // Storage for plugins, to avoid malloc
+    OverridableHttpConfigParams *my_txn_conf; // Storage for plugins, from the arena
 
     bool transparent_passthrough;
     
@@ -1053,6 +1059,7 @@ public:
         http_return_code(HTTP_STATUS_NONE),
         return_xbuf_size(0),
         return_xbuf_plain(false),
+        return_xbuf(NULL),
         api_txn_active_timeout_value(-1),
         api_txn_connect_timeout_value(-1),
         api_txn_dns_timeout_value(-1),
@@ -1076,6 +1083,7 @@ public:
         saved_update_cache_action(CACHE_DO_UNDEFINED),
         stale_icp_lookup(false),
         url_map(),
+        remap_table(NULL),
         pCongestionEntry(NULL),
         congest_saved_next_action(STATE_MACHINE_ACTION_UNDEFINED),
         congestion_control_crat(0),
@@ -1089,6 +1097,7 @@ public:
         range_output_cl(0),
         ranges(NULL),
         txn_conf(NULL),
+        my_txn_conf(NULL),
         transparent_passthrough(false)
     {
       int i;
@@ -1113,7 +1122,6 @@ public:
       via_string[VIA_DETAIL_SERVER_DESCRIPTOR] = VIA_DETAIL_SERVER_DESCRIPTOR_STRING;
       via_string[MAX_VIA_INDICES] = '\0';
 
-      memset(return_xbuf, 0, sizeof(return_xbuf));
       memset(user_args, 0, sizeof(user_args));
       memset(&host_db_info, 0, sizeof(host_db_info));
     }
@@ -1150,6 +1158,9 @@ public:
       if (internal_msg_buffer_type)
         ats_free(internal_msg_buffer_type);
 
+      if (parent_params) {
+        parent_params->parentRequestDone(&parent_result);
+      }
       ParentConfig::release(parent_params);
       parent_params = NULL;
 
@@ -1189,10 +1200,11 @@ public:
     void
     setup_per_txn_configs()
     {
-      if (txn_conf != &my_txn_conf) {
+      if (my_txn_conf == NULL) {
         // Make sure we copy it first.
-        memcpy(&my_txn_conf, &http_config_param->oride, sizeof(my_txn_conf));
-        txn_conf = &my_txn_conf;
+        my_txn_conf = (OverridableHttpConfigParams *) arena.alloc(sizeof(OverridableHttpConfigParams));
+        memcpy(my_txn_conf, &http_config_param->oride, sizeof(OverridableHttpConfigParams));
+        txn_conf = my_txn_conf;
       }
     }
 
@@ -1228,6 +1240,7 @@ public:
   static void HandleCacheOpenRead(State* s);
   static void HandleCacheOpenReadHitFreshness(State* s);
   static void HandleCacheOpenReadHit(State* s);
+  static void HandleFreshCacheHit(State* s);
   static void HandleCacheOpenReadMiss(State* s);
   static void build_response_from_cache(State* s, HTTPWarningCode warning_code);
   static void handle_cache_write_lock(State* s);
@@ -1289,6 +1302,8 @@ public:
   static bool is_server_negative_cached(State* s);
   static bool is_cache_response_returnable(State* s);
   static bool is_stale_cache_response_returnable(State* s);
+  static bool is_stale_while_revalidate_allowed(State* s);
+  static bool is_stale_if_error_allowed(State* s);
   static bool need_to_revalidate(State* s);
   static bool url_looks_dynamic(URL* url);
   static bool is_request_cache_lookupable(State* s, HTTPHdr* incoming);
@@ -155,8 +155,24 @@ HttpUpdateSM::handle_api_return()
       break;
     }
 #endif //TS_NO_TRANSFORM
-  case HttpTransact::PROXY_INTERNAL_CACHE_WRITE:
   case HttpTransact::SERVER_READ:
+    {
+      // There is no client to send the response to, but a new copy
+      //  of a cached object still goes into the cache
+      if ((t_state.cache_info.action == HttpTransact::CACHE_DO_WRITE ||
+           t_state.cache_info.action == HttpTransact::CACHE_DO_REPLACE) &&
+          cache_sm.cache_write_vc != NULL && transform_info.vc == NULL) {
+        cb_event = HTTP_SCH_UPDATE_EVENT_WRITTEN;
+        t_state.squid_codes.log_code = SQUID_LOG_TCP_REFRESH_MISS;
+        cache_sm.close_read();
+        t_state.cache_info.write_status = HttpTransact::CACHE_WRITE_IN_PROGRESS;
+        setup_server_transfer_to_cache_only();
+        tunnel.tunnel_run();
+        return;
+      }
+    }
+    // fall through
+  case HttpTransact::PROXY_INTERNAL_CACHE_WRITE:
   case HttpTransact::PROXY_INTERNAL_CACHE_NOOP:
   case HttpTransact::PROXY_SEND_ERROR_CACHE_NOOP:
   case HttpTransact::SERVE_FROM_CACHE:
@@ -0,0 +1,433 @@
+/** @file
+
+    Literal prefilter for regex_map rules.
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "RegexMappingIndex.h"
+#include "ParseRules.h"
+#include <algorithm>
+
+// Longest literal run we keep track of while scanning a pattern; a
+// prefix of a required literal is still required, so longer runs are
+// simply truncated.
+static const int REGEX_LITERAL_MAX = 256;
+
+// Skip a [...] character class starting at p.  Returns the position
+// after the closing bracket or NULL if the class is not terminated.
+static const char *
+skip_char_class(const char *p, const char *end)
+{
+  ++p;
+  if (p < end && *p == '^') {
+    ++p;
+  }
+  if (p < end && *p == ']') {     // leading ] is a literal
+    ++p;
+  }
+  while (p < end) {
+    if (*p == '\\') {
+      p += 2;
+    } else if (*p == '[' && (p + 1) < end && p[1] == ':') {
+      // POSIX class, e.g. [:alpha:]
+      for (p += 2; (p + 1) < end && !(p[0] == ':' && p[1] == ']'); ++p) ;
+      p += 2;
+    } else if (*p == ']') {
+      return p + 1;
+    } else {
+      ++p;
+    }
+  }
+  return NULL;
+}
+
+// Skip a (...) group starting at p, including nested groups.  Returns
+// the position after the closing paren or NULL if it is unbalanced.
+static const char *
+skip_group(const char *p, const char *end)
+{
+  int depth = 0;
+
+  while (p < end) {
+    if (*p == '\\') {
+      p += 2;
+    } else if (*p == '[') {
+      if ((p = skip_char_class(p, end)) == NULL) {
+        return NULL;
+      }
+    } else {
+      if (*p == '(') {
+        ++depth;
+      } else if (*p == ')' && --depth == 0) {
+        return p + 1;
+      }
+      ++p;
+    }
+  }
+  return NULL;
+}
+
+int
+RegexMappingIndex::ExtractLiteral(const char *pattern, int pattern_len, char *buf, int buf_size)
+{
+  char cur[REGEX_LITERAL_MAX];
+  int cur_len = 0;
+  int best_len = 0;
+  bool last_is_char = false;    // is the previous atom the last char of cur?
+  const char *p = pattern;
+  const char *end = pattern + pattern_len;
+
+#define END_RUN() \
+  do { \
+    if (cur_len > best_len && buf_size > 0) { \
+      best_len = (cur_len < buf_size) ? cur_len : buf_size; \
+      memcpy(buf, cur, best_len); \
+    } \
+    cur_len = 0; \
+    last_is_char = false; \
+  } while (0)
+
+#define APPEND_CHAR(ch) \
+  do { \
+    if (cur_len == REGEX_LITERAL_MAX) { \
+      END_RUN(); \
+    } \
+    cur[cur_len++] = ParseRules::ink_tolower(ch); \
+    last_is_char = true; \
+  } while (0)
+
+  while (p < end) {
+    char c = *p;
+
+    switch (c) {
+    case '\\':
+      if ((p + 1) >= end) {
+        return 0;
+      }
+      c = p[1];
+      if (ParseRules::is_alnum(c)) {
+        // Classes and assertions end the run; escapes that take
+        // arguments (\x, \c, \p, back references, \Q...) are not
+        // worth interpreting, so give up on the pattern.
+        if (strchr("dDwWsShHvVbBAzZGRXKafnrte", c) == NULL) {
+          return 0;
+        }
+        END_RUN();
+      } else {
+        APPEND_CHAR(c);
+      }
+      p += 2;
+      break;
+    case '|':
+      // Alternation at the top level; no single literal is required
+      return 0;
+    case '(':
+      // Option settings such as (?i) or (?x) change how the rest of
+      // the pattern reads; other groups are just skipped over.
+      if ((p + 1) < end && p[1] == '?' && ((p + 2) >= end || strchr(":=!<>|", p[2]) == NULL)) {
+        return 0;
+      }
+      if ((p = skip_group(p, end)) == NULL) {
+        return 0;
+      }
+      END_RUN();
+      break;
+    case '[':
+      if ((p = skip_char_class(p, end)) == NULL) {
+        return 0;
+      }
+      END_RUN();
+      break;
+    case '*':
+    case '?':
+    case '{':
+      // The previous char may occur zero times
+      if (last_is_char) {
+        --cur_len;
+      }
+      END_RUN();
+      if (c == '{') {
+        while (p < end && *p != '}') {
+          ++p;
+        }
+        if (p == end) {
+          return 0;
+        }
+      }
+      ++p;
+      break;
+    case '+':
+      // The previous char is still required, but the run ends here
+      END_RUN();
+      ++p;
+      break;
+    case ')':
+      return 0;
+    case '.':
+    case '^':
+    case '$':
+      END_RUN();
+      ++p;
+      break;
+    default:
+      APPEND_CHAR(c);
+      ++p;
+      break;
+    }
+  }
+  END_RUN();
+
+#undef APPEND_CHAR
+#undef END_RUN
+
+  return best_len;
+}
+
+int
+RegexMappingIndex::Insert(const char *pattern, int pattern_len)
+{
+  char literal[REGEX_LITERAL_MAX];
+  int rule_id = m_num_rules++;
+  int literal_len = ExtractLiteral(pattern, pattern_len, literal, sizeof(literal));
+
+  ink_assert(!m_built);
+  m_always.resize(BitmapWords(), 0);
+
+  if (literal_len == 0) {
+    Debug("url_rewrite_regex", "No literal for regex rule %d [%.*s]; always a candidate", rule_id, pattern_len, pattern);
+    _Mark(&m_always[0], rule_id);
+    return rule_id;
+  }
+
+  Debug("url_rewrite_regex", "Indexing regex rule %d [%.*s] by literal [%.*s]", rule_id, pattern_len, pattern,
+        literal_len, literal);
+
+  if (m_build.empty()) {
+    m_build.push_back(BuildNode());     // root
+  }
+
+  int state = 0;
+  for (int i = 0; i < literal_len; ++i) {
+    unsigned char c = (unsigned char) literal[i];
+    int next = -1;
+    std::vector<Edge> &edges = m_build[state].edges;
+
+    for (size_t e = 0; e < edges.size(); ++e) {
+      if (edges[e].c == c) {
+        next = edges[e].target;
+        break;
+      }
+    }
+    if (next < 0) {
+      Edge edge;
+      edge.c = c;
+      edge.target = next = m_build.size();
+      m_build[state].edges.push_back(edge);
+      m_build.push_back(BuildNode());
+    }
+    state = next;
+  }
+  m_build[state].rule_ids.push_back(rule_id);
+
+  return rule_id;
+}
+
+void
+RegexMappingIndex::Build()
+{
+  ink_assert(!m_built);
+  m_built = true;
+  m_always.resize(BitmapWords(), 0);
+
+  if (m_build.empty()) {
+    m_build.push_back(BuildNode());
+  }
+
+  // Flatten the trie; node ids are unchanged
+  m_nodes.resize(m_build.size());
+  for (size_t i = 0; i < m_build.size(); ++i) {
+    Node &node = m_nodes[i];
+    std::vector<Edge> &edges = m_build[i].edges;
+    std::vector<int> &rule_ids = m_build[i].rule_ids;
+
+    std::sort(edges.begin(), edges.end());
+    node.edges = m_edges.size();
+    node.n_edges = edges.size();
+    m_edges.insert(m_edges.end(), edges.begin(), edges.end());
+    node.outputs = m_outputs.size();
+    node.n_outputs = rule_ids.size();
+    m_outputs.insert(m_outputs.end(), rule_ids.begin(), rule_ids.end());
+    node.fail = 0;
+    node.dict = -1;
+  }
+  std::vector<BuildNode>().swap(m_build);
+
+  // Breadth first so a node's failure state is always settled first
+  std::vector<int> queue;
+  queue.push_back(0);
+  for (size_t q = 0; q < queue.size(); ++q) {
+    int u = queue[q];
+
+    for (int e = m_nodes[u].edges; e < m_nodes[u].edges + m_nodes[u].n_edges; ++e) {
+      unsigned char c = m_edges[e].c;
+      int v = m_edges[e].target;
+      int f = m_nodes[u].fail;
+      int g;
+
+      while (f != 0 && _Goto(f, c) < 0) {
+        f = m_nodes[f].fail;
+      }
+      g = _Goto(f, c);
+      m_nodes[v].fail = (g >= 0 && g != v) ? g : 0;
+      m_nodes[v].dict = (m_nodes[m_nodes[v].fail].n_outputs > 0) ? m_nodes[v].fail : m_nodes[m_nodes[v].fail].dict;
+      queue.push_back(v);
+    }
+  }
+
+  Debug("url_rewrite_regex", "Built regex index for %d rules with %d states", m_num_rules, (int) m_nodes.size());
+}
+
+inline int
+RegexMappingIndex::_Goto(int state, unsigned char c) const
+{
+  const Edge *edge = &m_edges[0] + m_nodes[state].edges;
+  const Edge *limit = edge + m_nodes[state].n_edges;
+
+  // Edges are sorted; host names draw from a small alphabet so the
+  // fan-out is low and a linear scan beats a binary search
+  for (; edge < limit && edge->c <= c; ++edge) {
+    if (edge->c == c) {
+      return edge->target;
+    }
+  }
+  return -1;
+}
+
+void
+RegexMappingIndex::Candidates(const char *subject, int subject_len, uint64_t *bitmap) const
+{
+  ink_assert(m_built);
+
+  if (m_num_rules == 0) {
+    return;
+  }
+  memcpy(bitmap, &m_always[0], BitmapWords() * sizeof(uint64_t));
+
+  if (m_edges.empty()) {
+    return;
+  }
+
+  int state = 0;
+  for (int i = 0; i < subject_len; ++i) {
+    unsigned char c = (unsigned char) subject[i];
+    int next;
+
+    while ((next = _Goto(state, c)) < 0 && state != 0) {
+      state = m_nodes[state].fail;
+    }
+    state = (next < 0) ? 0 : next;
+
+    for (int n = (m_nodes[state].n_outputs > 0) ? state : m_nodes[state].dict; n > 0; n = m_nodes[n].dict) {
+      for (int o = m_nodes[n].outputs; o < m_nodes[n].outputs + m_nodes[n].n_outputs; ++o) {
+        _Mark(bitmap, m_outputs[o]);
+      }
+    }
+  }
+}
+
+#if TS_HAS_TESTS
+#include "TestBox.h"
+
+REGRESSION_TEST(RegexMappingIndex_Literal)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+  static const struct
+  {
+    const char *pattern;
+    const char *literal;
+  } cases[] = {
+    { "www\\.example\\.com", "www.example.com" },
+    { "(.*)\\.Example\\.com", ".example.com" },
+    { "img[0-9]+\\.cdn\\.net", ".cdn.net" },
+    { "\\d+-static\\.foo\\.org$", "-static.foo.org" },
+    { "^abc{2,3}xyz", "xyz" },
+    { "ab*cd", "cd" },
+    { "abx+y", "abx" },
+    { "(?:www\\.)?shop\\.com", "shop.com" },
+    { "[a-z]+", "" },
+    { "foo|bar", "" },
+    { "(?i)abc", "" },
+    { "abc\\x41def", "" },
+    { "abc)", "" },
+  };
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  for (unsigned i = 0; i < countof(cases); ++i) {
+    char buf[256];
+    int len = RegexMappingIndex::ExtractLiteral(cases[i].pattern, strlen(cases[i].pattern), buf, sizeof(buf));
+
+    tb.check(len == (int) strlen(cases[i].literal) && memcmp(buf, cases[i].literal, len) == 0,
+             "Pattern [%s] gave literal [%.*s], expected [%s]", cases[i].pattern, len, buf, cases[i].literal);
+  }
+}
+
+REGRESSION_TEST(RegexMappingIndex_Candidates)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+  RegexMappingIndex index;
+  static const char *rules[] = {
+    "(.*)\\.example\\.com",           // 0
+    "[a-z0-9-]+",                      // 1, no literal
+    "cdn[0-9]+\\.example\\.com",      // 2
+    "ample",                           // 3
+    "static\\.other\\.org",           // 4
+  };
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  for (unsigned i = 0; i < countof(rules); ++i) {
+    tb.check(index.Insert(rules[i], strlen(rules[i])) == (int) i, "Rule %u got the wrong id", i);
+  }
+  index.Build();
+
+  tb.check(index.BitmapWords() == 1, "Expected one bitmap word for %d rules", index.NumRules());
+
+  static const struct
+  {
+    const char *host;
+    uint64_t expected;
+  } lookups[] = {
+    { "www.example.com", (1 << 0) | (1 << 1) | (1 << 2) | (1 << 3) },
+    { "cdn12.example.com", (1 << 0) | (1 << 1) | (1 << 2) | (1 << 3) },
+    { "static.other.org", (1 << 1) | (1 << 4) },
+    { "nothing.here", (1 << 1) },
+    { "", (1 << 1) },
+  };
+
+  for (unsigned i = 0; i < countof(lookups); ++i) {
+    uint64_t bitmap = 0;
+
+    index.Candidates(lookups[i].host, strlen(lookups[i].host), &bitmap);
+    tb.check(bitmap == lookups[i].expected, "Host [%s] gave candidates 0x%x, expected 0x%x",
+             lookups[i].host, (unsigned) bitmap, (unsigned) lookups[i].expected);
+  }
+}
+
+#endif // TS_HAS_TESTS
@@ -0,0 +1,118 @@
+/** @file
+
+    Literal prefilter for regex_map rules.
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef _REGEX_MAPPING_INDEX_H
+#define _REGEX_MAPPING_INDEX_H
+
+#include "libts.h"
+#undef std  // FIXME: remove dependancy on the STL
+#include <vector>
+
+/** Multi-pattern prefilter for the regex host rules of one mapping store.
+
+    Each rule contributes the longest literal that every match of its
+    pattern must contain.  All literals are compiled into one Aho-Corasick
+    automaton, so a single pass over the request host yields the set of
+    rules that can possibly match.  Rules without a usable literal are
+    always candidates.  Callers still confirm candidates with pcre_exec in
+    rule order, so first-match semantics are unchanged.
+
+    The index is built once at config load and is read only afterwards,
+    so lookups need no locking.
+*/
+class RegexMappingIndex
+{
+public:
+  RegexMappingIndex()
+    : m_num_rules(0), m_built(false)
+  { }
+
+  /// Add the next rule, in first-match order.  @return the rule id.
+  int Insert(const char *pattern, int pattern_len);
+  /// Compute failure links; must be called once after the last Insert.
+  void Build();
+
+  /** Mark the rules that may match @a subject in @a bitmap, which must
+      hold BitmapWords() words.  @a subject is expected to be lower case.
+  */
+  void Candidates(const char *subject, int subject_len, uint64_t *bitmap) const;
+
+  int NumRules() const { return m_num_rules; }
+  int BitmapWords() const { return (m_num_rules + 63) / 64; }
+
+  static bool IsCandidate(const uint64_t *bitmap, int rule_id)
+  {
+    return (bitmap[rule_id >> 6] & (((uint64_t) 1) << (rule_id & 63))) != 0;
+  }
+
+  /** Extract a literal which must appear in every string matched by the
+      regex @a pattern.  The literal is lower cased into @a buf.
+      @return the literal length, 0 if there is no usable literal.
+  */
+  static int ExtractLiteral(const char *pattern, int pattern_len, char *buf, int buf_size);
+
+private:
+  struct Node
+  {
+    int edges;                  // first edge in m_edges
+    int n_edges;
+    int fail;                   // longest proper suffix state
+    int dict;                   // nearest suffix state with output, or -1
+    int outputs;                // first rule id in m_outputs
+    int n_outputs;
+  };
+
+  struct Edge
+  {
+    unsigned char c;
+    int target;
+
+    bool operator <(const Edge &rhs) const { return c < rhs.c; }
+  };
+
+  // Build time trie, flattened into m_nodes / m_edges by Build()
+  struct BuildNode
+  {
+    std::vector<Edge> edges;
+    std::vector<int> rule_ids;
+  };
+
+  int _Goto(int state, unsigned char c) const;
+  static void _Mark(uint64_t *bitmap, int rule_id)
+  {
+    bitmap[rule_id >> 6] |= ((uint64_t) 1) << (rule_id & 63);
+  }
+
+  int m_num_rules;
+  bool m_built;
+  std::vector<BuildNode> m_build;
+  std::vector<Node> m_nodes;
+  std::vector<Edge> m_edges;
+  std::vector<int> m_outputs;
+  std::vector<uint64_t> m_always;       // rules without a literal
+
+  // make copy-constructor and assignment operator private
+  RegexMappingIndex(const RegexMappingIndex &rhs);
+  RegexMappingIndex &operator =(const RegexMappingIndex &rhs);
+};
+
+#endif // _REGEX_MAPPING_INDEX_H
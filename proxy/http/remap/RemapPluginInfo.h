@@ -70,6 +70,7 @@ public:
   _tsremap_delete_instance *fp_tsremap_delete_instance;
   _tsremap_do_remap *fp_tsremap_do_remap;
   _tsremap_os_response *fp_tsremap_os_response;
+  bool synchronous;             /* declared TSREMAP_FLAG_SYNC in TSRemapInit() */
 
   remap_plugin_info(char *_path);
   ~remap_plugin_info();
@@ -149,6 +149,26 @@ RemapPlugins::run_single_remap()
   return 0;
 }
 
+bool
+RemapPlugins::_last_synchronous() const
+{
+  remap_plugin_info *plugin = _s->url_map.getMapping()->get_plugin(_cur - 1);
+
+  return plugin && plugin->synchronous;
+}
+
+/**
+  Run the whole remaining plugin chain inline, without going back
+  through the event system between plugins.
+
+*/
+void
+RemapPlugins::run_chain()
+{
+  while (run_single_remap() == 0)
+    ;
+}
+
 int
 RemapPlugins::run_remap(int event, Event* e)
 {
@@ -169,7 +189,11 @@ RemapPlugins::run_remap(int event, Event* e)
   switch (event) {
   case EVENT_IMMEDIATE:
     Debug("url_rewrite", "handling immediate event inside RemapPlugins::run_remap");
-    ret = run_single_remap();
+    // A plugin that declared itself synchronous didn't hand anything to
+    // the event system, so go straight on to the next one.
+    do {
+      ret = run_single_remap();
+    } while (!ret && _last_synchronous());
     /**
      * If ret !=0 then we are done with this processor and we call back into the SM;
      * otherwise, we call this function again immediately (which really isn't immediate)
@@ -197,3 +221,160 @@ RemapPlugins::run_remap(int event, Event* e)
   };
   return EVENT_DONE;
 }
+
+#if TS_HAS_TESTS
+#include "HTTP.h"
+#include "TestBox.h"
+
+#define REMAP_BENCH_CHAIN 3
+#define REMAP_BENCH_RUNS 100000
+
+static TSRemapStatus
+bench_do_remap(void * /* ih ATS_UNUSED */, TSHttpTxn /* rh ATS_UNUSED */, TSRemapRequestInfo * /* rri ATS_UNUSED */)
+{
+  return TSREMAP_NO_REMAP;
+}
+
+// One mapping rule with a chain of do-nothing plugins, plus a request to run it on
+struct RemapBenchRule
+{
+  remap_plugin_info *plugins[REMAP_BENCH_CHAIN];
+  url_mapping map;
+  HTTPHdr request;
+  URL request_url;
+
+  RemapBenchRule()
+  {
+    const char *from = "http://www.example.com/";
+    const char *to = "http://origin.example.com/";
+    const char *url = "http://www.example.com/images/logo.png";
+
+    map.fromURL.create(NULL);
+    map.fromURL.parse(from, strlen(from));
+    map.toUrl.create(NULL);
+    map.toUrl.parse(to, strlen(to));
+    for (int i = 0; i < REMAP_BENCH_CHAIN; ++i) {
+      plugins[i] = new remap_plugin_info(NULL);
+      plugins[i]->fp_tsremap_do_remap = bench_do_remap;
+      plugins[i]->synchronous = true;
+      map.add_plugin(plugins[i], NULL);
+    }
+    request.create(HTTP_TYPE_REQUEST);
+    request_url.create(NULL);
+    request_url.parse(url, strlen(url));
+    request.url_set(&request_url);
+  }
+
+  ~RemapBenchRule()
+  {
+    request_url.destroy();
+    request.destroy();
+    for (int i = 0; i < REMAP_BENCH_CHAIN; ++i) {
+      delete plugins[i];
+    }
+  }
+};
+
+// Steps a chain one plugin per handleEvent(), as run_remap() does for
+// plugins that go back through the event system, but dispatched by the
+// caller so that no event thread wakeup is timed
+struct RemapBenchStepper: public Continuation
+{
+  RemapPlugins *plugins;
+  bool done;
+
+  RemapBenchStepper()
+    : Continuation(new_ProxyMutex()), plugins(NULL), done(false)
+  {
+    SET_HANDLER(&RemapBenchStepper::step);
+  }
+
+  int step(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+  {
+    done = plugins->run_single_remap() != 0;
+    return done ? EVENT_DONE : EVENT_CONT;
+  }
+};
+
+static double
+remap_bench_ns(ink_hrtime elapsed)
+{
+  return (double) elapsed / (double) REMAP_BENCH_RUNS;
+}
+
+/**
+  Times the work a chain does, without the event queue around it.
+  run_plugin() is the cost of calling one plugin.  run_dispatch is the
+  chain stepped through one locked continuation dispatch per plugin on
+  this thread, the way the remap threads run it minus the schedule_imm()
+  and wakeup, which depend on their load and are not measured here.
+  run_chain() is the whole chain in one inline pass, as perform_remap()
+  now runs synchronous chains.
+
+*/
+REGRESSION_TEST(RemapPlugins_Benchmark)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+  HttpTransact::State *state = new HttpTransact::State;
+  RemapBenchRule *rule = new RemapBenchRule;
+  ink_hrtime start;
+
+  tb = REGRESSION_TEST_PASSED;
+  state->url_map.set(&rule->map);
+
+  {
+    RemapPlugins plugins(state, rule->request.url_get(), &rule->request, NULL);
+
+    start = ink_get_hrtime_internal();
+    for (int i = 0; i < REMAP_BENCH_RUNS; ++i) {
+      plugins.run_plugin(rule->plugins[0]);
+    }
+    rperf(t, "run_plugin_ns", remap_bench_ns(ink_get_hrtime_internal() - start));
+  }
+
+  {
+    RemapBenchStepper stepper;
+    EThread *thread = this_ethread();
+    int dispatches = 0;
+
+    start = ink_get_hrtime_internal();
+    for (int i = 0; i < REMAP_BENCH_RUNS; ++i) {
+      RemapPlugins plugins(state, rule->request.url_get(), &rule->request, NULL);
+
+      stepper.plugins = &plugins;
+      stepper.done = false;
+      while (!stepper.done) {
+        MUTEX_TRY_LOCK(lock, stepper.mutex, thread);
+        stepper.handleEvent(EVENT_IMMEDIATE, NULL);
+        ++dispatches;
+      }
+    }
+    rperf(t, "run_dispatch_ns", remap_bench_ns(ink_get_hrtime_internal() - start));
+    tb.check(dispatches == REMAP_BENCH_RUNS * REMAP_BENCH_CHAIN, "%d dispatches for %d chains of %d plugins", dispatches,
+             REMAP_BENCH_RUNS, REMAP_BENCH_CHAIN);
+  }
+
+  start = ink_get_hrtime_internal();
+  for (int i = 0; i < REMAP_BENCH_RUNS; ++i) {
+    RemapPlugins plugins(state, rule->request.url_get(), &rule->request, NULL);
+
+    plugins.run_chain();
+  }
+  rperf(t, "run_chain_ns", remap_bench_ns(ink_get_hrtime_internal() - start));
+
+  // Stepping through the chain must take one step per plugin
+  {
+    RemapPlugins plugins(state, rule->request.url_get(), &rule->request, NULL);
+    int steps = 1;
+
+    while (plugins.run_single_remap() == 0) {
+      ++steps;
+    }
+    tb.check(steps == REMAP_BENCH_CHAIN, "chain of %d plugins took %d steps", REMAP_BENCH_CHAIN, steps);
+  }
+
+  state->url_map.clear();
+  delete rule;
+  delete state;
+}
+#endif /* TS_HAS_TESTS */
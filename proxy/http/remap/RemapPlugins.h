@@ -60,11 +60,14 @@ struct RemapPlugins: public Continuation
 
   int run_remap(int event, Event* e);
   int run_single_remap();
+  void run_chain();
   TSRemapStatus run_plugin(remap_plugin_info* plugin);
 
   Action action;
 
  private:
+  bool _last_synchronous() const;
+
   unsigned int _cur;
   HttpTransact::State * _s;
   URL *_request_url;
@@ -30,8 +30,8 @@
 url_mapping::url_mapping(int rank /* = 0 */)
   : from_path_len(0), fromURL(), toUrl(), homePageRedirect(false), unique(false), default_redirect_url(false),
     optional_referer(false), negative_referer(false), wildcard_from_scheme(false),
-    tag(NULL), filter_redirect_url(NULL), referer_list(0),
-    redir_chunk_list(0), filter(NULL), _plugin_count(0), _rank(rank)
+    tag(NULL), filter_redirect_url(NULL), line_hash(0), line_no(0), referer_list(0),
+    redir_chunk_list(0), filter(NULL), _plugin_count(0), _rank(rank), _plugins_synchronous(true)
 {
   memset(_plugin_list, 0, sizeof(_plugin_list));
   memset(_instance_data, 0, sizeof(_instance_data));
@@ -50,6 +50,7 @@ url_mapping::add_plugin(remap_plugin_info* i, void* ih)
   _plugin_list[_plugin_count] = i;
   _instance_data[_plugin_count] = ih;
   ++_plugin_count;
+  _plugins_synchronous = _plugins_synchronous && i->synchronous;
 
   return true;
 }
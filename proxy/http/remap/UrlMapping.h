@@ -38,6 +38,10 @@
 
 static const unsigned int MAX_REMAP_PLUGIN_CHAIN = 10;
 
+// FNV-1a parameters used to fingerprint remap.config lines
+#define URL_MAPPING_HASH_BASIS 14695981039346656037ULL
+#define URL_MAPPING_HASH_PRIME 1099511628211ULL
+
 
 /**
  * Used to store http referer strings (and/or regexp)
@@ -109,6 +113,8 @@ public:
   char *tag;                    // tag
   char *filter_redirect_url;    // redirect url when referer filtering enabled
   unsigned int map_id;
+  uint64_t line_hash;           // config line and directive context, 0 if synthesized
+  int line_no;                  // remap.config line, 0 if synthesized
   referer_info *referer_list;
   redirect_tag_str *redir_chunk_list;
   acl_filter_rule *filter;      // acl filtering (list of rules)
@@ -116,11 +122,14 @@ public:
   LINK(url_mapping, link); // For use with the main Queue linked list holding all the mapping
 
   int getRank() const { return _rank; };
+  // True if every plugin in the chain declared TSREMAP_FLAG_SYNC (or there are none)
+  bool plugins_synchronous() const { return _plugins_synchronous; };
 
 private:
   remap_plugin_info* _plugin_list[MAX_REMAP_PLUGIN_CHAIN];
   void* _instance_data[MAX_REMAP_PLUGIN_CHAIN];
   int _rank;
+  bool _plugins_synchronous;
 };
 
 
@@ -21,72 +21,322 @@
     limitations under the License.
 */
 #include "UrlMappingPathIndex.h"
+#include "Trie.h"
 
 UrlMappingPathIndex::~UrlMappingPathIndex()
 {
-  for (UrlMappingGroup::iterator group_iter = m_tries.begin(); group_iter != m_tries.end(); ++group_iter)
-    delete group_iter->second; // Delete the Trie
-  m_tries.clear();
+  url_mapping *mapping;
+
+  m_radix.Clear();
+  while ((mapping = m_mappings.dequeue()) != NULL)
+    delete mapping;
+  while ((mapping = m_pending.dequeue()) != NULL)
+    delete mapping;
 }
 
 bool
 UrlMappingPathIndex::Insert(url_mapping *mapping)
 {
-  int scheme_idx;
-  int port = (mapping->fromURL).port_get();
-  UrlMappingTrie *trie;
-  int from_path_len;
-  const char *from_path;
+  uint64_t rank = (uint64_t) mapping->getRank();
+
+  // Remap plugins re-read their own config when instantiated, so their
+  // mappings are always rebuilt on reload
+  if (mapping->line_hash == 0 || mapping->_plugin_count > 0) {
+    m_reusable = false;
+  }
+  // Order sensitive, so the same lines in a new order don't compare equal
+  m_signature = (m_signature * URL_MAPPING_HASH_PRIME) ^ mapping->line_hash;
+  m_rank_signature = (((m_rank_signature * URL_MAPPING_HASH_PRIME) ^ mapping->line_hash) * URL_MAPPING_HASH_PRIME) ^ rank;
+  m_pending.enqueue(mapping);
+  return true;
+}
+
+bool
+UrlMappingPathIndex::Build(url_mapping **duplicate_out)
+{
+  url_mapping *mapping;
+  url_mapping *duplicate = NULL;
+  char key_buf[SEARCH_KEY_INLINE];
 
-  trie = _GetTrie(&(mapping->fromURL), scheme_idx, port);
+  while ((mapping = m_pending.dequeue()) != NULL) {
+    int port = mapping->fromURL.port_get();
+    int group = _GroupKey(&mapping->fromURL, port);
+    int from_path_len;
+    const char *from_path = mapping->fromURL.path_get(&from_path_len);
+    char *key = key_buf;
 
-  if (!trie) {
-    trie = new UrlMappingTrie();
-    m_tries.insert(UrlMappingGroup::value_type(UrlMappingTrieKey(scheme_idx, port), trie));
-    Debug("UrlMappingPathIndex::Insert", "Created new trie for scheme index, port combo <%d, %d>",
-          scheme_idx, port);
+    if (GROUP_KEY_LEN + from_path_len > SEARCH_KEY_INLINE) {
+      key = (char *) ats_malloc(GROUP_KEY_LEN + from_path_len);
+    }
+    _PutGroupKey(key, group);
+    memcpy(key + GROUP_KEY_LEN, from_path, from_path_len);
+    m_radix.Insert(key, GROUP_KEY_LEN + from_path_len, mapping, mapping->getRank());
+    if (key != key_buf) {
+      ats_free(key);
+    }
+
+    if (m_first_group < 0 || group < m_first_group) {
+      m_first_group = group;
+    }
+    m_mappings.enqueue(mapping);
   }
 
-  from_path = mapping->fromURL.path_get(&from_path_len);
-  if (!trie->Insert(from_path, mapping, mapping->getRank(), from_path_len)) {
-    Error("Couldn't insert into trie!");
+  if (!m_radix.Build(&duplicate)) {
+    char from_url[256];
+    int from_url_len;
+
+    duplicate->fromURL.string_get_buf(from_url, sizeof(from_url), &from_url_len);
+    Warning("Could not index mapping for %.*s at line %d; duplicate path", from_url_len, from_url, duplicate->line_no);
+    if (duplicate_out) {
+      *duplicate_out = duplicate;
+    }
     return false;
   }
-  Debug("UrlMappingPathIndex::Insert", "Inserted new element!");
+  Debug("UrlMappingPathIndex::Build", "Indexed %d mappings in %d nodes", m_radix.NumValues(), m_radix.NumNodes());
   return true;
 }
 
 url_mapping *
 UrlMappingPathIndex::Search(URL *request_url, int request_port, bool normal_search /* = true */) const
 {
-  url_mapping *retval = 0;
-  int scheme_idx;
-  UrlMappingTrie *trie;
+  url_mapping *retval;
+  char key_buf[SEARCH_KEY_INLINE];
+  char *key = key_buf;
   int path_len;
   const char *path;
+  int group;
 
-  trie = _GetTrie(request_url, scheme_idx, request_port, normal_search);
-
-  if (!trie) {
-    Debug("UrlMappingPathIndex::Search", "No mappings exist for scheme index, port combo <%d, %d>",
-          scheme_idx, request_port);
-    goto lFail;
+  if (normal_search) {
+    group = _GroupKey(request_url, request_port);
+  } else { // use the first group arbitrarily
+    Debug("UrlMappingPathIndex::Search", "Not performing search; will use first available group");
+    if ((group = m_first_group) < 0) {
+      return NULL;
+    }
   }
 
   path = request_url->path_get(&path_len);
-  if (!(retval = trie->Search(path, path_len))) {
+  if (GROUP_KEY_LEN + path_len > SEARCH_KEY_INLINE) {
+    key = (char *) ats_malloc(GROUP_KEY_LEN + path_len);
+  }
+  _PutGroupKey(key, group);
+  memcpy(key + GROUP_KEY_LEN, path, path_len);
+
+  if (!(retval = m_radix.Search(key, GROUP_KEY_LEN + path_len))) {
     Debug("UrlMappingPathIndex::Search", "Couldn't find entry for url with path [%.*s]", path_len, path);
-    goto lFail;
   }
-  return retval;
 
-lFail:
-  return 0;
+  if (key != key_buf) {
+    ats_free(key);
+  }
+  return retval;
 }
 
 void
 UrlMappingPathIndex::Print()
 {
-  for (UrlMappingGroup::iterator group_iter = m_tries.begin(); group_iter != m_tries.end(); ++group_iter)
-    group_iter->second->Print();
+  forl_LL(url_mapping, iter, m_mappings)
+    iter->Print();
+}
+
+#if TS_HAS_TESTS
+#include "TestBox.h"
+
+static url_mapping *
+make_test_mapping(const char *from, uint64_t line_hash, int rank)
+{
+  url_mapping *mapping = NEW(new url_mapping(rank));
+
+  mapping->fromURL.create(NULL);
+  mapping->fromURL.parse(from, strlen(from));
+  mapping->line_hash = line_hash;
+  return mapping;
+}
+
+REGRESSION_TEST(UrlMappingPathIndex_Signature)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+  UrlMappingPathIndex live, same, renumbered, reordered, synthesized, dups;
+  URL request;
+  url_mapping *found;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  live.Insert(make_test_mapping("http://a.com/foo", 11, 1));
+  live.Insert(make_test_mapping("http://a.com/bar", 22, 2));
+  same.Insert(make_test_mapping("http://a.com/foo", 11, 1));
+  same.Insert(make_test_mapping("http://a.com/bar", 22, 2));
+  renumbered.Insert(make_test_mapping("http://a.com/foo", 11, 5));
+  renumbered.Insert(make_test_mapping("http://a.com/bar", 22, 6));
+  reordered.Insert(make_test_mapping("http://a.com/bar", 22, 1));
+  reordered.Insert(make_test_mapping("http://a.com/foo", 11, 2));
+  synthesized.Insert(make_test_mapping("http://a.com/", 0, 0));
+
+  tb.check(live.Signature() == same.Signature() && live.RankSignature() == same.RankSignature(),
+           "Identical lines should give identical signatures");
+  tb.check(live.Signature() == renumbered.Signature(), "Moving lines should not change the signature");
+  tb.check(live.RankSignature() != renumbered.RankSignature(), "Moving lines should change the rank signature");
+  tb.check(live.Signature() != reordered.Signature(), "Reordering lines should change the signature");
+  tb.check(live.Reusable() && !synthesized.Reusable(), "Only config lines should be reusable");
+
+  tb.check(live.Build(), "Could not build the index");
+  request.create(NULL);
+  request.parse("http://a.com/bar/baz", strlen("http://a.com/bar/baz"));
+  found = live.Search(&request, 80);
+  tb.check(found != NULL && found->getRank() == 2, "Lookup did not find the /bar mapping");
+  request.destroy();
+
+  url_mapping *first = make_test_mapping("http://a.com/foo", 11, 1);
+  url_mapping *second = make_test_mapping("http://a.com/foo", 12, 2);
+  url_mapping *duplicate = NULL;
+
+  first->line_no = 7;
+  second->line_no = 9;
+  dups.Insert(first);
+  dups.Insert(second);
+  tb.check(!dups.Build(&duplicate), "Duplicate paths should fail to build");
+  tb.check(duplicate != NULL && duplicate->line_no == 9, "Duplicate reported at line %d, expected 9",
+           duplicate ? duplicate->line_no : -1);
+}
+
+struct PathBenchValue
+{
+  int id;
+  LINK(PathBenchValue, link);
+};
+
+static int
+make_bench_paths(char **paths, int n_paths)
+{
+  char buf[128];
+
+  // Layout similar to a large CDN remap set: a few hundred sections,
+  // each with many customer / asset prefixes below it
+  for (int i = 0; i < n_paths; ++i) {
+    int len = snprintf(buf, sizeof(buf), "c%03d/%s/v%d/asset%d", i % 577, (i & 1) ? "img" : "static", (i / 577) % 7, i);
+    paths[i] = ats_strndup(buf, len);
+  }
+  return n_paths;
+}
+
+// Lookups cycle through a fixed set of keys built up front, each a
+// rule path plus a file name, so the timing excludes key formatting
+#define PATH_BENCH_KEYS 4096
+
+struct PathBenchKey
+{
+  char key[128];
+  int len;
+};
+
+static PathBenchKey *
+make_bench_keys(char **paths, int n_paths)
+{
+  PathBenchKey *keys = (PathBenchKey *) ats_malloc(PATH_BENCH_KEYS * sizeof(PathBenchKey));
+
+  for (int i = 0; i < PATH_BENCH_KEYS; ++i) {
+    keys[i].len = snprintf(keys[i].key, sizeof(keys[i].key), "%s/file%d.jpg",
+                           paths[(int) (((int64_t) i * 7919) % n_paths)], i & 15);
+  }
+  return keys;
+}
+
+static double
+bench_radix(RegressionTest *t, TestBox &tb, char **paths, int n_paths, int n_lookups, Trie<PathBenchValue> *trie)
+{
+  PathBenchKey *keys = make_bench_keys(paths, n_paths);
+  RadixTree<PathBenchValue> radix;
+  PathBenchValue *values = new PathBenchValue[n_paths];
+  char key[256];
+  ink_hrtime start, elapsed;
+  int64_t hits = 0;
+  int mismatches = 0;
+
+  for (int i = 0; i < n_paths; ++i) {
+    values[i].id = i;
+    radix.Insert(paths[i], strlen(paths[i]), &values[i], i);
+  }
+  tb.check(radix.Build(), "Radix build failed");
+
+  start = ink_get_hrtime_internal();
+  for (int i = 0; i < n_lookups; ++i) {
+    const PathBenchKey &lookup = keys[i & (PATH_BENCH_KEYS - 1)];
+    hits += (radix.Search(lookup.key, lookup.len) != NULL);
+  }
+  elapsed = ink_get_hrtime_internal() - start;
+
+  if (trie) {
+    // Same answers as the trie, including misses
+    for (int i = 0; i < n_paths; i += 13) {
+      int len = snprintf(key, sizeof(key), "%s%s", paths[i], (i & 2) ? "/x" : "9");
+      PathBenchValue *r = radix.Search(key, len), *tr = trie->Search(key, len);
+
+      if ((r ? r->id : -1) != (tr ? tr->id : -1)) {
+        ++mismatches;
+      }
+    }
+    tb.check(mismatches == 0, "Radix and Trie disagree on %d lookups", mismatches);
+  }
+
+  tb.check(hits == n_lookups, "Radix missed %d lookups", (int) (n_lookups - hits));
+  rprintf(t, "radix: %d paths in %d nodes\n", n_paths, radix.NumNodes());
+  delete[] values;
+  ats_free(keys);
+  return (double) n_lookups * HRTIME_SECOND / (double) (elapsed > 0 ? elapsed : 1);
+}
+
+static double
+bench_trie(TestBox &tb, Trie<PathBenchValue> &trie, char **paths, int n_paths, int n_lookups)
+{
+  PathBenchKey *keys = make_bench_keys(paths, n_paths);
+  ink_hrtime start, elapsed;
+  int64_t hits = 0;
+
+  for (int i = 0; i < n_paths; ++i) {
+    PathBenchValue *value = new PathBenchValue;   // owned by the trie
+
+    value->id = i;
+    trie.Insert(paths[i], value, i);
+  }
+
+  start = ink_get_hrtime_internal();
+  for (int i = 0; i < n_lookups; ++i) {
+    const PathBenchKey &lookup = keys[i & (PATH_BENCH_KEYS - 1)];
+    hits += (trie.Search(lookup.key, lookup.len) != NULL);
+  }
+  elapsed = ink_get_hrtime_internal() - start;
+
+  tb.check(hits == n_lookups, "Trie missed %d lookups", (int) (n_lookups - hits));
+  ats_free(keys);
+  return (double) n_lookups * HRTIME_SECOND / (double) (elapsed > 0 ? elapsed : 1);
 }
+
+// The trie needs ~2KB per node, so it is only compared on the smaller set
+#define PATH_BENCH_COMPARE_PATHS 20000
+#define PATH_BENCH_FULL_PATHS 200000
+#define PATH_BENCH_LOOKUPS 1000000
+
+REGRESSION_TEST(UrlMappingPathIndex_Benchmark)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+  char **paths = (char **) ats_malloc(PATH_BENCH_FULL_PATHS * sizeof(char *));
+  int n_paths = make_bench_paths(paths, PATH_BENCH_FULL_PATHS);
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  {
+    Trie<PathBenchValue> trie;
+
+    rperf(t, "trie_20k_lookups_per_sec", bench_trie(tb, trie, paths, PATH_BENCH_COMPARE_PATHS, PATH_BENCH_LOOKUPS));
+    rperf(t, "radix_20k_lookups_per_sec",
+          bench_radix(t, tb, paths, PATH_BENCH_COMPARE_PATHS, PATH_BENCH_LOOKUPS, &trie));
+  }
+  rperf(t, "radix_200k_lookups_per_sec", bench_radix(t, tb, paths, n_paths, PATH_BENCH_LOOKUPS, NULL));
+
+  for (int i = 0; i < n_paths; ++i) {
+    ats_free(paths[i]);
+  }
+  ats_free(paths);
+}
+
+#endif // TS_HAS_TESTS
@@ -24,54 +24,67 @@
 #define _URL_MAPPING_PATH_INDEX_H
 
 #include "libts.h"
-#undef std  // FIXME: remove dependancy on the STL
-#include <map>
 
 #include "URL.h"
 #include "UrlMapping.h"
-#include "Trie.h"
+#include "RadixTree.h"
 
-class UrlMappingPathIndex
+/**
+  Path index for all the mappings of one host.
+
+  Mappings are queued by Insert() and only indexed by Build(), so a
+  reload can compare an entry's Signature() with the live table and
+  share the old entry instead of building a new one.  Shared entries
+  are reference counted; the owning tables call refcount_dec().
+
+  All scheme / port groups of the host live in one radix tree, keyed by
+  a short group prefix followed by the path.
+
+*/
+class UrlMappingPathIndex: public RefCountObj
 {
 public:
   UrlMappingPathIndex()
+    : m_first_group(-1), m_signature(0), m_rank_signature(0), m_reusable(true)
   { }
 
   virtual ~UrlMappingPathIndex();
   bool Insert(url_mapping *mapping);
+  bool Build(url_mapping **duplicate = NULL);
   url_mapping* Search(URL *request_url, int request_port, bool normal_search = true) const;
   void Print();
 
+  /// Digest of the config lines behind this entry, in insertion order
+  uint64_t Signature() const { return m_signature; }
+  /// As Signature(), but also covering the rank of each mapping
+  uint64_t RankSignature() const { return m_rank_signature; }
+  /// False if a mapping was synthesized (backdoor, PAC) or uses plugins
+  bool Reusable() const { return m_reusable; }
+
+  // scheme index (1 byte) and port (2 bytes) ahead of the path
+  static const int GROUP_KEY_LEN = 3;
+  // longest key built on the stack during a search
+  static const int SEARCH_KEY_INLINE = 1024;
+
 private:
-  typedef Trie<url_mapping> UrlMappingTrie;
-
-  struct UrlMappingTrieKey {
-    int scheme_wks_idx;
-    int port;
-
-    UrlMappingTrieKey(int idx, int p)
-      : scheme_wks_idx(idx), port(p)
-    { }
-    
-    bool operator <(const UrlMappingTrieKey &rhs) const {
-      if (scheme_wks_idx == rhs.scheme_wks_idx) {
-        return (port < rhs.port);
-      }
-      return (scheme_wks_idx < rhs.scheme_wks_idx);
-    }
-  };
+  typedef RadixTree<url_mapping> UrlMappingRadix;
 
-  typedef std::map<UrlMappingTrieKey, UrlMappingTrie *> UrlMappingGroup;
-  UrlMappingGroup m_tries;
+  UrlMappingRadix m_radix;
+  Queue<url_mapping> m_pending;         // inserted but not yet built
+  Queue<url_mapping> m_mappings;        // owned, indexed by m_radix
+  int m_first_group;                    // lowest group key, for searches without a host
+  uint64_t m_signature;
+  uint64_t m_rank_signature;
+  bool m_reusable;
 
   // make copy-constructor and assignment operator private
   // till we properly implement them
   UrlMappingPathIndex(const UrlMappingPathIndex &rhs) { NOWARN_UNUSED(rhs); };
   UrlMappingPathIndex &operator =(const UrlMappingPathIndex &rhs) { NOWARN_UNUSED(rhs); return *this; }
 
-  inline UrlMappingTrie *
-  _GetTrie(URL *url, int &idx, int port, bool search = true) const {
-    idx = url->scheme_get_wksidx();
+  static inline int
+  _GroupKey(URL *url, int port) {
+    int idx = url->scheme_get_wksidx();
     // If the scheme is empty (e.g. because of a CONNECT method), guess it
     // based on port
     if (idx == -1) {
@@ -81,17 +94,14 @@ private:
             idx = URL_WKSIDX_HTTPS;
         }
     }
-    UrlMappingGroup::const_iterator group_iter;
-    if (search) { // normal search
-      group_iter = m_tries.find(UrlMappingTrieKey(idx, port));
-    } else { // return the first trie arbitrarily
-      Debug("UrlMappingPathIndex::_GetTrie", "Not performing search; will return first available trie");
-      group_iter = m_tries.begin();
-    }
-    if (group_iter != m_tries.end()) {
-      return group_iter->second;
-    }
-    return 0;
+    return ((idx & 0xff) << 16) | (port & 0xffff);
+  }
+
+  static inline void
+  _PutGroupKey(char *buf, int group) {
+    buf[0] = (char) (group >> 16);
+    buf[1] = (char) (group >> 8);
+    buf[2] = (char) group;
   }
 };
 
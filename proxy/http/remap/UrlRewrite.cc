@@ -35,6 +35,18 @@
 
 #include "ink_string.h"
 
+// Candidate bitmap words kept on the stack; covers 512 regex rules
+#define REGEX_INDEX_INLINE_WORDS 8
+
+// FNV-1a over one (whitespace trimmed) remap.config line
+static inline uint64_t
+remap_line_hash(uint64_t hash, const char *line)
+{
+  for (const unsigned char *p = (const unsigned char *) line; *p; ++p) {
+    hash = (hash ^ *p) * URL_MAPPING_HASH_PRIME;
+  }
+  return hash ? hash : 1;     // 0 marks synthesized mappings
+}
 
 unsigned long
 check_remap_option(char *argv[], int argc, unsigned long findmode = 0, int *_ret_idx = NULL, char **argptr = NULL)
@@ -471,16 +483,21 @@ process_filter_opt(url_mapping *mp, BUILD_TABLE_INFO *bti, char *errStrBuf, int
 //
 // CTOR / DTOR for the UrlRewrite class.
 //
-UrlRewrite::UrlRewrite(const char *file_var_in)
+UrlRewrite::UrlRewrite(const char *file_var_in, const UrlRewrite *prev)
  : nohost_rules(0), reverse_proxy(0), backdoor_enabled(0),
    mgmt_autoconf_port(0), default_to_pac(0), default_to_pac_port(0), file_var(NULL), ts_name(NULL),
    http_default_redirect_url(NULL), num_rules_forward(0), num_rules_reverse(0), num_rules_redirect_permanent(0),
-   num_rules_redirect_temporary(0), num_rules_forward_with_recv_port(0), _valid(false)
+   num_rules_redirect_temporary(0), num_rules_forward_with_recv_port(0), num_entries_reused(0),
+   num_entries_built(0), _valid(false)
 {
+  memset(_readers, 0, sizeof(_readers));
 
   forward_mappings.hash_lookup = reverse_mappings.hash_lookup =
     permanent_redirects.hash_lookup = temporary_redirects.hash_lookup = 
     forward_mappings_with_recv_port.hash_lookup = NULL;
+  forward_mappings.regex_index = reverse_mappings.regex_index =
+    permanent_redirects.regex_index = temporary_redirects.regex_index =
+    forward_mappings_with_recv_port.regex_index = NULL;
 
   char *config_file = NULL;
 
@@ -524,7 +541,7 @@ UrlRewrite::UrlRewrite(const char *file_var_in)
   ink_strlcat(config_file_path, config_file, sizeof(config_file_path));
   ats_free(config_file);
 
-  if (0 == this->BuildTable()) {
+  if (0 == this->BuildTable(prev)) {
     _valid = true;
     pcre_malloc = &ats_malloc;
     pcre_free = &ats_free;
@@ -551,6 +568,39 @@ UrlRewrite::~UrlRewrite()
   _valid = false;
 }
 
+static inline int
+reader_slot()
+{
+  EThread *t = this_ethread();
+
+  return (t && t->id >= 0) ? (t->id & (URL_REWRITE_READER_SLOTS - 1)) : 0;
+}
+
+void
+UrlRewrite::acquire()
+{
+  ink_atomic_increment(&_readers[reader_slot()].count, 1);
+}
+
+void
+UrlRewrite::release()
+{
+  // may run on another thread than acquire(); only the sum matters
+  ink_atomic_increment(&_readers[reader_slot()].count, -1);
+}
+
+bool
+UrlRewrite::in_use() const
+{
+  int64_t readers = 0;
+
+  for (int i = 0; i < URL_REWRITE_READER_SLOTS; ++i) {
+    readers += _readers[i].count;
+  }
+  ink_assert(readers >= 0);
+  return readers != 0;
+}
+
 /** Sets the reverse proxy flag. */
 void
 UrlRewrite::SetReverseFlag(int flag)
@@ -627,7 +677,10 @@ UrlRewrite::_destroyTable(InkHashTable *h_table)
     //   contained with in
     for (ht_entry = ink_hash_table_iterator_first(h_table, &ht_iter); ht_entry != NULL;) {
       item = (UrlMappingPathIndex *)ink_hash_table_entry_value(h_table, ht_entry);
-      delete item;
+      // entries may be shared with the next (or previous) table
+      if (item->refcount_dec() == 0) {
+        delete item;
+      }
       ht_entry = ink_hash_table_iterator_next(h_table, &ht_iter);
     }
     ink_hash_table_destroy(h_table);
@@ -1042,11 +1095,14 @@ UrlRewrite::_addToStore(MappingsStore &store, url_mapping *new_mapping, RegexMap
 /**
   Reads the configuration file and creates a new hash table.
 
+  If @a prev is given, host entries whose config lines are unchanged
+  are shared with @a prev instead of being indexed again.
+
   @return zero on success and non-zero on failure.
 
 */
 int
-UrlRewrite::BuildTable()
+UrlRewrite::BuildTable(const UrlRewrite *prev)
 {
   BUILD_TABLE_INFO bti;
   char *file_buf, errBuf[1024], errStrBuf[1024];
@@ -1076,6 +1132,11 @@ UrlRewrite::BuildTable()
   int length;
   int tok_count;
 
+  // Fingerprints used to match unchanged host entries against prev.
+  // Directives (filters) affect every mapping after them.
+  uint64_t directive_hash = URL_MAPPING_HASH_BASIS;
+  uint64_t line_hash;
+
   RegexMapping* reg_map;
   bool is_cur_mapping_regex;
   const char *type_id_str;
@@ -1141,6 +1202,7 @@ UrlRewrite::BuildTable()
     }
 
     Debug("url_rewrite", "[BuildTable] Parsing: \"%s\"", cur_line);
+    line_hash = remap_line_hash(directive_hash, cur_line);
 
     tok_count = whiteTok.Initialize(cur_line, SHARE_TOKS);
 
@@ -1170,6 +1232,7 @@ UrlRewrite::BuildTable()
         errStr = errStrBuf;
         goto MAP_ERROR;
       }
+      directive_hash = line_hash;
       // We skip the rest of the parsing here.
       cur_line = tokLine(NULL, &tok_state);
       ++cln;
@@ -1206,6 +1269,8 @@ UrlRewrite::BuildTable()
     }
 
     new_mapping = NEW(new url_mapping(cln));  // use line # for rank for now
+    new_mapping->line_hash = line_hash;
+    new_mapping->line_no = cln + 1;
 
     // apply filter rules if we have to
     if ((errStr = process_filter_opt(new_mapping, &bti, errStrBuf, sizeof(errStrBuf))) != NULL) {
@@ -1399,6 +1464,7 @@ UrlRewrite::BuildTable()
             u_mapping->fromURL.create(NULL);
             u_mapping->fromURL.copy(&new_mapping->fromURL);
             u_mapping->fromURL.host_set(ipb, strlen(ipb));
+            u_mapping->line_hash = line_hash;
             u_mapping->toUrl.create(NULL);
             u_mapping->toUrl.copy(&new_mapping->toUrl);
             if (bti.paramv[3] != NULL)
@@ -1549,11 +1615,90 @@ UrlRewrite::BuildTable()
     forward_mappings_with_recv_port.hash_lookup = ink_hash_table_destroy(
       forward_mappings_with_recv_port.hash_lookup);
   }
+
+  url_mapping *duplicate = NULL;
+
+  if (!FinalizeStore(forward_mappings, prev ? &prev->forward_mappings : NULL, &duplicate) ||
+      !FinalizeStore(reverse_mappings, prev ? &prev->reverse_mappings : NULL, &duplicate) ||
+      !FinalizeStore(permanent_redirects, prev ? &prev->permanent_redirects : NULL, &duplicate) ||
+      !FinalizeStore(temporary_redirects, prev ? &prev->temporary_redirects : NULL, &duplicate) ||
+      !FinalizeStore(forward_mappings_with_recv_port, prev ? &prev->forward_mappings_with_recv_port : NULL, &duplicate)) {
+    if (duplicate && duplicate->line_no > 0) {
+      snprintf(errBuf, sizeof(errBuf), "%s Unable to add mapping rule to lookup table at line %d; duplicate path",
+               modulePrefix, duplicate->line_no);
+    } else {
+      snprintf(errBuf, sizeof(errBuf), "%s Unable to add mapping rule to lookup table", modulePrefix);
+    }
+    SignalError(errBuf, alarm_already);
+    ats_free(file_buf);
+    return 4;
+  }
+  Debug("url_rewrite", "[BuildTable] %d host entries shared with the previous table, %d built",
+        num_entries_reused, num_entries_built);
+
+  _buildRegexIndex(forward_mappings);
+  _buildRegexIndex(reverse_mappings);
+  _buildRegexIndex(permanent_redirects);
+  _buildRegexIndex(temporary_redirects);
+  _buildRegexIndex(forward_mappings_with_recv_port);
   ats_free(file_buf);
 
   return 0;
 }
 
+/**
+  Indexes the host entries of @a store.  An entry whose config lines
+  match the entry of the same host in @a prev_store is replaced by
+  that entry, so unchanged hosts cost neither trie memory nor build
+  time on reload.  Mapping ranks only matter relative to regex rules,
+  so they are compared only when either store has any.
+
+  @return false if a mapping could not be indexed, with @a duplicate
+  set to the mapping whose path was already taken.
+
+*/
+bool
+UrlRewrite::FinalizeStore(MappingsStore &store, const MappingsStore *prev_store, url_mapping **duplicate)
+{
+  InkHashTableEntry *ht_entry;
+  InkHashTableIteratorState ht_iter;
+  bool rank_sensitive;
+
+  if (store.hash_lookup == NULL) {
+    return true;
+  }
+  if (prev_store && prev_store->hash_lookup == NULL) {
+    prev_store = NULL;
+  }
+  rank_sensitive = !store.regex_list.empty() || (prev_store && !prev_store->regex_list.empty());
+
+  for (ht_entry = ink_hash_table_iterator_first(store.hash_lookup, &ht_iter); ht_entry != NULL;
+       ht_entry = ink_hash_table_iterator_next(store.hash_lookup, &ht_iter)) {
+    UrlMappingPathIndex *index = (UrlMappingPathIndex *) ink_hash_table_entry_value(store.hash_lookup, ht_entry);
+    UrlMappingPathIndex *prev_index = NULL;
+
+    if (prev_store && index->Reusable() &&
+        ink_hash_table_lookup(prev_store->hash_lookup, ink_hash_table_entry_key(store.hash_lookup, ht_entry),
+                              (void **) &prev_index) &&
+        prev_index != NULL && prev_index->Signature() == index->Signature() &&
+        (!rank_sensitive || prev_index->RankSignature() == index->RankSignature())) {
+      prev_index->refcount_inc();
+      ink_hash_table_set_entry(store.hash_lookup, ht_entry, prev_index);
+      if (index->refcount_dec() == 0) {
+        delete index;
+      }
+      ++num_entries_reused;
+      continue;
+    }
+
+    if (!index->Build(duplicate)) {
+      return false;
+    }
+    ++num_entries_built;
+  }
+  return true;
+}
+
 /**
   Inserts arg mapping in h_table with key src_host chaining the mapping
   of existing entries bound to src_host if necessary.
@@ -1579,6 +1724,7 @@ UrlRewrite::TableInsert(InkHashTable *h_table, url_mapping *mapping, const char
     }
   } else {
     ht_contents = new UrlMappingPathIndex();
+    ht_contents->refcount_inc();
     ink_hash_table_insert(h_table, src_host, ht_contents);
   }
   if (!ht_contents->Insert(mapping)) {
@@ -1703,7 +1849,9 @@ UrlRewrite::load_remap_plugin(char *argv[], int argc, url_mapping *mp, char *err
       Warning("Failed to initialize plugin %s (non-zero retval) ... bailing out", pi->path);
       return -5;
     }
-    Debug("remap_plugin", "Remap plugin \"%s\" - initialization completed", c);
+    pi->synchronous = (ri.flags & TSREMAP_FLAG_SYNC) != 0;
+    Debug("remap_plugin", "Remap plugin \"%s\" - initialization completed%s", c,
+          pi->synchronous ? " (synchronous)" : "");
   }
 
   if (!pi->dlh) {
@@ -1810,7 +1958,7 @@ UrlRewrite::_mappingLookup(MappingsStore &mappings, URL *request_url,
     mapping_container.set(mapping);
     retval = true;
   }
-  if (_regexMappingLookup(mappings.regex_list, request_url, request_port, request_host_lower, request_host_len,
+  if (_regexMappingLookup(mappings.regex_list, mappings.regex_index, request_url, request_port, request_host_lower, request_host_len,
                           rank_ceiling, mapping_container)) {
     Debug("url_rewrite", "Using regex mapping with rank %d", (mapping_container.getMapping())->getRank());
     retval = true;
@@ -1868,12 +2016,16 @@ UrlRewrite::_expandSubstitutions(int *matches_info, const RegexMapping *reg_map,
 }
 
 bool
-UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_url, int request_port,
-                                const char *request_host, int request_host_len, int rank_ceiling,
-                                UrlMappingContainer &mapping_container)
+UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, const RegexMappingIndex *regex_index,
+                                URL *request_url, int request_port, const char *request_host, int request_host_len,
+                                int rank_ceiling, UrlMappingContainer &mapping_container)
 {
   bool retval = false;
 
+  if (regex_mappings.empty()) {
+    return false;
+  }
+
   if (rank_ceiling == -1) { // we will now look at all regex mappings
     rank_ceiling = INT_MAX;
     Debug("url_rewrite_regex", "Going to match all regexes");
@@ -1888,14 +2040,35 @@ UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_u
   int request_path_len, reg_map_path_len;
   const char *request_path = request_url->path_get(&request_path_len), *reg_map_path;
 
+  // One pass of the literal prefilter over the host tells us which rules
+  // can possibly match; only those are handed to pcre_exec() below.
+  uint64_t candidates_buf[REGEX_INDEX_INLINE_WORDS];
+  uint64_t *candidates = NULL;
+  int rule_id = -1;
+  int64_t rules_evaluated = 0, rules_skipped = 0;
+
+  if (regex_index) {
+    candidates = candidates_buf;
+    if (regex_index->BitmapWords() > REGEX_INDEX_INLINE_WORDS) {
+      candidates = (uint64_t *) ats_malloc(regex_index->BitmapWords() * sizeof(uint64_t));
+    }
+    regex_index->Candidates(request_host, request_host_len, candidates);
+  }
+
   // Loop over the entire linked list, or until we're satisfied
   forl_LL(RegexMapping, list_iter, regex_mappings) {
     int reg_map_rank = list_iter->url_map->getRank();
 
+    ++rule_id;
     if (reg_map_rank > rank_ceiling) {
       break;
     }
 
+    if (candidates && !RegexMappingIndex::IsCandidate(candidates, rule_id)) {
+      ++rules_skipped;
+      continue;
+    }
+
     reg_map_scheme = list_iter->url_map->fromURL.scheme_get(&reg_map_scheme_len);
     if ((request_scheme_len != reg_map_scheme_len) ||
         strncmp(request_scheme, reg_map_scheme, request_scheme_len)) {
@@ -1920,6 +2093,7 @@ UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_u
     }
 
     int matches_info[MAX_REGEX_SUBS * 3];
+    ++rules_evaluated;
     int match_result = pcre_exec(list_iter->re, list_iter->re_extra, request_host, request_host_len,
                                  0, 0, matches_info, (sizeof(matches_info) / sizeof(int)));
     if (match_result > 0) {
@@ -1950,9 +2124,44 @@ UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_u
     }
   }
 
+  if (candidates != candidates_buf) {
+    ats_free(candidates);
+  }
+
+  RecIncrRawStat(http_rsb, NULL, (int) http_remap_regex_lookups_stat, 1);
+  RecIncrRawStat(http_rsb, NULL, (int) http_remap_regex_rules_evaluated_stat, rules_evaluated);
+  RecIncrRawStat(http_rsb, NULL, (int) http_remap_regex_rules_skipped_stat, rules_skipped);
+
   return retval;
 }
 
+/**
+  Compile the literal prefilter for the regex rules of @a store.  Rule
+  ids are assigned in list order, which is also the rank order used by
+  _regexMappingLookup().
+
+*/
+void
+UrlRewrite::_buildRegexIndex(MappingsStore &store)
+{
+  if (store.regex_list.empty()) {
+    return;
+  }
+
+  RegexMappingIndex *index = NEW(new RegexMappingIndex);
+  forl_LL(RegexMapping, list_iter, store.regex_list) {
+    int host_len;
+    const char *host = list_iter->url_map->fromURL.host_get(&host_len);
+
+    index->Insert(host, host_len);
+  }
+  index->Build();
+  Debug("url_rewrite_regex", "Built regex prefilter over %d rules", index->NumRules());
+
+  delete store.regex_index;
+  store.regex_index = index;
+}
+
 void
 UrlRewrite::_destroyList(RegexMappingList &mappings)
 {
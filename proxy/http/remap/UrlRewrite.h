@@ -25,6 +25,7 @@
 #define _URL_REWRITE_H_
 
 #include "UrlMapping.h"
+#include "RegexMappingIndex.h"
 #include "HttpTransact.h"
 
 #ifdef HAVE_PCRE_PCRE_H
@@ -63,20 +64,31 @@ enum mapping_type
 { FORWARD_MAP, REVERSE_MAP, PERMANENT_REDIRECT, TEMPORARY_REDIRECT, FORWARD_MAP_REFERER,
   FORWARD_MAP_WITH_RECV_PORT, NONE };
 
+/**
+ *
+**/
+#define URL_REWRITE_READER_SLOTS 64     // power of two
+
 /**
  *
 **/
 class UrlRewrite
 {
 public:
-  UrlRewrite(const char *file_var_in);
+  UrlRewrite(const char *file_var_in, const UrlRewrite *prev = NULL);
   ~UrlRewrite();
-  int BuildTable();
+  int BuildTable(const UrlRewrite *prev = NULL);
   mapping_type Remap_redirect(HTTPHdr * request_header, URL *redirect_url);
   bool ReverseMap(HTTPHdr *response_header);
   void SetReverseFlag(int flag);
   void Print();
   bool is_valid() const { return _valid; };
+
+  // Readers pin the table for the life of a transaction; the counts are
+  // split per thread so pinning doesn't bounce one cache line around.
+  void acquire();
+  void release();
+  bool in_use() const;
 //  private:
 
   static const int MAX_REGEX_SUBS = 10;
@@ -111,6 +123,7 @@ public:
   {
     InkHashTable *hash_lookup;
     RegexMappingList regex_list;
+    RegexMappingIndex *regex_index;     // literal prefilter over regex_list
     bool empty() { return ((hash_lookup == NULL) && regex_list.empty()); }
   };
 
@@ -119,10 +132,13 @@ public:
   url_mapping *SetupBackdoorMapping();
   void PrintStore(MappingsStore &store);
 
+  bool FinalizeStore(MappingsStore &store, const MappingsStore *prev_store, url_mapping **duplicate);
   void DestroyStore(MappingsStore &store)
   {
     _destroyTable(store.hash_lookup);
     _destroyList(store.regex_list);
+    delete store.regex_index;
+    store.regex_index = NULL;
   }
 
   bool TableInsert(InkHashTable *h_table, url_mapping *mapping, const char *src_host);
@@ -189,15 +205,27 @@ public:
   int num_rules_redirect_temporary;
   int num_rules_forward_with_recv_port;
 
+  // Host entries shared with the previous table vs. built from scratch
+  int num_entries_reused;
+  int num_entries_built;
+
 private:
   bool _valid;
+
+  struct ReaderSlot
+  {
+    volatile int64_t count;
+    char pad[64 - sizeof(int64_t)];     // one cache line per slot
+  };
+  ReaderSlot _readers[URL_REWRITE_READER_SLOTS];
   bool _mappingLookup(MappingsStore &mappings, URL *request_url, int request_port, const char *request_host,
                       int request_host_len, UrlMappingContainer &mapping_container);
   url_mapping *_tableLookup(InkHashTable * h_table, URL * request_url, int request_port, char *request_host,
                             int request_host_len);
-  bool _regexMappingLookup(RegexMappingList &regex_mappings, URL * request_url, int request_port, const char *request_host,
-                           int request_host_len, int rank_ceiling,
+  bool _regexMappingLookup(RegexMappingList &regex_mappings, const RegexMappingIndex *regex_index, URL * request_url,
+                           int request_port, const char *request_host, int request_host_len, int rank_ceiling,
                            UrlMappingContainer &mapping_container);
+  void _buildRegexIndex(MappingsStore &store);
   int _expandSubstitutions(int *matches_info, const RegexMapping *reg_map, const char *matched_string, char *dest_buf,
                            int dest_buf_size);
   bool _processRegexMappingConfig(const char *from_host_lower, url_mapping *new_mapping, RegexMapping *reg_map);
@@ -42,6 +42,7 @@
 #include "LogObject.h"
 #include "LogConfig.h"
 #include "LogBuffer.h"
+#include "LogColumnar.h"
 #include "LogUtils.h"
 #include "LogSock.h"
 #include "Log.h"
@@ -86,12 +87,39 @@ static const char *USAGE_LINE = "Usage: " PROGRAM_NAME " [-o output-file | -a] [
 
 
 
+static int
+write_buffer(LogBufferHeader * header, int out_fd)
+{
+  // see if there is an alternate format request from the command
+  // line
+  //
+  char *alt_format = NULL;
+  if (squid_flag)
+    alt_format = (char *) LogFormat::squid_format;
+  if (clf_flag)
+    alt_format = (char *) LogFormat::common_format;
+  if (elf_flag)
+    alt_format = (char *) LogFormat::extended_format;
+  if (elf2_flag)
+    alt_format = (char *) LogFormat::extended2_format;
+
+  // convert the buffer to ascii entries and place onto stdout
+  //
+  if (header->fmt_fieldlist()) {
+    return LogFile::write_ascii_logbuffer(header, out_fd, ".", alt_format);
+  } else {
+    // TODO investigate why this buffer goes wonky
+  }
+  return 0;
+}
+
 static int
 process_file(int in_fd, int out_fd)
 {
   char buffer[MAX_LOGBUFFER_SIZE];
   int nread, buffer_bytes;
   unsigned bytes = 0;
+  static LogColumnarReader columnar;
 
   while (true) {
     // read the next buffer from file descriptor
@@ -110,6 +138,19 @@ process_file(int in_fd, int out_fd)
     if (!nread || nread == EOF)
       return 0;
 
+    // a block of a columnar log, which gives back the LogBuffer it
+    // was written from
+    //
+    if (header->cookie == LOG_COLUMNAR_COOKIE) {
+      LogBufferHeader *rebuilt;
+
+      if (columnar.read(in_fd, buffer, nread) < 0 || (rebuilt = columnar.decode()) == NULL) {
+        fprintf(stderr, "Bad columnar log block!\n");
+        return 1;
+      }
+      bytes += write_buffer(rebuilt, out_fd);
+      continue;
+    }
     // ensure that this is a valid logbuffer header
     //
     if (header->cookie != LOG_SEGMENT_COOKIE) {
@@ -161,26 +202,7 @@ process_file(int in_fd, int out_fd)
       fprintf(stderr, "Read too many bytes!\n");
       return 1;
     }
-    // see if there is an alternate format request from the command
-    // line
-    //
-    char *alt_format = NULL;
-    if (squid_flag)
-      alt_format = (char *) LogFormat::squid_format;
-    if (clf_flag)
-      alt_format = (char *) LogFormat::common_format;
-    if (elf_flag)
-      alt_format = (char *) LogFormat::extended_format;
-    if (elf2_flag)
-      alt_format = (char *) LogFormat::extended2_format;
-
-    // convert the buffer to ascii entries and place onto stdout
-    //
-    if (header->fmt_fieldlist()) {
-      bytes += LogFile::write_ascii_logbuffer(header, out_fd, ".", alt_format);
-    } else {
-      // TODO investigate why this buffer goes wonky
-    }
+    bytes += write_buffer(header, out_fd);
   }
 }
 
@@ -284,6 +306,7 @@ main(int /* argc ATS_UNUSED */, char *argv[])
 
   if (n_file_arguments) {
     int bin_ext_len = strlen(BINARY_LOG_OBJECT_FILENAME_EXTENSION);
+    int col_ext_len = strlen(COLUMNAR_LOG_OBJECT_FILENAME_EXTENSION);
     int ascii_ext_len = strlen(ASCII_LOG_OBJECT_FILENAME_EXTENSION);
 
     for (unsigned i = 0; i < n_file_arguments; ++i) {
@@ -297,12 +320,16 @@ main(int /* argc ATS_UNUSED */, char *argv[])
         posix_fadvise(in_fd, 0, 0, POSIX_FADV_DONTNEED);
 #endif
         if (auto_filenames) {
-          // change .blog to .log
+          // change .blog or .clog to .log
           //
           int n = strlen(file_arguments[i]);
-          int copy_len = (n >= bin_ext_len ? (strcmp(&file_arguments[i][n - bin_ext_len],
-                                                     BINARY_LOG_OBJECT_FILENAME_EXTENSION) ==
-                                              0 ? n - bin_ext_len : n) : n);
+          int copy_len = n;
+
+          if (n >= bin_ext_len && strcmp(&file_arguments[i][n - bin_ext_len], BINARY_LOG_OBJECT_FILENAME_EXTENSION) == 0)
+            copy_len = n - bin_ext_len;
+          else if (n >= col_ext_len &&
+                   strcmp(&file_arguments[i][n - col_ext_len], COLUMNAR_LOG_OBJECT_FILENAME_EXTENSION) == 0)
+            copy_len = n - col_ext_len;
 
           char *out_filename = (char *)ats_malloc(copy_len + ascii_ext_len + 1);
 
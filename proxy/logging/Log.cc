@@ -55,6 +55,7 @@
 #include "LogUtils.h"
 #include "Log.h"
 #include "LogSock.h"
+#include "LogFlushPool.h"
 #include "SimpleTokenizer.h"
 
 #include "ink_apidefs.h"
@@ -81,6 +82,7 @@ volatile unsigned long Log::flush_counter = 0;
 ink_mutex Log::flush_mutex;
 ink_cond Log::flush_cond;
 ink_thread Log::flush_thread;
+LogFlushPool *Log::flush_pool = NULL;
 
 // Collate thread stuff
 ink_mutex Log::collate_mutex;
@@ -1031,6 +1033,11 @@ Log::create_threads()
     Event *flush_event = eventProcessor.spawn_thread(flush_continuation, "[LOGGING]");
     flush_thread = flush_event->ethread->tid;
 
+    if (config->flush_threads > 1) {
+      flush_pool = NEW(new LogFlushPool);
+      flush_pool->start(config->flush_threads);
+    }
+
 #if !defined(IOCORE_LOG_COLLATION)
     // start the collation thread if we are not using iocore log collation
     //
@@ -1174,10 +1181,15 @@ Log::flush_thread_main(void *args)
   while (true) {
     buffers_flushed = 0;
 
-    buffers_flushed = config->log_object_manager.flush_buffers();
+    buffers_flushed = config->log_object_manager.flush_buffers(flush_pool);
 
     if (error_log)
-      buffers_flushed += error_log->flush_buffers();
+      buffers_flushed += error_log->flush_buffers(flush_pool);
+
+    // everything handed to the pool is written before the objects
+    // can be rolled, reconfigured or deleted
+    if (flush_pool)
+      flush_pool->drain();
 
     // config->increment_space_used(bytes_to_disk);
     // TODO: the bytes_to_disk should be set to Log
@@ -1346,7 +1358,8 @@ Log::match_logobject(LogBufferHeader * header)
     if (fmt->valid()) {
       LogFileFormat file_format =
         header->log_object_flags & LogObject::BINARY ? BINARY_LOG :
-        (header->log_object_flags & LogObject::WRITES_TO_PIPE ? ASCII_PIPE : ASCII_LOG);
+        (header->log_object_flags & LogObject::WRITES_TO_PIPE ? ASCII_PIPE :
+         (header->log_object_flags & LogObject::COLUMNAR ? COLUMNAR_LOG : ASCII_LOG));
 
       obj = NEW(new LogObject(fmt, Log::config->logfile_dir,
                               header->log_filename(), file_format, NULL,
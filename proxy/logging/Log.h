@@ -308,6 +308,7 @@ class LogFormat;
 class LogObject;
 class LogConfig;
 class TextLogObject;
+class LogFlushPool;
 
 /**
    This object exists to provide a namespace for the logging system.
@@ -397,6 +398,7 @@ public:
   static ink_cond flush_cond;
   static ink_thread flush_thread;
   static void *flush_thread_main(void *args);
+  static LogFlushPool *flush_pool;  // NULL unless flush_threads > 1
 
   // collation thread stuff
   static ink_mutex collate_mutex;
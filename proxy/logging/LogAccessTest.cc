@@ -38,8 +38,7 @@
   srandom(3) is used to seed the random number generator.
   -------------------------------------------------------------------------*/
 
-#include <assert.h>
-#include <stdio.h>
+#include "libts.h"
 #include "LogAccessTest.h"
 
 /*-------------------------------------------------------------------------
@@ -91,10 +90,15 @@ LogAccessTest::marshal_client_auth_user_name(char *buf)
 int
 LogAccessTest::marshal_client_req_text(char *buf)
 {
-  static char const* str = "GET http://www.foobar.com/ HTTP/1.0";
-  int len = LogAccess::strlen(str);
+  // laid out as LogAccessHttp does, for unmarshal_http_text
+  int len = marshal_client_req_http_method(NULL) + marshal_client_req_url(NULL) + marshal_client_req_http_version(NULL);
+
   if (buf) {
-    marshal_str(buf, str, len);
+    int offset = 0;
+    offset += marshal_client_req_http_method(&buf[offset]);
+    offset += marshal_client_req_url(&buf[offset]);
+    offset += marshal_client_req_http_version(&buf[offset]);
+    len = offset;
   }
   return len;
 }
@@ -105,11 +109,12 @@ LogAccessTest::marshal_client_req_text(char *buf)
 int
 LogAccessTest::marshal_client_req_http_method(char *buf)
 {
+  static char const* str = "GET";
+  int len = LogAccess::strlen(str);
   if (buf) {
-    int64_t val = 1;
-    marshal_int(buf, val);
+    marshal_str(buf, str, len);
   }
-  return sizeof(int64_t);
+  return len;
 }
 
 /*-------------------------------------------------------------------------
@@ -133,10 +138,10 @@ int
 LogAccessTest::marshal_client_req_http_version(char *buf)
 {
   if (buf) {
-    int64_t val = 2;
-    marshal_int(buf, val);
+    marshal_int(buf, 1);
+    marshal_int(buf + INK_MIN_ALIGN, 0);
   }
-  return sizeof(int64_t);
+  return 2 * INK_MIN_ALIGN;
 }
 
 /*-------------------------------------------------------------------------
@@ -394,3 +399,50 @@ LogAccessTest::marshal_http_header_field(char *header_symbol, char *field, char
 {
   return 0;                     // STUB
 }
+
+/*-------------------------------------------------------------------------
+  LogAccessTestSpread
+  -------------------------------------------------------------------------*/
+
+int
+LogAccessTestSpread::marshal_client_host_ip(char *buf)
+{
+  IpEndpoint ip;
+
+  ats_ip4_set(&ip, htonl(0x0a000001 + n % 200));
+  return marshal_ip(buf, &ip.sa);
+}
+
+int
+LogAccessTestSpread::marshal_client_req_url(char *buf)
+{
+  char url[128];
+  int len;
+
+  snprintf(url, sizeof(url), "http://host%u.example.com/path/%u/object%u.jpg", n % 7, n % 13, n % 61);
+  len = LogAccess::strlen(url);
+  if (buf) {
+    marshal_str(buf, url, len);
+  }
+  return len;
+}
+
+int
+LogAccessTestSpread::marshal_proxy_resp_status_code(char *buf)
+{
+  static const int64_t codes[] = { 200, 200, 200, 304, 200, 404, 206, 200, 302 };
+
+  if (buf) {
+    marshal_int(buf, codes[n % countof(codes)]);
+  }
+  return INK_MIN_ALIGN;
+}
+
+int
+LogAccessTestSpread::marshal_proxy_resp_content_len(char *buf)
+{
+  if (buf) {
+    marshal_int(buf, 1000 + (n * 7919) % 50000);
+  }
+  return INK_MIN_ALIGN;
+}
@@ -45,6 +45,11 @@ public:
   {
   }
 
+  LogEntryType entry_type()
+  {
+    return LOG_ENTRY_HTTP;
+  }
+
   //
   // client -> proxy fields
   //
@@ -52,7 +57,7 @@ public:
   virtual int marshal_client_auth_user_name(char *);    // STR
   // marshal_client_req_timestamp_sec is non-virtual!
   virtual int marshal_client_req_text(char *);  // STR
-  virtual int marshal_client_req_http_method(char *);   // INT
+  virtual int marshal_client_req_http_method(char *);   // STR
   virtual int marshal_client_req_url(char *);   // STR
   virtual int marshal_client_req_http_version(char *);  // INT
   virtual int marshal_client_req_header_len(char *);    // INT
@@ -103,4 +108,25 @@ private:
   LogAccessTest & operator=(LogAccessTest & rhs);
 };
 
+/*-------------------------------------------------------------------------
+  LogAccessTestSpread
+
+  A LogAccessTest with a spread of clients, URLs, status codes and sizes,
+  for tests that care how entries differ from each other.  Bump n between
+  entries.
+  -------------------------------------------------------------------------*/
+
+class LogAccessTestSpread:public LogAccessTest
+{
+public:
+  LogAccessTestSpread():n(0) { }
+
+  int marshal_client_host_ip(char *);
+  int marshal_client_req_url(char *);
+  int marshal_proxy_resp_status_code(char *);
+  int marshal_proxy_resp_content_len(char *);
+
+  unsigned n;
+};
+
 #endif
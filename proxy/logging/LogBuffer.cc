@@ -43,23 +43,30 @@
 #include "LogAccess.h"
 #include "LogConfig.h"
 #include "LogBuffer.h"
+#include "LogRenderProgram.h"
 #include "LogFormatType.h"
 #include "Log.h"
 
 
-struct FieldListCacheElement
+struct RenderProgramCacheElement
 {
-  LogFieldList *fieldlist;
   char *symbol_str;
+  char *printf_str;
+  LogRenderProgram *program;
 };
 
 enum
 {
-  FIELDLIST_CACHE_SIZE = 256
+  RENDER_PROGRAM_CACHE_SIZE = 256
 };
 
-FieldListCacheElement fieldlist_cache[FIELDLIST_CACHE_SIZE];
-int fieldlist_cache_entries = 0;
+// Entries are never changed once counted in render_program_cache_entries,
+// so lookups need no lock; the log flush workers may add entries
+// concurrently.
+static RenderProgramCacheElement render_program_cache[RENDER_PROGRAM_CACHE_SIZE];
+static volatile int render_program_cache_entries = 0;
+static ink_mutex render_program_cache_mutex = INK_MUTEX_INIT;
+
 vint32 LogBuffer::M_ID = 0;
 
 /*-------------------------------------------------------------------------
@@ -440,6 +447,115 @@ size_t LogBuffer::max_entry_bytes()
   return (Log::config->log_buffer_size - sizeof(LogBufferHeader));
 }
 
+/*-------------------------------------------------------------------------
+  LogBuffer::resolve_field
+
+  Unmarshal one field of an entry from read_from into the len bytes at to,
+  advancing read_from.  Non-aggregate timestamps come from the arguments,
+  not the entry.  Returns the number of bytes written, or -1 if they do
+  not fit.
+  -------------------------------------------------------------------------*/
+int
+LogBuffer::resolve_field(LogField * field, char **read_from, char *to, int len,
+                         long timestamp, long timestamp_usec, unsigned buffer_version)
+{
+  int res = -1;
+
+  // for timestamps that are not aggregates, we take the
+  // value from the function argument;  otherwise we use the
+  // unmarshaling function
+  bool non_aggregate_timestamp = false;
+
+  if (field->aggregate() == LogField::NO_AGGREGATE) {
+    char *sym = field->symbol();
+
+    if (strcmp(sym, "cqts") == 0) {
+      char *ptr = (char *) &timestamp;
+      res = LogAccess::unmarshal_int_to_str(&ptr, to, len);
+      if (buffer_version > 1) {
+        // space was reserved in read buffer; remove it
+        *read_from += INK_MIN_ALIGN;
+      }
+
+      non_aggregate_timestamp = true;
+
+    } else if (strcmp(sym, "cqth") == 0) {
+      char *ptr = (char *) &timestamp;
+      res = LogAccess::unmarshal_int_to_str_hex(&ptr, to, len);
+      if (buffer_version > 1) {
+        // space was reserved in read buffer; remove it
+        *read_from += INK_MIN_ALIGN;
+      }
+
+      non_aggregate_timestamp = true;
+
+    } else if (strcmp(sym, "cqtq") == 0) {
+      // From lib/ts
+      res = squid_timestamp_to_buf(to, len, timestamp, timestamp_usec);
+      if (res < 0)
+        res = -1;
+
+      if (buffer_version > 1) {
+        // space was reserved in read buffer; remove it
+        *read_from += INK_MIN_ALIGN;
+      }
+
+      non_aggregate_timestamp = true;
+
+    } else if (strcmp(sym, "cqtn") == 0) {
+      char *str = LogUtils::timestamp_to_netscape_str(timestamp);
+      res = (int)::strlen(str);
+      if (res < len) {
+        memcpy(to, str, res);
+      } else {
+        res = -1;
+      }
+      if (buffer_version > 1) {
+        // space was reserved in read buffer; remove it
+        *read_from += INK_MIN_ALIGN;
+      }
+
+      non_aggregate_timestamp = true;
+
+    } else if (strcmp(sym, "cqtd") == 0) {
+      char *str = LogUtils::timestamp_to_date_str(timestamp);
+      res = (int)::strlen(str);
+      if (res < len) {
+        memcpy(to, str, res);
+      } else {
+        res = -1;
+      }
+      if (buffer_version > 1) {
+        // space was reserved in read buffer; remove it
+        *read_from += INK_MIN_ALIGN;
+      }
+
+      non_aggregate_timestamp = true;
+
+    } else if (strcmp(sym, "cqtt") == 0) {
+      char *str = LogUtils::timestamp_to_time_str(timestamp);
+      res = (int)::strlen(str);
+      if (res < len) {
+        memcpy(to, str, res);
+      } else {
+        res = -1;
+      }
+      if (buffer_version > 1) {
+        // space was reserved in read buffer; remove it
+        *read_from += INK_MIN_ALIGN;
+      }
+
+      non_aggregate_timestamp = true;
+    }
+  }
+
+  if (!non_aggregate_timestamp) {
+    res = field->unmarshal(read_from, to, len);
+  }
+
+  return res;
+}
+
 /*-------------------------------------------------------------------------
   LogBuffer::resolve_custom_entry
   -------------------------------------------------------------------------*/
@@ -499,97 +615,7 @@ LogBuffer::resolve_custom_entry(LogFieldList * fieldlist,
       if (field != NULL) {
         char *to = &write_to[bytes_written];
 
-        // for timestamps that are not aggregates, we take the
-        // value from the function argument;  otherwise we use the
-        // unmarshaling function
-        bool non_aggregate_timestamp = false;
-
-        if (field->aggregate() == LogField::NO_AGGREGATE) {
-          char *sym = field->symbol();
-
-          if (strcmp(sym, "cqts") == 0) {
-            char *ptr = (char *) &timestamp;
-            res = LogAccess::unmarshal_int_to_str(&ptr, to, write_to_len - bytes_written);
-            if (buffer_version > 1) {
-              // space was reserved in read buffer; remove it
-              read_from += INK_MIN_ALIGN;
-            }
-
-            non_aggregate_timestamp = true;
-
-          } else if (strcmp(sym, "cqth") == 0) {
-            char *ptr = (char *) &timestamp;
-            res = LogAccess::unmarshal_int_to_str_hex(&ptr, to, write_to_len - bytes_written);
-            if (buffer_version > 1) {
-              // space was reserved in read buffer; remove it
-              read_from += INK_MIN_ALIGN;
-            }
-
-            non_aggregate_timestamp = true;
-
-          } else if (strcmp(sym, "cqtq") == 0) {
-            // From lib/ts
-            res = squid_timestamp_to_buf(to, write_to_len - bytes_written, timestamp, timestamp_usec);
-            if (res < 0)
-              res = -1;
-
-            if (buffer_version > 1) {
-              // space was reserved in read buffer; remove it
-              read_from += INK_MIN_ALIGN;
-            }
-
-            non_aggregate_timestamp = true;
-
-          } else if (strcmp(sym, "cqtn") == 0) {
-            char *str = LogUtils::timestamp_to_netscape_str(timestamp);
-            res = (int)::strlen(str);
-            if (res < write_to_len - bytes_written) {
-              memcpy(to, str, res);
-            } else {
-              res = -1;
-            }
-            if (buffer_version > 1) {
-              // space was reserved in read buffer; remove it
-              read_from += INK_MIN_ALIGN;
-            }
-
-            non_aggregate_timestamp = true;
-
-          } else if (strcmp(sym, "cqtd") == 0) {
-            char *str = LogUtils::timestamp_to_date_str(timestamp);
-            res = (int)::strlen(str);
-            if (res < write_to_len - bytes_written) {
-              memcpy(to, str, res);
-            } else {
-              res = -1;
-            }
-            if (buffer_version > 1) {
-              // space was reserved in read buffer; remove it
-              read_from += INK_MIN_ALIGN;
-            }
-
-            non_aggregate_timestamp = true;
-
-          } else if (strcmp(sym, "cqtt") == 0) {
-            char *str = LogUtils::timestamp_to_time_str(timestamp);
-            res = (int)::strlen(str);
-            if (res < write_to_len - bytes_written) {
-              memcpy(to, str, res);
-            } else {
-              res = -1;
-            }
-            if (buffer_version > 1) {
-              // space was reserved in read buffer; remove it
-              read_from += INK_MIN_ALIGN;
-            }
-
-            non_aggregate_timestamp = true;
-          }
-        }
-
-        if (!non_aggregate_timestamp) {
-          res = field->unmarshal(&read_from, to, write_to_len - bytes_written);
-        }
+        res = resolve_field(field, &read_from, to, write_to_len - bytes_written, timestamp, timestamp_usec, buffer_version);
 
         if (res < 0) {
           Note("%s", buffer_size_exceeded_msg);
@@ -619,6 +645,53 @@ LogBuffer::resolve_custom_entry(LogFieldList * fieldlist,
   return bytes_written;
 }
 
+/*-------------------------------------------------------------------------
+  LogBuffer::render_program
+
+  Return the cached render program for the given symbol and printf
+  strings, compiling it on first use.  Returns NULL if the cache is full;
+  the caller then has to fall back on to_ascii().
+  -------------------------------------------------------------------------*/
+LogRenderProgram *
+LogBuffer::render_program(const char *symbol_str, const char *printf_str)
+{
+  int i;
+  int n_cached = render_program_cache_entries;
+  LogRenderProgram *program = NULL;
+
+  if (symbol_str == NULL || printf_str == NULL)
+    return NULL;
+
+  for (i = 0; i < n_cached; i++) {
+    if (strcmp(symbol_str, render_program_cache[i].symbol_str) == 0 &&
+        strcmp(printf_str, render_program_cache[i].printf_str) == 0) {
+      return render_program_cache[i].program;
+    }
+  }
+
+  ink_mutex_acquire(&render_program_cache_mutex);
+  // another thread may have added it since we looked
+  for (; i < render_program_cache_entries; i++) {
+    if (strcmp(symbol_str, render_program_cache[i].symbol_str) == 0 &&
+        strcmp(printf_str, render_program_cache[i].printf_str) == 0) {
+      program = render_program_cache[i].program;
+      break;
+    }
+  }
+  if (!program && render_program_cache_entries < RENDER_PROGRAM_CACHE_SIZE) {
+    Debug("log-fieldlist", "Render program for %s cached as entry %d", symbol_str, render_program_cache_entries);
+    program = NEW(new LogRenderProgram(symbol_str, printf_str));
+    render_program_cache[render_program_cache_entries].symbol_str = ats_strdup(symbol_str);
+    render_program_cache[render_program_cache_entries].printf_str = ats_strdup(printf_str);
+    render_program_cache[render_program_cache_entries].program = program;
+    // publish the entry only once it is complete
+    ink_atomic_increment(&render_program_cache_entries, 1);
+  }
+  ink_mutex_release(&render_program_cache_mutex);
+
+  return program;
+}
+
 /*-------------------------------------------------------------------------
   LogBuffer::to_ascii
 
@@ -656,34 +729,26 @@ LogBuffer::to_ascii(LogEntryHeader * entry, LogFormatType type,
   // buffer since we get it from the buffer header.
   //
   // We want to cache the unmarshaling "plans" so that we don't have to
-  // re-create them each time.  We can use the symbol string as a key to
-  // these stored plans.
+  // re-create them each time.  We can use the symbol and printf strings
+  // as a key to these stored plans.
   //
 
-  int i;
-  LogFieldList *fieldlist = NULL;
+  if (symbol_str == NULL || printf_str == NULL)
+    return 0;
 
-  for (i = 0; i < fieldlist_cache_entries; i++) {
-    if (strcmp(symbol_str, fieldlist_cache[i].symbol_str) == 0) {
-      Debug("log-fieldlist", "Fieldlist for %s found in cache, #%d", symbol_str, i);
-      fieldlist = fieldlist_cache[i].fieldlist;
-      break;
-    }
+  LogRenderProgram *program = render_program(symbol_str, printf_str);
+  bool cached = (program != NULL);
+
+  if (!cached) {
+    program = NEW(new LogRenderProgram(symbol_str, printf_str));
   }
+  if (!alt_format) {
+    int ret = program->render(entry, buf, buf_len, buffer_version);
 
-  if (!fieldlist) {
-    Debug("log-fieldlist", "Fieldlist for %s not found; creating ...", symbol_str);
-    fieldlist = NEW(new LogFieldList);
-    ink_assert(fieldlist != NULL);
-    bool contains_aggregates = false;
-    LogFormat::parse_symbol_string(symbol_str, fieldlist, &contains_aggregates);
-
-    if (fieldlist_cache_entries < FIELDLIST_CACHE_SIZE) {
-      Debug("log-fieldlist", "Fieldlist cached as entry %d", fieldlist_cache_entries);
-      fieldlist_cache[fieldlist_cache_entries].fieldlist = fieldlist;
-      fieldlist_cache[fieldlist_cache_entries].symbol_str = ats_strdup(symbol_str);
-      fieldlist_cache_entries++;
+    if (!cached) {
+      delete program;
     }
+    return ret;
   }
 
   LogFieldList *alt_fieldlist = NULL;
@@ -720,7 +785,7 @@ LogBuffer::to_ascii(LogEntryHeader * entry, LogFormatType type,
     alt_symbol_str = NULL;
   }
 
-  int ret = resolve_custom_entry(fieldlist, printf_str,
+  int ret = resolve_custom_entry(program->fieldlist(), printf_str,
                                  read_from, write_to, buf_len, entry->timestamp,
                                  entry->timestamp_usec, buffer_version,
                                  alt_fieldlist, alt_printf_str);
@@ -728,6 +793,9 @@ LogBuffer::to_ascii(LogEntryHeader * entry, LogFormatType type,
   delete alt_fieldlist;
   ats_free(alt_printf_str);
   ats_free(alt_symbol_str);
+  if (!cached) {
+    delete program;
+  }
 
   return ret;
 }
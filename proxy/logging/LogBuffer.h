@@ -33,6 +33,7 @@
 
 class LogObject;
 class LogBufferIterator;
+class LogRenderProgram;
 
 #define LOG_SEGMENT_COOKIE 0xaceface
 #define LOG_SEGMENT_VERSION 2
@@ -197,12 +198,16 @@ public:
       LogEntryHeader * entry, LogFormatType type,
       char *buf, int max_len, char *symbol_str, char *printf_str,
       unsigned buffer_version, char *alt_format = NULL);
+  static LogRenderProgram *render_program(const char *symbol_str, const char *printf_str);
   static int resolve_custom_entry(
       LogFieldList * fieldlist,
       char *printf_str, char *read_from, char *write_to,
       int write_to_len, long timestamp, long timestamp_us,
       unsigned buffer_version, LogFieldList * alt_fieldlist = NULL,
       char *alt_printf_str = NULL);
+  static int resolve_field(
+      LogField * field, char **read_from, char *to, int len,
+      long timestamp, long timestamp_usec, unsigned buffer_version);
 
 private:
   char *m_unaligned_buffer;     // the unaligned buffer
@@ -48,6 +48,7 @@
 #include "Log.h"
 
 #include "LogCollationClientSM.h"
+#include "LogCollationCodec.h"
 
 //-------------------------------------------------------------------------
 // statics
@@ -71,7 +72,9 @@ LogCollationClientSM::LogCollationClientSM(LogHost * log_host):
   m_pending_event(NULL),
   m_abort_vio(NULL),
   m_abort_buffer(NULL),
-  m_buffer_send_list(NULL), m_buffer_in_iocore(NULL), m_flow(LOG_COLL_FLOW_ALLOW), m_log_host(log_host), m_id(ID++)
+  m_buffer_send_list(NULL), m_flow(LOG_COLL_FLOW_ALLOW), m_deflater(NULL),
+  m_window(NULL), m_window_size(Log::config->collation_window), m_window_head(0), m_window_count(0), m_window_end(0),
+  m_log_host(log_host), m_id(ID++)
 {
   Debug("log-coll", "[%d]client::constructor", m_id);
 
@@ -82,6 +85,11 @@ LogCollationClientSM::LogCollationClientSM(LogHost * log_host):
   m_buffer_send_list = NEW(new LogBufferList());
   ink_assert(m_buffer_send_list != NULL);
 
+  if (m_window_size < 1) {
+    m_window_size = 1;
+  }
+  m_window = (WindowSlot *) ats_malloc(m_window_size * sizeof(WindowSlot));
+
   SET_HANDLER((LogCollationClientSMHandler) & LogCollationClientSM::client_handler);
   client_init(LOG_COLL_EVENT_SWITCH, NULL);
 
@@ -379,6 +387,8 @@ LogCollationClientSM::client_done(int event, void *data)
     if (m_buffer_send_list) {
       delete m_buffer_send_list;
     }
+    ats_free(m_window);
+    delete m_deflater;
 
     return EVENT_DONE;
 
@@ -604,7 +614,6 @@ LogCollationClientSM::client_open(int event, NetVConnection * net_vc)
 int
 LogCollationClientSM::client_send(int event, VIO * vio)
 {
-  ip_port_text_buffer ipb;
   NOWARN_UNUSED(vio);
   Debug("log-coll", "[%d]client::client_send", m_id);
 
@@ -621,49 +630,16 @@ LogCollationClientSM::client_send(int event, VIO * vio)
       Debug("log-coll", "[%d]client::client_send - SWITCH", m_id);
       m_client_state = LOG_COLL_CLIENT_SEND;
 
-      // get a buffer off our queue
-      ink_assert(m_buffer_send_list != NULL);
-      ink_assert(m_buffer_in_iocore == NULL);
-      if ((m_buffer_in_iocore = m_buffer_send_list->get()) == NULL) {
+      // fill a new window from our queue
+      ink_assert(m_window_count == 0);
+      m_window_end = 0;
+      int64_t bytes_to_send = fill_window();
+      if (bytes_to_send == 0) {
         return client_idle(LOG_COLL_EVENT_SWITCH, NULL);
       }
-      Debug("log-coll", "[%d]client::client_send - send_list to m_buffer_in_iocore", m_id);
-      Debug("log-coll", "[%d]client::client_send - send_list_size(%d)", m_id, m_buffer_send_list->get_size());
-
-      // enable m_flow if we're out of work to do
-      if (m_flow == LOG_COLL_FLOW_DENY && m_buffer_send_list->get_size() == 0) {
-        Debug("log-coll", "[%d]client::client_send - m_flow = ALLOW", m_id);
-        Note("[log-coll] send-queue clear; resuming collation [%s:%u]",
-             m_log_host->ip_addr().toString(ipb, sizeof ipb), m_log_host->port());
-        m_flow = LOG_COLL_FLOW_ALLOW;
-      }
-      // future work:
-      // Wrap the buffer in a io_buffer_block and send directly to
-      // do_io_write to save a memory copy.  But for now, just
-      // write the lame way.
-
-#if defined(LOG_BUFFER_TRACKING)
-      Debug("log-buftrak", "[%d]client::client_send - network write begin", m_buffer_in_iocore->header()->id);
-#endif // defined(LOG_BUFFER_TRACKING)
-
-      // prepare to send data
-      ink_assert(m_buffer_in_iocore != NULL);
-      LogBufferHeader *log_buffer_header = m_buffer_in_iocore->header();
-      ink_assert(log_buffer_header != NULL);
-      NetMsgHeader nmh;
-      int bytes_to_send = log_buffer_header->byte_count;
-      nmh.msg_bytes = bytes_to_send;
-      // TODO: We currently don't try to make the log buffers handle little vs big endian. TS-1156.
-      //m_buffer_in_iocore->convert_to_network_order();
-
-      // copy into m_send_buffer
-      ink_assert(m_send_buffer != NULL);
-      m_send_buffer->write((char *) &nmh, sizeof(NetMsgHeader));
-      m_send_buffer->write((char *) log_buffer_header, bytes_to_send);
-      bytes_to_send += sizeof(NetMsgHeader);
 
       // send m_send_buffer to iocore
-      Debug("log-coll", "[%d]client::client_send - do_io_write(%d)", m_id, bytes_to_send);
+      Debug("log-coll", "[%d]client::client_send - do_io_write(%" PRId64 ")", m_id, bytes_to_send);
       ink_assert(m_host_vc != NULL);
       m_host_vio = m_host_vc->do_io_write(this, bytes_to_send, m_send_reader);
       ink_assert(m_host_vio != NULL);
@@ -672,20 +648,25 @@ LogCollationClientSM::client_send(int event, VIO * vio)
 
   case VC_EVENT_WRITE_READY:
     Debug("log-coll", "[%d]client::client_send - WRITE_READY", m_id);
+
+    // let go of what has been written, and top the window up so the
+    // write never waits for the next event to find more work
+    ink_assert(vio == m_host_vio);
+    release_window(m_host_vio->ndone);
+    if (m_window_count < m_window_size) {
+      int64_t more = fill_window();
+      if (more > 0) {
+        Debug("log-coll", "[%d]client::client_send - WRITE_READY, %" PRId64 " more bytes", m_id, more);
+        m_host_vio->nbytes = m_window_end;
+      }
+    }
     return EVENT_CONT;
 
   case VC_EVENT_WRITE_COMPLETE:
     Debug("log-coll", "[%d]client::client_send - WRITE_COMPLETE", m_id);
 
-    ink_assert(m_buffer_in_iocore != NULL);
-#if defined(LOG_BUFFER_TRACKING)
-    Debug("log-buftrak", "[%d]client::client_send - network write complete", m_buffer_in_iocore->header()->id);
-#endif // defined(LOG_BUFFER_TRACKING)
-
-    // done with the buffer, delete it
-    Debug("log-coll", "[%d]client::client_send - m_buffer_in_iocore[%p] to delete_list", m_id, m_buffer_in_iocore);
-    delete m_buffer_in_iocore;
-    m_buffer_in_iocore = NULL;
+    // done with the buffers, delete them
+    release_window(m_window_end);
 
     // switch back to client_send
     return client_send(LOG_COLL_EVENT_SWITCH, NULL);
@@ -728,13 +709,19 @@ LogCollationClientSM::flush_to_orphan()
 {
   Debug("log-coll", "[%d]client::flush_to_orphan", m_id);
 
-  // if in middle of a write, flush buffer_in_iocore to orphan
-  if (m_buffer_in_iocore != NULL) {
-    Debug("log-coll", "[%d]client::flush_to_orphan - m_buffer_in_iocore to oprhan", m_id);
+  // if in middle of a write, flush the window to orphan
+  while (m_window_count > 0) {
+    Debug("log-coll", "[%d]client::flush_to_orphan - window to orphan", m_id);
     // TODO: We currently don't try to make the log buffers handle little vs big endian. TS-1156.
-    // m_buffer_in_iocore->convert_to_host_order();
-    m_log_host->orphan_write_and_delete(m_buffer_in_iocore);
-    m_buffer_in_iocore = NULL;
+    // m_window[m_window_head].buffer->convert_to_host_order();
+    m_log_host->orphan_write_and_delete(m_window[m_window_head].buffer);
+    m_window_head = (m_window_head + 1) % m_window_size;
+    m_window_count--;
+    LOG_SUM_GLOBAL_DYN_STAT(log_stat_collation_buffers_in_flight_stat, -1);
+  }
+  // and whatever of it iocore had not written yet
+  if (m_send_reader) {
+    m_send_reader->consume(m_send_reader->read_avail());
   }
   // flush buffers in send_list to orphan
   LogBuffer *log_buffer;
@@ -746,3 +733,462 @@ LogCollationClientSM::flush_to_orphan()
 
 }
 #endif // TS_MICRO
+
+//-------------------------------------------------------------------------
+// LogCollationClientSM::fill_window
+//
+// Move buffers from the send list into m_send_buffer, deflated if we
+// are compressing, until the window is full.  Returns the bytes added.
+//-------------------------------------------------------------------------
+
+int64_t
+LogCollationClientSM::fill_window()
+{
+  ip_port_text_buffer ipb;
+  int64_t bytes_added = 0;
+  int level = Log::config->collation_compression;
+
+  ink_assert(m_buffer_send_list != NULL);
+  ink_assert(m_send_buffer != NULL);
+
+  while (m_window_count < m_window_size) {
+    LogBuffer *log_buffer = m_buffer_send_list->get();
+    if (log_buffer == NULL) {
+      break;
+    }
+    Debug("log-coll", "[%d]client::fill_window - send_list to window", m_id);
+
+#if defined(LOG_BUFFER_TRACKING)
+    Debug("log-buftrak", "[%d]client::fill_window - network write begin", log_buffer->header()->id);
+#endif // defined(LOG_BUFFER_TRACKING)
+
+    // future work:
+    // Wrap the buffer in a io_buffer_block and send directly to
+    // do_io_write to save a memory copy.  But for now, just
+    // write the lame way.
+    LogBufferHeader *log_buffer_header = log_buffer->header();
+    ink_assert(log_buffer_header != NULL);
+    char *body = (char *) log_buffer_header;
+    int body_bytes = log_buffer_header->byte_count;
+    // TODO: We currently don't try to make the log buffers handle little vs big endian. TS-1156.
+    //log_buffer->convert_to_network_order();
+
+    if (level > 0) {
+      if (m_deflater == NULL) {
+        m_deflater = NEW(new LogCollationDeflater);
+      }
+      int deflated_bytes = m_deflater->deflate(body, body_bytes, level);
+      if (deflated_bytes > 0) {
+        body = m_deflater->body();
+        body_bytes = deflated_bytes;
+      }
+    }
+    LOG_SUM_GLOBAL_DYN_STAT(log_stat_collation_bytes_uncompressed_stat, log_buffer_header->byte_count);
+    LOG_SUM_GLOBAL_DYN_STAT(log_stat_collation_bytes_compressed_stat, body_bytes);
+
+    NetMsgHeader nmh;
+    nmh.msg_bytes = body_bytes;
+    m_send_buffer->write((char *) &nmh, sizeof(NetMsgHeader));
+    m_send_buffer->write(body, body_bytes);
+    bytes_added += sizeof(NetMsgHeader) + body_bytes;
+
+    WindowSlot *slot = &m_window[(m_window_head + m_window_count) % m_window_size];
+    slot->buffer = log_buffer;
+    slot->end = m_window_end + bytes_added;
+    m_window_count++;
+    LOG_SUM_GLOBAL_DYN_STAT(log_stat_collation_buffers_in_flight_stat, 1);
+  }
+  m_window_end += bytes_added;
+  LOG_SUM_GLOBAL_DYN_STAT(log_stat_bytes_sent_to_network_stat, bytes_added);
+
+  Debug("log-coll", "[%d]client::fill_window - window(%d) send_list_size(%d)", m_id, m_window_count,
+        m_buffer_send_list->get_size());
+
+  // enable m_flow if we're out of work to do
+  if (m_flow == LOG_COLL_FLOW_DENY && m_buffer_send_list->get_size() == 0) {
+    Debug("log-coll", "[%d]client::fill_window - m_flow = ALLOW", m_id);
+    Note("[log-coll] send-queue clear; resuming collation [%s:%u]",
+         m_log_host->ip_addr().toString(ipb, sizeof ipb), m_log_host->port());
+    m_flow = LOG_COLL_FLOW_ALLOW;
+  }
+
+  return bytes_added;
+}
+
+//-------------------------------------------------------------------------
+// LogCollationClientSM::release_window
+//
+// Delete the buffers of the window written in full once m_host_vio has
+// done bytes_done bytes.
+//-------------------------------------------------------------------------
+
+void
+LogCollationClientSM::release_window(int64_t bytes_done)
+{
+  while (m_window_count > 0 && m_window[m_window_head].end <= bytes_done) {
+    LogBuffer *log_buffer = m_window[m_window_head].buffer;
+
+#if defined(LOG_BUFFER_TRACKING)
+    Debug("log-buftrak", "[%d]client::release_window - network write complete", log_buffer->header()->id);
+#endif // defined(LOG_BUFFER_TRACKING)
+
+    Debug("log-coll", "[%d]client::release_window - buffer[%p] to delete_list", m_id, log_buffer);
+    delete log_buffer;
+    m_window_head = (m_window_head + 1) % m_window_size;
+    m_window_count--;
+    LOG_SUM_GLOBAL_DYN_STAT(log_stat_collation_buffers_in_flight_stat, -1);
+  }
+}
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+#include "LogAccessTest.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define LOG_COLLATION_TEST_BUFFERS 240
+#define LOG_COLLATION_TEST_KINDS 8      // buffer i holds (i % KINDS + 1) * 8 entries
+#define LOG_COLLATION_TEST_DEFLATE_ROUNDS 200
+
+static const struct
+{
+  const char *name;
+  int window;
+  int compression;
+} log_collation_test_phases[] = {
+  { "one at a time", 1, 0 },
+  { "window", 8, 0 },
+  { "window, deflated", 8, 1 },
+};
+
+#define LOG_COLLATION_TEST_PHASES ((int) (sizeof(log_collation_test_phases) / sizeof(log_collation_test_phases[0])))
+
+// Stands in for a collation host: takes one client on a blocking socket
+// and reads its messages, inflating them the way LogCollationHostSM does.
+struct LogCollationTestHost
+{
+  int listen_fd;
+  int fd;
+  int port;
+  ink_thread thread;
+  LogCollationInflater inflater;
+  volatile int received;        // buffers
+  volatile int finished;
+  bool authenticated;
+  int bad;                      // corrupt, or out of order
+  int64_t entries;
+  int64_t wire_bytes;           // message bodies
+  int64_t raw_bytes;
+
+  LogCollationTestHost()
+    : listen_fd(-1), fd(-1), port(0), received(0), finished(0), authenticated(false), bad(0), entries(0), wire_bytes(0),
+      raw_bytes(0)
+  { }
+
+  bool read_fully(int fd, char *buf, int64_t len)
+  {
+    while (len > 0) {
+      ssize_t n = ::read(fd, buf, len);
+      if (n <= 0) {
+        return false;
+      }
+      buf += n;
+      len -= n;
+    }
+    return true;
+  }
+
+  void run()
+  {
+    int32_t msg_bytes;          // a NetMsgHeader
+
+    fd = ::accept(listen_fd, NULL, NULL);
+    while (fd >= 0 && read_fully(fd, (char *) &msg_bytes, sizeof(msg_bytes)) && msg_bytes > 0) {
+      int64_t len = msg_bytes;
+      char *msg = new char[len];
+
+      if (!read_fully(fd, msg, len)) {
+        delete[]msg;
+        break;
+      }
+      if (!authenticated) {
+        authenticated = (len == (int64_t) strlen(Log::config->collation_secret) &&
+                         memcmp(msg, Log::config->collation_secret, len) == 0);
+        delete[]msg;
+        continue;
+      }
+      wire_bytes += len;
+
+      char *buffer = inflater.inflate(msg, &len);
+      if (buffer == NULL) {
+        bad++;
+        delete[]msg;
+      } else {
+        LogBufferHeader *h = (LogBufferHeader *) buffer;
+        if (h->cookie != LOG_SEGMENT_COOKIE || h->byte_count != len ||
+            h->entry_count != (unsigned) (received % LOG_COLLATION_TEST_KINDS + 1) * 8) {
+          bad++;
+        }
+        entries += h->entry_count;
+        raw_bytes += len;
+        delete[]buffer;
+      }
+      ink_atomic_increment(&received, 1);
+    }
+    finished = 1;
+  }
+
+  // unblocks run(), if the client never got through
+  void stop()
+  {
+    if (fd >= 0) {
+      ::shutdown(fd, SHUT_RDWR);
+    }
+    ::shutdown(listen_fd, SHUT_RDWR);
+  }
+
+  ~LogCollationTestHost()
+  {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    if (listen_fd >= 0) {
+      ::close(listen_fd);
+    }
+  }
+
+  bool start()
+  {
+    struct sockaddr_in sin;
+    socklen_t sin_len = sizeof(sin);
+
+    listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listen_fd < 0 || ::bind(listen_fd, (struct sockaddr *) &sin, sizeof(sin)) < 0 ||
+        ::listen(listen_fd, 1) < 0 || ::getsockname(listen_fd, (struct sockaddr *) &sin, &sin_len) < 0) {
+      return false;
+    }
+    port = ntohs(sin.sin_port);
+    thread = ink_thread_create(main, this);
+    return true;
+  }
+
+  static void *main(void *data)
+  {
+    ((LogCollationTestHost *) data)->run();
+    return NULL;
+  }
+};
+
+// Feeds buffers through a LogHost to a stand-in host, once per phase,
+// keeping few enough outstanding that none is orphaned.
+struct LogCollationTest: public Continuation
+{
+  RegressionTest *t;
+  int *pstatus;
+  int phase;
+  LogFormat *format;
+  LogObject *obj;
+  LogBuffer *buffers[LOG_COLLATION_TEST_KINDS];
+  LogCollationTestHost *host;
+  LogHost *log_host;
+  int sent;
+  int64_t orphaned;
+  ink_hrtime deadline;
+  int64_t wire_bytes[LOG_COLLATION_TEST_PHASES];
+  int64_t raw_bytes;
+
+  LogCollationTest(RegressionTest *_t, int *_pstatus)
+    : Continuation(new_ProxyMutex()), t(_t), pstatus(_pstatus), phase(-1), host(NULL), log_host(NULL), sent(0),
+      orphaned(0), deadline(0), raw_bytes(0)
+  {
+    LogAccessTestSpread lad;
+
+    format = NEW(new LogFormat("squid", LogFormat::squid_format));
+    obj = NEW(new LogObject(format, Log::config->logfile_dir, "log_collation_test", BINARY_LOG, NULL,
+                            LogConfig::NO_ROLLING));
+    for (int i = 0; i < LOG_COLLATION_TEST_KINDS; i++) {
+      size_t offset;
+
+      buffers[i] = NEW(new LogBuffer(obj, Log::config->log_buffer_size));
+      for (int n = 0; n < (i + 1) * 8; n++, lad.n++) {
+        if (buffers[i]->checkout_write(&offset, format->m_field_list.marshal_len(&lad)) != LogBuffer::LB_OK) {
+          break;
+        }
+        format->m_field_list.marshal(&lad, &(*buffers[i])[offset]);
+        buffers[i]->checkin_write(offset);
+      }
+      buffers[i]->update_header_data();
+    }
+    SET_HANDLER(&LogCollationTest::main_event);
+  }
+
+  ~LogCollationTest()
+  {
+    for (int i = 0; i < LOG_COLLATION_TEST_KINDS; i++) {
+      delete buffers[i];
+    }
+    delete obj;
+    delete format;
+    mutex = NULL;
+  }
+
+  bool start_phase()
+  {
+    char ipstr[] = "127.0.0.1";
+    char filename[] = "log_collation_test";
+    int window = Log::config->collation_window;
+
+    host = NEW(new LogCollationTestHost);
+    if (!host->start()) {
+      delete host;
+      host = NULL;
+      return false;
+    }
+    RecGetGlobalRawStatSum(log_rsb, log_stat_collation_buffers_orphaned_stat, &orphaned);
+    deadline = ink_get_hrtime_internal() + HRTIME_SECONDS(30);
+    sent = 0;
+
+    // the client reads its window when it is created, on the first write
+    Log::config->collation_window = log_collation_test_phases[phase].window;
+    Log::config->collation_compression = log_collation_test_phases[phase].compression;
+    log_host = NEW(new LogHost(filename, 0));
+    log_host->set_ipstr_port(ipstr, host->port);
+    feed();
+    Log::config->collation_window = window;
+    return true;
+  }
+
+  void feed()
+  {
+    while (sent < LOG_COLLATION_TEST_BUFFERS && sent - host->received < Log::config->collation_max_send_buffers - 1) {
+      log_host->write(buffers[sent % LOG_COLLATION_TEST_KINDS]);
+      sent++;
+    }
+  }
+
+  void finish_phase()
+  {
+    TestBox tb(t, pstatus);
+    int64_t now_orphaned = 0;
+
+    if (!host->finished) {
+      host->stop();
+    }
+    ink_thread_join(host->thread);
+    Log::config->collation_compression = 0;
+
+    RecGetGlobalRawStatSum(log_rsb, log_stat_collation_buffers_orphaned_stat, &now_orphaned);
+    tb.check(host->authenticated, "%s: not authenticated", log_collation_test_phases[phase].name);
+    tb.check(host->received == LOG_COLLATION_TEST_BUFFERS && host->bad == 0,
+             "%s: %d of %d buffers received, %d bad", log_collation_test_phases[phase].name, host->received,
+             LOG_COLLATION_TEST_BUFFERS, host->bad);
+    tb.check(now_orphaned == orphaned, "%s: %d buffers orphaned", log_collation_test_phases[phase].name,
+             (int) (now_orphaned - orphaned));
+    wire_bytes[phase] = host->wire_bytes;
+    raw_bytes = host->raw_bytes;
+    delete host;
+    host = NULL;
+  }
+
+  int main_event(int /* event ATS_UNUSED */, void * /* edata ATS_UNUSED */)
+  {
+    if (log_host) {
+      feed();
+      if (host->received < LOG_COLLATION_TEST_BUFFERS && ink_get_hrtime_internal() < deadline) {
+        eventProcessor.schedule_in(this, HRTIME_MSECONDS(1), ET_CALL);
+        return EVENT_DONE;
+      }
+      // closing the connection lets the stand-in go
+      delete log_host;
+      log_host = NULL;
+    }
+    if (host) {
+      if (!host->finished && ink_get_hrtime_internal() < deadline) {
+        eventProcessor.schedule_in(this, HRTIME_MSECONDS(1), ET_CALL);
+        return EVENT_DONE;
+      }
+      finish_phase();
+    }
+    if (++phase < LOG_COLLATION_TEST_PHASES) {
+      if (start_phase()) {
+        eventProcessor.schedule_in(this, HRTIME_MSECONDS(1), ET_CALL);
+        return EVENT_DONE;
+      }
+      TestBox tb(t, pstatus);
+      tb.check(false, "cannot listen for the stand-in host");
+    } else {
+      report();
+    }
+    if (*pstatus == REGRESSION_TEST_INPROGRESS)
+      *pstatus = REGRESSION_TEST_PASSED;
+    delete this;
+    return EVENT_DONE;
+  }
+
+  // also times deflating and inflating the test buffers alone
+  void report()
+  {
+    LogCollationDeflater deflater;
+    LogCollationInflater inflater;
+    ink_hrtime deflate_time = 0, inflate_time = 0;
+    int64_t rounds = (int64_t) LOG_COLLATION_TEST_DEFLATE_ROUNDS * LOG_COLLATION_TEST_KINDS;
+    int64_t raw = wire_bytes[0] ? wire_bytes[0] : 1;
+
+    for (int r = 0; r < LOG_COLLATION_TEST_DEFLATE_ROUNDS; r++) {
+      for (int i = 0; i < LOG_COLLATION_TEST_KINDS; i++) {
+        LogBufferHeader *h = buffers[i]->header();
+        ink_hrtime start = ink_get_hrtime_internal();
+        int64_t len = deflater.deflate((char *) h, h->byte_count, 1);
+        deflate_time += ink_get_hrtime_internal() - start;
+        if (len <= 0) {
+          continue;
+        }
+
+        char *msg = new char[len];
+        memcpy(msg, deflater.body(), len);
+        start = ink_get_hrtime_internal();
+        char *buffer = inflater.inflate(msg, &len);
+        inflate_time += ink_get_hrtime_internal() - start;
+        delete[](buffer ? buffer : msg);
+      }
+    }
+
+    // A body that inflates to less than a LogBufferHeader is refused
+    {
+      TestBox tb(t, pstatus);
+      char runt[sizeof(LogBufferHeader) - 1];
+      int64_t len;
+
+      memset(runt, 0, sizeof(runt));
+      len = deflater.deflate(runt, sizeof(runt), 1);
+      tb.check(len > 0, "runt buffer did not deflate");
+      if (len > 0) {
+        char *msg = new char[len];
+
+        memcpy(msg, deflater.body(), len);
+        char *buffer = inflater.inflate(msg, &len);
+        tb.check(buffer == NULL, "runt buffer was inflated");
+        delete[](buffer ? buffer : msg);
+      }
+    }
+
+    rprintf(t, "%d buffers, %d bytes: %d on the wire as is, %d deflated (%d%%)\n", LOG_COLLATION_TEST_BUFFERS,
+            (int) raw_bytes, (int) wire_bytes[0], (int) wire_bytes[2], (int) (wire_bytes[2] * 100 / raw));
+    rprintf(t, "deflate %d ns, inflate %d ns per buffer\n", (int) (deflate_time / rounds),
+            (int) (inflate_time / rounds));
+    rperf(t, "log_collation_deflated_bytes_ratio", (double) wire_bytes[2] / raw);
+    rperf(t, "log_collation_deflate_ns_per_buffer", (double) deflate_time / rounds);
+    rperf(t, "log_collation_inflate_ns_per_buffer", (double) inflate_time / rounds);
+  }
+};
+
+REGRESSION_TEST(LogCollation_Window)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  eventProcessor.schedule_imm(NEW(new LogCollationTest(t, pstatus)), ET_CALL);
+}
+#endif /* TS_HAS_TESTS */
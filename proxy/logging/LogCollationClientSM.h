@@ -39,6 +39,7 @@
 
 class LogBuffer;
 class LogHost;
+class LogCollationDeflater;
 
 //-------------------------------------------------------------------------
 // LogCollationClientSM
@@ -94,6 +95,8 @@ private:
 
   // support functions
   void flush_to_orphan();
+  int64_t fill_window();
+  void release_window(int64_t bytes_done);
 
   // iocore stuff (two buffers to avoid races)
   NetVConnection *m_host_vc;
@@ -111,8 +114,21 @@ private:
 
   // send stuff
   LogBufferList *m_buffer_send_list;
-  LogBuffer *m_buffer_in_iocore;
   ClientFlowControl m_flow;
+  LogCollationDeflater *m_deflater;     // NULL unless compressing
+
+  // buffers handed to iocore and not yet written, oldest first; each
+  // is kept until m_host_vio is done with its last byte
+  struct WindowSlot
+  {
+    LogBuffer *buffer;
+    int64_t end;                // in m_host_vio
+  };
+  WindowSlot *m_window;
+  int m_window_size;
+  int m_window_head;
+  int m_window_count;
+  int64_t m_window_end;         // bytes queued to m_host_vio
 
   // back pointer to LogHost container
   LogHost *m_log_host;
@@ -0,0 +1,177 @@
+/** @file
+
+  Compression of the LogBuffers sent to a collation host
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+#include "LogCollationCodec.h"
+#include "LogBuffer.h"
+
+#if TS_HAS_LIBZ
+#include <zlib.h>
+#endif
+
+// Log buffers are a few tens of KB at most; a 16 KB window compresses
+// them about as well as the default, and resets in a fraction of the time.
+#define LOG_COLLATION_DEFLATE_WINDOW_BITS 14
+#define LOG_COLLATION_DEFLATE_MEM_LEVEL 6
+
+// refuse to inflate a body claiming more than this
+#define LOG_COLLATION_MAX_BUFFER (64 * 1024 * 1024)
+
+/*-------------------------------------------------------------------------
+  LogCollationDeflater
+  -------------------------------------------------------------------------*/
+
+LogCollationDeflater::LogCollationDeflater()
+  : m_stream(NULL), m_level(0), m_body(NULL), m_body_size(0)
+{
+}
+
+LogCollationDeflater::~LogCollationDeflater()
+{
+#if TS_HAS_LIBZ
+  if (m_stream) {
+    deflateEnd((z_stream *) m_stream);
+    ats_free(m_stream);
+  }
+#endif
+  ats_free(m_body);
+}
+
+int
+LogCollationDeflater::deflate(const char *data, int len, int level)
+{
+#if TS_HAS_LIBZ
+  z_stream *z = (z_stream *) m_stream;
+
+  if (z && level != m_level) {
+    deflateEnd(z);
+    ats_free(z);
+    z = NULL;
+  }
+  if (z == NULL) {
+    z = (z_stream *) ats_malloc(sizeof(z_stream));
+    memset(z, 0, sizeof(z_stream));
+    if (deflateInit2(z, level, Z_DEFLATED, LOG_COLLATION_DEFLATE_WINDOW_BITS, LOG_COLLATION_DEFLATE_MEM_LEVEL,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      ats_free(z);
+      m_stream = NULL;
+      return 0;
+    }
+    m_stream = z;
+    m_level = level;
+  }
+
+  int size = (int) (sizeof(LogCollationDeflateHeader) + deflateBound(z, len));
+
+  if (size > m_body_size) {
+    m_body = (char *) ats_realloc(m_body, size);
+    m_body_size = size;
+  }
+
+  LogCollationDeflateHeader *h = (LogCollationDeflateHeader *) m_body;
+
+  h->cookie = LOG_COLLATION_DEFLATE_COOKIE;
+  h->raw_bytes = len;
+
+  deflateReset(z);
+  z->next_in = (Bytef *) data;
+  z->avail_in = len;
+  z->next_out = (Bytef *) (m_body + sizeof(LogCollationDeflateHeader));
+  z->avail_out = size - sizeof(LogCollationDeflateHeader);
+  if (::deflate(z, Z_FINISH) == Z_STREAM_END && sizeof(LogCollationDeflateHeader) + z->total_out < (uLong) len) {
+    return (int) (sizeof(LogCollationDeflateHeader) + z->total_out);
+  }
+#else
+  NOWARN_UNUSED(data);
+  NOWARN_UNUSED(len);
+  NOWARN_UNUSED(level);
+#endif
+  return 0;
+}
+
+/*-------------------------------------------------------------------------
+  LogCollationInflater
+  -------------------------------------------------------------------------*/
+
+LogCollationInflater::LogCollationInflater()
+  : m_stream(NULL)
+{
+}
+
+LogCollationInflater::~LogCollationInflater()
+{
+#if TS_HAS_LIBZ
+  if (m_stream) {
+    inflateEnd((z_stream *) m_stream);
+    ats_free(m_stream);
+  }
+#endif
+}
+
+char *
+LogCollationInflater::inflate(char *msg, int64_t *len)
+{
+  if (*len < (int64_t) sizeof(LogCollationDeflateHeader)) {
+    return NULL;
+  }
+
+  LogCollationDeflateHeader *h = (LogCollationDeflateHeader *) msg;
+
+  if (h->cookie != LOG_COLLATION_DEFLATE_COOKIE) {
+    return msg;
+  }
+  // Anything shorter could not even hold the LogBufferHeader
+  if (h->raw_bytes < sizeof(LogBufferHeader) || h->raw_bytes > LOG_COLLATION_MAX_BUFFER) {
+    return NULL;
+  }
+#if TS_HAS_LIBZ
+  z_stream *z = (z_stream *) m_stream;
+
+  if (z == NULL) {
+    z = (z_stream *) ats_malloc(sizeof(z_stream));
+    memset(z, 0, sizeof(z_stream));
+    if (inflateInit2(z, LOG_COLLATION_DEFLATE_WINDOW_BITS) != Z_OK) {
+      ats_free(z);
+      return NULL;
+    }
+    m_stream = z;
+  }
+
+  char *buffer = new char[h->raw_bytes];
+
+  inflateReset(z);
+  z->next_in = (Bytef *) (msg + sizeof(LogCollationDeflateHeader));
+  z->avail_in = *len - sizeof(LogCollationDeflateHeader);
+  z->next_out = (Bytef *) buffer;
+  z->avail_out = h->raw_bytes;
+  if (::inflate(z, Z_FINISH) != Z_STREAM_END || z->total_out != h->raw_bytes) {
+    delete[]buffer;
+    return NULL;
+  }
+  *len = h->raw_bytes;
+  delete[]msg;
+  return buffer;
+#else
+  return NULL;
+#endif
+}
@@ -0,0 +1,108 @@
+/** @file
+
+  Compression of the LogBuffers sent to a collation host
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+   LogCollationCodec.h
+
+   Description:
+     With proxy.config.log.collation_compression set, a collation client
+     deflates each LogBuffer on its own, and the message body it sends
+     is a LogCollationDeflateHeader followed by the deflated buffer.  A
+     body that does not start with LOG_COLLATION_DEFLATE_COOKIE is a
+     plain LogBuffer, so a host takes both, and buffers that do not
+     shrink are sent as they are.
+
+ ****************************************************************************/
+
+#ifndef LOG_COLLATION_CODEC_H
+#define LOG_COLLATION_CODEC_H
+
+#include "libts.h"
+
+#define LOG_COLLATION_DEFLATE_COOKIE 0xdef1a7e
+
+// in the place of the LogBufferHeader cookie
+struct LogCollationDeflateHeader
+{
+  uint32_t cookie;
+  uint32_t raw_bytes;           // of the LogBuffer
+};
+
+/*-------------------------------------------------------------------------
+  LogCollationDeflater
+
+  Not thread safe; each collation client has its own.
+  -------------------------------------------------------------------------*/
+
+class LogCollationDeflater
+{
+public:
+  LogCollationDeflater();
+  ~LogCollationDeflater();
+
+  /** Deflate the @a len bytes of LogBuffer at @a data, at zlib @a level,
+      into a message body at body().  @return the body length, or 0 if
+      the buffer is better sent as is.
+  */
+  int deflate(const char *data, int len, int level);
+  char *body() { return m_body; }
+
+private:
+  void *m_stream;               // z_stream, kept from buffer to buffer
+  int m_level;
+  char *m_body;
+  int m_body_size;
+
+  // -- member functions not allowed --
+  LogCollationDeflater(const LogCollationDeflater &);
+  LogCollationDeflater & operator=(const LogCollationDeflater &);
+};
+
+/*-------------------------------------------------------------------------
+  LogCollationInflater
+  -------------------------------------------------------------------------*/
+
+class LogCollationInflater
+{
+public:
+  LogCollationInflater();
+  ~LogCollationInflater();
+
+  /** Turn the message body @a msg of @a *len bytes, allocated with
+      new char[], into a LogBuffer.  A deflated body is inflated into a
+      new char[], @a msg is deleted and @a *len updated.  @return the
+      LogBuffer, or NULL if the body is corrupt, in which case @a msg
+      is left to the caller.
+  */
+  char *inflate(char *msg, int64_t * len);
+
+private:
+  void *m_stream;               // z_stream
+
+  // -- member functions not allowed --
+  LogCollationInflater(const LogCollationInflater &);
+  LogCollationInflater & operator=(const LogCollationInflater &);
+};
+
+#endif
@@ -298,6 +298,17 @@ LogCollationHostSM::host_recv(int event, void *data)
       unsigned version;
 
       ink_assert(m_read_buffer != NULL);
+
+      // inflate it if the client compressed it
+      char *buffer = m_inflater.inflate(m_read_buffer, &m_read_bytes_received);
+      if (buffer == NULL) {
+        Note("[log-coll] invalid LogBuffer received; cannot inflate");
+        delete[]m_read_buffer;
+        m_read_buffer = 0;
+        return host_recv(LOG_COLL_EVENT_SWITCH, NULL);
+      }
+      m_read_buffer = buffer;
+
       ink_assert(m_read_bytes_received >= (int64_t)sizeof(LogBufferHeader));
       log_buffer_header = (LogBufferHeader *) m_read_buffer;
 
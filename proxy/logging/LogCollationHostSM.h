@@ -30,6 +30,7 @@
 
 #include "P_EventSystem.h"
 #include "LogCollationBase.h"
+#include "LogCollationCodec.h"
 
 //-------------------------------------------------------------------------
 // pre-declarations
@@ -101,6 +102,7 @@ private:
   char *m_read_buffer;
   int64_t m_read_bytes_wanted;
   int64_t m_read_bytes_received;
+  LogCollationInflater m_inflater;
 
   // client info
   int m_client_ip;
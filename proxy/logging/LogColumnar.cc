@@ -0,0 +1,1163 @@
+/** @file
+
+  Columnar log files
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+#include "Error.h"
+#include "LogAccess.h"
+#include "LogField.h"
+#include "LogFormat.h"
+#include "LogBuffer.h"
+#include "LogLimits.h"
+#include "LogColumnar.h"
+
+#if TS_HAS_LIBZ
+#include <zlib.h>
+#endif
+
+// chunks smaller than this are not worth deflating
+#define LOG_COLUMNAR_MIN_DEFLATE 64
+
+// A chunk is a few KB at most; a small window and hash table keep
+// deflateReset() from clearing far more memory than it compresses.
+#define LOG_COLUMNAR_DEFLATE_WINDOW_BITS 12
+#define LOG_COLUMNAR_DEFLATE_MEM_LEVEL 2
+
+static inline uint64_t
+zigzag(int64_t v)
+{
+  return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static inline int64_t
+unzigzag(uint64_t u)
+{
+  return (int64_t) ((u >> 1) ^ (~(u & 1) + 1));
+}
+
+static inline int
+varint_len(uint64_t v)
+{
+  int n = 1;
+
+  while (v >= 0x80) {
+    v >>= 7;
+    ++n;
+  }
+  return n;
+}
+
+static inline void
+put_varint(LogColumnarBuffer *b, uint64_t v)
+{
+  char *p = b->reserve(10);
+  char *start = p;
+
+  while (v >= 0x80) {
+    *p++ = (char) (v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (char) v;
+  b->len += p - start;
+}
+
+static inline bool
+get_varint(const char **p, const char *end, uint64_t *v)
+{
+  uint64_t result = 0;
+
+  for (int shift = 0; *p < end && shift < 64; shift += 7) {
+    uint8_t c = (uint8_t) *(*p)++;
+
+    result |= (uint64_t) (c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      *v = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+static inline uint32_t
+hash_bytes(const char *p, uint32_t len)
+{
+  uint32_t h = 2166136261U;     // FNV-1a
+
+  for (uint32_t i = 0; i < len; i++) {
+    h = (h ^ (uint8_t) p[i]) * 16777619U;
+  }
+  return h;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnarWriter
+  -------------------------------------------------------------------------*/
+
+LogColumnarWriter::LogColumnarWriter()
+  : m_symbol_str(NULL), m_fieldlist(NULL), m_fields(NULL), m_field_is_int(NULL), m_num_fields(0),
+    m_scratch(NULL), m_max_entries(0), m_entries(NULL), m_value_ptrs(NULL), m_value_lens(NULL),
+    m_ints(NULL), m_ptrs(NULL), m_lens(NULL), m_dict_slots_size(0), m_dict_slots(NULL),
+    m_dict_first(NULL), m_dict_hash(NULL), m_dict_index(NULL), m_dict_size(0), m_deflate(NULL)
+{
+}
+
+LogColumnarWriter::~LogColumnarWriter()
+{
+  ats_free(m_symbol_str);
+  delete m_fieldlist;
+  ats_free(m_fields);
+  ats_free(m_field_is_int);
+  ats_free(m_scratch);
+  ats_free(m_entries);
+  ats_free(m_value_ptrs);
+  ats_free(m_value_lens);
+  ats_free(m_ints);
+  ats_free(m_ptrs);
+  ats_free(m_lens);
+  ats_free(m_dict_slots);
+  ats_free(m_dict_first);
+  ats_free(m_dict_hash);
+  ats_free(m_dict_index);
+#if TS_HAS_LIBZ
+  if (m_deflate) {
+    deflateEnd((z_stream *) m_deflate);
+    ats_free(m_deflate);
+  }
+#endif
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnarWriter::set_fieldlist
+
+  A LogFile only ever sees one format, so the field list is parsed again
+  only if the symbol string changes.
+  -------------------------------------------------------------------------*/
+bool
+LogColumnarWriter::set_fieldlist(char *symbol_str)
+{
+  if (symbol_str == NULL) {
+    return false;
+  }
+  if (m_symbol_str && strcmp(m_symbol_str, symbol_str) == 0) {
+    return true;
+  }
+
+  bool contains_aggregates = false;
+  LogFieldList *fieldlist = NEW(new LogFieldList);
+
+  LogFormat::parse_symbol_string(symbol_str, fieldlist, &contains_aggregates);
+  delete m_fieldlist;
+  m_fieldlist = fieldlist;
+  ats_free(m_symbol_str);
+  m_symbol_str = ats_strdup(symbol_str);
+
+  m_num_fields = fieldlist->count();
+  m_fields = (LogField **) ats_realloc(m_fields, (m_num_fields + 1) * sizeof(LogField *));
+  m_field_is_int = (bool *) ats_realloc(m_field_is_int, (m_num_fields + 1) * sizeof(bool));
+
+  int f = 0;
+  for (LogField *field = fieldlist->first(); field; field = fieldlist->next(field), ++f) {
+    LogField::UnmarshalFunc unmarshal = field->unmarshal_func();
+
+    m_fields[f] = field;
+    m_field_is_int[f] = unmarshal == &LogAccess::unmarshal_int_to_str ||
+      ((field->type() == LogField::sINT || field->type() == LogField::dINT) &&
+       unmarshal != &LogAccess::unmarshal_http_version);
+  }
+
+  // the per field arrays are sized for it
+  m_max_entries = 0;
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnarWriter::field_len
+
+  Return the bytes taken by field f at p in a marshaled entry.
+  -------------------------------------------------------------------------*/
+uint32_t
+LogColumnarWriter::field_len(int f, char *p)
+{
+  if (m_field_is_int[f]) {
+    return INK_MIN_ALIGN;
+  }
+
+  LogField *field = m_fields[f];
+  char *q = p;
+
+  if (field->unmarshal_func() == &LogAccess::unmarshal_str) {
+    return LogAccess::strlen(p);
+  }
+  if (field->type() == LogField::IP) {
+    IpEndpoint ip;
+    return LogAccess::unmarshal_ip(&q, &ip);
+  }
+  // anything else: see how far its own routine reads
+  if (m_scratch == NULL) {
+    m_scratch = (char *) ats_malloc(LOG_MAX_FORMATTED_LINE);
+  }
+  field->unmarshal(&q, m_scratch, LOG_MAX_FORMATTED_LINE);
+  return q - p;
+}
+
+int
+LogColumnarWriter::build_dictionary(const char **ptrs, const uint32_t *lens, int n, int max_distinct)
+{
+  int mask = m_dict_slots_size - 1;
+
+  memset(m_dict_slots, 0, m_dict_slots_size * sizeof(int));
+  m_dict_size = 0;
+
+  for (int i = 0; i < n; i++) {
+    uint32_t h = hash_bytes(ptrs[i], lens[i]);
+    int s = h & mask;
+    int d;
+
+    while (true) {
+      d = m_dict_slots[s] - 1;
+      if (d < 0) {
+        if (m_dict_size >= max_distinct) {
+          return -1;
+        }
+        d = m_dict_size++;
+        m_dict_first[d] = i;
+        m_dict_hash[d] = h;
+        m_dict_slots[s] = d + 1;
+        break;
+      }
+
+      int first = m_dict_first[d];
+      if (m_dict_hash[d] == h && lens[first] == lens[i] && memcmp(ptrs[first], ptrs[i], lens[i]) == 0) {
+        break;
+      }
+      s = (s + 1) & mask;
+    }
+    m_dict_index[i] = d;
+  }
+  return m_dict_size;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnarWriter::add_column
+
+  Encode the n values in m_ints (integer columns) or m_ptrs and m_lens,
+  then append them to the block.
+  -------------------------------------------------------------------------*/
+void
+LogColumnarWriter::add_column(LogColumnarColumn *col, int n, bool is_int)
+{
+  int i;
+
+  m_chunk.len = 0;
+  if (is_int) {
+    uint64_t plain = 0, delta = 0, best;
+    int64_t prev = 0;
+
+    for (i = 0; i < n; i++) {
+      plain += varint_len(zigzag(m_ints[i]));
+      delta += varint_len(zigzag((int64_t) ((uint64_t) m_ints[i] - (uint64_t) prev)));
+      prev = m_ints[i];
+    }
+    col->encoding = plain <= delta ? LogColumnar::INT : LogColumnar::INT_DELTA;
+    best = plain <= delta ? plain : delta;
+
+    // an index costs at least a byte an entry, so only try if that can win
+    if ((uint64_t) n < best && build_dictionary(m_ptrs, m_lens, n, n / 4) >= 0) {
+      uint64_t dict = varint_len(m_dict_size);
+
+      for (i = 0; i < m_dict_size; i++) {
+        dict += varint_len(zigzag(m_ints[m_dict_first[i]]));
+      }
+      for (i = 0; i < n; i++) {
+        dict += varint_len(m_dict_index[i]);
+      }
+      if (dict < best) {
+        col->encoding = LogColumnar::INT_DICT;
+      }
+    }
+
+    switch (col->encoding) {
+    case LogColumnar::INT:
+      for (i = 0; i < n; i++) {
+        put_varint(&m_chunk, zigzag(m_ints[i]));
+      }
+      break;
+    case LogColumnar::INT_DELTA:
+      prev = 0;
+      for (i = 0; i < n; i++) {
+        put_varint(&m_chunk, zigzag((int64_t) ((uint64_t) m_ints[i] - (uint64_t) prev)));
+        prev = m_ints[i];
+      }
+      break;
+    default:
+      put_varint(&m_chunk, m_dict_size);
+      for (i = 0; i < m_dict_size; i++) {
+        put_varint(&m_chunk, zigzag(m_ints[m_dict_first[i]]));
+      }
+      for (i = 0; i < n; i++) {
+        put_varint(&m_chunk, m_dict_index[i]);
+      }
+      break;
+    }
+  } else if (build_dictionary(m_ptrs, m_lens, n, n / 2) >= 0) {
+    col->encoding = LogColumnar::BYTES_DICT;
+    put_varint(&m_chunk, m_dict_size);
+    for (i = 0; i < m_dict_size; i++) {
+      int first = m_dict_first[i];
+
+      put_varint(&m_chunk, m_lens[first]);
+      memcpy(m_chunk.reserve(m_lens[first]), m_ptrs[first], m_lens[first]);
+      m_chunk.len += m_lens[first];
+    }
+    for (i = 0; i < n; i++) {
+      put_varint(&m_chunk, m_dict_index[i]);
+    }
+  } else {
+    col->encoding = LogColumnar::BYTES;
+    for (i = 0; i < n; i++) {
+      put_varint(&m_chunk, m_lens[i]);
+      memcpy(m_chunk.reserve(m_lens[i]), m_ptrs[i], m_lens[i]);
+      m_chunk.len += m_lens[i];
+    }
+  }
+
+  store_chunk(col);
+}
+
+void
+LogColumnarWriter::store_chunk(LogColumnarColumn *col)
+{
+  uint32_t raw = m_chunk.len;
+
+  col->offset = m_block.len;
+  col->raw_bytes = raw;
+  col->flags = 0;
+
+#if TS_HAS_LIBZ
+  z_stream *z = (z_stream *) m_deflate;
+
+  if (z == NULL && raw >= LOG_COLUMNAR_MIN_DEFLATE) {
+    z = (z_stream *) ats_malloc(sizeof(z_stream));
+    memset(z, 0, sizeof(z_stream));
+    if (deflateInit2(z, Z_BEST_SPEED, Z_DEFLATED, LOG_COLUMNAR_DEFLATE_WINDOW_BITS, LOG_COLUMNAR_DEFLATE_MEM_LEVEL,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      ats_free(z);
+      z = NULL;
+    }
+    m_deflate = z;
+  }
+  if (z && raw >= LOG_COLUMNAR_MIN_DEFLATE) {
+    uLong bound = deflateBound(z, raw);
+    char *to = m_block.reserve(bound);
+
+    deflateReset(z);
+    z->next_in = (Bytef *) m_chunk.data;
+    z->avail_in = raw;
+    z->next_out = (Bytef *) to;
+    z->avail_out = bound;
+    if (deflate(z, Z_FINISH) == Z_STREAM_END && z->total_out < raw) {
+      col->flags = LogColumnar::DEFLATED;
+      col->stored_bytes = z->total_out;
+      m_block.len += z->total_out;
+      return;
+    }
+  }
+#endif
+
+  memcpy(m_block.reserve(raw), m_chunk.data, raw);
+  m_block.len += raw;
+  col->stored_bytes = raw;
+}
+
+int
+LogColumnarWriter::encode(LogBufferHeader *buffer)
+{
+  int n = buffer->entry_count;
+  int i, f;
+
+  if (n <= 0 || !set_fieldlist(buffer->fmt_fieldlist())) {
+    return -1;
+  }
+
+  if (n > m_max_entries) {
+    int slots = 1;
+
+    while (slots < 2 * n) {
+      slots <<= 1;
+    }
+    m_max_entries = n;
+    m_entries = (LogEntryHeader **) ats_realloc(m_entries, n * sizeof(LogEntryHeader *));
+    m_value_ptrs = (const char **) ats_realloc(m_value_ptrs, (m_num_fields + 1) * n * sizeof(char *));
+    m_value_lens = (uint32_t *) ats_realloc(m_value_lens, (m_num_fields + 1) * n * sizeof(uint32_t));
+    m_ints = (int64_t *) ats_realloc(m_ints, n * sizeof(int64_t));
+    m_ptrs = (const char **) ats_realloc(m_ptrs, n * sizeof(char *));
+    m_lens = (uint32_t *) ats_realloc(m_lens, n * sizeof(uint32_t));
+    m_dict_slots_size = slots;
+    m_dict_slots = (int *) ats_realloc(m_dict_slots, slots * sizeof(int));
+    m_dict_first = (int *) ats_realloc(m_dict_first, n * sizeof(int));
+    m_dict_hash = (uint32_t *) ats_realloc(m_dict_hash, n * sizeof(uint32_t));
+    m_dict_index = (int *) ats_realloc(m_dict_index, n * sizeof(int));
+  }
+
+  // find every field of every entry
+  LogBufferIterator iter(buffer);
+  LogEntryHeader *entry;
+  uint32_t data_bytes = 0;
+
+  for (i = 0; i < n && (entry = iter.next()); i++) {
+    char *p = (char *) entry + sizeof(LogEntryHeader);
+    char *end = (char *) entry + entry->entry_len;
+
+    m_entries[i] = entry;
+    for (f = 0; f < m_num_fields; f++) {
+      uint32_t len = field_len(f, p);
+
+      if (p + len > end) {
+        Warning("log entry does not match its format %s; not writing it as columnar", m_symbol_str);
+        return -1;
+      }
+      m_value_ptrs[f * n + i] = p;
+      m_value_lens[f * n + i] = len;
+      p += len;
+    }
+    data_bytes += INK_ALIGN(p - (char *) entry, INK_MIN_ALIGN);
+  }
+  n = i;
+
+  int num_columns = LogColumnar::FIRST_FIELD_COLUMN + m_num_fields;
+  LogColumnarColumn *columns;
+
+  m_index.len = 0;
+  columns = (LogColumnarColumn *) m_index.reserve(num_columns * sizeof(LogColumnarColumn));
+  m_index.len = num_columns * sizeof(LogColumnarColumn);
+
+  m_block.len = 0;
+  m_block.reserve(sizeof(LogColumnarBlockHeader));
+  m_block.len = sizeof(LogColumnarBlockHeader);
+  memcpy(m_block.reserve(buffer->data_offset), buffer, buffer->data_offset);
+  m_block.len += buffer->data_offset;
+
+  for (i = 0; i < n; i++) {
+    m_ints[i] = m_entries[i]->timestamp;
+    m_ptrs[i] = (const char *) &m_ints[i];
+    m_lens[i] = sizeof(int64_t);
+  }
+  add_column(&columns[LogColumnar::TIMESTAMP_COLUMN], n, true);
+  for (i = 0; i < n; i++) {
+    m_ints[i] = m_entries[i]->timestamp_usec;
+  }
+  add_column(&columns[LogColumnar::USEC_COLUMN], n, true);
+
+  for (f = 0; f < m_num_fields; f++) {
+    const char **ptrs = &m_value_ptrs[f * n];
+
+    if (m_field_is_int[f]) {
+      for (i = 0; i < n; i++) {
+        memcpy(&m_ints[i], ptrs[i], sizeof(int64_t));
+        m_ptrs[i] = (const char *) &m_ints[i];
+        m_lens[i] = sizeof(int64_t);
+      }
+    } else {
+      memcpy(m_ptrs, ptrs, n * sizeof(char *));
+      memcpy(m_lens, &m_value_lens[f * n], n * sizeof(uint32_t));
+    }
+    add_column(&columns[LogColumnar::FIRST_FIELD_COLUMN + f], n, m_field_is_int[f]);
+  }
+
+  // the index, then the trailer
+  uint32_t pad = INK_ALIGN(m_block.len, 8) - m_block.len;
+
+  memset(m_block.reserve(pad), 0, pad);
+  m_block.len += pad;
+
+  LogColumnarBlockHeader header;
+  LogColumnarTrailer trailer;
+  uint32_t footer_offset = m_block.len;
+  uint32_t block_bytes = footer_offset + m_index.len + sizeof(trailer);
+
+  memcpy(m_block.reserve(m_index.len), m_index.data, m_index.len);
+  m_block.len += m_index.len;
+
+  trailer.footer_offset = footer_offset;
+  trailer.block_bytes = block_bytes;
+  trailer.cookie = LOG_COLUMNAR_COOKIE;
+  trailer.reserved = 0;
+  memcpy(m_block.reserve(sizeof(trailer)), &trailer, sizeof(trailer));
+  m_block.len += sizeof(trailer);
+
+  header.cookie = LOG_COLUMNAR_COOKIE;
+  header.version = LOG_COLUMNAR_VERSION;
+  header.block_bytes = block_bytes;
+  header.entry_count = n;
+  header.column_count = num_columns;
+  header.low_timestamp = buffer->low_timestamp;
+  header.high_timestamp = buffer->high_timestamp;
+  header.buffer_header_bytes = buffer->data_offset;
+  header.footer_offset = footer_offset;
+  header.data_bytes = data_bytes;
+  memcpy(m_block.data, &header, sizeof(header));
+
+  ink_assert(m_block.len == block_bytes);
+  return block_bytes;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnarReader
+  -------------------------------------------------------------------------*/
+
+LogColumnarReader::LogColumnarReader()
+  : m_data(NULL), m_len(0), m_inflate(NULL), m_dict_ints(NULL), m_dict_ptrs(NULL), m_dict_lens(NULL)
+{
+  memset(&m_header, 0, sizeof(m_header));
+}
+
+LogColumnarReader::~LogColumnarReader()
+{
+#if TS_HAS_LIBZ
+  if (m_inflate) {
+    inflateEnd((z_stream *) m_inflate);
+    ats_free(m_inflate);
+  }
+#endif
+}
+
+static int
+read_fully(int fd, char *buf, int len)
+{
+  int nread = 0;
+
+  while (nread < len) {
+    int rc = ::read(fd, buf + nread, len - nread);
+
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      break;
+    }
+    nread += rc;
+  }
+  return nread;
+}
+
+int
+LogColumnarReader::read(int fd, const char *head, int head_len)
+{
+  LogColumnarBlockHeader header;
+  int header_len = sizeof(header);
+
+  ink_assert(head_len >= 0 && head_len <= header_len);
+  m_block.len = 0;
+  m_block.reserve(header_len);
+  memcpy(m_block.data, head, head_len);
+  if (read_fully(fd, m_block.data + head_len, header_len - head_len) != header_len - head_len) {
+    return -1;
+  }
+
+  memcpy(&header, m_block.data, header_len);
+  if (header.cookie != LOG_COLUMNAR_COOKIE || header.block_bytes < (uint32_t) header_len ||
+      header.block_bytes > LOG_COLUMNAR_MAX_BLOCK) {
+    return -1;
+  }
+
+  int rest = header.block_bytes - header_len;
+
+  m_block.reserve(header.block_bytes);
+  if (read_fully(fd, m_block.data + header_len, rest) != rest) {
+    return -1;
+  }
+  m_block.len = header.block_bytes;
+  return set_block(m_block.data, m_block.len) ? (int) m_block.len : -1;
+}
+
+bool
+LogColumnarReader::set_block(const char *block, int len)
+{
+  LogColumnarBlockHeader header;
+  LogColumnarTrailer trailer;
+
+  m_data = NULL;
+  m_len = 0;
+  if (len < (int) (sizeof(header) + sizeof(trailer))) {
+    return false;
+  }
+  memcpy(&header, block, sizeof(header));
+  memcpy(&trailer, block + len - sizeof(trailer), sizeof(trailer));
+
+  if (header.cookie != LOG_COLUMNAR_COOKIE || header.version != LOG_COLUMNAR_VERSION ||
+      header.block_bytes != (uint32_t) len || trailer.cookie != LOG_COLUMNAR_COOKIE ||
+      trailer.block_bytes != header.block_bytes || trailer.footer_offset != header.footer_offset ||
+      header.column_count < LogColumnar::FIRST_FIELD_COLUMN || header.column_count > LOG_COLUMNAR_MAX_BLOCK ||
+      header.entry_count > LOG_COLUMNAR_MAX_BLOCK / sizeof(LogEntryHeader) ||
+      header.buffer_header_bytes < sizeof(LogBufferHeader) ||
+      header.buffer_header_bytes > header.footer_offset - sizeof(header) ||
+      (uint64_t) header.footer_offset + header.column_count * sizeof(LogColumnarColumn) + sizeof(trailer) !=
+      header.block_bytes) {
+    return false;
+  }
+
+  m_header = header;
+  m_data = block;
+  m_len = len;
+  return true;
+}
+
+unsigned
+LogColumnarReader::entry_count() const
+{
+  return m_data ? m_header.entry_count : 0;
+}
+
+unsigned
+LogColumnarReader::column_count() const
+{
+  return m_data ? m_header.column_count : 0;
+}
+
+void
+LogColumnarReader::column(unsigned i, LogColumnarColumn *col) const
+{
+  memcpy(col, m_data + m_header.footer_offset + i * sizeof(LogColumnarColumn), sizeof(*col));
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnarReader::chunk
+
+  Return the raw bytes of a column, inflating them to inflate_to, which
+  has room for col->raw_bytes, if need be.
+  -------------------------------------------------------------------------*/
+const char *
+LogColumnarReader::chunk(const LogColumnarColumn *col, char *inflate_to)
+{
+  if (col->offset < sizeof(LogColumnarBlockHeader) + m_header.buffer_header_bytes ||
+      (uint64_t) col->offset + col->stored_bytes > m_header.footer_offset) {
+    return NULL;
+  }
+  if (!(col->flags & LogColumnar::DEFLATED)) {
+    return col->stored_bytes == col->raw_bytes ? m_data + col->offset : NULL;
+  }
+#if TS_HAS_LIBZ
+  z_stream *z = (z_stream *) m_inflate;
+
+  if (z == NULL) {
+    z = (z_stream *) ats_malloc(sizeof(z_stream));
+    memset(z, 0, sizeof(z_stream));
+    if (inflateInit(z) != Z_OK) {
+      ats_free(z);
+      return NULL;
+    }
+    m_inflate = z;
+  }
+  inflateReset(z);
+  z->next_in = (Bytef *) m_data + col->offset;
+  z->avail_in = col->stored_bytes;
+  z->next_out = (Bytef *) inflate_to;
+  z->avail_out = col->raw_bytes;
+  if (inflate(z, Z_FINISH) == Z_STREAM_END && z->total_out == col->raw_bytes) {
+    return inflate_to;
+  }
+#else
+  NOWARN_UNUSED(inflate_to);
+#endif
+  return NULL;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnarReader::decode_column
+
+  Decode the n values of a column from its raw bytes at p.  Integers go
+  to ints, and ptrs and lens point to them; other values point into p.
+  -------------------------------------------------------------------------*/
+bool
+LogColumnarReader::decode_column(const LogColumnarColumn *col, const char *p, int64_t *ints, const char **ptrs,
+                                 uint32_t *lens)
+{
+  const char *end = p + col->raw_bytes;
+  unsigned n = m_header.entry_count;
+  unsigned i;
+  uint64_t v, count;
+  int64_t prev = 0;
+
+  switch (col->encoding) {
+  case LogColumnar::INT:
+  case LogColumnar::INT_DELTA:
+    for (i = 0; i < n; i++) {
+      if (!get_varint(&p, end, &v)) {
+        return false;
+      }
+      if (col->encoding == LogColumnar::INT) {
+        ints[i] = unzigzag(v);
+      } else {
+        prev = ints[i] = (int64_t) ((uint64_t) prev + (uint64_t) unzigzag(v));
+      }
+    }
+    break;
+
+  case LogColumnar::INT_DICT:
+    if (!get_varint(&p, end, &count) || count > n) {
+      return false;
+    }
+    for (i = 0; i < count; i++) {
+      if (!get_varint(&p, end, &v)) {
+        return false;
+      }
+      m_dict_ints[i] = unzigzag(v);
+    }
+    for (i = 0; i < n; i++) {
+      if (!get_varint(&p, end, &v) || v >= count) {
+        return false;
+      }
+      ints[i] = m_dict_ints[v];
+    }
+    break;
+
+  case LogColumnar::BYTES:
+    for (i = 0; i < n; i++) {
+      if (!get_varint(&p, end, &v) || v > (uint64_t) (end - p)) {
+        return false;
+      }
+      ptrs[i] = p;
+      lens[i] = v;
+      p += v;
+    }
+    return p == end;
+
+  case LogColumnar::BYTES_DICT:
+    if (!get_varint(&p, end, &count) || count > n) {
+      return false;
+    }
+    for (i = 0; i < count; i++) {
+      if (!get_varint(&p, end, &v) || v > (uint64_t) (end - p)) {
+        return false;
+      }
+      m_dict_ptrs[i] = p;
+      m_dict_lens[i] = v;
+      p += v;
+    }
+    for (i = 0; i < n; i++) {
+      if (!get_varint(&p, end, &v) || v >= count) {
+        return false;
+      }
+      ptrs[i] = m_dict_ptrs[v];
+      lens[i] = m_dict_lens[v];
+    }
+    return p == end;
+
+  default:
+    return false;
+  }
+
+  for (i = 0; i < n; i++) {
+    ptrs[i] = (const char *) &ints[i];
+    lens[i] = sizeof(int64_t);
+  }
+  return p == end;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnarReader::values
+
+  Lay out m_values for the given number of columns, plus the dictionary
+  of the column being decoded.
+  -------------------------------------------------------------------------*/
+void
+LogColumnarReader::values(unsigned columns, int64_t **ints, const char ***ptrs, uint32_t **lens)
+{
+  size_t n = m_header.entry_count;
+  size_t slots = (columns + 1) * n;
+
+  m_values.len = 0;
+  m_values.reserve(slots * (sizeof(int64_t) + sizeof(char *) + sizeof(uint32_t)));
+  *ints = (int64_t *) m_values.data;
+  *ptrs = (const char **) (*ints + slots);
+  *lens = (uint32_t *) (*ptrs + slots);
+  m_dict_ints = *ints + columns * n;
+  m_dict_ptrs = *ptrs + columns * n;
+  m_dict_lens = *lens + columns * n;
+}
+
+LogBufferHeader *
+LogColumnarReader::decode()
+{
+  if (m_data == NULL) {
+    return NULL;
+  }
+
+  unsigned n = m_header.entry_count;
+  unsigned num_columns = m_header.column_count;
+  LogColumnarColumn col;
+  uint64_t inflated = 0;
+  unsigned c, i;
+
+  for (c = 0; c < num_columns; c++) {
+    column(c, &col);
+    if (col.flags & LogColumnar::DEFLATED) {
+      inflated += col.raw_bytes;
+    }
+  }
+  if (inflated > LOG_COLUMNAR_MAX_BLOCK) {
+    return NULL;
+  }
+  m_inflated.len = 0;
+  m_inflated.reserve(inflated);
+
+  int64_t *ints;
+  const char **ptrs;
+  uint32_t *lens;
+
+  values(num_columns, &ints, &ptrs, &lens);
+  for (c = 0; c < num_columns; c++) {
+    const char *raw;
+
+    column(c, &col);
+    raw = chunk(&col, m_inflated.data + m_inflated.len);
+    if (col.flags & LogColumnar::DEFLATED) {
+      m_inflated.len += col.raw_bytes;
+    }
+    if (raw == NULL || !decode_column(&col, raw, &ints[c * n], &ptrs[c * n], &lens[c * n])) {
+      return NULL;
+    }
+    // the entry header has no room for anything but integers
+    if (c < LogColumnar::FIRST_FIELD_COLUMN && col.encoding >= LogColumnar::BYTES) {
+      return NULL;
+    }
+  }
+
+  // rebuild the entries, as LogBuffer::checkout_write() laid them out
+  uint64_t data_bytes = 0;
+
+  for (i = 0; i < n; i++) {
+    uint64_t entry_bytes = sizeof(LogEntryHeader);
+
+    for (c = LogColumnar::FIRST_FIELD_COLUMN; c < num_columns; c++) {
+      entry_bytes += lens[c * n + i];
+    }
+    data_bytes += INK_ALIGN(entry_bytes, INK_MIN_ALIGN);
+  }
+  if (data_bytes > LOG_COLUMNAR_MAX_BLOCK) {
+    return NULL;
+  }
+
+  uint32_t header_bytes = m_header.buffer_header_bytes;
+  char *out;
+
+  m_decoded.len = 0;
+  out = m_decoded.reserve(header_bytes + data_bytes);
+  memcpy(out, m_data + sizeof(LogColumnarBlockHeader), header_bytes);
+
+  LogBufferHeader *buffer = (LogBufferHeader *) out;
+  char *p = out + header_bytes;
+
+  buffer->entry_count = n;
+  buffer->byte_count = header_bytes + data_bytes;
+  buffer->data_offset = header_bytes;
+
+  for (i = 0; i < n; i++) {
+    LogEntryHeader *entry = (LogEntryHeader *) p;
+    char *start = p;
+
+    entry->timestamp = ints[LogColumnar::TIMESTAMP_COLUMN * n + i];
+    entry->timestamp_usec = (int32_t) ints[LogColumnar::USEC_COLUMN * n + i];
+    p += sizeof(LogEntryHeader);
+    for (c = LogColumnar::FIRST_FIELD_COLUMN; c < num_columns; c++) {
+      memcpy(p, ptrs[c * n + i], lens[c * n + i]);
+      p += lens[c * n + i];
+    }
+    entry->entry_len = INK_ALIGN(p - start, INK_MIN_ALIGN);
+    memset(p, 0, start + entry->entry_len - p);
+    p = start + entry->entry_len;
+  }
+  m_decoded.len = p - out;
+
+  return buffer;
+}
+
+int
+LogColumnarReader::int_column(unsigned column_index, int64_t *result)
+{
+  if (m_data == NULL || column_index >= m_header.column_count) {
+    return -1;
+  }
+
+  LogColumnarColumn col;
+
+  column(column_index, &col);
+  if (col.encoding >= LogColumnar::BYTES || col.raw_bytes > LOG_COLUMNAR_MAX_BLOCK) {
+    return -1;
+  }
+  m_inflated.len = 0;
+  m_inflated.reserve(col.raw_bytes);
+
+  int64_t *ints;
+  const char **ptrs;
+  uint32_t *lens;
+  const char *raw = chunk(&col, m_inflated.data);
+
+  values(1, &ints, &ptrs, &lens);
+  if (raw == NULL || !decode_column(&col, raw, result, ptrs, lens)) {
+    return -1;
+  }
+  return m_header.entry_count;
+}
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+#include "LogAccessTest.h"
+#include "LogObject.h"
+#include "LogConfig.h"
+#include "LogRenderProgram.h"
+#include "Log.h"
+
+#define LOG_COLUMNAR_TEST_ROUNDS 50
+
+static LogBuffer *
+log_columnar_test_buffer(LogObject *obj, LogFormat *format, LogAccessTestSpread *lad)
+{
+  LogBuffer *lb = NEW(new LogBuffer(obj, Log::config->log_buffer_size));
+  size_t offset;
+
+  while (lb->checkout_write(&offset, format->m_field_list.marshal_len(lad)) == LogBuffer::LB_OK) {
+    format->m_field_list.marshal(lad, &(*lb)[offset]);
+    lb->checkin_write(offset);
+    ++lad->n;
+  }
+  lb->update_header_data();
+  return lb;
+}
+
+// the status code of each squid format line, the way a log parser would
+static int64_t
+log_columnar_scan_ascii(const char *text, int len)
+{
+  const char *p = text, *end = text + len;
+  int64_t sum = 0;
+
+  while (p < end) {
+    const char *eol = (const char *) memchr(p, '\n', end - p);
+    int field = 0;
+
+    if (eol == NULL) {
+      eol = end;
+    }
+    for (; p < eol && field < 3; p++) {
+      if (*p == ' ') {
+        field++;
+      }
+    }
+    // the fourth field is crc/pssc
+    while (p < eol && *p != '/') {
+      p++;
+    }
+    if (p < eol) {
+      sum += strtol(p + 1, NULL, 10);
+    }
+    p = eol + 1;
+  }
+  return sum;
+}
+
+// Writes a buffer of each predefined format as a block and reads it
+// back, then times writing and reading squid blocks against ASCII.
+REGRESSION_TEST(LogColumnar_RoundTrip)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  const struct
+  {
+    const char *name;
+    const char *format;
+  } formats[] = {
+    { "squid", LogFormat::squid_format },
+    { "common", LogFormat::common_format },
+    { "extended", LogFormat::extended_format },
+    { "extended2", LogFormat::extended2_format },
+  };
+  TestBox tb(t, pstatus);
+  LogAccessTestSpread lad;
+  LogColumnarWriter writer;
+  LogColumnarReader reader;
+  char *original = (char *) ats_malloc(LOG_MAX_FORMATTED_LINE);
+  char *rebuilt = (char *) ats_malloc(LOG_MAX_FORMATTED_LINE);
+  char tag[128];
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  for (unsigned i = 0; i < countof(formats); i++) {
+    LogFormat format(formats[i].name, formats[i].format);
+    LogObject obj(&format, Log::config->logfile_dir, "log_columnar_test", COLUMNAR_LOG, NULL, LogConfig::NO_ROLLING);
+    LogBuffer *lb = log_columnar_test_buffer(&obj, &format, &lad);
+    LogBufferHeader *h = lb->header();
+    LogRenderProgram *program = LogBuffer::render_program(h->fmt_fieldlist(), h->fmt_printf());
+    int block_bytes = writer.encode(h);
+
+    tb.check(block_bytes > 0 && program != NULL, "%s: block of %d bytes", formats[i].name, block_bytes);
+    if (block_bytes <= 0 || program == NULL) {
+      delete lb;
+      continue;
+    }
+
+    LogBufferHeader *d = reader.set_block(writer.block(), block_bytes) ? reader.decode() : NULL;
+
+    tb.check(d != NULL, "%s: block does not decode", formats[i].name);
+    if (d == NULL) {
+      delete lb;
+      continue;
+    }
+    tb.check(d->entry_count == h->entry_count && strcmp(d->fmt_fieldlist(), h->fmt_fieldlist()) == 0 &&
+             d->log_object_signature == h->log_object_signature,
+             "%s: %d entries rebuilt from %d", formats[i].name, (int) d->entry_count, (int) h->entry_count);
+
+    LogBufferIterator iter_h(h), iter_d(d);
+    LogEntryHeader *eh, *ed;
+    int mismatches = 0;
+
+    while ((eh = iter_h.next()) && (ed = iter_d.next())) {
+      int n = program->render(eh, original, LOG_MAX_FORMATTED_LINE, h->version);
+      int m = program->render(ed, rebuilt, LOG_MAX_FORMATTED_LINE, d->version);
+
+      if (n <= 0 || n != m || memcmp(original, rebuilt, n) != 0 || eh->timestamp_usec != ed->timestamp_usec) {
+        ++mismatches;
+      }
+    }
+    tb.check(mismatches == 0, "%s: %d entries differ once rebuilt", formats[i].name, mismatches);
+
+    rprintf(t, "%s: %d entries, %d bytes as a LogBuffer, %d as a block\n", formats[i].name, (int) h->entry_count,
+            (int) h->byte_count, block_bytes);
+
+    // a damaged block is refused
+    writer.block()[block_bytes - 4 - sizeof(uint32_t)] ^= 1;
+    tb.check(!reader.set_block(writer.block(), block_bytes), "%s: damaged trailer accepted", formats[i].name);
+    tb.check(!reader.set_block(writer.block(), block_bytes - 1), "%s: truncated block accepted", formats[i].name);
+
+    delete lb;
+  }
+
+  // squid: write and scan as columnar, against ASCII
+  LogFormat format("squid", LogFormat::squid_format);
+  LogObject obj(&format, Log::config->logfile_dir, "log_columnar_test", COLUMNAR_LOG, NULL, LogConfig::NO_ROLLING);
+  LogBuffer *lb = log_columnar_test_buffer(&obj, &format, &lad);
+  LogBufferHeader *h = lb->header();
+  LogRenderProgram *program = LogBuffer::render_program(h->fmt_fieldlist(), h->fmt_printf());
+  int entries = h->entry_count;
+  int status_column = LogColumnar::FIRST_FIELD_COLUMN;
+  int64_t *status = (int64_t *) ats_malloc(entries * sizeof(int64_t));
+  char *text = (char *) ats_malloc(entries * LOG_MAX_FORMATTED_LINE / 16);
+  int text_len = 0, block_bytes = 0;
+  int64_t ascii_sum = 0, columnar_sum = 0;
+  ink_hrtime ascii_write = 0, columnar_write = 0, ascii_scan = 0, columnar_scan = 0, columnar_decode = 0;
+
+  // pssc is the fifth field of the squid format
+  for (LogField *f = program->fieldlist()->first(); f && strcmp(f->symbol(), "pssc"); f = program->fieldlist()->next(f)) {
+    ++status_column;
+  }
+
+  // best of three, the box may be busy with other threads
+  for (int k = 0; k < 3; k++) {
+    ink_hrtime start = ink_get_hrtime_internal();
+
+    for (int r = 0; r < LOG_COLUMNAR_TEST_ROUNDS; r++) {
+      LogBufferIterator iter(h);
+      LogEntryHeader *e;
+
+      text_len = 0;
+      while ((e = iter.next())) {
+        int n = program->render(e, &text[text_len], LOG_MAX_FORMATTED_LINE, h->version);
+
+        text_len += n;
+        text[text_len++] = '\n';
+      }
+    }
+    ink_hrtime aw = ink_get_hrtime_internal() - start;
+
+    start = ink_get_hrtime_internal();
+    for (int r = 0; r < LOG_COLUMNAR_TEST_ROUNDS; r++) {
+      block_bytes = writer.encode(h);
+    }
+    ink_hrtime cw = ink_get_hrtime_internal() - start;
+
+    start = ink_get_hrtime_internal();
+    for (int r = 0; r < LOG_COLUMNAR_TEST_ROUNDS; r++) {
+      ascii_sum = log_columnar_scan_ascii(text, text_len);
+    }
+    ink_hrtime as = ink_get_hrtime_internal() - start;
+
+    reader.set_block(writer.block(), block_bytes);
+    start = ink_get_hrtime_internal();
+    for (int r = 0; r < LOG_COLUMNAR_TEST_ROUNDS; r++) {
+      columnar_sum = 0;
+      if (reader.int_column(status_column, status) == entries) {
+        for (int e = 0; e < entries; e++) {
+          columnar_sum += status[e];
+        }
+      }
+    }
+    ink_hrtime cs = ink_get_hrtime_internal() - start;
+
+    start = ink_get_hrtime_internal();
+    for (int r = 0; r < LOG_COLUMNAR_TEST_ROUNDS; r++) {
+      reader.decode();
+    }
+    ink_hrtime cd = ink_get_hrtime_internal() - start;
+
+    if (k == 0 || aw < ascii_write)
+      ascii_write = aw;
+    if (k == 0 || cw < columnar_write)
+      columnar_write = cw;
+    if (k == 0 || as < ascii_scan)
+      ascii_scan = as;
+    if (k == 0 || cs < columnar_scan)
+      columnar_scan = cs;
+    if (k == 0 || cd < columnar_decode)
+      columnar_decode = cd;
+  }
+
+  tb.check(ascii_sum == columnar_sum && ascii_sum > 0, "status column sums to %d, ASCII to %d",
+           (int) columnar_sum, (int) ascii_sum);
+
+  int64_t processed = (int64_t) entries * LOG_COLUMNAR_TEST_ROUNDS;
+  const struct
+  {
+    const char *name;
+    ink_hrtime time;
+  } timings[] = {
+    { "ascii_write", ascii_write },
+    { "columnar_write", columnar_write },
+    { "ascii_status_scan", ascii_scan },
+    { "columnar_status_scan", columnar_scan },
+    { "columnar_decode", columnar_decode },
+  };
+
+  rprintf(t, "squid: %d entries, %d bytes an entry as ASCII, %d binary, %d columnar\n", entries,
+          text_len / entries, (int) (h->byte_count / entries), block_bytes / entries);
+  for (unsigned i = 0; i < countof(timings); i++) {
+    rprintf(t, "squid: %s %d ns per entry\n", timings[i].name, (int) (timings[i].time / processed));
+    snprintf(tag, sizeof(tag), "log_squid_%s_entries_per_sec", timings[i].name);
+    rperf(t, tag, (double) processed * HRTIME_SECOND / (timings[i].time ? timings[i].time : 1));
+  }
+  rperf(t, "log_squid_ascii_bytes_per_entry", (double) text_len / entries);
+  rperf(t, "log_squid_columnar_bytes_per_entry", (double) block_bytes / entries);
+
+  delete lb;
+  ats_free(status);
+  ats_free(text);
+  ats_free(original);
+  ats_free(rebuilt);
+}
+#endif /* TS_HAS_TESTS */
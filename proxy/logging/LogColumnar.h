@@ -0,0 +1,273 @@
+/** @file
+
+  Columnar log files
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+   LogColumnar.h
+
+   Description:
+     A COLUMNAR_LOG file is a sequence of blocks, one per LogBuffer,
+     written straight from the marshaled entries.  A block holds:
+
+       LogColumnarBlockHeader
+       the LogBufferHeader of the buffer, with its strings
+       one chunk per column
+       the column index: a LogColumnarColumn per column
+       LogColumnarTrailer
+
+     Column 0 is the entry timestamps, column 1 the microseconds, and
+     then one column per field of the format, in order.  Integer
+     columns are stored as zigzag varints, as deltas, or through a
+     dictionary, whichever is smallest.  Other fields (strings, IP
+     addresses) keep their marshaled bytes, through a dictionary when
+     at most half the values are distinct.  With zlib, a chunk is
+     deflated when that makes it smaller.
+
+     The index lets a reader pull out one column without touching the
+     others, and the trailer, at a fixed distance from the end of the
+     block, lets it walk a file backwards.  A reader can also rebuild
+     the LogBuffer a block came from, so anything that prints or parses
+     binary logs works on columnar ones too.
+
+     Like binary logs, blocks are in host byte order.
+
+ ****************************************************************************/
+
+#ifndef LOG_COLUMNAR_H
+#define LOG_COLUMNAR_H
+
+#include "libts.h"
+
+struct LogBufferHeader;
+struct LogEntryHeader;
+class LogField;
+class LogFieldList;
+
+#define LOG_COLUMNAR_COOKIE 0xc01face
+#define LOG_COLUMNAR_VERSION 1
+#define LOG_COLUMNAR_MAX_BLOCK (64 * 1024 * 1024)
+
+// the first two words match a LogBufferHeader, so readers can tell them apart
+struct LogColumnarBlockHeader
+{
+  uint32_t cookie;
+  uint32_t version;
+  uint32_t block_bytes;         // header to trailer
+  uint32_t entry_count;
+  uint32_t column_count;        // 2 + number of fields
+  uint32_t low_timestamp;
+  uint32_t high_timestamp;
+  uint32_t buffer_header_bytes; // LogBufferHeader and strings, after us
+  uint32_t footer_offset;       // column index, from the block start
+  uint32_t data_bytes;          // entries of the rebuilt LogBuffer
+};
+
+struct LogColumnarColumn
+{
+  uint32_t offset;              // from the block start
+  uint32_t stored_bytes;
+  uint32_t raw_bytes;           // once inflated
+  uint16_t encoding;
+  uint16_t flags;
+};
+
+struct LogColumnarTrailer
+{
+  uint32_t footer_offset;
+  uint32_t block_bytes;
+  uint32_t cookie;
+  uint32_t reserved;
+};
+
+class LogColumnar
+{
+public:
+  enum Encoding
+  {
+    INT = 0,                    // zigzag varint per entry
+    INT_DELTA,                  // zigzag varint of the change
+    INT_DICT,                   // varint count, values, then an index per entry
+    BYTES,                      // varint length and bytes per entry
+    BYTES_DICT,                 // varint count, values as BYTES, then indexes
+    N_ENCODINGS
+  };
+
+  enum ColumnFlags
+  {
+    DEFLATED = 1
+  };
+
+  enum
+  {
+    TIMESTAMP_COLUMN = 0,
+    USEC_COLUMN = 1,
+    FIRST_FIELD_COLUMN = 2
+  };
+};
+
+// A growable byte array
+struct LogColumnarBuffer
+{
+  char *data;
+  uint32_t len;
+  uint32_t size;
+
+  LogColumnarBuffer():data(NULL), len(0), size(0) { }
+  ~LogColumnarBuffer() { ats_free(data); }
+
+  char *reserve(uint32_t n)
+  {
+    if (len + n > size) {
+      size = (len + n) * 2;
+      data = (char *) ats_realloc(data, size);
+    }
+    return data + len;
+  }
+};
+
+/*-------------------------------------------------------------------------
+  LogColumnarWriter
+
+  Turns LogBuffers into blocks.  Not thread safe; a LogFile has its own.
+  -------------------------------------------------------------------------*/
+
+class LogColumnarWriter
+{
+public:
+  LogColumnarWriter();
+  ~LogColumnarWriter();
+
+  /** Encode the entries of @a buffer as one block, then at block().
+      @return the block length, or -1 if the entries do not match the
+      buffer's field list.
+  */
+  int encode(LogBufferHeader * buffer);
+  char *block() { return m_block.data; }
+
+private:
+  bool set_fieldlist(char *symbol_str);
+  uint32_t field_len(int f, char *p);
+  int build_dictionary(const char **ptrs, const uint32_t *lens, int n, int max_distinct);
+  void add_column(LogColumnarColumn * col, int n, bool is_int);
+  void store_chunk(LogColumnarColumn * col);
+
+  LogColumnarBuffer m_block;
+  LogColumnarBuffer m_chunk;    // the column being encoded
+  LogColumnarBuffer m_index;
+
+  char *m_symbol_str;
+  LogFieldList *m_fieldlist;
+  LogField **m_fields;
+  bool *m_field_is_int;
+  int m_num_fields;
+  char *m_scratch;              // to measure unusual fields
+
+  // per entry and field
+  int m_max_entries;
+  LogEntryHeader **m_entries;
+  const char **m_value_ptrs;
+  uint32_t *m_value_lens;
+
+  // the column being encoded
+  int64_t *m_ints;
+  const char **m_ptrs;
+  uint32_t *m_lens;
+
+  // dictionary of the column being encoded
+  int m_dict_slots_size;
+  int *m_dict_slots;            // 1 + distinct index, 0 if free
+  int *m_dict_first;            // entry that introduced each value
+  uint32_t *m_dict_hash;
+  int *m_dict_index;            // per entry
+  int m_dict_size;
+
+  void *m_deflate;              // z_stream, kept from block to block
+
+  // -- member functions not allowed --
+  LogColumnarWriter(const LogColumnarWriter &);
+  LogColumnarWriter & operator=(const LogColumnarWriter &);
+};
+
+/*-------------------------------------------------------------------------
+  LogColumnarReader
+
+  Reads blocks back, either whole, as the LogBuffer they were written
+  from, or one integer column at a time.
+  -------------------------------------------------------------------------*/
+
+class LogColumnarReader
+{
+public:
+  LogColumnarReader();
+  ~LogColumnarReader();
+
+  /** Read the rest of a block from @a fd, given its first @a head_len
+      bytes at @a head.  @return the block length, or -1.
+  */
+  int read(int fd, const char *head, int head_len);
+
+  /** Use the @a len bytes at @a block, which must outlive the reader's
+      use of them.  @return false if they are not a block.
+  */
+  bool set_block(const char *block, int len);
+
+  unsigned entry_count() const;
+  unsigned column_count() const;
+
+  /** Rebuild the LogBuffer of the current block.  The result is valid
+      until the next call.  @return NULL if the block is corrupt.
+  */
+  LogBufferHeader *decode();
+
+  /** Decode integer column @a column into @a values, which has room
+      for entry_count() values.  @return the number of values, or -1 if
+      the column is not an integer one or is corrupt.
+  */
+  int int_column(unsigned column, int64_t * values);
+
+private:
+  void column(unsigned i, LogColumnarColumn * col) const;
+  const char *chunk(const LogColumnarColumn * col, char *inflate_to);
+  void values(unsigned columns, int64_t ** ints, const char ***ptrs, uint32_t ** lens);
+  bool decode_column(const LogColumnarColumn * col, const char *p, int64_t * ints, const char **ptrs, uint32_t * lens);
+
+  LogColumnarBlockHeader m_header;
+  const char *m_data;
+  uint32_t m_len;
+  LogColumnarBuffer m_block;    // as read()
+  LogColumnarBuffer m_inflated;
+  LogColumnarBuffer m_decoded;
+  LogColumnarBuffer m_values;   // per entry and column
+  void *m_inflate;              // z_stream
+
+  // dictionary of the column being decoded
+  int64_t *m_dict_ints;
+  const char **m_dict_ptrs;
+  uint32_t *m_dict_lens;
+
+  // -- member functions not allowed --
+  LogColumnarReader(const LogColumnarReader &);
+  LogColumnarReader & operator=(const LogColumnarReader &);
+};
+
+#endif
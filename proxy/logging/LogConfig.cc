@@ -105,6 +105,8 @@ LogConfig::setup_default_values()
   log_buffer_size = (int) (10 * LOG_KILOBYTE);
   max_entries_per_buffer = 100;
   max_secs_per_buffer = 5;
+  per_thread_buffers = true;
+  flush_threads = 1;
   max_space_mb_for_logs = 100;
   max_space_mb_for_orphan_logs = 25;
   max_space_mb_headroom = 10;
@@ -142,6 +144,8 @@ LogConfig::setup_default_values()
   collation_secret = ats_strdup("foobar");
   collation_retry_sec = 0;
   collation_max_send_buffers = 0;
+  collation_window = 1;
+  collation_compression = 0;
 
   rolling_enabled = NO_ROLLING;
   rolling_interval_sec = 86400; // 24 hours
@@ -219,6 +223,14 @@ LogConfig::read_configuration_variables()
     max_secs_per_buffer = val;
   }
 
+  val = (int) LOG_ConfigReadInteger("proxy.config.log.per_thread_buffers");
+  per_thread_buffers = (val > 0);
+
+  val = (int) LOG_ConfigReadInteger("proxy.config.log.flush_threads");
+  if (val > 0) {
+    flush_threads = val;
+  }
+
   val = (int) LOG_ConfigReadInteger("proxy.config.log.max_space_mb_for_logs");
   if (val > 0) {
     max_space_mb_for_logs = val;
@@ -439,6 +451,16 @@ LogConfig::read_configuration_variables()
     collation_max_send_buffers = val;
   }
 
+  val = (int) LOG_ConfigReadInteger("proxy.config.log.collation_window");
+  if (val > 0) {
+    collation_window = val;
+  }
+
+  val = (int) LOG_ConfigReadInteger("proxy.config.log.collation_compression");
+  if (val >= 0 && val <= 9) {
+    collation_compression = val;
+  }
+
 
   // ROLLING
 
@@ -775,6 +797,8 @@ LogConfig::display(FILE * fd)
   fprintf(fd, "   log_buffer_size = %d\n", log_buffer_size);
   fprintf(fd, "   max_entries_per_buffer = %d\n", max_entries_per_buffer);
   fprintf(fd, "   max_secs_per_buffer = %d\n", max_secs_per_buffer);
+  fprintf(fd, "   per_thread_buffers = %d\n", per_thread_buffers);
+  fprintf(fd, "   flush_threads = %d\n", flush_threads);
   fprintf(fd, "   max_space_mb_for_logs = %d\n", max_space_mb_for_logs);
   fprintf(fd, "   max_space_mb_for_orphan_logs = %d\n", max_space_mb_for_orphan_logs);
   fprintf(fd, "   use_orphan_log_space_value = %d\n", use_orphan_log_space_value);
@@ -808,6 +832,8 @@ LogConfig::display(FILE * fd)
   fprintf(fd, "   collation_port = %d\n", collation_port);
   fprintf(fd, "   collation_host_tagged = %d\n", collation_host_tagged);
   fprintf(fd, "   collation_secret = %s\n", collation_secret);
+  fprintf(fd, "   collation_window = %d\n", collation_window);
+  fprintf(fd, "   collation_compression = %d\n", collation_compression);
   fprintf(fd, "   rolling_enabled = %d\n", rolling_enabled);
   fprintf(fd, "   rolling_interval_sec = %d\n", rolling_interval_sec);
   fprintf(fd, "   rolling_offset_hr = %d\n", rolling_offset_hr);
@@ -1374,6 +1400,53 @@ do { \
   RecRegisterRawStat(log_rsb, RECT_PROCESS,
                      "proxy.process.log.event_log_access_skip",
                      RECD_COUNTER, RECP_PERSISTENT, (int) log_stat_event_log_access_skip_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.event_log_access_sampled",
+                     RECD_COUNTER, RECP_PERSISTENT, (int) log_stat_event_log_access_sampled_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.event_log_access_rate_limited",
+                     RECD_COUNTER, RECP_PERSISTENT, (int) log_stat_event_log_access_rate_limited_stat, RecRawStatSyncCount);
+
+  //
+  // buffer contention
+  //
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.buffer_checkout_cas_retries",
+                     RECD_COUNTER, RECP_NON_PERSISTENT, (int) log_stat_buffer_checkout_cas_retries_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.buffer_checkout_retries",
+                     RECD_COUNTER, RECP_NON_PERSISTENT, (int) log_stat_buffer_checkout_retries_stat, RecRawStatSyncSum);
+
+  //
+  // parallel flush
+  //
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.flush_queue_depth",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) log_stat_flush_queue_depth_stat, RecRawStatSyncSum);
+  LOG_CLEAR_DYN_STAT(log_stat_flush_queue_depth_stat);
+
+  //
+  // collation clients
+  //
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.collation_bytes_uncompressed",
+                     RECD_INT, RECP_PERSISTENT, (int) log_stat_collation_bytes_uncompressed_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.collation_bytes_compressed",
+                     RECD_INT, RECP_PERSISTENT, (int) log_stat_collation_bytes_compressed_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.collation_buffers_in_flight",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) log_stat_collation_buffers_in_flight_stat, RecRawStatSyncSum);
+  LOG_CLEAR_DYN_STAT(log_stat_collation_buffers_in_flight_stat);
+
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.collation_buffers_orphaned",
+                     RECD_COUNTER, RECP_PERSISTENT, (int) log_stat_collation_buffers_orphaned_stat, RecRawStatSyncSum);
 }
 
 /*-------------------------------------------------------------------------
@@ -2074,6 +2147,10 @@ LogConfig::read_xml_log_config(int from_memory)
       NameList rollingIntervalSec;
       NameList rollingOffsetHr;
       NameList rollingSizeMb;
+      NameList sampleRate;
+      NameList sampleKey;
+      NameList rateLimit;
+      NameList rateLimitBurst;
 
       for (xattr = xobj->first(); xattr; xattr = xobj->next(xattr)) {
         Debug("xml", "XmlAttr  : <%s,%s>", xattr->tag(), xattr->value());
@@ -2101,6 +2178,14 @@ LogConfig::read_xml_log_config(int from_memory)
           rollingOffsetHr.enqueue(xattr->value());
         } else if (strcasecmp(xattr->tag(), "RollingSizeMb") == 0) {
           rollingSizeMb.enqueue(xattr->value());
+        } else if (strcasecmp(xattr->tag(), "SampleRate") == 0) {
+          sampleRate.enqueue(xattr->value());
+        } else if (strcasecmp(xattr->tag(), "SampleKey") == 0) {
+          sampleKey.enqueue(xattr->value());
+        } else if (strcasecmp(xattr->tag(), "RateLimit") == 0) {
+          rateLimit.enqueue(xattr->value());
+        } else if (strcasecmp(xattr->tag(), "RateLimitBurst") == 0) {
+          rateLimitBurst.enqueue(xattr->value());
         } else {
           Note("Unknown attribute %s for %s; ignoring", xattr->tag(), xobj->object_name());
         }
@@ -2153,6 +2238,18 @@ LogConfig::read_xml_log_config(int from_memory)
       if (rollingSizeMb.count() > 1) {
         Note("Multiple values for 'RollingSizeMb' attribute in %s; " "using the first one", xobj->object_name());
       }
+      if (sampleRate.count() > 1) {
+        Note("Multiple values for 'SampleRate' attribute in %s; " "using the first one", xobj->object_name());
+      }
+      if (sampleKey.count() > 1) {
+        Note("Multiple values for 'SampleKey' attribute in %s; " "using the first one", xobj->object_name());
+      }
+      if (rateLimit.count() > 1) {
+        Note("Multiple values for 'RateLimit' attribute in %s; " "using the first one", xobj->object_name());
+      }
+      if (rateLimitBurst.count() > 1) {
+        Note("Multiple values for 'RateLimitBurst' attribute in %s; " "using the first one", xobj->object_name());
+      }
       // create new LogObject and start adding to it
       //
 
@@ -2169,7 +2266,8 @@ LogConfig::read_xml_log_config(int from_memory)
         char *mode_str = mode.dequeue();
         file_type = (strncasecmp(mode_str, "bin", 3) == 0 ||
                      (mode_str[0] == 'b' && mode_str[1] == 0) ?
-                     BINARY_LOG : (strcasecmp(mode_str, "ascii_pipe") == 0 ? ASCII_PIPE : ASCII_LOG));
+                     BINARY_LOG : (strcasecmp(mode_str, "ascii_pipe") == 0 ? ASCII_PIPE :
+                                   (strcasecmp(mode_str, "columnar") == 0 ? COLUMNAR_LOG : ASCII_LOG)));
       }
       // rolling
       //
@@ -2272,6 +2370,33 @@ LogConfig::read_xml_log_config(int from_memory)
           obj->add_filter(&server_host_filter);
         }
       }
+      // sampling and rate limit
+      //
+      char *sampleRate_str = sampleRate.dequeue();
+      if (sampleRate_str) {
+        char *sampleKey_str = sampleKey.dequeue();
+        const char *key_symbol = sampleKey_str ? sampleKey_str : "cquc";
+        LogField *key_field = Log::global_field_list.find_by_symbol(key_symbol);
+        double rate = strtod(sampleRate_str, NULL);
+
+        if (!key_field) {
+          Warning("SampleKey %s is not a log field; " "LogObject %s will not be sampled", key_symbol,
+                  obj->get_base_filename());
+        } else if (rate < 0.0 || rate > 1.0) {
+          Warning("SampleRate %s is not between 0 and 1; " "LogObject %s will not be sampled", sampleRate_str,
+                  obj->get_base_filename());
+        } else {
+          obj->m_sampler.set_sample_rate(rate, key_field);
+        }
+      }
+
+      char *rateLimit_str = rateLimit.dequeue();
+      if (rateLimit_str) {
+        char *rateLimitBurst_str = rateLimitBurst.dequeue();
+        int64_t burst = rateLimitBurst_str ? ink_atoi64(rateLimitBurst_str) : 0;
+
+        obj->m_sampler.set_rate_limit(ink_atoi64(rateLimit_str), burst);
+      }
       // collation hosts
       //
       char *collationHosts_str = collationHosts.dequeue();
@@ -47,6 +47,18 @@ enum
   log_stat_event_log_access_stat,
   log_stat_event_log_access_fail_stat,
   log_stat_event_log_access_skip_stat,
+  log_stat_event_log_access_sampled_stat,
+  log_stat_event_log_access_rate_limited_stat,
+  // Log buffer contention
+  log_stat_buffer_checkout_cas_retries_stat,
+  log_stat_buffer_checkout_retries_stat,
+  // Parallel flush
+  log_stat_flush_queue_depth_stat,
+  // Collation clients
+  log_stat_collation_bytes_uncompressed_stat,
+  log_stat_collation_bytes_compressed_stat,
+  log_stat_collation_buffers_in_flight_stat,
+  log_stat_collation_buffers_orphaned_stat,
   log_stat_count
 };
 
@@ -199,6 +211,8 @@ public:
   int log_buffer_size;
   int max_entries_per_buffer;
   int max_secs_per_buffer;
+  bool per_thread_buffers;
+  int flush_threads;
   int max_space_mb_for_logs;
   int max_space_mb_for_orphan_logs;
   int max_space_mb_headroom;
@@ -219,6 +233,8 @@ public:
   bool collation_host_tagged;
   int collation_retry_sec;
   int collation_max_send_buffers;
+  int collation_window;
+  int collation_compression;
   int rolling_enabled;
   int rolling_interval_sec;
   int rolling_offset_hr;
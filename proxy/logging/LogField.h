@@ -120,6 +120,11 @@ public:
   Ptr<LogFieldAliasMap> map() {
     return m_alias_map;
   };
+  // NULL for fields unmarshaled through an alias map
+  UnmarshalFunc unmarshal_func()
+  {
+    return m_alias_map == NULL ? m_unmarshal_func : NULL;
+  }
   Aggregate aggregate()
   {
     return m_agg_op;
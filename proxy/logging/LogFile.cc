@@ -44,11 +44,14 @@
 #include "LogFilter.h"
 #include "LogFormat.h"
 #include "LogBuffer.h"
+#include "LogRenderProgram.h"
+#include "LogColumnar.h"
 #include "LogFile.h"
 #include "LogHost.h"
 #include "LogObject.h"
 #include "LogUtils.h"
 #include "LogConfig.h"
+#include "LogFlushPool.h"
 #include "Log.h"
 
 // the FILESIZE_SAFE_THRESHOLD_FACTOR is used to compute the file size
@@ -93,7 +96,8 @@ LogFile::LogFile(const char *name, const char *header, LogFileFormat format,
     m_signature(signature),
     m_meta_info(NULL),
     m_max_line_size(max_line_size),
-    m_overspill_report_count(overspill_report_count)
+    m_overspill_report_count(overspill_report_count),
+    m_columnar(NULL)
 {
   delete m_meta_info;
   m_meta_info = NULL;
@@ -108,6 +112,10 @@ LogFile::LogFile(const char *name, const char *header, LogFileFormat format,
   m_ascii_buffer_size = (ascii_buffer_size < max_line_size ? max_line_size : ascii_buffer_size);
   m_ascii_buffer = NEW(new char[m_ascii_buffer_size]);
   m_overspill_buffer = NEW(new char[m_max_line_size]);
+  ink_mutex_init(&m_order_mutex, "LogFile order");
+  m_order_next_seq = 0;
+  m_order_write_seq = 0;
+  m_order_writing = false;
 
   Debug("log-file", "exiting LogFile constructor, m_name=%s, this=%p", m_name, this);
 }
@@ -130,14 +138,19 @@ LogFile::LogFile (const LogFile& copy)
     m_overspill_written (0),
     m_attempts_to_write_overspill (0),
     m_overspill_report_count (copy.m_overspill_report_count),
+    m_columnar (NULL),
     m_fd (-1),
     m_start_time (0L),
     m_end_time (0L),
-    m_bytes_written (0)
+    m_bytes_written (0),
+    m_order_next_seq (0),
+    m_order_write_seq (0),
+    m_order_writing (false)
 {
     ink_assert(m_ascii_buffer_size >= m_max_line_size);
     m_ascii_buffer = NEW (new char[m_ascii_buffer_size]);
     m_overspill_buffer = NEW (new char[m_max_line_size]);
+    ink_mutex_init(&m_order_mutex, "LogFile order");
 
     Debug("log-file", "exiting LogFile copy constructor, m_name=%s, this=%p",
           m_name, this);
@@ -158,6 +171,9 @@ LogFile::~LogFile()
   m_ascii_buffer = 0;
   delete[]m_overspill_buffer;
   m_overspill_buffer = 0;
+  delete m_columnar;
+  ink_assert(m_order_pending.head == NULL);
+  ink_mutex_destroy(&m_order_mutex);
   Debug("log-file", "exiting LogFile destructor, this=%p", this);
 }
 
@@ -285,7 +301,7 @@ LogFile::open_file()
   // file.
   //
   if (!file_exists) {
-    if (m_file_format != BINARY_LOG && m_header != NULL) {
+    if ((m_file_format == ASCII_LOG || m_file_format == ASCII_PIPE) && m_header != NULL) {
       Debug("log-file", "writing header to LogFile %s", m_name);
       writeln(m_header, strlen(m_header), m_fd, m_name);
     }
@@ -528,6 +544,19 @@ LogFile::write(LogBuffer * lb)
       Warning("An error was encountered writing to %s: [tried %d, wrote %d, '%s']", m_name, buffer_header->byte_count, bytes, strerror(errno));
     }
   }
+  else if (m_file_format == COLUMNAR_LOG) {
+    if (m_columnar == NULL) {
+      m_columnar = NEW(new LogColumnarWriter);
+    }
+    int block_bytes = m_columnar->encode(buffer_header);
+
+    if (block_bytes > 0) {
+      bytes = ::write(m_fd, m_columnar->block(), block_bytes);
+      if (bytes != block_bytes) {
+        Warning("An error was encountered writing to %s: [tried %d, wrote %d, '%s']", m_name, block_bytes, bytes, strerror(errno));
+      }
+    }
+  }
   else if (m_file_format == ASCII_LOG || m_file_format == ASCII_PIPE) {
     bytes = write_ascii_logbuffer3(buffer_header);
 #if defined(LOG_BUFFER_TRACKING)
@@ -596,10 +625,20 @@ LogFile::write_ascii_logbuffer(LogBufferHeader * buffer_header, int fd, const ch
     return 0;
   }
 
+  // look the render program up once for the whole buffer
+  LogRenderProgram *program = NULL;
+  if (format_type != TEXT_LOG && alt_format == NULL) {
+    program = LogBuffer::render_program(fieldlist_str, printf_str);
+  }
+
   while ((entry_header = iter.next())) {
-    fmt_line_bytes = LogBuffer::to_ascii(entry_header, format_type,
-                                         &fmt_line[0], LOG_MAX_FORMATTED_LINE,
-                                         fieldlist_str, printf_str, buffer_header->version, alt_format);
+    if (program) {
+      fmt_line_bytes = program->render(entry_header, &fmt_line[0], LOG_MAX_FORMATTED_LINE, buffer_header->version);
+    } else {
+      fmt_line_bytes = LogBuffer::to_ascii(entry_header, format_type,
+                                           &fmt_line[0], LOG_MAX_FORMATTED_LINE,
+                                           fieldlist_str, printf_str, buffer_header->version, alt_format);
+    }
     ink_assert(fmt_line_bytes > 0);
 
     if (fmt_line_bytes > 0) {
@@ -657,6 +696,11 @@ LogFile::write_ascii_logbuffer3(LogBufferHeader * buffer_header, char *alt_forma
     return 0;
   }
 
+  LogRenderProgram *program = NULL;
+  if (format_type != TEXT_LOG && alt_format == NULL) {
+    program = LogBuffer::render_program(fieldlist_str, printf_str);
+  }
+
   while ((entry_header = iter.next())) {
     fmt_buf_bytes = 0;
 
@@ -664,12 +708,19 @@ LogFile::write_ascii_logbuffer3(LogBufferHeader * buffer_header, char *alt_forma
     //
     do {
       if (m_ascii_buffer_size - fmt_buf_bytes >= m_max_line_size) {
-        int bytes = LogBuffer::to_ascii(entry_header, format_type,
-                                        &m_ascii_buffer[fmt_buf_bytes],
-                                        m_max_line_size - 1,
-                                        fieldlist_str, printf_str,
-                                        buffer_header->version,
-                                        alt_format);
+        int bytes;
+
+        if (program) {
+          bytes = program->render(entry_header, &m_ascii_buffer[fmt_buf_bytes], m_max_line_size - 1,
+                                  buffer_header->version);
+        } else {
+          bytes = LogBuffer::to_ascii(entry_header, format_type,
+                                      &m_ascii_buffer[fmt_buf_bytes],
+                                      m_max_line_size - 1,
+                                      fieldlist_str, printf_str,
+                                      buffer_header->version,
+                                      alt_format);
+        }
 
         if (bytes > 0) {
           fmt_buf_bytes += bytes;
@@ -736,6 +787,127 @@ LogFile::write_ascii_logbuffer3(LogBufferHeader * buffer_header, char *alt_forma
   return total_bytes;
 }
 
+/*-------------------------------------------------------------------------
+  LogFile::format_ascii_logbuffer
+
+  Convert the given buffer to ASCII in a block of its own, for a flush
+  worker.  The caller frees the block with ats_free().
+  -------------------------------------------------------------------------*/
+
+char *
+LogFile::format_ascii_logbuffer(LogBufferHeader * buffer_header, int *len)
+{
+  ink_assert(buffer_header != NULL);
+
+  *len = 0;
+  if (buffer_header->version != LOG_SEGMENT_VERSION) {
+    Note("Invalid LogBuffer version %d in format_ascii_logbuffer; "
+         "current version is %d", buffer_header->version, LOG_SEGMENT_VERSION);
+    return NULL;
+  }
+
+  LogFormatType format_type = (LogFormatType) buffer_header->format_type;
+  char *fieldlist_str = buffer_header->fmt_fieldlist();
+  char *printf_str = buffer_header->fmt_printf();
+  LogBufferIterator iter(buffer_header);
+  LogEntryHeader *entry_header;
+  size_t size = m_ascii_buffer_size;
+  size_t fmt_buf_bytes = 0;
+  char *fmt_buf = (char *) ats_malloc(size);
+  LogRenderProgram *program = NULL;
+
+  if (format_type != TEXT_LOG) {
+    program = LogBuffer::render_program(fieldlist_str, printf_str);
+  }
+
+  while ((entry_header = iter.next())) {
+    if (size - fmt_buf_bytes < m_max_line_size) {
+      size *= 2;
+      fmt_buf = (char *) ats_realloc(fmt_buf, size);
+    }
+    int bytes;
+
+    if (program) {
+      bytes = program->render(entry_header, &fmt_buf[fmt_buf_bytes], m_max_line_size - 1, buffer_header->version);
+    } else {
+      bytes = LogBuffer::to_ascii(entry_header, format_type, &fmt_buf[fmt_buf_bytes], m_max_line_size - 1,
+                                  fieldlist_str, printf_str, buffer_header->version);
+    }
+
+    if (bytes > 0) {
+      fmt_buf_bytes += bytes;
+      fmt_buf[fmt_buf_bytes++] = '\n';
+    }
+  }
+
+  *len = (int) fmt_buf_bytes;
+  return fmt_buf;
+}
+
+/*-------------------------------------------------------------------------
+  LogFile::write_in_order
+
+  The reorder stage of the parallel flush.  Jobs arrive from the workers
+  in any order; whichever worker finds the file free writes every job
+  that is next in sequence, and the others leave theirs queued for it.
+  The written jobs are finished only once this file is let go of, since
+  the flush thread may delete the file as soon as the pool is empty.
+  -------------------------------------------------------------------------*/
+
+void
+LogFile::write_in_order(LogFlushJob * job, LogFlushPool * pool)
+{
+  Queue<LogFlushJob> written;
+  LogFlushJob *after;
+
+  ink_mutex_acquire(&m_order_mutex);
+  for (after = m_order_pending.tail; after && after->seq > job->seq; after = after->link.prev);
+  m_order_pending.insert(job, after);
+
+  if (m_order_writing) {
+    ink_mutex_release(&m_order_mutex);
+    return;
+  }
+  m_order_writing = true;
+
+  while ((job = m_order_pending.head) && job->seq == m_order_write_seq) {
+    m_order_pending.remove(job);
+    ++m_order_write_seq;
+    ink_mutex_release(&m_order_mutex);
+
+    if (job->len > 0) {
+      int total_bytes = 0;
+
+      check_fd();
+      if (is_open() && !Log::config->logging_space_exhausted) {
+        while (total_bytes < job->len) {
+          ssize_t bytes_written = ::write(m_fd, job->data + total_bytes, job->len - total_bytes);
+
+          if (bytes_written < 0) {
+            Error("An error was encountered in writing to %s: %s.", ((m_name) ? m_name : "logfile"), strerror(errno));
+            break;
+          }
+          total_bytes += bytes_written;
+        }
+      }
+      if (!m_start_time)
+        m_start_time = job->low_timestamp;
+      m_end_time = job->high_timestamp;
+      m_bytes_written += total_bytes;
+    }
+    written.enqueue(job);
+
+    ink_mutex_acquire(&m_order_mutex);
+  }
+
+  m_order_writing = false;
+  ink_mutex_release(&m_order_mutex);
+
+  while ((job = written.dequeue())) {
+    pool->finish(job);
+  }
+}
+
 /*-------------------------------------------------------------------------
   LogFile::writeln
 
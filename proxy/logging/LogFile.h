@@ -32,6 +32,9 @@
 #include "libts.h"
 #include "LogFormatType.h"
 #include "LogBufferSink.h"
+#include "LogFlushPool.h"
+
+class LogColumnarWriter;
 
 class LogSock;
 class LogBuffer;
@@ -155,11 +158,17 @@ public:
 
   LogFileFormat get_format() const { return m_file_format; }
   const char *get_format_name() const {
-    return (m_file_format == BINARY_LOG ? "binary" : (m_file_format == ASCII_PIPE ? "ascii_pipe" : "ascii"));
+    return (m_file_format == BINARY_LOG ? "binary" : (m_file_format == ASCII_PIPE ? "ascii_pipe" :
+                                                      (m_file_format == COLUMNAR_LOG ? "columnar" : "ascii")));
   }
 
   static int write_ascii_logbuffer(LogBufferHeader * buffer_header, int fd, const char *path, char *alt_format = NULL);
   int write_ascii_logbuffer3(LogBufferHeader * buffer_header, char *alt_format = NULL);
+
+  // Parallel flush (see LogFlushPool.h)
+  uint64_t next_flush_seq() { return m_order_next_seq++; }
+  char *format_ascii_logbuffer(LogBufferHeader * buffer_header, int *len);
+  void write_in_order(LogFlushJob * job, LogFlushPool * pool);
   static bool rolled_logfile(char *file);
   static bool exists(const char *pathname);
 
@@ -201,6 +210,7 @@ private:
   size_t m_overspill_report_count;      // number of attempts at which
   // overspill report is written to
   // diags log
+  LogColumnarWriter *m_columnar;        // encoder of COLUMNAR_LOG files
 
   int m_fd;
   long m_start_time;
@@ -208,6 +218,13 @@ private:
   uint64_t m_bytes_written;
   off_t m_size_bytes;           // current size of file in bytes
 
+  // reorder stage of the parallel flush
+  ink_mutex m_order_mutex;
+  Queue<LogFlushJob> m_order_pending;   // formatted, sorted by seq
+  uint64_t m_order_next_seq;    // given to the next buffer dispatched
+  uint64_t m_order_write_seq;   // next to be written
+  bool m_order_writing;         // a worker holds the right to write
+
 public:
   Link<LogFile> link;
 
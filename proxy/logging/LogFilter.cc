@@ -32,6 +32,7 @@
 #include "Error.h"
 #include "LogUtils.h"
 #include "LogFilter.h"
+#include "LogFilterProgram.h"
 #include "LogField.h"
 #include "LogFormat.h"
 #include "LogFile.h"
@@ -547,7 +548,7 @@ filters_are_equal(LogFilter * filt1, LogFilter * filt2)
   add() function is overloaded for each sub-type of LogFilter.
   -------------------------------------------------------------------------*/
 
-LogFilterList::LogFilterList():m_does_conjunction(true)
+LogFilterList::LogFilterList():m_program(NULL), m_does_conjunction(true)
 {
 }
 
@@ -596,6 +597,19 @@ LogFilterList::clear()
   while ((f = m_filter_list.dequeue())) {
     delete f;                   // safe given the semantics stated above
   }
+  invalidate();
+}
+
+/*-------------------------------------------------------------------------
+  The program points into the filters, so it goes whenever they change.
+  Filters are only changed while the list is not in use for logging.
+  -------------------------------------------------------------------------*/
+
+void
+LogFilterList::invalidate()
+{
+  delete m_program;
+  m_program = NULL;
 }
 
 /*-------------------------------------------------------------------------
@@ -616,6 +630,7 @@ LogFilterList::add(LogFilter * filter, bool copy)
   } else {
     m_filter_list.enqueue(filter);
   }
+  invalidate();
 }
 
 /*-------------------------------------------------------------------------
@@ -623,25 +638,22 @@ LogFilterList::add(LogFilter * filter, bool copy)
 
 bool LogFilterList::toss_this_entry(LogAccess * lad)
 {
-  if (m_does_conjunction) {
-    // toss if any filter rejects the entry (all filters should accept)
-    //
-    for (LogFilter * f = first(); f; f = next(f)) {
-      if (f->toss_this_entry(lad)) {
-        return true;
-      }
-    }
-    return false;
-  } else {
-    // toss if all filters reject the entry (any filter accepts)
-    //
-    for (LogFilter * f = first(); f; f = next(f)) {
-      if (!f->toss_this_entry(lad)) {
-        return false;
-      }
+  // conjunction: toss if any filter rejects the entry (all filters should accept)
+  // disjunction: toss if all filters reject the entry (any filter accepts)
+  if (m_filter_list.head == NULL) {
+    return !m_does_conjunction;
+  }
+
+  LogFilterProgram *program = m_program;
+
+  if (program == NULL) {
+    program = NEW(new LogFilterProgram(*this));
+    if (!ink_atomic_cas(&m_program, (LogFilterProgram *) NULL, program)) {
+      delete program;
+      program = m_program;
     }
-    return true;
   }
+  return program->toss_this_entry(lad);
 }
 
 /*-------------------------------------------------------------------------
@@ -30,6 +30,8 @@
 #include "LogField.h"
 #include "LogFormat.h"
 
+class LogFilterProgram;
+
 /*-------------------------------------------------------------------------
   LogFilter
 
@@ -84,6 +86,8 @@ public:
   void reverse() { m_action = (m_action == REJECT ? ACCEPT : REJECT); }
 
 protected:
+  friend class LogFilterProgram;
+
   char *m_name;
   LogField *m_field;
   Action m_action;              // the action this filter takes
@@ -120,6 +124,8 @@ public:
   void display_as_XML(FILE * fd = stdout);
 
 private:
+  friend class LogFilterProgram;
+
   char **m_value;               // the array of values
 
   // these are used to speed up case insensitive operations
@@ -175,6 +181,8 @@ public:
   void display_as_XML(FILE * fd = stdout);
 
 private:
+  friend class LogFilterProgram;
+
   int64_t *m_value;            // the array of values
 
   void _setValues(size_t n, int64_t *value);
@@ -211,10 +219,13 @@ public:
   void display_as_XML(FILE * fd = stdout);
 
   bool does_conjunction() const { return m_does_conjunction;  };
-  void set_conjunction(bool c) { m_does_conjunction = c;  };
+  void set_conjunction(bool c) { m_does_conjunction = c; invalidate(); };
 
 private:
+  void invalidate();
+
   Queue<LogFilter> m_filter_list;
+  LogFilterProgram *m_program;  // compiled by toss_this_entry()
 
   bool m_does_conjunction;
   // If m_does_conjunction = true
@@ -0,0 +1,501 @@
+/** @file
+
+  Log filter lists compiled for evaluation
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+#include "LogAccess.h"
+#include "LogField.h"
+#include "LogFilter.h"
+#include "LogFilterProgram.h"
+
+// integer filters with more values than this use a hash set
+#define LOG_FILTER_PROGRAM_MAX_INT_LIST 4
+
+// the fields of an entry are marshaled on the stack up to these limits
+#define LOG_FILTER_PROGRAM_STACK_FIELDS 16
+#define LOG_FILTER_PROGRAM_STACK_BYTES 2048
+
+// A field of the entry being filtered, marshaled on first use
+struct LogFilterValue
+{
+  bool ready;
+  int64_t ival;
+  char *str;
+  size_t len;                   // strlen(str)
+  char *upper;                  // str uppercased, if a predicate needs it
+  bool str_on_heap;
+  bool upper_on_heap;
+};
+
+static inline uint32_t
+log_filter_hash(const char *s, size_t len, bool upper)
+{
+  uint32_t h = 2166136261U;
+
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ (unsigned char) (upper ? ParseRules::ink_toupper(s[i]) : s[i])) * 16777619U;
+  }
+  return h;
+}
+
+static inline uint32_t
+log_filter_hash(int64_t v)
+{
+  return (uint32_t) (((uint64_t) v * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+/*-------------------------------------------------------------------------
+  LogFilterProgram::LogFilterProgram
+  -------------------------------------------------------------------------*/
+
+LogFilterProgram::LogFilterProgram(const LogFilterList & list)
+  : m_preds(NULL), m_num_preds(0), m_fields(NULL), m_num_fields(0), m_conjunction(list.does_conjunction()),
+    m_always_keep(false)
+{
+  int n = 0;
+
+  for (LogFilter * f = list.first(); f; f = list.next(f)) {
+    n++;
+  }
+  m_preds = (Pred *) ats_malloc(n * sizeof(Pred));
+  m_fields = (Field *) ats_malloc(n * sizeof(Field));
+
+  for (LogFilter * f = list.first(); f; f = list.next(f)) {
+    // a filter without values never tosses an entry
+    if (f->m_num_values == 0 || f->m_field == NULL) {
+      if (!m_conjunction) {
+        m_always_keep = true;
+      }
+      continue;
+    }
+
+    Pred *p = &m_preds[m_num_preds];
+
+    memset(p, 0, sizeof(Pred));
+    p->reject = (f->m_action == LogFilter::REJECT);
+    p->num_values = f->m_num_values;
+
+    if (f->type() == LogFilter::INT_FILTER) {
+      LogFilterInt *fi = (LogFilterInt *) f;
+
+      // all operators mean MATCH for integers
+      p->field = add_field(f->m_field, true);
+      p->ints = fi->m_value;
+      if (p->num_values == 1) {
+        p->type = PRED_INT;
+        p->value = fi->m_value[0];
+        p->cost = 1;
+      } else if (p->num_values <= LOG_FILTER_PROGRAM_MAX_INT_LIST) {
+        p->type = PRED_INT_LIST;
+        p->cost = 2;
+      } else {
+        p->type = PRED_INT_SET;
+        p->cost = 3;
+        build_set(p);
+      }
+    } else {
+      LogFilterString *fs = (LogFilterString *) f;
+
+      p->field = add_field(f->m_field, false);
+      p->lens = fs->m_length;
+      switch (f->m_operator) {
+      case LogFilter::MATCH:
+        p->type = PRED_MATCH;
+        p->strs = fs->m_value;
+        p->cost = 6;
+        build_set(p);
+        break;
+      case LogFilter::CASE_INSENSITIVE_MATCH:
+        p->type = PRED_CASE_MATCH;
+        p->strs = fs->m_value_uppercase;
+        p->cost = 7;
+        build_set(p);
+        break;
+      case LogFilter::CONTAIN:
+        p->type = PRED_CONTAIN;
+        p->strs = fs->m_value;
+        p->cost = 8 + 4 * (int) p->num_values;
+        break;
+      case LogFilter::CASE_INSENSITIVE_CONTAIN:
+      default:
+        p->type = PRED_CASE_CONTAIN;
+        p->strs = fs->m_value_uppercase;
+        p->cost = 10 + 4 * (int) p->num_values;
+        m_fields[p->field].needs_upper = true;
+        break;
+      }
+    }
+    m_num_preds++;
+  }
+
+  // cheapest first; filters of equal cost keep their order
+  for (int i = 1; i < m_num_preds; i++) {
+    Pred p = m_preds[i];
+    int j = i;
+
+    for (; j > 0 && m_preds[j - 1].cost > p.cost; j--) {
+      m_preds[j] = m_preds[j - 1];
+    }
+    m_preds[j] = p;
+  }
+}
+
+LogFilterProgram::~LogFilterProgram()
+{
+  for (int i = 0; i < m_num_preds; i++) {
+    ats_free(m_preds[i].set);
+  }
+  ats_free(m_preds);
+  ats_free(m_fields);
+}
+
+int
+LogFilterProgram::add_field(LogField *field, bool is_int)
+{
+  for (int i = 0; i < m_num_fields; i++) {
+    if (m_fields[i].is_int == is_int && *m_fields[i].field == *field) {
+      return i;
+    }
+  }
+  m_fields[m_num_fields].field = field;
+  m_fields[m_num_fields].is_int = is_int;
+  m_fields[m_num_fields].needs_upper = false;
+  return m_num_fields++;
+}
+
+void
+LogFilterProgram::build_set(Pred *p)
+{
+  unsigned slots = 8;
+
+  while (slots < 2 * p->num_values) {
+    slots <<= 1;
+  }
+  p->set_mask = slots - 1;
+  p->set = (int *) ats_calloc(slots, sizeof(int));
+
+  for (size_t i = 0; i < p->num_values; i++) {
+    uint32_t h = p->ints ? log_filter_hash(p->ints[i]) : log_filter_hash(p->strs[i], p->lens[i], false);
+
+    while (p->set[h & p->set_mask]) {
+      h++;
+    }
+    p->set[h & p->set_mask] = (int) i + 1;
+  }
+}
+
+/*-------------------------------------------------------------------------
+  LogFilterProgram::toss_this_entry
+  -------------------------------------------------------------------------*/
+
+bool
+LogFilterProgram::toss_this_entry(LogAccess *lad)
+{
+  if (m_always_keep || lad == NULL) {
+    return false;
+  }
+
+  LogFilterValue stack_values[LOG_FILTER_PROGRAM_STACK_FIELDS];
+  LogFilterValue *values = stack_values;
+  char arena[LOG_FILTER_PROGRAM_STACK_BYTES];
+  size_t arena_used = 0;
+  // what the list decides if no filter does
+  bool toss = !m_conjunction;
+
+  if (m_num_fields > LOG_FILTER_PROGRAM_STACK_FIELDS) {
+    values = (LogFilterValue *) ats_malloc(m_num_fields * sizeof(LogFilterValue));
+  }
+  for (int i = 0; i < m_num_fields; i++) {
+    values[i].ready = false;
+  }
+
+  for (int i = 0; i < m_num_preds; i++) {
+    Pred *p = &m_preds[i];
+    Field *f = &m_fields[p->field];
+    LogFilterValue *v = &values[p->field];
+    bool cond = false;
+
+    if (!v->ready) {
+      v->ready = true;
+      v->str = NULL;
+      v->upper = NULL;
+      v->str_on_heap = v->upper_on_heap = false;
+      if (f->is_int) {
+        f->field->marshal(lad, (char *) &v->ival);
+      } else {
+        size_t marsh_len = f->field->marshal_len(lad);      // includes null termination
+
+        if (arena_used + marsh_len <= sizeof(arena)) {
+          v->str = arena + arena_used;
+          arena_used += marsh_len;
+        } else {
+          v->str = (char *) ats_malloc(marsh_len);
+          v->str_on_heap = true;
+        }
+        f->field->marshal(lad, v->str);
+        v->len = strlen(v->str);
+        if (f->needs_upper) {
+          if (arena_used + v->len + 1 <= sizeof(arena)) {
+            v->upper = arena + arena_used;
+            arena_used += v->len + 1;
+          } else {
+            v->upper = (char *) ats_malloc(v->len + 1);
+            v->upper_on_heap = true;
+          }
+          for (size_t j = 0; j <= v->len; j++) {
+            v->upper[j] = ParseRules::ink_toupper(v->str[j]);
+          }
+        }
+      }
+    }
+
+    switch (p->type) {
+    case PRED_INT:
+      cond = (v->ival == p->value);
+      break;
+    case PRED_INT_LIST:
+      for (size_t j = 0; j < p->num_values; j++) {
+        if (v->ival == p->ints[j]) {
+          cond = true;
+          break;
+        }
+      }
+      break;
+    case PRED_INT_SET:
+      for (uint32_t h = log_filter_hash(v->ival); p->set[h & p->set_mask]; h++) {
+        if (p->ints[p->set[h & p->set_mask] - 1] == v->ival) {
+          cond = true;
+          break;
+        }
+      }
+      break;
+    case PRED_MATCH:
+    case PRED_CASE_MATCH:
+      {
+        bool upper = (p->type == PRED_CASE_MATCH);
+
+        for (uint32_t h = log_filter_hash(v->str, v->len, upper); p->set[h & p->set_mask]; h++) {
+          int k = p->set[h & p->set_mask] - 1;
+
+          if (p->lens[k] != v->len) {
+            continue;
+          }
+          if (!upper) {
+            cond = (memcmp(p->strs[k], v->str, v->len) == 0);
+          } else {
+            size_t j = 0;
+
+            while (j < v->len && ParseRules::ink_toupper(v->str[j]) == p->strs[k][j]) {
+              j++;
+            }
+            cond = (j == v->len);
+          }
+          if (cond) {
+            break;
+          }
+        }
+      }
+      break;
+    case PRED_CONTAIN:
+    case PRED_CASE_CONTAIN:
+      {
+        const char *s = (p->type == PRED_CONTAIN ? v->str : v->upper);
+
+        for (size_t j = 0; j < p->num_values; j++) {
+          if (v->len >= p->lens[j] && strstr(s, p->strs[j]) != NULL) {
+            cond = true;
+            break;
+          }
+        }
+      }
+      break;
+    }
+
+    // REJECT tosses entries meeting its condition, ACCEPT the others
+    if (p->reject == cond) {
+      if (m_conjunction) {
+        toss = true;
+        break;
+      }
+    } else if (!m_conjunction) {
+      toss = false;
+      break;
+    }
+  }
+
+  for (int i = 0; i < m_num_fields; i++) {
+    if (values[i].ready) {
+      if (values[i].str_on_heap) {
+        ats_free(values[i].str);
+      }
+      if (values[i].upper_on_heap) {
+        ats_free(values[i].upper);
+      }
+    }
+  }
+  if (values != stack_values) {
+    ats_free(values);
+  }
+  return toss;
+}
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+#include "LogAccessTest.h"
+#include "Log.h"
+
+#define LOG_FILTER_PROGRAM_TEST_FILTERS 24
+#define LOG_FILTER_PROGRAM_TEST_ENTRIES 20000
+
+// A spread of every kind of predicate.  A disjunction gets the same
+// filters made to ACCEPT, less the method one that would keep everything.
+static void
+log_filter_program_test_list(LogFilterList *list, bool conjunction)
+{
+  LogFilter::Action action = conjunction ? LogFilter::REJECT : LogFilter::ACCEPT;
+  LogField *status = Log::global_field_list.find_by_symbol("pssc");
+  LogField *length = Log::global_field_list.find_by_symbol("pscl");
+  LogField *url = Log::global_field_list.find_by_symbol("cqu");
+  LogField *host = Log::global_field_list.find_by_symbol("shn");
+  LogField *method = Log::global_field_list.find_by_symbol("cqhm");
+  char *values = (char *) ats_malloc(16384);
+  char name[64];
+
+  for (int k = 0; k < LOG_FILTER_PROGRAM_TEST_FILTERS; k++) {
+    LogFilter *f = NULL;
+    int len = 0;
+
+    snprintf(name, sizeof(name), "filter%d", k);
+    values[0] = '\0';
+    switch (k % 6) {
+    case 0:
+      f = NEW(new LogFilterInt(name, status, action, LogFilter::MATCH, (char *) (k < 6 ? "404" : "500,502,503,504")));
+      break;
+    case 1:
+      for (unsigned n = 0; n < 64; n++) {
+        len += snprintf(values + len, 16384 - len, "%s%u", n ? "," : "", 1000 + ((n * 97 + k) * 7919) % 50000);
+      }
+      f = NEW(new LogFilterInt(name, length, action, LogFilter::MATCH, values));
+      break;
+    case 2:
+      for (int n = 0; n < 100; n++) {
+        len += snprintf(values + len, 16384 - len, "%shttp://elsewhere%d.example.com/%d", n ? "," : "", k, n);
+      }
+      f = NEW(new LogFilterString(name, url, action, LogFilter::MATCH, values));
+      break;
+    case 3:
+      for (int n = 0; n < 100; n++) {
+        len += snprintf(values + len, 16384 - len, "%sHTTP://HOST%d.EXAMPLE.COM/PATH/%d/OBJECT%d.JPG", n ? "," : "",
+                        k % 7, n % 13, (n * 11 + k) % 61);
+      }
+      f = NEW(new LogFilterString(name, url, action, LogFilter::CASE_INSENSITIVE_MATCH, values));
+      break;
+    case 4:
+      snprintf(values, 16384, "object%d.jpg,badhost,/path/%d/", k % 61, k % 13);
+      f = NEW(new LogFilterString(name, (k & 1) ? url : host, action,
+                                  (k < 12) ? LogFilter::CONTAIN : LogFilter::CASE_INSENSITIVE_CONTAIN, values));
+      break;
+    case 5:
+      if (conjunction) {
+        f = NEW(new LogFilterString(name, method, LogFilter::ACCEPT, LogFilter::CASE_INSENSITIVE_MATCH,
+                                    (char *) "get,head,post"));
+      }
+      break;
+    }
+    if (f) {
+      list->add(f, false);
+    }
+  }
+  ats_free(values);
+}
+
+// What LogFilterList decided before it had a program: ask each filter.
+static bool
+log_filter_program_test_reference(LogFilterList *list, LogAccess *lad)
+{
+  bool conjunction = list->does_conjunction();
+
+  for (LogFilter * f = list->first(); f; f = list->next(f)) {
+    if (f->toss_this_entry(lad) == conjunction) {
+      return conjunction;
+    }
+  }
+  return !conjunction;
+}
+
+// Compares the decisions of the program with those of the filters one
+// by one, for conjunctions and disjunctions, and times both.
+REGRESSION_TEST(LogFilterProgram_Toss)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox tb(t, pstatus);
+  LogAccessTestSpread lad;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  for (int conjunction = 1; conjunction >= 0; conjunction--) {
+    const char *kind = conjunction ? "conjunction" : "disjunction";
+    LogFilterList list;
+    int tossed = 0, mismatches = 0;
+    ink_hrtime reference_time = 0, program_time = 0;
+
+    list.set_conjunction(conjunction);
+    log_filter_program_test_list(&list, conjunction);
+
+    for (lad.n = 0; lad.n < LOG_FILTER_PROGRAM_TEST_ENTRIES; lad.n++) {
+      ink_hrtime start = ink_get_hrtime_internal();
+      bool expected = log_filter_program_test_reference(&list, &lad);
+      ink_hrtime middle = ink_get_hrtime_internal();
+      bool toss = list.toss_this_entry(&lad);
+
+      program_time += ink_get_hrtime_internal() - middle;
+      reference_time += middle - start;
+      if (toss != expected) {
+        ++mismatches;
+      }
+      if (toss) {
+        ++tossed;
+      }
+    }
+
+    LogFilterProgram program(list);
+
+    tb.check(mismatches == 0, "%s: %d entries decided differently", kind, mismatches);
+    tb.check(tossed > 0 && tossed < LOG_FILTER_PROGRAM_TEST_ENTRIES, "%s: %d of %d entries tossed", kind, tossed,
+             LOG_FILTER_PROGRAM_TEST_ENTRIES);
+    rprintf(t, "%s: %d filters, %d predicates over %d fields, %d of %d tossed, %d ns/entry filter by filter, "
+            "%d ns/entry compiled\n", kind, (int) list.count(), program.num_preds(), program.num_fields(), tossed,
+            LOG_FILTER_PROGRAM_TEST_ENTRIES, (int) (reference_time / LOG_FILTER_PROGRAM_TEST_ENTRIES),
+            (int) (program_time / LOG_FILTER_PROGRAM_TEST_ENTRIES));
+    if (conjunction) {
+      rperf(t, "log_filter_list_ns_per_entry", (double) reference_time / LOG_FILTER_PROGRAM_TEST_ENTRIES);
+      rperf(t, "log_filter_program_ns_per_entry", (double) program_time / LOG_FILTER_PROGRAM_TEST_ENTRIES);
+    }
+  }
+
+  // an empty disjunction tosses everything, an empty conjunction nothing
+  LogFilterList empty;
+
+  tb.check(!empty.toss_this_entry(&lad), "empty conjunction tosses");
+  empty.set_conjunction(false);
+  tb.check(empty.toss_this_entry(&lad), "empty disjunction keeps");
+}
+#endif /* TS_HAS_TESTS */
@@ -0,0 +1,115 @@
+/** @file
+
+  Log filter lists compiled for evaluation
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+   LogFilterProgram.h
+
+   Description:
+     Asking each LogFilter of a list in turn marshals a field once per
+     filter that uses it, and compares string and integer values one by
+     one.  A LogFilterProgram turns the whole list into predicates over
+     the distinct fields it uses:
+
+       - a field is marshaled at most once per entry, and only if a
+         predicate gets to look at it;
+       - MATCH and CASE_INSENSITIVE_MATCH string values, and integer
+         values past a handful, go in hash sets;
+       - predicates run cheapest first, so the list stops at the first
+         filter that decides it without paying for the dear ones.
+
+     Its decisions are the same as LogFilterList's were.  LogFilterList
+     compiles its program on first use and drops it when filters change.
+
+ ****************************************************************************/
+
+#ifndef LOG_FILTER_PROGRAM_H
+#define LOG_FILTER_PROGRAM_H
+
+#include "libts.h"
+
+class LogAccess;
+class LogField;
+class LogFilterList;
+
+class LogFilterProgram
+{
+public:
+  enum PredType
+  {
+    PRED_INT,                   // one value
+    PRED_INT_LIST,              // a few values, compared in turn
+    PRED_INT_SET,
+    PRED_MATCH,                 // string hash set
+    PRED_CASE_MATCH,            // hash set of uppercased strings
+    PRED_CONTAIN,
+    PRED_CASE_CONTAIN
+  };
+
+  struct Pred
+  {
+    PredType type;
+    int field;                  // into m_fields
+    bool reject;                // a REJECT filter
+    int cost;
+    int64_t value;              // PRED_INT
+    size_t num_values;
+    const int64_t *ints;        // the filter's values
+    char **strs;                // the filter's values, uppercased for PRED_CASE_*
+    size_t *lens;
+    unsigned set_mask;          // hash sets: slots - 1
+    int *set;                   // 1 + value index, 0 if free
+  };
+
+  struct Field
+  {
+    LogField *field;
+    bool is_int;
+    bool needs_upper;           // for PRED_CASE_CONTAIN
+  };
+
+  LogFilterProgram(const LogFilterList & list);
+  ~LogFilterProgram();
+
+  bool toss_this_entry(LogAccess * lad);
+
+  int num_preds() const { return m_num_preds; }
+  int num_fields() const { return m_num_fields; }
+
+private:
+  int add_field(LogField * field, bool is_int);
+  void build_set(Pred * p);
+
+  Pred *m_preds;
+  int m_num_preds;
+  Field *m_fields;
+  int m_num_fields;
+  bool m_conjunction;
+  bool m_always_keep;           // an empty filter in a disjunction
+
+  // -- member functions not allowed --
+  LogFilterProgram(const LogFilterProgram &);
+  LogFilterProgram & operator=(const LogFilterProgram &);
+};
+
+#endif
@@ -0,0 +1,263 @@
+/** @file
+
+  A pool of threads formatting and writing ASCII log buffers
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/***************************************************************************
+ LogFlushPool.cc
+
+
+ ***************************************************************************/
+#include "libts.h"
+
+#include "Error.h"
+#include "P_EventSystem.h"
+#include "LogBuffer.h"
+#include "LogFile.h"
+#include "LogObject.h"
+#include "LogConfig.h"
+#include "Log.h"
+#include "LogFlushPool.h"
+
+enum
+{
+  LOG_FLUSH_WORKER_BUFFERS,
+  LOG_FLUSH_WORKER_BYTES,
+  LOG_FLUSH_WORKER_STATS
+};
+
+struct LogFlushWorkerContinuation: public Continuation
+{
+  LogFlushPool *pool;
+  int worker;
+
+  int mainEvent(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+  {
+    pool->worker_main(worker);
+    return 0;
+  }
+
+  LogFlushWorkerContinuation(LogFlushPool *p, int w):Continuation(NULL), pool(p), worker(w)
+  {
+    SET_HANDLER(&LogFlushWorkerContinuation::mainEvent);
+  }
+};
+
+LogFlushPool::LogFlushPool()
+  : m_num_workers(0), m_pending(0), m_rsb(NULL)
+{
+  ink_mutex_init(&m_mutex, "LogFlushPool");
+  ink_cond_init(&m_work_cond);
+  ink_cond_init(&m_space_cond);
+}
+
+// The workers never exit; a pool lives as long as the process.
+LogFlushPool::~LogFlushPool()
+{
+  ink_release_assert(m_num_workers == 0);
+  ink_mutex_destroy(&m_mutex);
+  ink_cond_destroy(&m_work_cond);
+  ink_cond_destroy(&m_space_cond);
+}
+
+void
+LogFlushPool::start(int n_workers, const char *stat_prefix)
+{
+  char name[64];
+
+  ink_assert(m_num_workers == 0 && n_workers > 0);
+  m_rsb = RecAllocateRawStatBlock(n_workers * LOG_FLUSH_WORKER_STATS);
+  for (int i = 0; i < n_workers; i++) {
+    snprintf(name, sizeof(name), "proxy.process.log.%s_worker_%d.buffers", stat_prefix, i);
+    RecRegisterRawStat(m_rsb, RECT_PROCESS, name, RECD_COUNTER, RECP_NON_PERSISTENT,
+                       i * LOG_FLUSH_WORKER_STATS + LOG_FLUSH_WORKER_BUFFERS, RecRawStatSyncSum);
+    snprintf(name, sizeof(name), "proxy.process.log.%s_worker_%d.bytes", stat_prefix, i);
+    RecRegisterRawStat(m_rsb, RECT_PROCESS, name, RECD_COUNTER, RECP_NON_PERSISTENT,
+                       i * LOG_FLUSH_WORKER_STATS + LOG_FLUSH_WORKER_BYTES, RecRawStatSyncSum);
+  }
+
+  m_num_workers = n_workers;
+  for (int i = 0; i < n_workers; i++) {
+    snprintf(name, sizeof(name), "[LOG_FLUSH %d]", i);
+    eventProcessor.spawn_thread(NEW(new LogFlushWorkerContinuation(this, i)), name);
+  }
+  Debug("log-flush", "started %d log flush workers", n_workers);
+}
+
+void
+LogFlushPool::dispatch(LogFile *file, LogBuffer *lb)
+{
+  LogFlushJob *job = NEW(new LogFlushJob);
+
+  job->file = file;
+  job->buffer = lb;
+  job->seq = file->next_flush_seq();
+  job->data = NULL;
+  job->len = 0;
+  job->low_timestamp = 0;
+  job->high_timestamp = 0;
+
+  ink_mutex_acquire(&m_mutex);
+  while (m_pending >= FLUSH_ARRAY_SIZE) {
+    ink_cond_wait(&m_space_cond, &m_mutex);
+  }
+  m_jobs.enqueue(job);
+  ++m_pending;
+  ink_cond_signal(&m_work_cond);
+  ink_mutex_release(&m_mutex);
+
+  LOG_SUM_GLOBAL_DYN_STAT(log_stat_flush_queue_depth_stat, 1);
+}
+
+void
+LogFlushPool::drain()
+{
+  ink_mutex_acquire(&m_mutex);
+  while (m_pending > 0) {
+    ink_cond_wait(&m_space_cond, &m_mutex);
+  }
+  ink_mutex_release(&m_mutex);
+}
+
+// Called by the file's writer once the job's text is written
+void
+LogFlushPool::finish(LogFlushJob *job)
+{
+  ats_free(job->data);
+  delete job;
+
+  ink_mutex_acquire(&m_mutex);
+  --m_pending;
+  ink_cond_broadcast(&m_space_cond);
+  ink_mutex_release(&m_mutex);
+
+  LOG_SUM_GLOBAL_DYN_STAT(log_stat_flush_queue_depth_stat, -1);
+}
+
+void *
+LogFlushPool::worker_main(int worker)
+{
+  LogFlushJob *job;
+
+  Debug("log-flush", "log flush worker %d is alive ...", worker);
+
+  while (true) {
+    ink_mutex_acquire(&m_mutex);
+    while (!(job = m_jobs.dequeue())) {
+      ink_cond_wait(&m_work_cond, &m_mutex);
+    }
+    ink_mutex_release(&m_mutex);
+
+    LogBufferHeader *h = job->buffer->header();
+
+    job->low_timestamp = h->low_timestamp;
+    job->high_timestamp = h->high_timestamp;
+    if (h->entry_count > 0) {
+      job->data = job->file->format_ascii_logbuffer(h, &job->len);
+    }
+    delete job->buffer;
+    job->buffer = NULL;
+
+    RecIncrGlobalRawStatSum(m_rsb, worker * LOG_FLUSH_WORKER_STATS + LOG_FLUSH_WORKER_BUFFERS, 1);
+    RecIncrGlobalRawStatSum(m_rsb, worker * LOG_FLUSH_WORKER_STATS + LOG_FLUSH_WORKER_BYTES, job->len);
+
+    job->file->write_in_order(job, this);
+  }
+
+  /* NOTREACHED */
+  return NULL;
+}
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+
+#define LOG_FLUSH_POOL_TEST_WORKERS 4
+#define LOG_FLUSH_POOL_TEST_ENTRIES 50000
+
+// Writes the same entries through the flush thread path, a pool of one
+// worker and a pool of several, checks that each file reads in the
+// order logged, and reports the flush time per entry.
+REGRESSION_TEST(LogFlushPool_Order)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  static LogFlushPool *pools[2];
+  static const int workers[] = { 0, 1, LOG_FLUSH_POOL_TEST_WORKERS };
+  static const char *stat_prefixes[] = { "flush_test_single", "flush_test_multi" };
+  TestBox tb(t, pstatus);
+  char entry[64], line[128];
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  for (unsigned mode = 0; mode < countof(workers); mode++) {
+    LogFlushPool *pool = NULL;
+
+    if (mode > 0) {
+      if (pools[mode - 1] == NULL) {
+        pools[mode - 1] = NEW(new LogFlushPool);
+        pools[mode - 1]->start(workers[mode], stat_prefixes[mode - 1]);
+      }
+      pool = pools[mode - 1];
+    }
+
+    TextLogObject *obj = NEW(new TextLogObject("log_flush_pool_test", Log::config->logfile_dir, false, NULL,
+                                               LogConfig::NO_ROLLING));
+    char *filename = ats_strdup(obj->get_full_filename());
+
+    for (int i = 0; i < LOG_FLUSH_POOL_TEST_ENTRIES; i++) {
+      snprintf(entry, sizeof(entry), "log flush pool entry %d", i);
+      obj->log(NULL, entry);
+    }
+    obj->force_new_buffer();
+
+    ink_hrtime start = ink_get_hrtime_internal();
+    size_t buffers = obj->flush_buffers(pool);
+    if (pool)
+      pool->drain();
+    ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+
+    FILE *fp = fopen(filename, "r");
+    int n = 0, out_of_order = 0;
+
+    tb.check(fp != NULL, "%d workers: could not open %s", workers[mode], filename);
+    while (fp && fgets(line, sizeof(line), fp)) {
+      char *num = strrchr(line, ' ');
+
+      if (num == NULL || atoi(num + 1) != n) {
+        ++out_of_order;
+      }
+      ++n;
+    }
+    if (fp)
+      fclose(fp);
+    tb.check(n == LOG_FLUSH_POOL_TEST_ENTRIES, "%d workers: %d lines written, expected %d", workers[mode], n,
+             LOG_FLUSH_POOL_TEST_ENTRIES);
+    tb.check(out_of_order == 0, "%d workers: %d lines out of order", workers[mode], out_of_order);
+
+    rprintf(t, "%d workers: %d buffers, %d ns per entry\n", workers[mode], (int) buffers,
+            (int) (elapsed / LOG_FLUSH_POOL_TEST_ENTRIES));
+    snprintf(entry, sizeof(entry), "log_flush_%d_workers_ns_per_entry", workers[mode]);
+    rperf(t, entry, (double) elapsed / LOG_FLUSH_POOL_TEST_ENTRIES);
+
+    delete obj;
+    unlink(filename);
+    ats_free(filename);
+  }
+}
+#endif /* TS_HAS_TESTS */
@@ -0,0 +1,107 @@
+/** @file
+
+  A pool of threads formatting and writing ASCII log buffers
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+   LogFlushPool.h
+
+   Description:
+     With proxy.config.log.flush_threads above 1, the flush thread no
+     longer converts ASCII log buffers itself.  It gives each LogBuffer
+     of an ASCII LogFile a sequence number in that file and queues it
+     to a pool of worker threads.  A worker formats the buffer into a
+     private block of text and hands the block to the file's reorder
+     stage (LogFile::write_in_order()), which writes blocks strictly in
+     sequence order, so a file reads the same as with a single flush
+     thread.  Binary files and collation hosts are still written by
+     the flush thread.
+
+     The flush thread drains the pool at the end of each round, so
+     rolling, reconfiguration and LogObject deletion never race with
+     a worker.
+
+ ****************************************************************************/
+
+#ifndef LOG_FLUSH_POOL_H
+#define LOG_FLUSH_POOL_H
+
+#include "libts.h"
+
+class LogBuffer;
+class LogFile;
+struct RecRawStatBlock;
+
+// A buffer on its way through the pool, then its formatted text
+struct LogFlushJob
+{
+  LogFile *file;
+  LogBuffer *buffer;
+  uint64_t seq;                 // position in file
+  char *data;                   // formatted text
+  int len;
+  uint32_t low_timestamp;
+  uint32_t high_timestamp;
+
+  LINK(LogFlushJob, link);
+};
+
+class LogFlushPool
+{
+public:
+  LogFlushPool();
+  ~LogFlushPool();
+
+  /** Start @a n_workers threads, with stats named
+      proxy.process.log.<stat_prefix>_worker_<n>.{buffers,bytes}.
+  */
+  void start(int n_workers, const char *stat_prefix = "flush");
+  int num_workers() const { return m_num_workers; }
+
+  /** Queue @a lb, to be written to @a file after every buffer queued
+      for it before.  Takes ownership of @a lb.  Blocks while too many
+      buffers are in the pool.  Only the flush thread dispatches.
+  */
+  void dispatch(LogFile * file, LogBuffer * lb);
+
+  /** Wait until everything dispatched has been written. */
+  void drain();
+
+  void finish(LogFlushJob * job);
+
+  void *worker_main(int worker);
+
+private:
+  int m_num_workers;
+  ink_mutex m_mutex;
+  ink_cond m_work_cond;
+  ink_cond m_space_cond;        // signalled as jobs finish
+  Queue<LogFlushJob> m_jobs;
+  int m_pending;                // dispatched, not yet written
+  RecRawStatBlock *m_rsb;       // per worker stats
+
+  // -- member functions not allowed --
+  LogFlushPool(const LogFlushPool &);
+  LogFlushPool & operator=(const LogFlushPool &);
+};
+
+#endif
@@ -434,7 +434,7 @@ LogFormat::format_from_specification(char *spec, char **file_name, char **file_h
   *file_name = ats_strdup(token);
 
   //
-  // Next should be the file type, either "ASCII" or "BINARY"
+  // Next should be the file type, "ASCII", "BINARY" or "COLUMNAR"
   //
   token = tok.getNext();
   if (token == NULL) {
@@ -445,8 +445,10 @@ LogFormat::format_from_specification(char *spec, char **file_name, char **file_h
     *file_type = ASCII_LOG;
   } else if (!strcasecmp(token, "BINARY")) {
     *file_type = BINARY_LOG;
+  } else if (!strcasecmp(token, "COLUMNAR")) {
+    *file_type = COLUMNAR_LOG;
   } else {
-    Debug("log-format", "%s is not a valid file format (ASCII or BINARY)", token);
+    Debug("log-format", "%s is not a valid file format (ASCII, BINARY or COLUMNAR)", token);
     return NULL;
   }
 
@@ -42,6 +42,7 @@ enum LogFileFormat
   BINARY_LOG,
   ASCII_LOG,
   ASCII_PIPE,
+  COLUMNAR_LOG,
   N_LOGFILE_TYPES
 };
 
@@ -353,6 +353,7 @@ LogHost::write (LogBuffer *lb)
 int
 LogHost::orphan_write(LogBuffer * lb)
 {
+  LOG_SUM_GLOBAL_DYN_STAT(log_stat_collation_buffers_orphaned_stat, 1);
   if (!Log::config->logging_space_exhausted) {
     Debug("log-host", "Sending LogBuffer to orphan file %s", m_orphan_file->get_name());
     return m_orphan_file->write(lb);
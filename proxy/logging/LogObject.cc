@@ -38,11 +38,37 @@
 #include "LogAccess.h"
 #include "Log.h"
 #include "LogObject.h"
+#include "LogFlushPool.h"
 
-size_t
-LogBufferManager::flush_buffers(LogBufferSink *sink) {
+struct LogBufferFlushOrder
+{
+  int64_t timestamp;
+  int32_t timestamp_usec;
+  uint32_t id;
+  LogBuffer *buffer;
+};
+
+static int
+log_buffer_flush_order_cmp(const void *a, const void *b)
+{
+  const LogBufferFlushOrder *x = (const LogBufferFlushOrder *) a;
+  const LogBufferFlushOrder *y = (const LogBufferFlushOrder *) b;
+
+  if (x->timestamp != y->timestamp)
+    return x->timestamp < y->timestamp ? -1 : 1;
+  if (x->timestamp_usec != y->timestamp_usec)
+    return x->timestamp_usec < y->timestamp_usec ? -1 : 1;
+  return x->id < y->id ? -1 : (x->id > y->id ? 1 : 0);
+}
+
+// Take the buffers ready to be written, in the order of their first
+// entry: buffers filled side by side by different threads are written
+// in that order.  Entries are not merged across buffers.
+int
+LogBufferManager::_collect(LogBufferFlushOrder **order_out) {
   SList(LogBuffer, write_link) q(write_list.popall()), new_q;
   LogBuffer *b = NULL;
+  int n = 0;
   while ((b = q.pop())) {
     if (b->m_references) {  // Still has outstanding references.
       write_list.push(b);
@@ -52,22 +78,75 @@ LogBufferManager::flush_buffers(LogBufferSink *sink) {
       Warning("Dropping log buffer, can't keep up.");
     } else {
       new_q.push(b);
+      n++;
     }
   }
 
-  int flushed = 0;
+  if (n == 0) {
+    Debug("log-logbuffer", "flushed 0 buffers");
+    return 0;
+  }
+
+  LogBufferFlushOrder *order = (LogBufferFlushOrder *)ats_malloc(n * sizeof(LogBufferFlushOrder));
+  int i = 0;
+
   while ((b = new_q.pop())) {
+    LogBufferHeader *h;
+    LogEntryHeader *e;
+
     b->update_header_data();
+    h = b->header();
+    e = (LogEntryHeader *) ((char *) h + h->data_offset);
+    order[i].timestamp = h->entry_count ? e->timestamp : 0;
+    order[i].timestamp_usec = h->entry_count ? e->timestamp_usec : 0;
+    order[i].id = b->get_id();
+    order[i].buffer = b;
+    i++;
+  }
+  if (n > 1) {
+    qsort(order, n, sizeof(LogBufferFlushOrder), log_buffer_flush_order_cmp);
+  }
+  *order_out = order;
+  return n;
+}
+
+size_t
+LogBufferManager::flush_buffers(LogBufferSink *sink) {
+  LogBufferFlushOrder *order = NULL;
+  int n = _collect(&order);
+  int flushed = 0;
+
+  for (int i = 0; i < n; i++) {
+    LogBuffer *b = order[i].buffer;
     sink->write(b);
     delete b;
     ink_atomic_increment(&_num_flush_buffers, -1);
     flushed++;
   }
+  ats_free(order);
 
-  Debug("log-logbuffer", "flushed %d buffers", flushed);
+  if (n)
+    Debug("log-logbuffer", "flushed %d buffers", flushed);
   return flushed;
 }
 
+// The pool formats and writes the buffers, in the same order
+size_t
+LogBufferManager::flush_buffers(LogFile *file, LogFlushPool *pool) {
+  LogBufferFlushOrder *order = NULL;
+  int n = _collect(&order);
+
+  for (int i = 0; i < n; i++) {
+    pool->dispatch(file, order[i].buffer);
+    ink_atomic_increment(&_num_flush_buffers, -1);
+  }
+  ats_free(order);
+
+  if (n)
+    Debug("log-logbuffer", "queued %d buffers for %s", n, file->get_name());
+  return n;
+}
+
 /*-------------------------------------------------------------------------
   LogObject
   -------------------------------------------------------------------------*/
@@ -90,6 +169,8 @@ LogObject::LogObject(LogFormat *format, const char *log_dir,
 
     if (file_format == BINARY_LOG) {
         m_flags |= BINARY;
+    } else if (file_format == COLUMNAR_LOG) {
+        m_flags |= COLUMNAR;
     } else if (file_format == ASCII_PIPE) {
 #ifdef ASCII_PIPE_FORMAT_SUPPORTED
         m_flags |= WRITES_TO_PIPE;
@@ -117,9 +198,15 @@ LogObject::LogObject(LogFormat *format, const char *log_dir,
                                  Log::config->overspill_report_count));
 #endif // TS_MICRO
 
+    // compile the ASCII rendering of our format now, not at the first flush
+    if (file_format == ASCII_LOG || file_format == ASCII_PIPE) {
+      LogBuffer::render_program(m_format->fieldlist(), m_format->printf_str());
+    }
+
     LogBuffer *b = NEW (new LogBuffer (this, Log::config->log_buffer_size));
     ink_assert(b);
     SET_FREELIST_POINTER_VERSION(m_log_buffer, b, 0);
+    _init_thread_buffers();
 
     _setup_rolling(rolling_enabled, rolling_interval_sec, rolling_offset_hr, rolling_size_mb);
 
@@ -128,7 +215,8 @@ LogObject::LogObject(LogFormat *format, const char *log_dir,
 }
 
 LogObject::LogObject(LogObject& rhs)
-  : m_basename(ats_strdup(rhs.m_basename)),
+  : m_sampler(rhs.m_sampler),
+    m_basename(ats_strdup(rhs.m_basename)),
     m_filename(ats_strdup(rhs.m_filename)),
     m_alt_filename(ats_strdup(rhs.m_alt_filename)),
     m_flags(rhs.m_flags),
@@ -166,6 +254,7 @@ LogObject::LogObject(LogObject& rhs)
     LogBuffer *b = NEW (new LogBuffer (this, Log::config->log_buffer_size));
     ink_assert(b);
     SET_FREELIST_POINTER_VERSION(m_log_buffer, b, 0);
+    _init_thread_buffers();
 
     Debug("log-config", "exiting LogObject copy constructor, "
           "filename=%s this=%p", m_filename, this);
@@ -193,6 +282,57 @@ LogObject::~LogObject()
   ats_free(m_alt_filename);
   delete m_format;
   delete (LogBuffer*)FREELIST_POINTER(m_log_buffer);
+  for (int i = 0; i < m_num_thread_buffers; i++) {
+    delete (LogBuffer*)FREELIST_POINTER(m_thread_buffers[i].head);
+  }
+  ats_memalign_free(m_thread_buffers);
+}
+
+/*-------------------------------------------------------------------------
+  With proxy.config.log.per_thread_buffers set, each event thread that
+  exists when the object is created checks entries out of a buffer of
+  its own, so the net threads do not all update the same buffer head
+  and LogBuffer state.  Other threads share m_log_buffer.  A thread's
+  buffer is created the first time it logs.
+  -------------------------------------------------------------------------*/
+
+void
+LogObject::_init_thread_buffers()
+{
+  m_thread_buffers = NULL;
+  m_num_thread_buffers = 0;
+
+  if (Log::config->per_thread_buffers && eventProcessor.n_ethreads > 0) {
+    m_num_thread_buffers = eventProcessor.n_ethreads;
+    m_thread_buffers = (LogBufferSlot *)ats_memalign(LOG_BUFFER_SLOT_SIZE,
+                                                      m_num_thread_buffers * sizeof(LogBufferSlot));
+    for (int i = 0; i < m_num_thread_buffers; i++) {
+      SET_FREELIST_POINTER_VERSION(m_thread_buffers[i].head, NULL, 0);
+    }
+  }
+}
+
+volatile head_p *
+LogObject::_work_buffer_head()
+{
+  EThread *t = this_ethread();
+
+  if (m_thread_buffers == NULL || t == NULL || t->id < 0 || t->id >= m_num_thread_buffers) {
+    return &m_log_buffer;
+  }
+
+  volatile head_p *head = &m_thread_buffers[t->id].head;
+
+  // Only the owning thread sets its first buffer, other threads leave
+  // an empty slot alone
+  if (FREELIST_POINTER(*head) == NULL) {
+    head_p h;
+
+    SET_FREELIST_POINTER_VERSION(h, NEW(new LogBuffer(this, Log::config->log_buffer_size)), 0);
+    INK_WRITE_MEMORY_BARRIER;
+    head->data = h.data;
+  }
+  return head;
 }
 
 //-----------------------------------------------------------------------------
@@ -240,6 +380,10 @@ LogObject::generate_filenames(const char *log_dir, const char *basename, LogFile
       ext = ASCII_PIPE_OBJECT_FILENAME_EXTENSION;
       ext_len = 5;
       break;
+    case COLUMNAR_LOG:
+      ext = COLUMNAR_LOG_OBJECT_FILENAME_EXTENSION;
+      ext_len = 5;
+      break;
     default:
       ink_assert(!"unknown file format");
     }
@@ -337,7 +481,8 @@ uint64_t LogObject::compute_signature(LogFormat * format, char *filename, unsign
     char *buffer = (char *)ats_malloc(buf_size);
 
     ink_string_concatenate_strings(buffer, fl, ps, filename, flags & LogObject::BINARY ? "B" :
-                                   (flags & LogObject::WRITES_TO_PIPE ? "P" : "A"), NULL);
+                                   (flags & LogObject::WRITES_TO_PIPE ? "P" :
+                                    (flags & LogObject::COLUMNAR ? "C" : "A")), NULL);
 
     INK_MD5 md5s;
 
@@ -367,6 +512,7 @@ LogObject::display(FILE * fd)
   }
 #endif // TS_MICRO
   m_filter_list.display(fd);
+  m_sampler.display(fd);
   fprintf(fd, "++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
 }
 
@@ -385,7 +531,7 @@ LogObject::displayAsXML(FILE * fd, bool extended)
           "<LogObject>\n"
           "  <Mode        = \"%s\"/>\n"
           "  <Format      = \"%s\"/>\n"
-          "  <Filename    = \"%s\"/>\n", (m_flags & BINARY ? "binary" : "ascii"), m_format->name(), m_filename);
+          "  <Filename    = \"%s\"/>\n", (m_flags & BINARY ? "binary" : (m_flags & COLUMNAR ? "columnar" : "ascii")), m_format->name(), m_filename);
 
   LogFilter *filter;
   for (filter = m_filter_list.first(); filter != NULL; filter = m_filter_list.next(filter)) {
@@ -396,6 +542,7 @@ LogObject::displayAsXML(FILE * fd, bool extended)
   for (host = m_host_list.first(); host != NULL; host = m_host_list.next(host)) {
     fprintf(fd, "  <LogHostName = \"%s\"/>\n", host->name());
   }
+  m_sampler.display_as_XML(fd);
 
   fprintf(fd, "</LogObject>\n");
 }
@@ -403,11 +550,13 @@ LogObject::displayAsXML(FILE * fd, bool extended)
 
 
 LogBuffer *
-LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
+LogObject::_checkout_write(volatile head_p * head, size_t * write_offset, size_t bytes_needed) {
   LogBuffer::LB_ResultCode result_code;
   LogBuffer *buffer;
   LogBuffer *new_buffer;
   bool retry = true;
+  int cas_retries = 0;
+  int lb_retries = 0;
 
   do {
     // To avoid a race condition, we keep a count of held references in
@@ -415,14 +564,15 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
     head_p h;
     int result = 0;
     do {
-      INK_QUEUE_LD(h, m_log_buffer);
+      INK_QUEUE_LD(h, *head);
       head_p new_h;
       SET_FREELIST_POINTER_VERSION(new_h, FREELIST_POINTER(h), FREELIST_VERSION(h) + 1);
 #if TS_HAS_128BIT_CAS
-       result = ink_atomic_cas((__int128_t*) &m_log_buffer.data, h.data, new_h.data);
+       result = ink_atomic_cas((__int128_t*) &head->data, h.data, new_h.data);
 #else
-       result = ink_atomic_cas((int64_t *) &m_log_buffer.data, h.data, new_h.data);
+       result = ink_atomic_cas((int64_t *) &head->data, h.data, new_h.data);
 #endif
+      cas_retries += !result;
     } while (!result);
     buffer = (LogBuffer*)FREELIST_POINTER(h);
     result_code = buffer->checkout_write(write_offset, bytes_needed);
@@ -444,14 +594,15 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
       INK_WRITE_MEMORY_BARRIER;
       head_p old_h;
       do {
-        INK_QUEUE_LD(old_h, m_log_buffer);
+        INK_QUEUE_LD(old_h, *head);
         head_p tmp_h;
         SET_FREELIST_POINTER_VERSION(tmp_h, new_buffer, 0);
 #if TS_HAS_128BIT_CAS
-       result = ink_atomic_cas((__int128_t*) &m_log_buffer.data, old_h.data, tmp_h.data);
+       result = ink_atomic_cas((__int128_t*) &head->data, old_h.data, tmp_h.data);
 #else
-       result = ink_atomic_cas((int64_t *) &m_log_buffer.data, old_h.data, tmp_h.data);
+       result = ink_atomic_cas((int64_t *) &head->data, old_h.data, tmp_h.data);
 #endif
+        cas_retries += !result;
       } while (!result);
       if (FREELIST_POINTER(old_h) == FREELIST_POINTER(h))
         ink_atomic_increment(&buffer->m_references, FREELIST_VERSION(old_h) - 1);
@@ -469,6 +620,7 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
       // no more room, but another thread should be taking care of
       // creating a new buffer, so try again
       //
+      lb_retries++;
       break;
 
     case LogBuffer::LB_BUFFER_TOO_SMALL:
@@ -486,16 +638,17 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
     if (!decremented) {
       head_p old_h;
       do {
-        INK_QUEUE_LD(old_h, m_log_buffer);
+        INK_QUEUE_LD(old_h, *head);
         if (FREELIST_POINTER(old_h) != FREELIST_POINTER(h))
           break;
         head_p tmp_h;
         SET_FREELIST_POINTER_VERSION(tmp_h, FREELIST_POINTER(h), FREELIST_VERSION(old_h) - 1);
 #if TS_HAS_128BIT_CAS
-       result = ink_atomic_cas((__int128_t*) &m_log_buffer.data, old_h.data, tmp_h.data);
+       result = ink_atomic_cas((__int128_t*) &head->data, old_h.data, tmp_h.data);
 #else
-       result = ink_atomic_cas((int64_t *) &m_log_buffer.data, old_h.data, tmp_h.data);
+       result = ink_atomic_cas((int64_t *) &head->data, old_h.data, tmp_h.data);
 #endif
+        cas_retries += !result;
       } while (!result);
       if (FREELIST_POINTER(old_h) != FREELIST_POINTER(h))
         ink_atomic_increment(&buffer->m_references, -1);
@@ -505,6 +658,15 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
   // not want to write to the buffer
   // only to set it as full
 
+  if (cas_retries || lb_retries) {
+    EThread *t = this_ethread();
+
+    if (t) {
+      RecIncrRawStat(log_rsb, t, (int) log_stat_buffer_checkout_cas_retries_stat, cas_retries);
+      RecIncrRawStat(log_rsb, t, (int) log_stat_buffer_checkout_retries_stat, lb_retries);
+    }
+  }
+
   return buffer;
 }
 
@@ -541,6 +703,19 @@ LogObject::log(LogAccess * lad, char *text_entry)
     return Log::SKIP;
   }
 
+  if (lad && m_sampler.is_active()) {
+    switch (m_sampler.decide(lad)) {
+    case LogSampler::SAMPLED_OUT:
+      LOG_INCREMENT_DYN_STAT(log_stat_event_log_access_sampled_stat);
+      return Log::SKIP;
+    case LogSampler::RATE_LIMITED:
+      LOG_INCREMENT_DYN_STAT(log_stat_event_log_access_rate_limited_stat);
+      return Log::SKIP;
+    default:
+      break;
+    }
+  }
+
   if (lad && m_format->is_aggregate()) {
     // marshal the field data into the temp space provided by the
     // LogFormat object for aggregate formats
@@ -588,7 +763,7 @@ LogObject::log(LogAccess * lad, char *text_entry)
   }
   // Now try to place this entry in the current LogBuffer.
 
-  buffer = _checkout_write(&offset, bytes_needed);
+  buffer = _checkout_write(_work_buffer_head(), &offset, bytes_needed);
 
   if (!buffer) {
     Note("Traffic Server is skipping the current log entry for %s because "
@@ -791,7 +966,25 @@ LogObject::check_buffer_expiration(long time_now)
 {
   LogBuffer *b = (LogBuffer*)FREELIST_POINTER(m_log_buffer);
   if (b && time_now > b->expiration_time()) {
-    force_new_buffer();
+    _checkout_write(&m_log_buffer, NULL, 0);
+  }
+  for (int i = 0; i < m_num_thread_buffers; i++) {
+    b = (LogBuffer*)FREELIST_POINTER(m_thread_buffers[i].head);
+    if (b && time_now > b->expiration_time()) {
+      _checkout_write(&m_thread_buffers[i].head, NULL, 0);
+    }
+  }
+}
+
+
+void
+LogObject::force_new_buffer()
+{
+  _checkout_write(&m_log_buffer, NULL, 0);
+  for (int i = 0; i < m_num_thread_buffers; i++) {
+    if (FREELIST_POINTER(m_thread_buffers[i].head)) {
+      _checkout_write(&m_thread_buffers[i].head, NULL, 0);
+    }
   }
 }
 
@@ -1179,17 +1372,17 @@ LogObjectManager::check_buffer_expiration(long time_now)
   }
 }
 
-size_t LogObjectManager::flush_buffers()
+size_t LogObjectManager::flush_buffers(LogFlushPool *pool)
 {
   size_t i;
   size_t buffers_flushed = 0;
 
   for (i = 0; i < _numObjects; i++) {
-    buffers_flushed += _objects[i]->flush_buffers();
+    buffers_flushed += _objects[i]->flush_buffers(pool);
   }
 
   for (i = 0; i < _numAPIobjects; i++) {
-      buffers_flushed += _APIobjects[i]->flush_buffers();
+      buffers_flushed += _APIobjects[i]->flush_buffers(pool);
   }
   return buffers_flushed;
 }
@@ -1311,3 +1504,173 @@ LogObjectManager::transfer_objects(LogObjectManager & old_mgr)
     display();
   }
 }
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+
+#define LOG_BUFFER_BENCH_THREADS 4
+#define LOG_BUFFER_BENCH_ENTRIES 20000
+
+enum LogBufferBenchMode
+{
+  LOG_BUFFER_BENCH_SHARED,
+  LOG_BUFFER_BENCH_PER_THREAD,
+  LOG_BUFFER_BENCH_MODES
+};
+
+static const char *log_buffer_bench_names[] = { "shared buffer", "per-thread buffers" };
+static EventType ET_LOG_BENCH;
+
+struct LogBufferBench;
+
+struct LogBufferBenchWorker:public Continuation
+{
+  LogBufferBench *bench;
+
+  LogBufferBenchWorker():Continuation(new_ProxyMutex()), bench(NULL)
+  {
+    SET_HANDLER(&LogBufferBenchWorker::main_event);
+  }
+
+  int main_event(int event, void *edata);
+};
+
+// Logs from LOG_BUFFER_BENCH_THREADS threads at once into one
+// TextLogObject, first with every thread on the shared buffer, then
+// with per-thread buffers, and reports the time and the checkout
+// retries of each.
+struct LogBufferBench:public Continuation
+{
+  RegressionTest *t;
+  int *pstatus;
+  int mode;
+  TextLogObject *obj;
+  char *filename;
+  volatile int running;
+  volatile int failed;
+  LogBufferBenchWorker workers[LOG_BUFFER_BENCH_THREADS];
+  ink_hrtime start_time;
+  ink_hrtime elapsed[LOG_BUFFER_BENCH_MODES];
+  int64_t cas_retries[LOG_BUFFER_BENCH_MODES];
+  int64_t retries[LOG_BUFFER_BENCH_MODES];
+
+  LogBufferBench(RegressionTest *_t, int *_pstatus)
+    : Continuation(new_ProxyMutex()), t(_t), pstatus(_pstatus), mode(0), obj(NULL), filename(NULL), running(0), failed(0),
+      start_time(0)
+  {
+    for (int i = 0; i < LOG_BUFFER_BENCH_THREADS; i++) {
+      workers[i].bench = this;
+    }
+    SET_HANDLER(&LogBufferBench::main_event);
+  }
+
+  ~LogBufferBench()
+  {
+    for (int i = 0; i < LOG_BUFFER_BENCH_THREADS; i++) {
+      workers[i].mutex = NULL;
+    }
+    mutex = NULL;
+  }
+
+  int64_t thread_stat(int id)
+  {
+    int64_t sum = 0;
+
+    for (int i = 0; i < LOG_BUFFER_BENCH_THREADS; i++) {
+      sum += raw_stat_get_tlp(log_rsb, id, eventProcessor.eventthread[ET_LOG_BENCH][i])->sum;
+    }
+    return sum;
+  }
+
+  void start_mode()
+  {
+    bool per_thread_buffers = Log::config->per_thread_buffers;
+
+    Log::config->per_thread_buffers = (mode == LOG_BUFFER_BENCH_PER_THREAD);
+    obj = NEW(new TextLogObject("log_buffer_bench", Log::config->logfile_dir, false, NULL, LogConfig::NO_ROLLING));
+    Log::config->per_thread_buffers = per_thread_buffers;
+    filename = ats_strdup(obj->get_full_filename());
+
+    cas_retries[mode] = thread_stat(log_stat_buffer_checkout_cas_retries_stat);
+    retries[mode] = thread_stat(log_stat_buffer_checkout_retries_stat);
+    running = LOG_BUFFER_BENCH_THREADS;
+    start_time = ink_get_hrtime_internal();
+    for (int i = 0; i < LOG_BUFFER_BENCH_THREADS; i++) {
+      eventProcessor.eventthread[ET_LOG_BENCH][i]->schedule_imm(&workers[i]);
+    }
+  }
+
+  void finish_mode()
+  {
+    elapsed[mode] = ink_get_hrtime_internal() - start_time;
+    cas_retries[mode] = thread_stat(log_stat_buffer_checkout_cas_retries_stat) - cas_retries[mode];
+    retries[mode] = thread_stat(log_stat_buffer_checkout_retries_stat) - retries[mode];
+
+    obj->force_new_buffer();
+    delete obj;
+    obj = NULL;
+    unlink(filename);
+    ats_free(filename);
+    filename = NULL;
+  }
+
+  int main_event(int /* event ATS_UNUSED */, void * /* edata ATS_UNUSED */)
+  {
+    if (obj == NULL) {
+      start_mode();
+      return EVENT_DONE;
+    }
+
+    finish_mode();
+    if (++mode < LOG_BUFFER_BENCH_MODES) {
+      start_mode();
+      return EVENT_DONE;
+    }
+
+    TestBox tb(t, pstatus);
+    int64_t entries = (int64_t) LOG_BUFFER_BENCH_THREADS * LOG_BUFFER_BENCH_ENTRIES;
+
+    tb.check(failed == 0, "%d entries not logged", failed);
+    for (int i = 0; i < LOG_BUFFER_BENCH_MODES; i++) {
+      rprintf(t, "%s: %d ns per entry, %d CAS retries, %d buffer retries\n", log_buffer_bench_names[i],
+              (int) (elapsed[i] / entries), (int) cas_retries[i], (int) retries[i]);
+    }
+    // nothing else checks out of a thread's own buffer
+    tb.check(cas_retries[LOG_BUFFER_BENCH_PER_THREAD] == 0 && retries[LOG_BUFFER_BENCH_PER_THREAD] == 0,
+             "per-thread buffers contended");
+    rperf(t, "log_shared_buffer_ns_per_entry", (double) elapsed[LOG_BUFFER_BENCH_SHARED] / entries);
+    rperf(t, "log_per_thread_buffer_ns_per_entry", (double) elapsed[LOG_BUFFER_BENCH_PER_THREAD] / entries);
+    if (*pstatus == REGRESSION_TEST_INPROGRESS)
+      *pstatus = REGRESSION_TEST_PASSED;
+    delete this;
+    return EVENT_DONE;
+  }
+};
+
+int
+LogBufferBenchWorker::main_event(int /* event ATS_UNUSED */, void * /* edata ATS_UNUSED */)
+{
+  char entry[64];
+
+  for (int i = 0; i < LOG_BUFFER_BENCH_ENTRIES; i++) {
+    snprintf(entry, sizeof(entry), "log buffer bench entry %d", i);
+    if (bench->obj->log(NULL, entry) != Log::LOG_OK) {
+      ink_atomic_increment(&bench->failed, 1);
+    }
+  }
+  if (ink_atomic_increment(&bench->running, -1) == 1) {
+    eventProcessor.schedule_imm(bench, ET_CALL);
+  }
+  return EVENT_DONE;
+}
+
+REGRESSION_TEST(LogObject_ThreadBuffers)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  if (ET_LOG_BENCH == 0) {
+    ET_LOG_BENCH = eventProcessor.spawn_event_threads(LOG_BUFFER_BENCH_THREADS, "ET_LOG_BENCH");
+  }
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  eventProcessor.schedule_imm(NEW(new LogBufferBench(t, pstatus)), ET_CALL);
+}
+#endif /* TS_HAS_TESTS */
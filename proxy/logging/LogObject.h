@@ -31,12 +31,16 @@
 #include "LogFile.h"
 #include "LogFormat.h"
 #include "LogFilter.h"
+#include "LogSampler.h"
 #include "LogHost.h"
 #include "LogBuffer.h"
 #include "LogAccess.h"
 #include "LogFilter.h"
 #include "SimpleTokenizer.h"
 
+class LogFlushPool;
+struct LogBufferFlushOrder;
+
 /*-------------------------------------------------------------------------
   LogObject
 
@@ -52,11 +56,15 @@
 #define ASCII_LOG_OBJECT_FILENAME_EXTENSION ".log"
 #define BINARY_LOG_OBJECT_FILENAME_EXTENSION ".blog"
 #define ASCII_PIPE_OBJECT_FILENAME_EXTENSION ".pipe"
+#define COLUMNAR_LOG_OBJECT_FILENAME_EXTENSION ".clog"
 
 #define FLUSH_ARRAY_SIZE (512*4)
 
 #define LOG_OBJECT_ARRAY_DELTA 8
 
+// size of a per-thread work buffer slot, one cache line
+#define LOG_BUFFER_SLOT_SIZE 64
+
 #define ACQUIRE_API_MUTEX(_f) \
 ink_mutex_acquire(_APImutex); \
 Debug("log-api-mutex", _f)
@@ -80,6 +88,18 @@ class LogBufferManager
     }
 
     size_t flush_buffers(LogBufferSink *sink);
+    size_t flush_buffers(LogFile *file, LogFlushPool *pool);
+
+  private:
+    int _collect(LogBufferFlushOrder **order);
+};
+
+// The work buffer head of one event thread, padded so that threads
+// checking out of their own buffers do not share a cache line
+union LogBufferSlot
+{
+  volatile head_p head;
+  char pad[LOG_BUFFER_SLOT_SIZE];
 };
 
 class LogObject
@@ -89,13 +109,15 @@ public:
   {
     BINARY = 1,
     REMOTE_DATA = 2,
-    WRITES_TO_PIPE = 4
+    WRITES_TO_PIPE = 4,
+    COLUMNAR = 8
   };
 
   // BINARY: log is written in binary format (rather than ascii)
   // REMOTE_DATA: object receives data from remote collation clients, so
   //              it should not be destroyed during a reconfiguration
   // WRITES_TO_PIPE: object writes to a named pipe rather than to a file
+  // COLUMNAR: log is written in columnar format (see LogColumnar.h)
 
   LogObject(LogFormat *format, const char *log_dir, const char *basename,
                  LogFileFormat file_format, const char *header,
@@ -116,12 +138,17 @@ public:
 
   void add_to_flush_queue(LogBuffer * buffer) { m_buffer_manager.add_to_flush_queue(buffer); }
 
-  size_t flush_buffers()
+  // pool, if given, formats and writes buffers of an ASCII log file
+  size_t flush_buffers(LogFlushPool *pool = NULL)
   {
     size_t nfb;
 
     if (m_logFile) {
-      nfb = m_buffer_manager.flush_buffers(m_logFile);
+      if (pool && m_logFile->get_format() == ASCII_LOG) {
+        nfb = m_buffer_manager.flush_buffers(m_logFile, pool);
+      } else {
+        nfb = m_buffer_manager.flush_buffers(m_logFile);
+      }
     } else {
       nfb = m_buffer_manager.flush_buffers(&m_host_list);
     }
@@ -179,9 +206,7 @@ public:
 
   const char *get_format_string() { return (m_format ? m_format->format_string() : "<none>"); }
 
-  void force_new_buffer() {
-    _checkout_write(NULL, 0);
-  }
+  void force_new_buffer();
 
   bool operator==(LogObject & rhs);
   int do_filesystem_checks();
@@ -190,6 +215,7 @@ public:
   LogFormat * m_format;
   LogFile *m_logFile;
   LogFilterList m_filter_list;
+  LogSampler m_sampler;         // after the filters, before marshaling
   LogHostList m_host_list;
 
 private:
@@ -217,6 +243,9 @@ private:
   int m_ref_count;
 
   volatile head_p m_log_buffer;     // current work buffer
+  LogBufferSlot *m_thread_buffers;  // work buffer of each event thread,
+  // NULL if all threads share m_log_buffer
+  int m_num_thread_buffers;
   LogBufferManager m_buffer_manager;
 
   void generate_filenames(const char *log_dir, const char *basename, LogFileFormat file_format);
@@ -225,7 +254,9 @@ private:
   int _roll_files(long interval_start, long interval_end);
 #endif
 
-  LogBuffer *_checkout_write(size_t * write_offset, size_t write_size);
+  void _init_thread_buffers();
+  volatile head_p *_work_buffer_head();
+  LogBuffer *_checkout_write(volatile head_p * head, size_t * write_offset, size_t write_size);
 
 private:
   // -- member functions not allowed --
@@ -369,7 +400,7 @@ public:
   void display(FILE * str = stdout);
   void add_filter_to_all(LogFilter * filter);
   LogObject *find_by_format_name(const char *name);
-  size_t flush_buffers();
+  size_t flush_buffers(LogFlushPool *pool = NULL);
   void open_local_pipes();
   void transfer_objects(LogObjectManager & mgr);
 
@@ -441,6 +472,7 @@ LogObject::operator==(LogObject & old)
              m_logFile && old.m_logFile &&
              strcmp(m_logFile->get_name(), old.m_logFile->get_name()) == 0) &&
             (m_filter_list == old.m_filter_list) &&
+            (m_sampler == old.m_sampler) &&
             (m_rolling_interval_sec == old.m_rolling_interval_sec &&
              m_rolling_offset_hr == old.m_rolling_offset_hr && m_rolling_size_mb == old.m_rolling_size_mb));
   }
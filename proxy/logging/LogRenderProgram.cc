@@ -0,0 +1,403 @@
+/** @file
+
+  Precompiled rendering of custom log formats to ASCII
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/***************************************************************************
+ LogRenderProgram.cc
+
+
+ ***************************************************************************/
+#include "libts.h"
+
+#include "Error.h"
+#include "LogAccess.h"
+#include "LogField.h"
+#include "LogFormat.h"
+#include "LogBuffer.h"
+#include "LogUtils.h"
+#include "LogRenderProgram.h"
+
+static const char render_digit_pairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// Same output as LogAccess::unmarshal_itoa(), which prints values
+// below one as "0", written straight into dest.
+static inline int
+render_int(int64_t val, char *dest, int len)
+{
+  char tmp[24];
+  char *p = tmp + sizeof(tmp);
+  uint64_t v = (val > 0) ? (uint64_t) val : 0;
+
+  while (v >= 100) {
+    unsigned i = (unsigned) (v % 100) * 2;
+    v /= 100;
+    *--p = render_digit_pairs[i + 1];
+    *--p = render_digit_pairs[i];
+  }
+  if (v >= 10) {
+    *--p = render_digit_pairs[v * 2 + 1];
+    *--p = render_digit_pairs[v * 2];
+  } else {
+    *--p = (char) ('0' + v);
+  }
+
+  int n = (int) (tmp + sizeof(tmp) - p);
+  if (n < len) {
+    memcpy(dest, p, n);
+    return n;
+  }
+  return -1;
+}
+
+static inline int
+render_timestamp_str(const char *str, char *dest, int len)
+{
+  int n = (int)::strlen(str);
+
+  if (n < len) {
+    memcpy(dest, str, n);
+    return n;
+  }
+  return -1;
+}
+
+LogRenderProgram::LogRenderProgram(const char *symbol_str, const char *printf_str)
+  : m_literals(ats_strdup(printf_str)), m_ops(NULL), m_num_ops(0)
+{
+  bool contains_aggregates = false;
+  LogFormat::parse_symbol_string(symbol_str, &m_fieldlist, &contains_aggregates);
+
+  // at most one literal and one field op per marker, plus a literal
+  int n_markers = 0;
+  for (const char *p = m_literals; *p; ++p) {
+    if (*p == LOG_FIELD_MARKER)
+      ++n_markers;
+  }
+  m_ops = (Op *) ats_malloc((2 * n_markers + 1) * sizeof(Op));
+
+  LogField *field = m_fieldlist.first();
+  char *lit = m_literals;
+  char *p;
+
+  for (p = m_literals; *p; ++p) {
+    if (*p != LOG_FIELD_MARKER)
+      continue;
+
+    if (p > lit) {
+      Op & op = m_ops[m_num_ops++];
+      op.type = OP_LITERAL;
+      op.literal = lit;
+      op.len = (int) (p - lit);
+      op.field = NULL;
+    }
+    lit = p + 1;
+
+    Op & op = m_ops[m_num_ops++];
+    op.literal = NULL;
+    op.len = 0;
+    op.field = field;
+    if (field == NULL) {
+      op.type = OP_TOO_FEW_FIELDS;
+      return;
+    }
+
+    const char *sym = field->symbol();
+    LogField::UnmarshalFunc f = field->unmarshal_func();
+
+    if (field->aggregate() == LogField::NO_AGGREGATE && strcmp(sym, "cqts") == 0) {
+      op.type = OP_TS_SEC;
+    } else if (field->aggregate() == LogField::NO_AGGREGATE && strcmp(sym, "cqth") == 0) {
+      op.type = OP_TS_HEX;
+    } else if (field->aggregate() == LogField::NO_AGGREGATE && strcmp(sym, "cqtq") == 0) {
+      op.type = OP_TS_SQUID;
+    } else if (field->aggregate() == LogField::NO_AGGREGATE && strcmp(sym, "cqtn") == 0) {
+      op.type = OP_TS_NETSCAPE;
+    } else if (field->aggregate() == LogField::NO_AGGREGATE && strcmp(sym, "cqtd") == 0) {
+      op.type = OP_TS_DATE;
+    } else if (field->aggregate() == LogField::NO_AGGREGATE && strcmp(sym, "cqtt") == 0) {
+      op.type = OP_TS_TIME;
+    } else if (f == &LogAccess::unmarshal_int_to_str) {
+      op.type = OP_INT;
+    } else if (f == &LogAccess::unmarshal_str) {
+      op.type = OP_STR;
+    } else {
+      op.type = OP_FIELD;
+    }
+    field = m_fieldlist.next(field);
+  }
+
+  if (p > lit) {
+    Op & op = m_ops[m_num_ops++];
+    op.type = OP_LITERAL;
+    op.literal = lit;
+    op.len = (int) (p - lit);
+    op.field = NULL;
+  }
+}
+
+LogRenderProgram::~LogRenderProgram()
+{
+  ats_free(m_ops);
+  ats_free(m_literals);
+}
+
+int
+LogRenderProgram::render(LogEntryHeader * entry, char *buf, int buf_len, unsigned buffer_version)
+{
+  char *read_from = (char *) entry + sizeof(LogEntryHeader);
+  long timestamp = entry->timestamp;
+  int ts_skip = (buffer_version > 1) ? INK_MIN_ALIGN : 0;
+  int bytes_written = 0;
+
+  for (int i = 0; i < m_num_ops; i++) {
+    const Op & op = m_ops[i];
+    char *to = &buf[bytes_written];
+    int len = buf_len - bytes_written;
+    int res;
+
+    switch (op.type) {
+    case OP_LITERAL:
+      if (bytes_written + op.len >= buf_len) {
+        res = -1;
+        break;
+      }
+      memcpy(to, op.literal, op.len);
+      res = op.len;
+      break;
+
+    case OP_INT:
+      res = render_int(*((int64_t *) read_from), to, len);
+      read_from += INK_MIN_ALIGN;
+      break;
+
+    case OP_STR:
+      res = (int)::strlen(read_from);
+      if (res < len) {
+        memcpy(to, read_from, res);
+      } else {
+        res = -1;
+      }
+      read_from += LogAccess::strlen(read_from);
+      break;
+
+    case OP_FIELD:
+      res = op.field->unmarshal(&read_from, to, len);
+      break;
+
+    case OP_TS_SEC:
+      res = render_int(timestamp, to, len);
+      read_from += ts_skip;
+      break;
+
+    case OP_TS_HEX:
+      {
+        char *ptr = (char *) &timestamp;
+        res = LogAccess::unmarshal_int_to_str_hex(&ptr, to, len);
+        read_from += ts_skip;
+      }
+      break;
+
+    case OP_TS_SQUID:
+      res = squid_timestamp_to_buf(to, len, timestamp, entry->timestamp_usec);
+      if (res < 0)
+        res = -1;
+      read_from += ts_skip;
+      break;
+
+    case OP_TS_NETSCAPE:
+      res = render_timestamp_str(LogUtils::timestamp_to_netscape_str(timestamp), to, len);
+      read_from += ts_skip;
+      break;
+
+    case OP_TS_DATE:
+      res = render_timestamp_str(LogUtils::timestamp_to_date_str(timestamp), to, len);
+      read_from += ts_skip;
+      break;
+
+    case OP_TS_TIME:
+      res = render_timestamp_str(LogUtils::timestamp_to_time_str(timestamp), to, len);
+      read_from += ts_skip;
+      break;
+
+    case OP_TOO_FEW_FIELDS:
+    default:
+      Note("There are more field markers than fields;" " cannot process log entry");
+      return 0;
+    }
+
+    if (res < 0) {
+      Note("Traffic Server is skipping the current log entry because its size "
+           "exceeds the maximum line (entry) size for an ascii log buffer");
+      return 0;
+    }
+    bytes_written += res;
+  }
+
+  return bytes_written;
+}
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+#include "LogAccessTest.h"
+#include "LogObject.h"
+#include "LogConfig.h"
+#include "Log.h"
+
+#define LOG_RENDER_TEST_ROUNDS 200
+
+static ink_hrtime
+log_render_time(LogRenderProgram *program, LogBufferHeader *h, char *buf, bool compiled)
+{
+  ink_hrtime start = ink_get_hrtime_internal();
+  LogEntryHeader *e;
+
+  for (int r = 0; r < LOG_RENDER_TEST_ROUNDS; r++) {
+    LogBufferIterator iter(h);
+
+    while ((e = iter.next())) {
+      if (compiled) {
+        program->render(e, buf, LOG_MAX_FORMATTED_LINE, h->version);
+      } else {
+        LogBuffer::resolve_custom_entry(program->fieldlist(), h->fmt_printf(), (char *) e + sizeof(LogEntryHeader),
+                                        buf, LOG_MAX_FORMATTED_LINE, e->timestamp, e->timestamp_usec, h->version);
+      }
+    }
+  }
+  return ink_get_hrtime_internal() - start;
+}
+
+// Renders a buffer of LogAccessTest entries in each predefined format,
+// and one using every timestamp field, through the interpreter and the
+// compiled program; the output must be the same byte for byte.
+REGRESSION_TEST(LogRenderProgram_Formats)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  const struct
+  {
+    const char *name;
+    const char *format;
+  } formats[] = {
+    { "squid", LogFormat::squid_format },
+    { "common", LogFormat::common_format },
+    { "extended", LogFormat::extended_format },
+    { "extended2", LogFormat::extended2_format },
+    { "timestamps", "%<cqts> %<cqth> %<cqtq> %<cqtd> %<cqtt> [%<cqtn>] %<ttms> \"%<cqu>\" %<shn> %<chi>" },
+  };
+  TestBox tb(t, pstatus);
+  LogAccessTest lad;
+  char *interpreted = (char *) ats_malloc(LOG_MAX_FORMATTED_LINE);
+  char *compiled = (char *) ats_malloc(LOG_MAX_FORMATTED_LINE);
+  char tag[128];
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  for (unsigned i = 0; i < countof(formats); i++) {
+    LogFormat format(formats[i].name, formats[i].format);
+    LogObject obj(&format, Log::config->logfile_dir, "log_render_test", ASCII_LOG, NULL, LogConfig::NO_ROLLING);
+    LogBuffer *lb = NEW(new LogBuffer(&obj, Log::config->log_buffer_size));
+    size_t entry_bytes = format.m_field_list.marshal_len(&lad);
+    size_t offset;
+    int entries = 0;
+
+    while (lb->checkout_write(&offset, entry_bytes) == LogBuffer::LB_OK) {
+      format.m_field_list.marshal(&lad, &(*lb)[offset]);
+      lb->checkin_write(offset);
+      ++entries;
+    }
+    lb->update_header_data();
+
+    LogBufferHeader *h = lb->header();
+    LogRenderProgram *program = LogBuffer::render_program(h->fmt_fieldlist(), h->fmt_printf());
+    LogEntryHeader *e;
+    int mismatches = 0;
+    int bytes = 0;
+
+    tb.check(program != NULL, "%s: no render program", formats[i].name);
+    if (program == NULL || entries == 0) {
+      delete lb;
+      continue;
+    }
+
+    {
+      LogBufferIterator iter(h);
+
+      while ((e = iter.next())) {
+        int n = LogBuffer::resolve_custom_entry(program->fieldlist(), h->fmt_printf(), (char *) e + sizeof(LogEntryHeader),
+                                                interpreted, LOG_MAX_FORMATTED_LINE, e->timestamp, e->timestamp_usec,
+                                                h->version);
+        int m = program->render(e, compiled, LOG_MAX_FORMATTED_LINE, h->version);
+
+        if (n <= 0 || n != m || memcmp(interpreted, compiled, n) != 0) {
+          ++mismatches;
+        }
+        bytes = m;
+      }
+    }
+    tb.check(mismatches == 0, "%s: %d of %d entries rendered differently", formats[i].name, mismatches, entries);
+    // and an entry that barely fits, or does not, is treated the same
+    e = (LogEntryHeader *) ((char *) h + h->data_offset);
+    for (int len = bytes - 2; len <= bytes + 1; len++) {
+      int n = LogBuffer::resolve_custom_entry(program->fieldlist(), h->fmt_printf(), (char *) e + sizeof(LogEntryHeader),
+                                              interpreted, len, e->timestamp, e->timestamp_usec, h->version);
+      int m = program->render(e, compiled, len, h->version);
+
+      tb.check(n == m, "%s: %d bytes rendered into %d, %d interpreted", formats[i].name, m, len, n);
+    }
+
+    // best of three, the box may be busy with other threads
+    ink_hrtime interpreted_time = 0, compiled_time = 0;
+    for (int k = 0; k < 3; k++) {
+      ink_hrtime ti = log_render_time(program, h, interpreted, false);
+      ink_hrtime tc = log_render_time(program, h, compiled, true);
+
+      if (k == 0 || ti < interpreted_time)
+        interpreted_time = ti;
+      if (k == 0 || tc < compiled_time)
+        compiled_time = tc;
+    }
+
+    int64_t rendered = (int64_t) entries * LOG_RENDER_TEST_ROUNDS;
+    double interpreted_eps = (double) rendered * HRTIME_SECOND / (interpreted_time ? interpreted_time : 1);
+    double compiled_eps = (double) rendered * HRTIME_SECOND / (compiled_time ? compiled_time : 1);
+
+    rprintf(t, "%s: %d entries, interpreted %d ns, compiled %d ns per entry\n", formats[i].name, entries,
+            (int) (interpreted_time / rendered), (int) (compiled_time / rendered));
+    snprintf(tag, sizeof(tag), "log_render_%s_interpreted_entries_per_sec", formats[i].name);
+    rperf(t, tag, interpreted_eps);
+    snprintf(tag, sizeof(tag), "log_render_%s_compiled_entries_per_sec", formats[i].name);
+    rperf(t, tag, compiled_eps);
+
+    delete lb;
+  }
+  ats_free(interpreted);
+  ats_free(compiled);
+}
+#endif /* TS_HAS_TESTS */
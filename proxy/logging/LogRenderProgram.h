@@ -0,0 +1,100 @@
+/** @file
+
+  Precompiled rendering of custom log formats to ASCII
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+   LogRenderProgram.h
+
+   Description:
+     LogBuffer::resolve_custom_entry() interprets the printf string of a
+     format for every entry, and LogBuffer::resolve_field() compares each
+     field's symbol against the timestamp symbols before unmarshaling
+     it.  A LogRenderProgram does that work once per (fieldlist, printf)
+     pair: the printf string is split into literal segments, and each
+     field gets an op saying how to unmarshal it, with integers and
+     strings handled inline.  Its output is identical to
+     resolve_custom_entry() without an alternate format.
+
+     Programs are cached by LogBuffer::render_program() under the symbol
+     and printf strings found in buffer headers; LogObject compiles the
+     program for its own format when it is created.
+
+ ****************************************************************************/
+
+#ifndef LOG_RENDER_PROGRAM_H
+#define LOG_RENDER_PROGRAM_H
+
+#include "libts.h"
+#include "LogField.h"
+
+struct LogEntryHeader;
+
+class LogRenderProgram
+{
+public:
+  enum OpType
+  {
+    OP_LITERAL,
+    OP_INT,                     // LogAccess::unmarshal_int_to_str
+    OP_STR,                     // LogAccess::unmarshal_str
+    OP_FIELD,                   // LogField::unmarshal
+    OP_TS_SEC,                  // cqts, and the rest from the entry header
+    OP_TS_HEX,                  // cqth
+    OP_TS_SQUID,                // cqtq
+    OP_TS_NETSCAPE,             // cqtn
+    OP_TS_DATE,                 // cqtd
+    OP_TS_TIME,                 // cqtt
+    OP_TOO_FEW_FIELDS           // more markers than fields
+  };
+
+  struct Op
+  {
+    OpType type;
+    int len;                    // OP_LITERAL
+    const char *literal;        // OP_LITERAL, into m_literals
+    LogField *field;
+  };
+
+  LogRenderProgram(const char *symbol_str, const char *printf_str);
+  ~LogRenderProgram();
+
+  /** Render @a entry into the @a buf_len bytes at @a buf.
+      @return the number of bytes written, 0 if the entry does not fit.
+  */
+  int render(LogEntryHeader * entry, char *buf, int buf_len, unsigned buffer_version);
+
+  LogFieldList *fieldlist() { return &m_fieldlist; }
+  int num_ops() const { return m_num_ops; }
+
+private:
+  LogFieldList m_fieldlist;
+  char *m_literals;             // the printf string
+  Op *m_ops;
+  int m_num_ops;
+
+  // -- member functions not allowed --
+  LogRenderProgram(const LogRenderProgram &);
+  LogRenderProgram & operator=(const LogRenderProgram &);
+};
+
+#endif
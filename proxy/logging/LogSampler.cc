@@ -0,0 +1,280 @@
+/** @file
+
+  Sampling and rate limits for a LogObject
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+#include "LogAccess.h"
+#include "LogField.h"
+#include "LogSampler.h"
+
+// sample keys are marshaled on the stack up to this size
+#define LOG_SAMPLER_STACK_KEY 512
+
+/*-------------------------------------------------------------------------
+  LogSampler::LogSampler
+  -------------------------------------------------------------------------*/
+
+LogSampler::LogSampler()
+  : m_key(NULL), m_threshold(0), m_per_sec(0), m_burst(0), m_interval(0), m_tolerance(0), m_full(0),
+    m_sampled_out(0), m_rate_limited(0)
+{
+}
+
+LogSampler::LogSampler(const LogSampler & rhs)
+  : m_key(NULL), m_threshold(0), m_per_sec(0), m_burst(0), m_interval(0), m_tolerance(0), m_full(0),
+    m_sampled_out(0), m_rate_limited(0)
+{
+  if (rhs.m_key) {
+    set_sample_rate(rhs.sample_rate(), rhs.m_key);
+  }
+  set_rate_limit(rhs.m_per_sec, rhs.m_burst);
+}
+
+LogSampler::~LogSampler()
+{
+  delete m_key;
+}
+
+void
+LogSampler::set_sample_rate(double rate, LogField * key)
+{
+  delete m_key;
+  m_key = NULL;
+  m_threshold = 0;
+  if (key && rate < 1.0) {
+    m_key = NEW(new LogField(*key));
+    m_threshold = rate > 0.0 ? (uint64_t) (rate * 4294967296.0) : 0;
+  }
+}
+
+void
+LogSampler::set_rate_limit(int64_t per_sec, int64_t burst)
+{
+  if (per_sec <= 0) {
+    m_per_sec = m_burst = 0;
+    m_interval = m_tolerance = 0;
+    return;
+  }
+  m_per_sec = per_sec;
+  m_burst = burst > 0 ? burst : per_sec;
+  m_interval = HRTIME_SECOND / per_sec;
+  if (m_interval == 0) {
+    m_interval = 1;
+  }
+  m_tolerance = m_burst * m_interval;
+  m_full = 0;
+}
+
+/*-------------------------------------------------------------------------
+  LogSampler::key_hash
+
+  FNV-1a over the marshaled key, finished with the MurmurHash3 mixer so
+  that the high bits, which the threshold looks at, depend on all of it.
+  -------------------------------------------------------------------------*/
+
+uint32_t
+LogSampler::key_hash(LogAccess * lad)
+{
+  char stack_key[LOG_SAMPLER_STACK_KEY];
+  unsigned len = m_key->marshal_len(lad);
+  char *key = len <= sizeof(stack_key) ? stack_key : (char *) ats_malloc(len);
+  uint64_t h = 14695981039346656037ULL;
+
+  // strings hash up to their null, other fields in full with the padding zeroed
+  memset(key, 0, len);
+  m_key->marshal(lad, key);
+  if (m_key->type() == LogField::STRING) {
+    len = strnlen(key, len);
+  }
+  for (unsigned i = 0; i < len; i++) {
+    h = (h ^ (unsigned char) key[i]) * 1099511628211ULL;
+  }
+  if (key != stack_key) {
+    ats_free(key);
+  }
+
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (uint32_t) (h >> 32);
+}
+
+/*-------------------------------------------------------------------------
+  LogSampler::decide
+  -------------------------------------------------------------------------*/
+
+LogSampler::Decision
+LogSampler::decide(LogAccess * lad, ink_hrtime now)
+{
+  if (m_key && key_hash(lad) >= m_threshold) {
+    ink_atomic_increment(&m_sampled_out, 1);
+    return SAMPLED_OUT;
+  }
+
+  if (m_interval) {
+    int64_t full, next;
+
+    // each entry takes a token, that is, puts off the time the bucket is
+    // full by an interval; the bucket is empty once that is a burst away
+    do {
+      full = m_full;
+      next = (full > now ? full : now) + m_interval;
+      if (next - now > m_tolerance) {
+        ink_atomic_increment(&m_rate_limited, 1);
+        return RATE_LIMITED;
+      }
+    } while (!ink_atomic_cas(&m_full, full, next));
+  }
+  return KEEP;
+}
+
+bool
+LogSampler::operator==(const LogSampler & rhs) const
+{
+  if ((m_key == NULL) != (rhs.m_key == NULL)) {
+    return false;
+  }
+  if (m_key && (m_threshold != rhs.m_threshold || !(*m_key == *rhs.m_key))) {
+    return false;
+  }
+  return m_per_sec == rhs.m_per_sec && m_burst == rhs.m_burst;
+}
+
+/*-------------------------------------------------------------------------
+  LogSampler::display
+  -------------------------------------------------------------------------*/
+
+void
+LogSampler::display(FILE * fd)
+{
+  if (m_key) {
+    fprintf(fd, "sample rate = %g of %s, %" PRId64 " sampled out\n", sample_rate(), m_key->symbol(), m_sampled_out);
+  }
+  if (m_interval) {
+    fprintf(fd, "rate limit = %" PRId64 "/s, burst %" PRId64 ", %" PRId64 " rate limited\n", m_per_sec, m_burst,
+            m_rate_limited);
+  }
+}
+
+void
+LogSampler::display_as_XML(FILE * fd)
+{
+  if (m_key) {
+    fprintf(fd, "  <SampleRate  = \"%g\"/>\n" "  <SampleKey   = \"%s\"/>\n", sample_rate(), m_key->symbol());
+  }
+  if (m_interval) {
+    fprintf(fd, "  <RateLimit   = \"%" PRId64 "\"/>\n" "  <RateLimitBurst = \"%" PRId64 "\"/>\n", m_per_sec, m_burst);
+  }
+}
+
+#if TS_HAS_TESTS
+#include "Regression.h"
+#include "TestBox.h"
+#include "LogAccessTest.h"
+#include "Log.h"
+
+#define LOG_SAMPLER_TEST_ENTRIES 20000
+
+// Samples by client and by URL, checking the fraction kept and that a
+// key always gets the same answer, then runs entries through a rate
+// limit on a clock of its own.
+REGRESSION_TEST(LogSampler_Decide)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  const char *keys[] = { "chi", "cqu" };
+  TestBox tb(t, pstatus);
+  LogAccessTestSpread lad;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  for (unsigned i = 0; i < countof(keys); i++) {
+    LogSampler sampler;
+    char decisions[200];
+    int kept = 0, flips = 0;
+    ink_hrtime start;
+
+    sampler.set_sample_rate(0.1, Log::global_field_list.find_by_symbol(keys[i]));
+    tb.check(sampler.is_active(), "%s: sampler not active", keys[i]);
+    start = ink_get_hrtime_internal();
+    for (lad.n = 0; lad.n < LOG_SAMPLER_TEST_ENTRIES; lad.n++) {
+      LogSampler::Decision d = sampler.decide(&lad, 0);
+
+      // the first 200 clients come round again, and so do their decisions
+      if (lad.n < 200) {
+        decisions[lad.n] = d;
+      } else if (i == 0 && decisions[lad.n % 200] != d) {
+        ++flips;
+      }
+      if (d == LogSampler::KEEP) {
+        ++kept;
+      }
+    }
+    start = ink_get_hrtime_internal() - start;
+
+    tb.check(flips == 0, "%s: %d entries decided unlike others of the same key", keys[i], flips);
+    tb.check(kept > LOG_SAMPLER_TEST_ENTRIES / 20 && kept < LOG_SAMPLER_TEST_ENTRIES * 3 / 20,
+             "%s: kept %d of %d entries at a rate of 0.1", keys[i], kept, LOG_SAMPLER_TEST_ENTRIES);
+    tb.check(sampler.sampled_out() == LOG_SAMPLER_TEST_ENTRIES - kept, "%s: %d sampled out, counted %d", keys[i],
+             LOG_SAMPLER_TEST_ENTRIES - kept, (int) sampler.sampled_out());
+
+    LogSampler copy(sampler);
+
+    tb.check(copy == sampler && copy.sampled_out() == 0, "%s: copy differs", keys[i]);
+    rprintf(t, "%s: kept %d of %d entries, %d ns/entry\n", keys[i], kept, LOG_SAMPLER_TEST_ENTRIES,
+            (int) (start / LOG_SAMPLER_TEST_ENTRIES));
+    if (i == 1) {
+      rperf(t, "log_sampler_ns_per_entry", (double) start / LOG_SAMPLER_TEST_ENTRIES);
+    }
+  }
+
+  // 1000 entries a second, bursts of 100, offered 10000 a second for 10 seconds
+  LogSampler limiter;
+  ink_hrtime now = HRTIME_SECONDS(1000);
+  int kept = 0, burst = 0;
+
+  limiter.set_rate_limit(1000, 100);
+  tb.check(!(limiter == LogSampler()), "rate limit makes no difference");
+  for (int n = 0; n < 100000; n++, now += HRTIME_USECONDS(100)) {
+    if (limiter.decide(&lad, now) == LogSampler::KEEP) {
+      ++kept;
+      if (n < 100) {
+        ++burst;
+      }
+    }
+  }
+  tb.check(burst == 100, "kept %d of a burst of 100", burst);
+  tb.check(kept >= 100 + 9999 && kept <= 100 + 10000, "kept %d entries over 10 s at 1000/s", kept);
+  tb.check(limiter.rate_limited() == 100000 - kept, "%d entries limited, counted %d", 100000 - kept,
+           (int) limiter.rate_limited());
+
+  // the bucket fills up again while idle, but no further than the burst
+  now += HRTIME_SECONDS(60);
+  kept = 0;
+  for (int n = 0; n < 1000; n++) {
+    if (limiter.decide(&lad, now) == LogSampler::KEEP) {
+      ++kept;
+    }
+  }
+  tb.check(kept == 100, "kept %d entries after a minute idle", kept);
+  rprintf(t, "rate limit: %d of 100000 entries limited\n", (int) limiter.rate_limited());
+}
+#endif /* TS_HAS_TESTS */
@@ -0,0 +1,113 @@
+/** @file
+
+  Sampling and rate limits for a LogObject
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+   LogSampler.h
+
+   Description:
+     Filters decide which entries a LogObject wants; a LogSampler decides
+     how many of those it can afford, before any field but the sample key
+     is marshaled.  Set from the SampleRate, SampleKey, RateLimit and
+     RateLimitBurst tags of a LogObject in logs_xml.config.
+
+     Sampling hashes the SampleKey field of the entry and keeps the
+     SampleRate fraction of the hash space, so a given key (a cache key,
+     a client) is always all in or all out, on every host.
+
+     The rate limit is a token bucket of RateLimitBurst entries filling
+     at RateLimit entries per second, kept as the time at which the
+     bucket will be full again so that one compare-and-swap updates it.
+
+     Every entry turned away is counted, per object and in the
+     proxy.process.log.event_log_access_sampled and
+     proxy.process.log.event_log_access_rate_limited stats.
+
+ ****************************************************************************/
+
+#ifndef LOG_SAMPLER_H
+#define LOG_SAMPLER_H
+
+#include "libts.h"
+
+class LogAccess;
+class LogField;
+
+class LogSampler
+{
+public:
+  enum Decision
+  {
+    KEEP = 0,
+    SAMPLED_OUT,
+    RATE_LIMITED
+  };
+
+  LogSampler();
+  LogSampler(const LogSampler & rhs);   // same settings, counts start over
+  ~LogSampler();
+
+  /** Keep @a rate (0 to 1) of the entries, chosen by the value of
+      @a key.  A rate of 1 or more turns sampling off.
+  */
+  void set_sample_rate(double rate, LogField * key);
+  /** Keep at most @a per_sec entries a second, with bursts of up to
+      @a burst; 0 turns the limit off, and @a burst defaults to a
+      second's worth.
+  */
+  void set_rate_limit(int64_t per_sec, int64_t burst = 0);
+
+  bool is_active() const { return m_key != NULL || m_interval != 0; }
+
+  Decision decide(LogAccess * lad) { return decide(lad, ink_get_hrtime_internal()); }
+  Decision decide(LogAccess * lad, ink_hrtime now);
+
+  double sample_rate() const { return m_key ? (double) m_threshold / 4294967296.0 : 1.0; }
+  int64_t rate_limit() const { return m_per_sec; }
+  int64_t rate_limit_burst() const { return m_burst; }
+  int64_t sampled_out() const { return m_sampled_out; }
+  int64_t rate_limited() const { return m_rate_limited; }
+
+  bool operator==(const LogSampler & rhs) const;
+
+  void display(FILE * fd = stdout);
+  void display_as_XML(FILE * fd = stdout);
+
+private:
+  uint32_t key_hash(LogAccess * lad);
+
+  LogField *m_key;              // NULL if not sampling
+  uint64_t m_threshold;         // keep hashes below this, out of 2^32
+  int64_t m_per_sec;
+  int64_t m_burst;
+  ink_hrtime m_interval;        // between tokens, 0 if not limiting
+  ink_hrtime m_tolerance;       // how far ahead of now m_full may run
+  volatile int64_t m_full;      // when the bucket is full again
+  volatile int64_t m_sampled_out;
+  volatile int64_t m_rate_limited;
+
+  // -- member functions not allowed --
+  LogSampler & operator=(const LogSampler &);
+};
+
+#endif
@@ -32,6 +32,7 @@
 #include "LogStandalone.cc"
 
 #include "LogObject.h"
+#include "LogColumnar.h"
 #include "hdrs/HTTP.h"
 
 #include <math.h>
@@ -1644,6 +1645,23 @@ parse_log_buff(LogBufferHeader * buf_header, bool summary = false)
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Parse a buffer, unless it is too old (the entire buffer is skipped)
+static int
+process_buffer(LogBufferHeader * header, unsigned max_age)
+{
+  if (header->high_timestamp >= max_age) {
+    if (parse_log_buff(header, cl.summary != 0) != 0) {
+      Debug("logstats", "Failed to parse log buffer.");
+      return 1;
+    }
+  } else {
+    Debug("logstats", "Skipping old buffer (age=%d, max=%d)", header->high_timestamp, max_age);
+  }
+  return 0;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Process a file (FD)
 int
@@ -1651,6 +1669,7 @@ process_file(int in_fd, off_t offset, unsigned max_age)
 {
   char buffer[MAX_LOGBUFFER_SIZE];
   int nread, buffer_bytes;
+  static LogColumnarReader columnar;
 
   Debug("logstats", "Processing file [offset=%" PRId64 "].", (int64_t)offset);
   while (true) {
@@ -1678,7 +1697,7 @@ process_file(int in_fd, off_t offset, unsigned max_age)
           return 0;
         }
         // ensure that this is a valid logbuffer header
-        if (header->cookie && (LOG_SEGMENT_COOKIE == header->cookie)) {
+        if (header->cookie && (LOG_SEGMENT_COOKIE == header->cookie || LOG_COLUMNAR_COOKIE == header->cookie)) {
           offset = 0;
           break;
         }
@@ -1693,12 +1712,26 @@ process_file(int in_fd, off_t offset, unsigned max_age)
         return 0;
 
       // ensure that this is a valid logbuffer header
-      if (header->cookie != LOG_SEGMENT_COOKIE) {
+      if (header->cookie != LOG_SEGMENT_COOKIE && header->cookie != LOG_COLUMNAR_COOKIE) {
         Debug("logstats", "Invalid segment cookie (expected %d, got %d)", LOG_SEGMENT_COOKIE, header->cookie);
         return 1;
       }
     }
 
+    // a block of a columnar log gives back the LogBuffer it was written from
+    if (LOG_COLUMNAR_COOKIE == header->cookie) {
+      LogBufferHeader *rebuilt;
+
+      if (columnar.read(in_fd, buffer, first_read_size) < 0 || (rebuilt = columnar.decode()) == NULL) {
+        Debug("logstats", "Failed to read columnar log block.");
+        return 1;
+      }
+      if (process_buffer(rebuilt, max_age) != 0) {
+        return 1;
+      }
+      continue;
+    }
+
     Debug("logstats", "LogBuffer version %d, current = %d", header->version, LOG_SEGMENT_VERSION);
     if (header->version != LOG_SEGMENT_VERSION)
       return 1;
@@ -1729,14 +1762,8 @@ process_file(int in_fd, off_t offset, unsigned max_age)
       return 1;
     }
 
-    // Possibly skip too old entries (the entire buffer is skipped)
-    if (header->high_timestamp >= max_age) {
-      if (parse_log_buff(header, cl.summary != 0) != 0) {
-        Debug("logstats", "Failed to parse log buffer.");
-        return 1;
-      }
-    } else {
-      Debug("logstats", "Skipping old buffer (age=%d, max=%d)", header->high_timestamp, max_age);
+    if (process_buffer(header, max_age) != 0) {
+      return 1;
     }
   }
 